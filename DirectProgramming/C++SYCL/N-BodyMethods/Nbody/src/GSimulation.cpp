@@ -10,8 +10,18 @@
 // e.g., $ONEAPI_ROOT/dev-utilities/latest/include/dpc_common.hpp
 #include "dpc_common.hpp"
 
+#include "Octree.hpp"
+
 using namespace sycl;
 
+// Size of the work-groups, which is also the size of the tiles of j-particles
+// of the SoA force kernel
+constexpr int kWorkGroupSize = 128;
+
+constexpr float kSofteningSquared = 1e-3f;
+// prevents explosion in the case the particles are really close to each other
+constexpr float kG = 6.67259e-11f;
+
 /* Default Constructor for the GSimulation class which sets up the default
  * values for number of particles, number of integration steps, time steo and
  * sample frequency */
@@ -24,6 +34,11 @@ GSimulation::GSimulation() {
   set_nsteps(10);
   set_tstep(0.1);
   set_sfreq(1);
+  SetLayout(Layout::kAoS);
+  SetCompareLayouts(false);
+  SetSolver(Solver::kDirect);
+  SetOpeningAngle(0.5);
+  SetCrossover(false);
 }
 
 /* Set the number of particles */
@@ -32,6 +47,24 @@ void GSimulation::SetNumberOfParticles(int N) { set_npart(N); }
 /* Set the number of integration steps */
 void GSimulation::SetNumberOfSteps(int N) { set_nsteps(N); }
 
+/* Set the storage layout of the particles */
+void GSimulation::SetLayout(Layout layout) { layout_ = layout; }
+
+/* Run the simulation with both layouts, and compare them */
+void GSimulation::SetCompareLayouts(bool compare) {
+  compare_layouts_ = compare;
+}
+
+/* Set the solver computing the accelerations */
+void GSimulation::SetSolver(Solver solver) { solver_ = solver; }
+
+/* Set the opening angle of the Barnes-Hut tree code */
+void GSimulation::SetOpeningAngle(RealType theta) { theta_ = theta; }
+
+/* Compare the solvers for increasing numbers of particles instead of running
+ * the simulation */
+void GSimulation::SetCrossover(bool crossover) { crossover_ = crossover; }
+
 /* Initialize the position of all the particles using random number generator
  * between 0 and 1.0 */
 void GSimulation::InitPos() {
@@ -82,48 +115,92 @@ void GSimulation::InitMass() {
   }
 }
 
-/* This function does the simulation logic for Nbody */
-void GSimulation::Start() {
-  RealType dt = get_tstep();
-  int n = get_npart();
-  particles_.resize(n);
+/* Initialize all the particles */
+void GSimulation::InitParticles() {
+  particles_.resize(get_npart());
 
   InitPos();
   InitVel();
   InitAcc();
   InitMass();
+}
 
-  PrintHeader();
-
-  total_time_ = 0.;
-
-  constexpr float kSofteningSquared = 1e-3f;
-  // prevents explosion in the case the particles are really close to each other
-  constexpr float kG = 6.67259e-11f;
+/* Run the integration steps, calling step(energy) to submit the kernels of a
+ * step, which adds twice the kinetic energy of the particles to "energy".
+ * Prints the time and performance of the steps, and returns the average
+ * performance in GFLOPS */
+template <typename StepFunc>
+double GSimulation::RunSteps(queue &q, StepFunc step) {
+  int n = get_npart();
   double gflops = 1e-9 * ((11. + 18.) * n * n + n * 19.);
   int nf = 0;
   double av = 0.0, dev = 0.0;
+  // Allocate energy using USM allocator shared
+  RealType *energy = malloc_shared<RealType>(1, q);
+  *energy = 0.f;
+
+  total_time_ = 0.;
+
+  dpc_common::TimeInterval t0;
+  int nsteps = get_nsteps();
+  // Looping across integration steps
+  for (int s = 1; s <= nsteps; ++s) {
+    dpc_common::TimeInterval ts0;
+    step(energy);
+    kenergy_ = 0.5 * (*energy);
+    *energy = 0.f;
+    double elapsed_seconds = ts0.Elapsed();
+    if ((s % get_sfreq()) == 0) {
+      nf += 1;
+      std::cout << " " << std::left << std::setw(8) << s << std::left
+                << std::setprecision(5) << std::setw(8) << s * get_tstep()
+                << std::left << std::setprecision(5) << std::setw(12)
+                << kenergy_ << std::left << std::setprecision(5)
+                << std::setw(12) << elapsed_seconds << std::left
+                << std::setprecision(5) << std::setw(12)
+                << gflops * get_sfreq() / elapsed_seconds << "\n";
+      if (nf > 2) {
+        av += gflops * get_sfreq() / elapsed_seconds;
+        dev += gflops * get_sfreq() * gflops * get_sfreq() /
+               (elapsed_seconds * elapsed_seconds);
+      }
+    }
+
+  }  // end of the time step loop
+  total_time_ = t0.Elapsed();
+  total_flops_ = gflops * get_nsteps();
+  av /= (double)(nf - 2);
+  dev = sqrt(dev / (double)(nf - 2) - av * av);
+  sycl::free(energy, q);
+
+  std::cout << "\n";
+  std::cout << "# Total Time (s)     : " << total_time_ << "\n";
+  std::cout << "# Average Performance : " << av << " +- " << dev << "\n";
+  std::cout << "==============================="
+            << "\n";
+  return av;
+}
+
+/* This function does the simulation logic for Nbody, with the particles
+ * stored as an array of Particle structures */
+double GSimulation::StartAoS(queue &q) {
+  RealType dt = get_tstep();
+  int n = get_npart();
+
+  InitParticles();
+  PrintHeader("AoS");
+
   // Create global range
   auto r = range<1>(n);
   // Create local range
-  auto lr = range<1>(128);
+  auto lr = range<1>(kWorkGroupSize);
   // Create ndrange 
   auto ndrange = nd_range<1>(r, lr);
-  // Create a queue to the selected device and enabled asynchronous exception
-  // handling for that queue
-  queue q(default_selector_v);
   // Create SYCL buffer for the Particle array of size "n"
   buffer pbuf(particles_.data(), r,
               {sycl::property::buffer::use_host_ptr()});
-  // Allocate energy using USM allocator shared
-  RealType *energy = malloc_shared<RealType>(1,q);
-  *energy = 0.f;
 
-  dpc_common::TimeInterval t0;
-  int nsteps = get_nsteps();
-  // Looping across integration steps
-  for (int s = 1; s <= nsteps; ++s) {
-    dpc_common::TimeInterval ts0;
+  return RunSteps(q, [&](RealType *energy) {
     // Submitting first kernel to device which computes acceleration of all
     // particles
     q.submit([&](handler& h) {
@@ -182,43 +259,329 @@ void GSimulation::Start() {
                  p[i].vel[2] * p[i].vel[2]));  // 7flops
        });
      }).wait_and_throw();
-    kenergy_ = 0.5 * (*energy);
-    *energy = 0.f;
-    double elapsed_seconds = ts0.Elapsed();
-    if ((s % get_sfreq()) == 0) {
-      nf += 1;
-      std::cout << " " << std::left << std::setw(8) << s << std::left
-                << std::setprecision(5) << std::setw(8) << s * get_tstep()
-                << std::left << std::setprecision(5) << std::setw(12)
-                << kenergy_ << std::left << std::setprecision(5)
-                << std::setw(12) << elapsed_seconds << std::left
-                << std::setprecision(5) << std::setw(12)
-                << gflops * get_sfreq() / elapsed_seconds << "\n";
-      if (nf > 2) {
-        av += gflops * get_sfreq() / elapsed_seconds;
-        dev += gflops * get_sfreq() * gflops * get_sfreq() /
-               (elapsed_seconds * elapsed_seconds);
+  });
+}
+
+/* Allocate the 10 arrays of n particles in the SoA layout, in a single device
+ * allocation which is returned */
+static RealType *AllocateSoA(queue &q, int n, ParticleSoA &p) {
+  RealType *storage = malloc_device<RealType>(10 * n, q);
+  for (int k = 0; k < 3; k++) {
+    p.pos[k] = storage + k * n;
+    p.vel[k] = storage + (3 + k) * n;
+    p.acc[k] = storage + (6 + k) * n;
+  }
+  p.mass = storage + 9 * n;
+  return storage;
+}
+
+/* Copy the particles to the device, one component at a time */
+static void CopyToDevice(queue &q, const std::vector<Particle> &particles,
+                         const ParticleSoA &p) {
+  int n = particles.size();
+  std::vector<RealType> component(n);
+  auto copy_to_device = [&](RealType *dst, auto get) {
+    for (int i = 0; i < n; i++) component[i] = get(particles[i]);
+    q.memcpy(dst, component.data(), n * sizeof(RealType)).wait();
+  };
+  for (int k = 0; k < 3; k++) {
+    copy_to_device(p.pos[k], [=](const Particle &pi) { return pi.pos[k]; });
+    copy_to_device(p.vel[k], [=](const Particle &pi) { return pi.vel[k]; });
+    copy_to_device(p.acc[k], [=](const Particle &pi) { return pi.acc[k]; });
+  }
+  copy_to_device(p.mass, [](const Particle &pi) { return pi.mass; });
+}
+
+/* Copy the particles back to the host */
+static void CopyToHost(queue &q, const ParticleSoA &p,
+                       std::vector<Particle> &particles) {
+  int n = particles.size();
+  std::vector<RealType> component(n);
+  auto copy_to_host = [&](const RealType *src, auto set) {
+    q.memcpy(component.data(), src, n * sizeof(RealType)).wait();
+    for (int i = 0; i < n; i++) set(particles[i], component[i]);
+  };
+  for (int k = 0; k < 3; k++) {
+    copy_to_host(p.pos[k], [=](Particle &pi, RealType v) { pi.pos[k] = v; });
+    copy_to_host(p.vel[k], [=](Particle &pi, RealType v) { pi.vel[k] = v; });
+    copy_to_host(p.acc[k], [=](Particle &pi, RealType v) { pi.acc[k] = v; });
+  }
+}
+
+/* Submit the kernel which computes the acceleration of all the particles in
+ * the SoA layout. The j-particles are processed by tiles of one work-group
+ * size: each work-item stages one j-particle of the tile in local memory,
+ * and all the work-items of the work-group then read the whole tile from
+ * local memory */
+static void SubmitTiledForces(queue &q, const ParticleSoA &p, int n) {
+  auto lr = range<1>(kWorkGroupSize);
+  auto ndrange = nd_range<1>(range<1>(n), lr);
+
+  q.submit([&](handler& h) {
+    // Position and mass of the tile of j-particles
+    local_accessor<RealType, 1> tile_x(lr, h);
+    local_accessor<RealType, 1> tile_y(lr, h);
+    local_accessor<RealType, 1> tile_z(lr, h);
+    local_accessor<RealType, 1> tile_mass(lr, h);
+
+    h.parallel_for(ndrange, [=](nd_item<1> it) {
+      auto i = it.get_global_id(0);
+      auto li = it.get_local_id(0);
+      RealType pos0 = p.pos[0][i];
+      RealType pos1 = p.pos[1][i];
+      RealType pos2 = p.pos[2][i];
+      RealType acc0 = p.acc[0][i];
+      RealType acc1 = p.acc[1][i];
+      RealType acc2 = p.acc[2][i];
+      for (int tile = 0; tile < n; tile += kWorkGroupSize) {
+        // Stage the tile in local memory
+        tile_x[li] = p.pos[0][tile + li];
+        tile_y[li] = p.pos[1][tile + li];
+        tile_z[li] = p.pos[2][tile + li];
+        tile_mass[li] = p.mass[tile + li];
+        group_barrier(it.get_group());
+
+        for (int j = 0; j < kWorkGroupSize; j++) {
+          RealType dx, dy, dz;
+          RealType distance_sqr = 0.0f;
+          RealType distance_inv = 0.0f;
+
+          dx = tile_x[j] - pos0;  // 1flop
+          dy = tile_y[j] - pos1;  // 1flop
+          dz = tile_z[j] - pos2;  // 1flop
+
+          distance_sqr =
+              dx * dx + dy * dy + dz * dz + kSofteningSquared;  // 6flops
+          distance_inv = 1.0f / sycl::sqrt(distance_sqr);  // 1div+1sqrt
+
+          acc0 += dx * kG * tile_mass[j] * distance_inv * distance_inv *
+                  distance_inv;  // 6flops
+          acc1 += dy * kG * tile_mass[j] * distance_inv * distance_inv *
+                  distance_inv;  // 6flops
+          acc2 += dz * kG * tile_mass[j] * distance_inv * distance_inv *
+                  distance_inv;  // 6flops
+        }
+        // Wait for all the work-items before overwriting the tile
+        group_barrier(it.get_group());
       }
+      p.acc[0][i] = acc0;
+      p.acc[1][i] = acc1;
+      p.acc[2][i] = acc2;
+    });
+  }).wait_and_throw();
+}
+
+/* Submit the kernel which updates the velocity and position of all the
+ * particles in the SoA layout, and adds twice their kinetic energy to
+ * "energy" */
+static void SubmitSoAUpdate(queue &q, const ParticleSoA &p, int n,
+                            RealType dt, RealType *energy) {
+  auto ndrange = nd_range<1>(range<1>(n), range<1>(kWorkGroupSize));
+
+  q.submit([&](handler& h) {
+    h.parallel_for(ndrange, reduction(energy, 0.f, std::plus<RealType>()),
+                   [=](nd_item<1> it, auto& energy) {
+      auto i = it.get_global_id(0);
+
+      p.vel[0][i] += p.acc[0][i] * dt;  // 2flops
+      p.vel[1][i] += p.acc[1][i] * dt;  // 2flops
+      p.vel[2][i] += p.acc[2][i] * dt;  // 2flops
+
+      p.pos[0][i] += p.vel[0][i] * dt;  // 2flops
+      p.pos[1][i] += p.vel[1][i] * dt;  // 2flops
+      p.pos[2][i] += p.vel[2][i] * dt;  // 2flops
+
+      p.acc[0][i] = 0.f;
+      p.acc[1][i] = 0.f;
+      p.acc[2][i] = 0.f;
+
+      energy += (p.mass[i] *
+                 (p.vel[0][i] * p.vel[0][i] + p.vel[1][i] * p.vel[1][i] +
+                  p.vel[2][i] * p.vel[2][i]));  // 7flops
+    });
+  }).wait_and_throw();
+}
+
+/* This function does the simulation logic for Nbody, with the particles
+ * stored in the structure-of-arrays layout. The accelerations are computed
+ * either by the tiled all-pairs kernel, or by the Barnes-Hut tree code (see
+ * Octree.hpp). The particles are copied back to "particles_" at the end of
+ * the simulation */
+double GSimulation::StartSoA(queue &q, Solver solver) {
+  RealType dt = get_tstep();
+  int n = get_npart();
+
+  InitParticles();
+  PrintHeader(solver == Solver::kTree ? "SoA, Barnes-Hut" : "SoA, tiled");
+
+  ParticleSoA p;
+  RealType *storage = AllocateSoA(q, n, p);
+  CopyToDevice(q, particles_, p);
+
+  std::unique_ptr<Octree> tree;
+  if (solver == Solver::kTree) {
+    std::cout << " theta = " << theta_
+              << "; GFLOPS are the all-pairs FLOPS per second\n";
+    tree = std::make_unique<Octree>(q, n);
+  }
+
+  double av = RunSteps(q, [&](RealType *energy) {
+    // Compute the acceleration of all particles
+    if (tree)
+      tree->ComputeAccelerations(p, theta_, kSofteningSquared, kG);
+    else
+      SubmitTiledForces(q, p, n);
+    // Update the velocity and position for all particles
+    SubmitSoAUpdate(q, p, n, dt, energy);
+  });
+
+  CopyToHost(q, p, particles_);
+
+  sycl::free(storage, q);
+  return av;
+}
+
+/* This function compares the Barnes-Hut tree code with the tiled all-pairs
+ * kernel, for numbers of particles doubling from 1024 to the number of
+ * particles of the simulation. It reports the time of one evaluation of the
+ * accelerations with each solver, the relative RMS error of the tree code,
+ * and the first number of particles for which the tree code is faster */
+void GSimulation::RunCrossover(queue &q) {
+  int npart = get_npart();
+  int crossover = 0;
+
+  std::cout << " theta = " << theta_ << "\n";
+  std::cout << "------------------------------------------------------------"
+            << "\n";
+  std::cout << " " << std::left << std::setw(10) << "nPart" << std::left
+            << std::setw(14) << "direct (s)" << std::left << std::setw(14)
+            << "tree (s)" << std::left << std::setw(10) << "speedup"
+            << std::left << std::setw(12) << "rel. error"
+            << "\n";
+  std::cout << "------------------------------------------------------------"
+            << "\n";
+
+  for (int n = 1024; n <= npart; n *= 2) {
+    set_npart(n);
+    InitParticles();
+
+    ParticleSoA p;
+    RealType *storage = AllocateSoA(q, n, p);
+    CopyToDevice(q, particles_, p);
+    Octree tree(q, n);
+
+    // Accelerations of the particles with each solver, the first run of each
+    // solver being a warm-up
+    std::vector<RealType> acc_direct(3 * n), acc_tree(3 * n);
+    double time_direct = 0.0, time_tree = 0.0;
+    for (int run = 0; run < 2; run++) {
+      q.memset(p.acc[0], 0, 3 * n * sizeof(RealType)).wait();
+      dpc_common::TimeInterval t_direct;
+      SubmitTiledForces(q, p, n);
+      time_direct = t_direct.Elapsed();
+
+      q.memset(p.acc[0], 0, 3 * n * sizeof(RealType)).wait();
+      dpc_common::TimeInterval t_tree;
+      tree.ComputeAccelerations(p, theta_, kSofteningSquared, kG);
+      time_tree = t_tree.Elapsed();
     }
+    q.memcpy(acc_tree.data(), p.acc[0], 3 * n * sizeof(RealType)).wait();
+    q.memset(p.acc[0], 0, 3 * n * sizeof(RealType)).wait();
+    SubmitTiledForces(q, p, n);
+    q.memcpy(acc_direct.data(), p.acc[0], 3 * n * sizeof(RealType)).wait();
 
-  }  // end of the time step loop
-  total_time_ = t0.Elapsed();
-  total_flops_ = gflops * get_nsteps();
-  av /= (double)(nf - 2);
-  dev = sqrt(dev / (double)(nf - 2) - av * av);
+    double error = 0.0, norm = 0.0;
+    for (int i = 0; i < 3 * n; i++) {
+      double diff = acc_tree[i] - acc_direct[i];
+      error += diff * diff;
+      norm += static_cast<double>(acc_direct[i]) * acc_direct[i];
+    }
+
+    std::cout << " " << std::left << std::setw(10) << n << std::left
+              << std::setprecision(5) << std::setw(14) << time_direct
+              << std::left << std::setprecision(5) << std::setw(14)
+              << time_tree << std::left << std::setprecision(5)
+              << std::setw(10) << time_direct / time_tree << std::left
+              << std::setprecision(5) << std::setw(12)
+              << std::sqrt(error / norm) << "\n";
+
+    if (crossover == 0 && time_tree < time_direct) crossover = n;
+    sycl::free(storage, q);
+  }
+  set_npart(npart);
 
   std::cout << "\n";
-  std::cout << "# Total Time (s)     : " << total_time_ << "\n";
-  std::cout << "# Average Performance : " << av << " +- " << dev << "\n";
+  if (crossover > 0)
+    std::cout << "# The tree code beats all-pairs from " << crossover
+              << " particles\n";
+  else
+    std::cout << "# The tree code does not beat all-pairs up to " << npart
+              << " particles\n";
+  std::cout << "==============================="
+            << "\n";
+}
+
+/* This function runs the simulation with the selected layout and solver, or
+ * with both layouts from the same initial state to compare their
+ * performance, or the comparison of the solvers */
+void GSimulation::Start() {
+  // Create a queue to the selected device and enabled asynchronous exception
+  // handling for that queue
+  queue q(default_selector_v);
+
+  if (crossover_) {
+    RunCrossover(q);
+    return;
+  }
+
+  // The kernels of both layouts run in work-groups of kWorkGroupSize
+  // particles, and the tiled kernel reads whole tiles of that size, so the
+  // size is checked before running any of them
+  if (get_npart() % kWorkGroupSize != 0) {
+    std::cout << "The number of particles must be a multiple of "
+              << kWorkGroupSize << "\n";
+    return;
+  }
+
+  if (!compare_layouts_) {
+    if (solver_ == Solver::kTree)
+      StartSoA(q, Solver::kTree);
+    else if (layout_ == Layout::kAoS)
+      StartAoS(q);
+    else
+      StartSoA(q, Solver::kDirect);
+    return;
+  }
+
+  double av_aos = StartAoS(q);
+  std::vector<Particle> aos_particles = particles_;
+  double av_soa = StartSoA(q, Solver::kDirect);
+
+  // Both layouts compute the forces in the same order, so the final positions
+  // only differ by rounding
+  RealType max_diff = 0.f;
+  for (int i = 0; i < get_npart(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      max_diff = std::max(
+          max_diff, std::fabs(particles_[i].pos[k] - aos_particles[i].pos[k]));
+    }
+  }
+
+  std::cout << "# AoS Performance (GFLOPS)        : " << av_aos << "\n";
+  std::cout << "# SoA tiled Performance (GFLOPS)  : " << av_soa << "\n";
+  std::cout << "# Speedup                         : " << av_soa / av_aos
+            << "\n";
+  std::cout << "# Max position difference         : " << max_diff << "\n";
   std::cout << "==============================="
             << "\n";
 }
 
 /* Print the headers for the output */
-void GSimulation::PrintHeader() {
+void GSimulation::PrintHeader(const char *layout) {
   std::cout << " nPart = " << get_npart() << "; "
             << "nSteps = " << get_nsteps() << "; "
-            << "dt = " << get_tstep() << "\n";
+            << "dt = " << get_tstep() << "; "
+            << "layout = " << layout << "\n";
 
   std::cout << "------------------------------------------------"
             << "\n";
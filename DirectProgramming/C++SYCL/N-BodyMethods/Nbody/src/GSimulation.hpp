@@ -8,10 +8,12 @@
 #define _GSIMULATION_HPP
 
 #include <sycl/sycl.hpp>
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <string>
@@ -19,6 +21,18 @@
 
 #include "Particle.hpp"
 
+// Storage layout of the particles on the device
+enum class Layout {
+  kAoS,  // array of Particle structures
+  kSoA   // one array per component of the particles, see ParticleSoA
+};
+
+// Solver computing the accelerations of the particles
+enum class Solver {
+  kDirect,  // all-pairs, O(N^2)
+  kTree     // Barnes-Hut tree code, O(N log N), see Octree.hpp
+};
+
 class GSimulation {
  public:
   GSimulation();
@@ -26,6 +40,11 @@ class GSimulation {
   void Init();
   void SetNumberOfParticles(int N);
   void SetNumberOfSteps(int N);
+  void SetLayout(Layout layout);
+  void SetCompareLayouts(bool compare);
+  void SetSolver(Solver solver);
+  void SetOpeningAngle(RealType theta);
+  void SetCrossover(bool crossover);
   void Start();
 
  private:
@@ -37,6 +56,12 @@ class GSimulation {
 
   int sfreq_;  // sample frequency
 
+  Layout layout_;          // storage layout of the particles
+  bool compare_layouts_;   // run both layouts and compare them
+  Solver solver_;          // solver computing the accelerations
+  RealType theta_;         // opening angle of the tree code
+  bool crossover_;         // compare the solvers for increasing sizes
+
   RealType kenergy_;  // kinetic energy
 
   double total_time_;   // total time of the simulation
@@ -46,6 +71,13 @@ class GSimulation {
   void InitVel();
   void InitAcc();
   void InitMass();
+  void InitParticles();
+
+  double StartAoS(sycl::queue &q);
+  double StartSoA(sycl::queue &q, Solver solver);
+  void RunCrossover(sycl::queue &q);
+  template <typename StepFunc>
+  double RunSteps(sycl::queue &q, StepFunc step);
 
   void set_npart(const int &N) { npart_ = N; }
   int get_npart() const { return npart_; }
@@ -59,7 +91,7 @@ class GSimulation {
   void set_sfreq(const int &sf) { sfreq_ = sf; }
   int get_sfreq() const { return sfreq_; }
 
-  void PrintHeader();
+  void PrintHeader(const char *layout);
 };
 
 #endif
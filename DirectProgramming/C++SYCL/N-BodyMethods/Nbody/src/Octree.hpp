@@ -0,0 +1,417 @@
+//==============================================================
+// Copyright © 2020 Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef _OCTREE_HPP
+#define _OCTREE_HPP
+
+#include <sycl/sycl.hpp>
+#include <algorithm>
+#include <cstdint>
+
+#include "Particle.hpp"
+
+// Barnes-Hut tree code, computing the accelerations of the particles in
+// O(N log N) instead of O(N^2).
+//
+// At each step, the tree is rebuilt on the device:
+// 1. The particles are sorted by the Morton code of their position in the
+//    bounding cube of the particles (kOctreeMaxLevel bits per axis).
+// 2. The nodes of level l of the octree are the runs of sorted particles that
+//    share the first 3 * l bits of their Morton code. A node is identified by
+//    its level and its first particle, so that the nodes of all the levels are
+//    found in parallel without any compaction: node (l, p) exists if the
+//    prefix of particle p differs from the one of particle p - 1 and its
+//    parent is not a leaf, and its last particle is found by a binary search
+//    in the sorted codes.
+// 3. The centre of mass of each node is computed level by level, from the
+//    deepest level that has nodes up to the root, from the particles of the
+//    leaves and from the children of the other nodes.
+// 4. Each particle traverses the tree from the root: a node that is seen
+//    under an angle below the opening angle theta (cell size / distance)
+//    acts as a single particle at its centre of mass. Else the particles of
+//    a leaf are summed directly, and the children of the other nodes are
+//    visited.
+
+// Depth of the octree, 10 bits per axis in 30-bit Morton codes
+constexpr int kOctreeMaxLevel = 10;
+constexpr int kOctreeLevels = kOctreeMaxLevel + 1;
+
+// Nodes with this number of particles or less are not subdivided
+constexpr int kOctreeLeafSize = 16;
+
+// Each node that is opened replaces itself by at most 8 children on the
+// traversal stack
+constexpr int kOctreeStackSize = 7 * kOctreeMaxLevel + 8;
+
+// Centre of mass and total mass of a node
+struct NodeCom {
+  RealType x, y, z;
+  RealType mass;
+};
+
+// Spreads the 10 low bits of v, with two zero bits between consecutive bits
+inline uint32_t ExpandBits(uint32_t v) {
+  v = (v * 0x00010001u) & 0xFF0000FFu;
+  v = (v * 0x00000101u) & 0x0F00F00Fu;
+  v = (v * 0x00000011u) & 0xC30C30C3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+// Morton code of a position, in a bounding cube starting at (min_x, min_y,
+// min_z) whose inverse size is inv_box_size
+inline uint32_t MortonCode(RealType x, RealType y, RealType z, RealType min_x,
+                           RealType min_y, RealType min_z,
+                           RealType inv_box_size) {
+  auto cell = [=](RealType v, RealType v_min) {
+    int c = static_cast<int>((v - v_min) * inv_box_size *
+                             (1 << kOctreeMaxLevel));
+    return static_cast<uint32_t>(
+        std::min(std::max(c, 0), (1 << kOctreeMaxLevel) - 1));
+  };
+  return (ExpandBits(cell(x, min_x)) << 2) |
+         (ExpandBits(cell(y, min_y)) << 1) | ExpandBits(cell(z, min_z));
+}
+
+// Nodes that are not subdivided
+inline bool IsLeaf(int level, int count) {
+  return level == kOctreeMaxLevel || count <= kOctreeLeafSize;
+}
+
+// Returns the first and the end of the run of the n sorted codes that share
+// the prefix of particle p at this level
+inline int RunStart(const uint32_t *codes, int level, int p) {
+  int shift = 3 * (kOctreeMaxLevel - level);
+  uint32_t prefix = codes[p] >> shift;
+  int lo = 0, hi = p;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if ((codes[mid] >> shift) < prefix)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+inline int RunEnd(const uint32_t *codes, int n, int level, int p) {
+  int shift = 3 * (kOctreeMaxLevel - level);
+  uint32_t prefix = codes[p] >> shift;
+  int lo = p + 1, hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if ((codes[mid] >> shift) == prefix)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Returns the end of node (level, p) of the n sorted codes, or 0 if no node
+// of this level starts at particle p. The runs below a leaf are not nodes:
+// the counts of the ancestors of a node are at least the count of its
+// parent, so all of them are subdivided if the parent is.
+inline int NodeEnd(const uint32_t *codes, int n, int level, int p) {
+  int shift = 3 * (kOctreeMaxLevel - level);
+  if (p > 0 && (codes[p - 1] >> shift) == (codes[p] >> shift)) return 0;
+
+  if (level > 0) {
+    int parent_count =
+        RunEnd(codes, n, level - 1, p) - RunStart(codes, level - 1, p);
+    if (IsLeaf(level - 1, parent_count)) return 0;
+  }
+  return RunEnd(codes, n, level, p);
+}
+
+// Computes the centre of mass of node (level, p), from its particles if it is
+// a leaf, else from its children. node_end and node_com hold the nodes of
+// all the levels, the nodes of level l starting at index l * n.
+inline void ComputeNodeCom(int n, int level, int p, const int *node_end,
+                           NodeCom *node_com, const RealType *x,
+                           const RealType *y, const RealType *z,
+                           const RealType *mass) {
+  int node = level * n + p;
+  int end = node_end[node];
+  if (end == 0) return;
+
+  RealType m = 0.f, mx = 0.f, my = 0.f, mz = 0.f;
+  if (IsLeaf(level, end - p)) {
+    for (int j = p; j < end; j++) {
+      m += mass[j];
+      mx += mass[j] * x[j];
+      my += mass[j] * y[j];
+      mz += mass[j] * z[j];
+    }
+  } else {
+    int children = (level + 1) * n;
+    for (int q = p; q < end; q = node_end[children + q]) {
+      const NodeCom &c = node_com[children + q];
+      m += c.mass;
+      mx += c.mass * c.x;
+      my += c.mass * c.y;
+      mz += c.mass * c.z;
+    }
+  }
+
+  if (m > 0.f)
+    node_com[node] = {mx / m, my / m, mz / m, m};
+  else
+    node_com[node] = {x[p], y[p], z[p], 0.f};
+}
+
+// Adds the acceleration of a particle at distance (dx, dy, dz) from a mass m
+inline void AddAcceleration(RealType dx, RealType dy, RealType dz, RealType m,
+                            RealType softening_sqr, RealType g,
+                            RealType *acc) {
+  RealType distance_sqr = dx * dx + dy * dy + dz * dz + softening_sqr;
+  RealType distance_inv = 1.0f / sycl::sqrt(distance_sqr);
+  RealType s = g * m * distance_inv * distance_inv * distance_inv;
+  acc[0] += dx * s;
+  acc[1] += dy * s;
+  acc[2] += dz * s;
+}
+
+// Computes the acceleration of sorted particle i by traversing the tree
+inline void TreeAcceleration(int n, int i, const int *node_end,
+                             const NodeCom *node_com, const RealType *x,
+                             const RealType *y, const RealType *z,
+                             const RealType *mass, RealType box_size,
+                             RealType theta_sqr, RealType softening_sqr,
+                             RealType g, RealType *acc) {
+  RealType xi = x[i], yi = y[i], zi = z[i];
+
+  // Stack of the nodes to visit, starting with the root
+  int stack[kOctreeStackSize];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    int node = stack[--top];
+    int level = node / n;
+    int p = node - level * n;
+    int end = node_end[node];
+
+    // Far enough nodes act as a single particle at their centre of mass
+    const NodeCom &c = node_com[node];
+    RealType dx = c.x - xi, dy = c.y - yi, dz = c.z - zi;
+    RealType size = box_size / (1 << level);
+    if (size * size < theta_sqr * (dx * dx + dy * dy + dz * dz)) {
+      AddAcceleration(dx, dy, dz, c.mass, softening_sqr, g, acc);
+      continue;
+    }
+
+    // The particles of the opened leaves are summed directly
+    if (IsLeaf(level, end - p)) {
+      for (int j = p; j < end; j++) {
+        AddAcceleration(x[j] - xi, y[j] - yi, z[j] - zi, mass[j],
+                        softening_sqr, g, acc);
+      }
+      continue;
+    }
+
+    int children = (level + 1) * n;
+    for (int q = p; q < end; q = node_end[children + q]) {
+      stack[top++] = children + q;
+    }
+  }
+}
+
+// Device-side octree of n particles stored in the SoA layout, with the
+// buffers needed to rebuild it at every step
+class Octree {
+ public:
+  Octree(sycl::queue &q, int n)
+      : q_(q.get_context(), q.get_device(), sycl::property::queue::in_order()),
+        n_(n) {
+    n_pad_ = 1;
+    while (n_pad_ < n_) n_pad_ <<= 1;
+
+    keys_ = sycl::malloc_device<uint64_t>(n_pad_, q_);
+    codes_ = sycl::malloc_device<uint32_t>(n_, q_);
+    order_ = sycl::malloc_device<int>(n_, q_);
+    sorted_ = sycl::malloc_device<RealType>(4 * n_, q_);
+    node_end_ = sycl::malloc_device<int>(kOctreeLevels * n_, q_);
+    node_com_ = sycl::malloc_device<NodeCom>(kOctreeLevels * n_, q_);
+    box_ = sycl::malloc_shared<RealType>(6, q_);
+    depth_ = sycl::malloc_shared<int>(1, q_);
+  }
+
+  ~Octree() {
+    sycl::free(keys_, q_);
+    sycl::free(codes_, q_);
+    sycl::free(order_, q_);
+    sycl::free(sorted_, q_);
+    sycl::free(node_end_, q_);
+    sycl::free(node_com_, q_);
+    sycl::free(box_, q_);
+    sycl::free(depth_, q_);
+  }
+
+  Octree(const Octree &) = delete;
+  Octree &operator=(const Octree &) = delete;
+
+  // Adds the accelerations of the particles p, computed with the opening
+  // angle theta, to p.acc
+  void ComputeAccelerations(ParticleSoA p, RealType theta,
+                            RealType softening_sqr, RealType g) {
+    Build(p);
+    Traverse(p, theta, softening_sqr, g);
+    q_.wait_and_throw();
+  }
+
+ private:
+  sycl::queue q_;
+  int n_;
+  int n_pad_;  // n_ rounded up to a power of 2 for the sort
+
+  uint64_t *keys_;     // Morton code and index of the particles
+  uint32_t *codes_;    // sorted Morton codes
+  int *order_;         // index of the sorted particles
+  RealType *sorted_;   // x, y, z and mass of the sorted particles
+  int *node_end_;      // end of the nodes of each level, see NodeEnd
+  NodeCom *node_com_;  // centre of mass of the nodes of each level
+  RealType *box_;      // bounding box: min x, y, z, max x, y, z
+  int *depth_;         // deepest level that has nodes
+
+  RealType box_size_;
+
+  void Build(ParticleSoA p) {
+    int n = n_, n_pad = n_pad_;
+
+    // Bounding box of the particles
+    q_.submit([&](sycl::handler &h) {
+      auto init = sycl::property::reduction::initialize_to_identity();
+      auto px = p.pos[0], py = p.pos[1], pz = p.pos[2];
+      h.parallel_for(
+          sycl::range<1>(n),
+          sycl::reduction(box_ + 0, sycl::minimum<RealType>(), init),
+          sycl::reduction(box_ + 1, sycl::minimum<RealType>(), init),
+          sycl::reduction(box_ + 2, sycl::minimum<RealType>(), init),
+          sycl::reduction(box_ + 3, sycl::maximum<RealType>(), init),
+          sycl::reduction(box_ + 4, sycl::maximum<RealType>(), init),
+          sycl::reduction(box_ + 5, sycl::maximum<RealType>(), init),
+          [=](sycl::id<1> i, auto &min_x, auto &min_y, auto &min_z,
+              auto &max_x, auto &max_y, auto &max_z) {
+            min_x.combine(px[i]);
+            min_y.combine(py[i]);
+            min_z.combine(pz[i]);
+            max_x.combine(px[i]);
+            max_y.combine(py[i]);
+            max_z.combine(pz[i]);
+          });
+    });
+    q_.wait_and_throw();
+
+    // Bounding cube, slightly enlarged so that no particle is on its upper
+    // faces
+    RealType min_x = box_[0], min_y = box_[1], min_z = box_[2];
+    RealType extent = std::max(
+        {box_[3] - box_[0], box_[4] - box_[1], box_[5] - box_[2], 1e-6f});
+    box_size_ = extent * 1.0001f;
+    RealType inv_box_size = 1.0f / box_size_;
+
+    // Morton codes, with the padding keys sorted after the particles
+    auto keys = keys_;
+    q_.parallel_for(sycl::range<1>(n_pad), [=](sycl::id<1> idx) {
+      int i = idx[0];
+      if (i < n) {
+        uint64_t code = MortonCode(p.pos[0][i], p.pos[1][i], p.pos[2][i],
+                                   min_x, min_y, min_z, inv_box_size);
+        keys[i] = (code << 32) | static_cast<uint64_t>(i);
+      } else {
+        keys[i] = UINT64_MAX;
+      }
+    });
+
+    // Bitonic sort of the keys
+    for (int k = 2; k <= n_pad; k <<= 1) {
+      for (int j = k >> 1; j > 0; j >>= 1) {
+        q_.parallel_for(sycl::range<1>(n_pad), [=](sycl::id<1> idx) {
+          size_t i = idx[0];
+          size_t l = i ^ j;
+          if (l > i) {
+            bool ascending = (i & k) == 0;
+            if ((keys[i] > keys[l]) == ascending) {
+              uint64_t t = keys[i];
+              keys[i] = keys[l];
+              keys[l] = t;
+            }
+          }
+        });
+      }
+    }
+
+    // Gather the sorted particles
+    auto codes = codes_;
+    auto order = order_;
+    auto sorted = sorted_;
+    q_.parallel_for(sycl::range<1>(n), [=](sycl::id<1> idx) {
+      int i = idx[0];
+      int index = static_cast<int>(keys[i] & 0xFFFFFFFFu);
+      codes[i] = static_cast<uint32_t>(keys[i] >> 32);
+      order[i] = index;
+      sorted[i] = p.pos[0][index];
+      sorted[n + i] = p.pos[1][index];
+      sorted[2 * n + i] = p.pos[2][index];
+      sorted[3 * n + i] = p.mass[index];
+    });
+
+    // Nodes of all the levels, and the deepest level that has nodes
+    auto node_end = node_end_;
+    q_.submit([&](sycl::handler &h) {
+      auto init = sycl::property::reduction::initialize_to_identity();
+      h.parallel_for(
+          sycl::range<2>(kOctreeLevels, n),
+          sycl::reduction(depth_, sycl::maximum<int>(), init),
+          [=](sycl::id<2> idx, auto &depth) {
+            int level = idx[0], q = idx[1];
+            int end = NodeEnd(codes, n, level, q);
+            node_end[level * n + q] = end;
+            if (end != 0) depth.combine(level);
+          });
+    });
+    q_.wait_and_throw();
+
+    // Centres of mass, from the deepest level that has nodes up to the root.
+    // The levels below are only made of the runs below the leaves, which are
+    // never visited.
+    auto node_com = node_com_;
+    for (int level = *depth_; level >= 0; level--) {
+      q_.parallel_for(sycl::range<1>(n), [=](sycl::id<1> idx) {
+        ComputeNodeCom(n, level, idx[0], node_end, node_com, sorted, sorted + n,
+                       sorted + 2 * n, sorted + 3 * n);
+      });
+    }
+  }
+
+  void Traverse(ParticleSoA p, RealType theta, RealType softening_sqr,
+                RealType g) {
+    int n = n_;
+    auto order = order_;
+    auto sorted = sorted_;
+    auto node_end = node_end_;
+    auto node_com = node_com_;
+    RealType box_size = box_size_;
+    RealType theta_sqr = theta * theta;
+
+    // Consecutive work-items handle particles that are close in space, and
+    // thus traverse similar parts of the tree
+    q_.parallel_for(sycl::range<1>(n), [=](sycl::id<1> idx) {
+      int i = idx[0];
+      RealType acc[3] = {0.f, 0.f, 0.f};
+      TreeAcceleration(n, i, node_end, node_com, sorted, sorted + n,
+                       sorted + 2 * n, sorted + 3 * n, box_size, theta_sqr,
+                       softening_sqr, g, acc);
+      int index = order[i];
+      p.acc[0][index] += acc[0];
+      p.acc[1][index] += acc[1];
+      p.acc[2][index] += acc[2];
+    });
+  }
+};
+
+#endif
@@ -13,4 +13,14 @@ struct Particle {
   RealType mass;
 };
 
+// Structure-of-arrays (SoA) layout of the particles: each component of the
+// particles is stored in its own array, so that consecutive work-items access
+// consecutive addresses
+struct ParticleSoA {
+  RealType *pos[3];
+  RealType *vel[3];
+  RealType *acc[3];
+  RealType *mass;
+};
+
 #endif
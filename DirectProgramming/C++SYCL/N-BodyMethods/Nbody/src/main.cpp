@@ -5,6 +5,7 @@
 // =============================================================
 
 #include <iostream>
+#include <string>
 
 #include "GSimulation.hpp"
 
@@ -22,10 +23,32 @@ int main(int argc, char** argv) {
   if (argc > 1) {
     n = std::atoi(argv[1]);
     sim.SetNumberOfParticles(n);
-    if (argc == 3) {
+    if (argc >= 3) {
       nstep = std::atoi(argv[2]);
       sim.SetNumberOfSteps(nstep);
     }
+    if (argc >= 4) {
+      std::string layout = argv[3];
+      if (layout == "aos") {
+        sim.SetLayout(Layout::kAoS);
+      } else if (layout == "soa") {
+        sim.SetLayout(Layout::kSoA);
+      } else if (layout == "compare") {
+        sim.SetCompareLayouts(true);
+      } else if (layout == "tree") {
+        sim.SetSolver(Solver::kTree);
+      } else if (layout == "crossover") {
+        sim.SetCrossover(true);
+      } else {
+        std::cout << "Usage: " << argv[0]
+                  << " [particles] [steps] [aos|soa|compare|tree|crossover]"
+                  << " [theta]\n";
+        return 1;
+      }
+    }
+    if (argc >= 5) {
+      sim.SetOpeningAngle(std::atof(argv[4]));
+    }
   }
 
   sim.Start();
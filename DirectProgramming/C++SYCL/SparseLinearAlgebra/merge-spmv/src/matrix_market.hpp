@@ -0,0 +1,174 @@
+//==============================================================
+// A reader for sparse matrices stored in the Matrix Market exchange format,
+// as distributed by the SuiteSparse Matrix Collection. The matrix is returned
+// in compressed sparse row format.
+//==============================================================
+// Copyright © Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef MATRIX_MARKET_HPP
+#define MATRIX_MARKET_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read a sparse matrix from a Matrix Market file. Only the coordinate format
+// is supported, with real, integer or pattern values (pattern entries are set
+// to 1), and general, symmetric or skew-symmetric structure (the missing half
+// of a symmetric matrix is mirrored). Indices in the file are 1-based.
+//
+// The columns of each row are sorted and duplicate entries are summed, so the
+// arrays can be used as they are by the CSR kernels.
+//
+// Returns false, after printing the reason, if the file cannot be read.
+inline bool ReadMatrixMarket(const std::string &path, int *rows, int *columns,
+                             std::vector<int> &row_offsets,
+                             std::vector<int> &column_indices,
+                             std::vector<float> &values) {
+  std::ifstream file(path);
+
+  if (!file) {
+    std::cout << "Cannot open " << path << "\n";
+    return false;
+  }
+
+  // Banner: %%MatrixMarket matrix <format> <field> <symmetry>
+  std::string line;
+  std::getline(file, line);
+  std::transform(line.begin(), line.end(), line.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  std::istringstream banner(line);
+  std::string tag, object, format, field, symmetry;
+  banner >> tag >> object >> format >> field >> symmetry;
+
+  if (tag != "%%matrixmarket" || object != "matrix") {
+    std::cout << path << " is not a Matrix Market file\n";
+    return false;
+  }
+
+  if (format != "coordinate" ||
+      (field != "real" && field != "integer" && field != "pattern") ||
+      (symmetry != "general" && symmetry != "symmetric" &&
+       symmetry != "skew-symmetric")) {
+    std::cout << path << ": unsupported matrix type '" << format << " "
+              << field << " " << symmetry << "'\n";
+    return false;
+  }
+
+  bool pattern = (field == "pattern");
+  bool mirror = (symmetry != "general");
+  float mirror_sign = (symmetry == "skew-symmetric") ? -1.0f : 1.0f;
+
+  // Skip comments up to the size line.
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[0] != '%') break;
+  }
+
+  long long file_rows = 0, file_columns = 0, entries = 0;
+  std::istringstream size_line(line);
+
+  if (!(size_line >> file_rows >> file_columns >> entries) || file_rows <= 0 ||
+      file_columns <= 0 || entries < 0) {
+    std::cout << path << ": invalid size line\n";
+    return false;
+  }
+
+  // Indices and offsets are stored as int.
+  long long stored = mirror ? 2 * entries : entries;
+
+  if (file_rows > INT_MAX - 1 || file_columns > INT_MAX || stored > INT_MAX) {
+    std::cout << path << ": matrix is too large\n";
+    return false;
+  }
+
+  // Coordinate entries, converted to 0-based indices.
+  std::vector<int> entry_rows, entry_columns;
+  std::vector<float> entry_values;
+
+  entry_rows.reserve(stored);
+  entry_columns.reserve(stored);
+  entry_values.reserve(stored);
+
+  for (long long k = 0; k < entries; k++) {
+    long long i, j;
+    double value = 1;
+
+    if (!(file >> i >> j) || (!pattern && !(file >> value)) || i < 1 ||
+        i > file_rows || j < 1 || j > file_columns) {
+      std::cout << path << ": invalid entry " << (k + 1) << "\n";
+      return false;
+    }
+
+    entry_rows.push_back(i - 1);
+    entry_columns.push_back(j - 1);
+    entry_values.push_back(value);
+
+    if (mirror && i != j) {
+      entry_rows.push_back(j - 1);
+      entry_columns.push_back(i - 1);
+      entry_values.push_back(mirror_sign * value);
+    }
+  }
+
+  *rows = file_rows;
+  *columns = file_columns;
+
+  // Counting sort of the entries by row.
+  row_offsets.assign(*rows + 1, 0);
+
+  for (int i : entry_rows) row_offsets[i + 1]++;
+
+  for (int i = 0; i < *rows; i++) row_offsets[i + 1] += row_offsets[i];
+
+  std::vector<int> next(row_offsets.begin(), row_offsets.end() - 1);
+  std::vector<std::pair<int, float>> row_entries(entry_rows.size());
+
+  for (size_t k = 0; k < entry_rows.size(); k++) {
+    row_entries[next[entry_rows[k]]++] = {entry_columns[k], entry_values[k]};
+  }
+
+  // Sort each row by column and sum duplicate entries.
+  column_indices.clear();
+  values.clear();
+  column_indices.reserve(row_entries.size());
+  values.reserve(row_entries.size());
+
+  int begin = 0;
+
+  for (int i = 0; i < *rows; i++) {
+    int end = row_offsets[i + 1];
+
+    std::sort(row_entries.begin() + begin, row_entries.begin() + end,
+              [](const std::pair<int, float> &a,
+                 const std::pair<int, float> &b) { return a.first < b.first; });
+
+    row_offsets[i] = column_indices.size();
+
+    for (int k = begin; k < end; k++) {
+      if (k > begin && row_entries[k].first == column_indices.back()) {
+        values.back() += row_entries[k].second;
+      } else {
+        column_indices.push_back(row_entries[k].first);
+        values.push_back(row_entries[k].second);
+      }
+    }
+
+    begin = end;
+  }
+
+  row_offsets[*rows] = column_indices.size();
+
+  return true;
+}
+
+#endif  // MATRIX_MARKET_HPP
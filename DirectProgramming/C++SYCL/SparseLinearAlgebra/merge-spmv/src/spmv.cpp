@@ -2,6 +2,11 @@
 // This sample provides a parallel implementation of a merge based sparse matrix
 // and vector multiplication algorithm using SYCL. The input matrix is in
 // compressed sparse row format.
+//
+// Given Matrix Market files on the command line, the sample runs two CSR
+// kernels, an ELL, a SELL-C-sigma and the merge based kernel side by side on
+// each matrix, reports their performance, and compares them with the format
+// selected from the row length statistics of the matrix.
 //==============================================================
 // Copyright © Intel Corporation
 //
@@ -9,18 +14,27 @@
 // =============================================================
 
 #include <sycl/sycl.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <numeric>
 #include <set>
+#include <string>
+#include <vector>
 
 // dpc_common.hpp can be found in the dev-utilities include folder.
 // e.g., $ONEAPI_ROOT/dev-utilities/<version>/include/dpc_common.hpp
 #include "dpc_common.hpp"
 
+#include "matrix_market.hpp"
+
 using namespace std;
 using namespace sycl;
 
-// n x n sparse matrix.
+// n x n sparse matrix, used when no Matrix Market file is given.
 constexpr int n = 100 * 1000;
 
 // Number of non zero values in sparse matrix.
@@ -32,6 +46,14 @@ constexpr int max_value = 100;
 // Number of repetitions.
 constexpr int repetitions = 16;
 
+// Slice height (C) and sorting window (sigma) of the SELL-C-sigma format.
+constexpr int sell_slice_height = 32;
+constexpr int sell_sigma = 256;
+
+// ELL is not built when it would store more than this many times the non
+// zero values of the matrix.
+constexpr double ell_max_padding = 3;
+
 // Compressed Sparse Row (CSR) representation for sparse matrix.
 //
 // Example: The following 4 x 4 sparse matrix
@@ -68,24 +90,30 @@ constexpr int repetitions = 16;
 //     2         1                    3
 //     3         2                    4
 //     -         -                    6
+//
+// The matrix also records its dimensions and its number of non zero values.
 typedef struct {
+  int rows;
+  int columns;
+  int nonzeros;
   int *row_offsets;
   int *column_indices;
   float *values;
 } CompressedSparseRow;
 
 // Allocate unified shared memory for storing matrix and vectors so that they
-// are accessible from both the CPU and the device (e.g., a GPU).
+// are accessible from both the CPU and the device (e.g., a GPU). The
+// dimensions of the matrix must be set.
 bool AllocateMemory(queue &q, int thread_count, CompressedSparseRow *matrix,
                     float **x, float **y_sequential, float **y_parallel,
                     int **carry_row, float **carry_value) {
-  matrix->row_offsets = malloc_shared<int>(n + 1, q);
-  matrix->column_indices = malloc_shared<int>(nonzero, q);
-  matrix->values = malloc_shared<float>(nonzero, q);
+  matrix->row_offsets = malloc_shared<int>(matrix->rows + 1, q);
+  matrix->column_indices = malloc_shared<int>(matrix->nonzeros, q);
+  matrix->values = malloc_shared<float>(matrix->nonzeros, q);
 
-  *x = malloc_shared<float>(n, q);
-  *y_sequential = malloc_shared<float>(n, q);
-  *y_parallel = malloc_shared<float>(n, q);
+  *x = malloc_shared<float>(matrix->columns, q);
+  *y_sequential = malloc_shared<float>(matrix->rows, q);
+  *y_parallel = malloc_shared<float>(matrix->rows, q);
 
   *carry_row = malloc_shared<int>(thread_count, q);
   *carry_value = malloc_shared<float>(thread_count, q);
@@ -119,9 +147,9 @@ void InitializeSparseMatrixAndVector(CompressedSparseRow *matrix, float *x) {
 
   // Randomly choose a set of elements (i.e., row and column pairs) of the
   // matrix. These elements will have non zero values.
-  for (int k = 0; k < nonzero; k++) {
-    int i = rand() % n;
-    int j = rand() % n;
+  for (int k = 0; k < matrix->nonzeros; k++) {
+    int i = rand() % matrix->rows;
+    int j = rand() % matrix->columns;
 
     if (indices.find(i) == indices.end()) {
       indices[i] = {j};
@@ -137,7 +165,7 @@ void InitializeSparseMatrixAndVector(CompressedSparseRow *matrix, float *x) {
   int offset = 0;
 
   // Randomly choose non zero values of the sparse matrix.
-  for (int i = 0; i < n; i++) {
+  for (int i = 0; i < matrix->rows; i++) {
     matrix->row_offsets[i] = offset;
 
     if (indices.find(i) != indices.end()) {
@@ -150,10 +178,10 @@ void InitializeSparseMatrixAndVector(CompressedSparseRow *matrix, float *x) {
     }
   }
 
-  matrix->row_offsets[n] = nonzero;
+  matrix->row_offsets[matrix->rows] = matrix->nonzeros;
 
   // Initialize input vector.
-  for (int i = 0; i < n; i++) {
+  for (int i = 0; i < matrix->columns; i++) {
     x[i] = 1;
   }
 }
@@ -193,7 +221,7 @@ void MergeSparseMatrixVector(CompressedSparseRow *matrix, float *x, float *y) {
 
   y[row_index] = 0;
 
-  while (val_index < nonzero) {
+  while (val_index < matrix->nonzeros) {
     if (val_index < matrix->row_offsets[row_index + 1]) {
       // Accumulate and move down.
       y[row_index] +=
@@ -207,7 +235,7 @@ void MergeSparseMatrixVector(CompressedSparseRow *matrix, float *x, float *y) {
     }
   }
 
-  for (row_index++; row_index < n; row_index++) {
+  for (row_index++; row_index < matrix->rows; row_index++) {
     y[row_index] = 0;
   }
 }
@@ -220,10 +248,11 @@ typedef struct {
 
 // Given linear position on the merge path, find two dimensional merge
 // coordinate (row index and value index pair) on the path.
-MergeCoordinate MergePathBinarySearch(int diagonal, int *row_offsets) {
+MergeCoordinate MergePathBinarySearch(int diagonal, int rows, int nonzeros,
+                                      int *row_offsets) {
   // Diagonal search range (in row index space).
-  int row_min = (diagonal - nonzero > 0) ? (diagonal - nonzero) : 0;
-  int row_max = (diagonal < n) ? diagonal : n;
+  int row_min = (diagonal - nonzeros > 0) ? (diagonal - nonzeros) : 0;
+  int row_max = (diagonal < rows) ? diagonal : rows;
 
   // 2D binary search along the diagonal search range.
   while (row_min < row_max) {
@@ -240,7 +269,7 @@ MergeCoordinate MergePathBinarySearch(int diagonal, int *row_offsets) {
 
   MergeCoordinate coordinate;
 
-  coordinate.row_index = (row_min < n) ? row_min : n;
+  coordinate.row_index = (row_min < rows) ? row_min : rows;
   coordinate.val_index = diagonal - row_min;
 
   return coordinate;
@@ -260,7 +289,7 @@ void MergeSparseMatrixVectorThread(int thread_count, int tid,
                                    CompressedSparseRow matrix, float *x,
                                    float *y, int *carry_row,
                                    float *carry_value) {
-  int path_length = n + nonzero;  // Merge path length.
+  int path_length = matrix.rows + matrix.nonzeros;  // Merge path length.
   int items_per_thread = (path_length + thread_count - 1) /
                          thread_count;  // Merge items per thread.
 
@@ -272,14 +301,16 @@ void MergeSparseMatrixVectorThread(int thread_count, int tid,
                          ? (diagonal + items_per_thread)
                          : path_length;
 
-  MergeCoordinate path = MergePathBinarySearch(diagonal, matrix.row_offsets);
-  MergeCoordinate path_end =
-      MergePathBinarySearch(diagonal_end, matrix.row_offsets);
+  MergeCoordinate path = MergePathBinarySearch(
+      diagonal, matrix.rows, matrix.nonzeros, matrix.row_offsets);
+  MergeCoordinate path_end = MergePathBinarySearch(
+      diagonal_end, matrix.rows, matrix.nonzeros, matrix.row_offsets);
 
-  // Consume items-per-thread merge items.
+  // Consume the merge items of this thread (the last threads may have fewer
+  // than items-per-thread of them).
   float dot_product = 0;
 
-  for (int i = 0; i < items_per_thread; i++) {
+  for (int i = diagonal; i < diagonal_end; i++) {
     if (path.val_index < matrix.row_offsets[path.row_index + 1]) {
       // Accumulate and move down.
       dot_product += matrix.values[path.val_index] *
@@ -314,17 +345,18 @@ void MergeSparseMatrixVector(queue &q, int compute_units, int work_group_size,
                              CompressedSparseRow matrix, float *x, float *y,
                              int *carry_row, float *carry_value) {
   int thread_count = compute_units * work_group_size;
+  int rows = matrix.rows;
 
   // Initialize output vector.
   q.parallel_for<class InitializeVector>(
       nd_range<1>(compute_units * work_group_size, work_group_size),
       [=](nd_item<1> item) {
         auto global_id = item.get_global_id(0);
-        auto items_per_thread = (n + thread_count - 1) / thread_count;
+        auto items_per_thread = (rows + thread_count - 1) / thread_count;
         auto start = global_id * items_per_thread;
         auto stop = start + items_per_thread;
 
-        for (auto i = start; (i < stop) && (i < n); i++) {
+        for (auto i = start; (i < stop) && (i < rows); i++) {
           y[i] = 0;
         }
       });
@@ -344,15 +376,15 @@ void MergeSparseMatrixVector(queue &q, int compute_units, int work_group_size,
 
   // Carry fix up for rows spanning multiple threads.
   for (int tid = 0; tid < thread_count - 1; tid++) {
-    if (carry_row[tid] < n) {
+    if (carry_row[tid] < rows) {
       y[carry_row[tid]] += carry_value[tid];
     }
   }
 }
 
 // Check if two input vectors are equal.
-bool VerifyVectorsAreEqual(float *u, float *v) {
-  for (int i = 0; i < n; i++) {
+bool VerifyVectorsAreEqual(int size, float *u, float *v) {
+  for (int i = 0; i < size; i++) {
     if (fabs(u[i] - v[i]) > 1E-06) {
       return false;
     }
@@ -361,7 +393,492 @@ bool VerifyVectorsAreEqual(float *u, float *v) {
   return true;
 }
 
-int main() {
+// Sliced ELLPACK (SELL-C-sigma) representation for sparse matrix.
+//
+// Rows are grouped into slices of C consecutive rows. Each slice is padded to
+// the length of its longest row and stored column by column, so that the C
+// work-items of a slice read consecutive addresses at each step. Before the
+// rows are sliced, they are sorted by decreasing length within windows of
+// sigma rows, so that rows of similar lengths share a slice and little
+// padding is needed. The result of each row is written through the row
+// permutation.
+//
+// Example: The 4 x 4 sparse matrix above with C = 2 and sigma = 4
+//
+//   Row permutation: 1, 3, 0, 2
+//   Slice offsets: 0, 4, 6
+//   Values: b, e, c, f, a, d
+//   Column indices: 0, 2, 1, 3, 0, 3
+//
+// ELLPACK (ELL) is the special case of a single slice holding all rows, left
+// in their original order (C = rows, sigma = 1).
+typedef struct {
+  int rows;
+  int slice_height;
+  int slice_count;
+  int stored;  // Stored values, including padding.
+  int *slice_offsets;
+  int *row_permutation;
+  int *column_indices;
+  float *values;
+} SlicedEllpack;
+
+// Free the unified shared memory of a SELL-C-sigma matrix.
+void FreeSlicedEllpack(queue &q, SlicedEllpack *matrix) {
+  if (matrix->slice_offsets != nullptr) free(matrix->slice_offsets, q);
+  if (matrix->row_permutation != nullptr) free(matrix->row_permutation, q);
+  if (matrix->column_indices != nullptr) free(matrix->column_indices, q);
+  if (matrix->values != nullptr) free(matrix->values, q);
+
+  matrix->slice_offsets = nullptr;
+  matrix->row_permutation = nullptr;
+  matrix->column_indices = nullptr;
+  matrix->values = nullptr;
+}
+
+// Convert a CSR matrix to the SELL-C-sigma format. Padding values are zeros in
+// column 0. Returns false if the padded matrix does not fit in memory.
+bool BuildSlicedEllpack(queue &q, const CompressedSparseRow &csr,
+                        int slice_height, int sigma, SlicedEllpack *sell) {
+  int rows = csr.rows;
+  int slice_count = (rows + slice_height - 1) / slice_height;
+
+  auto row_length = [&](int row) {
+    return csr.row_offsets[row + 1] - csr.row_offsets[row];
+  };
+
+  // Sort rows by decreasing length within each sigma window.
+  vector<int> permutation(rows);
+  std::iota(permutation.begin(), permutation.end(), 0);
+
+  for (int window = 0; sigma > 1 && window < rows; window += sigma) {
+    std::stable_sort(
+        permutation.begin() + window,
+        permutation.begin() + std::min(window + sigma, rows),
+        [&](int a, int b) { return row_length(a) > row_length(b); });
+  }
+
+  // Each slice is as wide as its longest row.
+  vector<long long> slice_offsets(slice_count + 1, 0);
+
+  for (int slice = 0; slice < slice_count; slice++) {
+    int width = 0;
+
+    for (int lane = 0; lane < slice_height; lane++) {
+      int i = slice * slice_height + lane;
+      if (i < rows) width = std::max(width, row_length(permutation[i]));
+    }
+
+    slice_offsets[slice + 1] =
+        slice_offsets[slice] + (long long)width * slice_height;
+  }
+
+  if (slice_offsets[slice_count] > INT_MAX) return false;
+
+  sell->rows = rows;
+  sell->slice_height = slice_height;
+  sell->slice_count = slice_count;
+  sell->stored = slice_offsets[slice_count];
+  sell->slice_offsets = malloc_shared<int>(slice_count + 1, q);
+  sell->row_permutation = malloc_shared<int>(rows, q);
+  sell->column_indices = malloc_shared<int>(std::max(sell->stored, 1), q);
+  sell->values = malloc_shared<float>(std::max(sell->stored, 1), q);
+
+  if ((sell->slice_offsets == nullptr) || (sell->row_permutation == nullptr) ||
+      (sell->column_indices == nullptr) || (sell->values == nullptr)) {
+    FreeSlicedEllpack(q, sell);
+    return false;
+  }
+
+  std::copy(slice_offsets.begin(), slice_offsets.end(), sell->slice_offsets);
+  std::copy(permutation.begin(), permutation.end(), sell->row_permutation);
+
+  for (int slice = 0; slice < slice_count; slice++) {
+    int begin = slice_offsets[slice];
+    int width = (slice_offsets[slice + 1] - begin) / slice_height;
+
+    for (int lane = 0; lane < slice_height; lane++) {
+      int i = slice * slice_height + lane;
+      int row = (i < rows) ? permutation[i] : 0;
+      int length = (i < rows) ? row_length(row) : 0;
+
+      for (int j = 0; j < width; j++) {
+        int k = begin + j * slice_height + lane;
+
+        if (j < length) {
+          int csr_index = csr.row_offsets[row] + j;
+          sell->column_indices[k] = csr.column_indices[csr_index];
+          sell->values[k] = csr.values[csr_index];
+        } else {
+          sell->column_indices[k] = 0;
+          sell->values[k] = 0;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+// Sparse matrix and vector multiplication in CSR format, one row per
+// work-item. Work-items of a sub-group walk through different rows, so their
+// reads are not coalesced and they wait for the longest row of the sub-group.
+void CsrSparseMatrixVector(queue &q, CompressedSparseRow matrix, float *x,
+                           float *y) {
+  q.parallel_for<class CsrMatrixVector>(range<1>(matrix.rows), [=](id<1> idx) {
+    int row = idx[0];
+    float dot_product = 0;
+
+    for (int k = matrix.row_offsets[row]; k < matrix.row_offsets[row + 1];
+         k++) {
+      dot_product += matrix.values[k] * x[matrix.column_indices[k]];
+    }
+
+    y[row] = dot_product;
+  });
+
+  q.wait();
+}
+
+// Sparse matrix and vector multiplication in CSR format, one row per
+// sub-group. The work-items of the sub-group read consecutive values of the
+// row, and their partial dot products are added by a sub-group reduction.
+// Each sub-group strides through the rows, so that any number of rows can be
+// handled by one work-item per thread.
+void CsrVectorSparseMatrixVector(queue &q, int compute_units,
+                                 int work_group_size,
+                                 CompressedSparseRow matrix, float *x,
+                                 float *y) {
+  q.parallel_for<class CsrVectorMatrixVector>(
+      nd_range<1>(compute_units * work_group_size, work_group_size),
+      [=](nd_item<1> item) {
+        auto sg = item.get_sub_group();
+        int lane = sg.get_local_linear_id();
+        int lanes = sg.get_local_linear_range();
+        int sub_groups = sg.get_group_linear_range();
+        int first_row =
+            item.get_group_linear_id() * sub_groups + sg.get_group_linear_id();
+        int stride = item.get_group_range(0) * sub_groups;
+
+        for (int row = first_row; row < matrix.rows; row += stride) {
+          float dot_product = 0;
+
+          for (int k = matrix.row_offsets[row] + lane;
+               k < matrix.row_offsets[row + 1]; k += lanes) {
+            dot_product += matrix.values[k] * x[matrix.column_indices[k]];
+          }
+
+          dot_product =
+              reduce_over_group(sg, dot_product, sycl::plus<float>());
+
+          if (lane == 0) y[row] = dot_product;
+        }
+      });
+
+  q.wait();
+}
+
+// Sparse matrix and vector multiplication in SELL-C-sigma (or ELL) format,
+// one row per work-item. At each step, the work-items of a slice read
+// consecutive values and column indices.
+void SellSparseMatrixVector(queue &q, SlicedEllpack matrix, float *x,
+                            float *y) {
+  int slice_height = matrix.slice_height;
+
+  q.parallel_for<class SellMatrixVector>(
+      range<1>((size_t)matrix.slice_count * slice_height), [=](id<1> idx) {
+        int i = idx[0];
+
+        if (i >= matrix.rows) return;
+
+        int slice = i / slice_height;
+        int lane = i % slice_height;
+        float dot_product = 0;
+
+        for (int k = matrix.slice_offsets[slice] + lane;
+             k < matrix.slice_offsets[slice + 1]; k += slice_height) {
+          dot_product += matrix.values[k] * x[matrix.column_indices[k]];
+        }
+
+        y[matrix.row_permutation[i]] = dot_product;
+      });
+
+  q.wait();
+}
+
+// Row length statistics of a sparse matrix, from which a format is selected.
+typedef struct {
+  double mean;
+  double variation;  // Standard deviation over mean.
+  int max;
+  int empty;
+} RowStatistics;
+
+RowStatistics ComputeRowStatistics(const CompressedSparseRow &matrix) {
+  RowStatistics stats = {0, 0, 0, 0};
+  double sum_squares = 0;
+
+  for (int row = 0; row < matrix.rows; row++) {
+    int length = matrix.row_offsets[row + 1] - matrix.row_offsets[row];
+
+    stats.max = std::max(stats.max, length);
+    stats.empty += (length == 0);
+    sum_squares += (double)length * length;
+  }
+
+  stats.mean = (double)matrix.nonzeros / matrix.rows;
+
+  double variance = sum_squares / matrix.rows - stats.mean * stats.mean;
+
+  if (stats.mean > 0) {
+    stats.variation = std::sqrt(std::max(variance, 0.0)) / stats.mean;
+  }
+
+  return stats;
+}
+
+// Sparse matrix formats (and kernels) compared on each matrix.
+enum SpmvFormat { kCsr, kCsrVector, kEll, kSell, kMerge, kFormatCount };
+
+string FormatName(int format) {
+  switch (format) {
+    case kCsr:
+      return "CSR";
+    case kCsrVector:
+      return "CSR vector";
+    case kEll:
+      return "ELL";
+    case kSell:
+      return "SELL-" + to_string(sell_slice_height) + "-" +
+             to_string(sell_sigma);
+    default:
+      return "Merge";
+  }
+}
+
+// Select a format from the row length statistics of the matrix, and the
+// padding (stored over non zero values) that ELL and SELL-C-sigma need:
+// - Rows of nearly equal lengths: ELL, which reads no row offsets and
+//   coalesces all its reads.
+// - Skewed row lengths (e.g., power-law graphs): merge, which gives every
+//   thread the same amount of work whatever the row lengths, where the other
+//   kernels would wait for the few longest rows.
+// - Long rows: CSR vector, which spreads each row over a sub-group.
+// - Rows that SELL-C-sigma pads little once sorted: SELL-C-sigma.
+// - Otherwise: CSR.
+int SelectFormat(const RowStatistics &stats, double ell_padding,
+                 double sell_padding) {
+  if (ell_padding <= 1.1) return kEll;
+
+  if (stats.variation > 2 || stats.max > 64 * stats.mean) return kMerge;
+
+  if (stats.mean >= 32) return kCsrVector;
+
+  if (sell_padding <= 1.5) return kSell;
+
+  return kCsr;
+}
+
+// Check the result of a kernel against a reference computed in double
+// precision. Each kernel adds the terms of a row in a different order, so the
+// tolerance is relative to the sum of the magnitudes of the terms of the row.
+bool VerifyResult(const CompressedSparseRow &matrix, const float *x,
+                  const float *y) {
+  for (int row = 0; row < matrix.rows; row++) {
+    double dot_product = 0;
+    double magnitude = 0;
+
+    for (int k = matrix.row_offsets[row]; k < matrix.row_offsets[row + 1];
+         k++) {
+      double term = (double)matrix.values[k] * x[matrix.column_indices[k]];
+      dot_product += term;
+      magnitude += fabs(term);
+    }
+
+    if (!(fabs(y[row] - dot_product) <= 1E-04 * magnitude)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Read a Matrix Market file into a matrix in unified shared memory.
+bool LoadMatrix(queue &q, const string &path, CompressedSparseRow *matrix) {
+  vector<int> row_offsets;
+  vector<int> column_indices;
+  vector<float> values;
+
+  if (!ReadMatrixMarket(path, &matrix->rows, &matrix->columns, row_offsets,
+                        column_indices, values)) {
+    return false;
+  }
+
+  matrix->nonzeros = values.size();
+  matrix->row_offsets = malloc_shared<int>(matrix->rows + 1, q);
+  matrix->column_indices = malloc_shared<int>(std::max(matrix->nonzeros, 1), q);
+  matrix->values = malloc_shared<float>(std::max(matrix->nonzeros, 1), q);
+
+  if ((matrix->row_offsets == nullptr) ||
+      (matrix->column_indices == nullptr) || (matrix->values == nullptr)) {
+    cout << "Memory allocation failure.\n";
+    FreeMemory(q, matrix, nullptr, nullptr, nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  std::copy(row_offsets.begin(), row_offsets.end(), matrix->row_offsets);
+  std::copy(column_indices.begin(), column_indices.end(),
+            matrix->column_indices);
+  std::copy(values.begin(), values.end(), matrix->values);
+
+  return true;
+}
+
+// Multiply a matrix and a vector in every format, verify the results, and
+// report the run time, the floating point throughput (two operations per non
+// zero value) and the memory throughput of each format. The memory traffic is
+// estimated as one read of the matrix arrays the kernel uses (padding
+// included), of the input vector and of the row permutation, and one write of
+// the output vector. Returns false if a format computes a wrong result.
+bool RunMatrix(queue &q, int compute_units, int work_group_size,
+               const string &name, CompressedSparseRow matrix) {
+  int thread_count = compute_units * work_group_size;
+  RowStatistics stats = ComputeRowStatistics(matrix);
+  double nonzeros = std::max(matrix.nonzeros, 1);
+  double ell_padding = (double)matrix.rows * stats.max / nonzeros;
+
+  cout << "\nMatrix: " << name << " (" << matrix.rows << " x "
+       << matrix.columns << ", " << matrix.nonzeros << " non zeros)\n";
+  cout << "Row lengths: mean " << stats.mean << ", max " << stats.max
+       << ", coefficient of variation " << stats.variation << ", "
+       << stats.empty << " empty rows\n";
+
+  float *x = malloc_shared<float>(matrix.columns, q);
+  float *y = malloc_shared<float>(matrix.rows, q);
+  int *carry_row = malloc_shared<int>(thread_count, q);
+  float *carry_value = malloc_shared<float>(thread_count, q);
+
+  SlicedEllpack ell = {};
+  SlicedEllpack sell = {};
+  bool has_ell = (ell_padding <= ell_max_padding) &&
+                 BuildSlicedEllpack(q, matrix, matrix.rows, 1, &ell);
+  bool has_sell =
+      BuildSlicedEllpack(q, matrix, sell_slice_height, sell_sigma, &sell);
+  double sell_padding = has_sell ? sell.stored / nonzeros : ell_padding;
+
+  bool allocated = (x != nullptr) && (y != nullptr) &&
+                   (carry_row != nullptr) && (carry_value != nullptr);
+
+  if (!allocated) cout << "Memory allocation failure.\n";
+
+  // Vary the input vector so that a wrong column index changes the result.
+  for (int i = 0; allocated && i < matrix.columns; i++) {
+    x[i] = 1 + (i % 8) * 0.125f;
+  }
+
+  size_t csr_bytes = (size_t)matrix.nonzeros * (sizeof(float) + sizeof(int)) +
+                     (matrix.rows + 1) * sizeof(int);
+  size_t vector_bytes = (matrix.columns + matrix.rows) * sizeof(float);
+
+  int selected = SelectFormat(stats, ell_padding, sell_padding);
+  int fastest = -1;
+  double fastest_time = 0;
+
+  cout << left << setw(14) << "Format" << right << setw(12) << "Time (ms)"
+       << setw(10) << "GFLOP/s" << setw(10) << "GB/s" << setw(10) << "Padding"
+       << "\n";
+
+  // A format that fails verification is reported and excluded from the
+  // timings, but the remaining formats are still run.
+  bool success = allocated;
+
+  for (int format = 0; allocated && format < kFormatCount; format++) {
+    cout << left << setw(14) << FormatName(format) << right << fixed
+         << setprecision(3);
+
+    if ((format == kEll && !has_ell) || (format == kSell && !has_sell)) {
+      cout << setw(12) << "skipped" << setw(30)
+           << (format == kEll ? ell_padding : sell_padding) << "\n";
+      cout.unsetf(ios::floatfield);
+      continue;
+    }
+
+    SlicedEllpack &sliced = (format == kEll) ? ell : sell;
+    double padding = 1;
+    size_t bytes = csr_bytes + vector_bytes;
+
+    if (format == kEll || format == kSell) {
+      padding = sliced.stored / nonzeros;
+      bytes = (size_t)sliced.stored * (sizeof(float) + sizeof(int)) +
+              (sliced.slice_count + 1 + matrix.rows) * sizeof(int) +
+              vector_bytes;
+    }
+
+    auto multiply = [&]() {
+      switch (format) {
+        case kCsr:
+          CsrSparseMatrixVector(q, matrix, x, y);
+          break;
+        case kCsrVector:
+          CsrVectorSparseMatrixVector(q, compute_units, work_group_size,
+                                      matrix, x, y);
+          break;
+        case kEll:
+        case kSell:
+          SellSparseMatrixVector(q, sliced, x, y);
+          break;
+        default:
+          MergeSparseMatrixVector(q, compute_units, work_group_size, matrix,
+                                  x, y, carry_row, carry_value);
+      }
+    };
+
+    // Warm up the JIT and verify, starting from an output vector that fails
+    // verification wherever a row is not written.
+    std::fill(y, y + matrix.rows, numeric_limits<float>::quiet_NaN());
+    multiply();
+
+    if (!VerifyResult(matrix, x, y)) {
+      cout << setw(12) << "failed" << "\n";
+      cout.unsetf(ios::floatfield);
+      success = false;
+      continue;
+    }
+
+    dpc_common::TimeInterval timer;
+
+    for (int i = 0; i < repetitions; i++) {
+      multiply();
+    }
+
+    double elapsed = timer.Elapsed() / repetitions;
+
+    cout << setw(12) << elapsed * 1E+03 << setw(10)
+         << 2.0 * matrix.nonzeros / elapsed * 1E-09 << setw(10)
+         << bytes / elapsed * 1E-09 << setw(10) << padding << "\n";
+    cout.unsetf(ios::floatfield);
+
+    if (fastest < 0 || elapsed < fastest_time) {
+      fastest = format;
+      fastest_time = elapsed;
+    }
+  }
+
+  if (allocated) cout << "Selected format: " << FormatName(selected) << "\n";
+  if (fastest >= 0) cout << "Fastest format: " << FormatName(fastest) << "\n";
+
+  FreeSlicedEllpack(q, &ell);
+  FreeSlicedEllpack(q, &sell);
+
+  if (x != nullptr) free(x, q);
+  if (y != nullptr) free(y, q);
+  if (carry_row != nullptr) free(carry_row, q);
+  if (carry_value != nullptr) free(carry_value, q);
+
+  return success;
+}
+
+int main(int argc, char *argv[]) {
   // Sparse matrix.
   CompressedSparseRow matrix;
 
@@ -398,6 +915,32 @@ int main() {
     cout << "Compute units: " << compute_units << "\n";
     cout << "Work group size: " << work_group_size << "\n";
 
+    // Compare the formats on each Matrix Market file given on the command
+    // line.
+    if (argc > 1) {
+      int status = 0;
+
+      for (int a = 1; a < argc; a++) {
+        if (!LoadMatrix(q, argv[a], &matrix)) {
+          status = -1;
+          continue;
+        }
+
+        if (!RunMatrix(q, compute_units, work_group_size, argv[a], matrix)) {
+          cout << "Failed to correctly compute!\n";
+          status = -1;
+        }
+
+        FreeMemory(q, &matrix, nullptr, nullptr, nullptr, nullptr, nullptr);
+      }
+
+      return status;
+    }
+
+    matrix.rows = n;
+    matrix.columns = n;
+    matrix.nonzeros = nonzero;
+
     // Allocate memory.
     if (!AllocateMemory(q, compute_units * work_group_size, &matrix, &x,
                         &y_sequential, &y_parallel, &carry_row, &carry_value)) {
@@ -438,7 +981,7 @@ int main() {
       elapsed_p += timer_p.Elapsed();
 
       // Verify two results are equal.
-      if (!VerifyVectorsAreEqual(y_sequential, y_parallel)) {
+      if (!VerifyVectorsAreEqual(matrix.rows, y_sequential, y_parallel)) {
         cout << "Failed to correctly compute!\n";
         break;
       }
@@ -13,6 +13,7 @@ using namespace sycl;
 #include <ctime>
 #include <fstream>
 #include <algorithm>
+#include <vector>
 /*
  * Parameters to define coefficients
  * kHalfLength: Radius of the stencil
@@ -34,6 +35,21 @@ bool Iso3dfdDevice(sycl::queue &q, float *ptr_next, float *ptr_prev,
                      size_t n3, size_t n1_block, size_t n2_block,
                      size_t n3_block, size_t end_z, unsigned int num_iterations);
 
+bool Iso3dfdDeviceTemporal(sycl::queue &q, float *ptr_next, float *ptr_prev,
+                           float *ptr_vel, float *ptr_coeff, size_t n1,
+                           size_t n2, size_t n3, size_t n1_block,
+                           size_t n2_block, size_t n3_block, size_t end_z,
+                           unsigned int num_iterations,
+                           unsigned int time_block);
+
+bool Iso3dfdMultiDevice(sycl::queue &q, float *ptr_next, float *ptr_prev,
+                        float *ptr_vel, float *ptr_coeff, size_t n1, size_t n2,
+                        size_t n3, size_t n1_block, size_t n2_block,
+                        size_t n3_block, unsigned int num_iterations,
+                        unsigned int num_ranks);
+
+double MeasureDeviceBandwidth(sycl::queue &q, size_t n);
+
 void PrintTargetInfo(sycl::queue &q, unsigned int dim_x, unsigned int dim_y);
 
 void Usage(const std::string &program_name);
@@ -41,6 +57,10 @@ void Usage(const std::string &program_name);
 void PrintStats(double time, size_t n1, size_t n2, size_t n3,
                 unsigned int num_iterations);
 
+void PrintRooflineStats(double time, size_t n1, size_t n2, size_t n3,
+                        unsigned int num_iterations, unsigned int time_block,
+                        double bandwidth);
+
 bool WithinEpsilon(float *output, float *reference, const size_t dim_x,
                     const size_t dim_y, const size_t dim_z,
                     const unsigned int radius, const int zadjust,
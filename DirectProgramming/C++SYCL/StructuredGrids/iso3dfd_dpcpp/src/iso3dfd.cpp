@@ -165,6 +165,10 @@ int main(int argc, char* argv[]) {
   bool omp = true;
   bool error = false;
   bool is_gpu = true;
+  // Time steps per sweep of the temporal blocking variant, 0 to disable it
+  unsigned int time_block = 0;
+  // Number of ranks of the domain decomposition, 0 to run on a single queue
+  unsigned int num_ranks = 0;
 
   size_t n1, n2, n3;
   size_t n1_block, n2_block, n3_block;
@@ -201,12 +205,40 @@ int main(int argc, char* argv[]) {
       is_gpu = true;
     } else if (arg_value == "cpu") {
       is_gpu = false;
+    } else if (arg_value.rfind("tblock=", 0) == 0) {
+      int depth = 0;
+      try {
+        depth = std::stoi(arg_value.substr(7));
+      } catch (...) {
+      }
+      if (depth < 1) {
+        Usage(argv[0]);
+        return 1;
+      }
+      time_block = depth;
+    } else if (arg_value.rfind("ranks=", 0) == 0) {
+      int count = 0;
+      try {
+        count = std::stoi(arg_value.substr(6));
+      } catch (...) {
+      }
+      if (count < 1) {
+        Usage(argv[0]);
+        return 1;
+      }
+      num_ranks = count;
     } else {
       Usage(argv[0]);
       return 1;
     }
   }
 
+  if (time_block > 0 && num_ranks > 0) {
+    std::cout << " ERROR: tblock and ranks cannot be combined\n";
+    Usage(argv[0]);
+    return 1;
+  }
+
   // Validate input sizes for the grid and block dimensions
   if (CheckGridDimension(n1 - 2 * kHalfLength, n2 - 2 * kHalfLength,
                          n3 - 2 * kHalfLength, n1_block, n2_block, n3_block)) {
@@ -305,27 +337,88 @@ int main(int argc, char* argv[]) {
     dpc_common::TimeInterval t_dpc;
 
     // Invoke the driver function to perform 3D wave propogation
-    // using SYCL version on the selected device
-    Iso3dfdDevice(q, next_base, prev_base, vel_base, coeff, n1, n2, n3,
-                  n1_block, n2_block, n3_block, n3 - kHalfLength,
-                  num_iterations);
+    // using SYCL version on the selected device, or on several ranks
+    // with a domain decomposition
+    if (num_ranks > 0) {
+      if (!Iso3dfdMultiDevice(q, next_base, prev_base, vel_base, coeff, n1,
+                              n2, n3, n1_block, n2_block, n3_block,
+                              num_iterations, num_ranks)) {
+        Usage(argv[0]);
+        return 1;
+      }
+    } else {
+      Iso3dfdDevice(q, next_base, prev_base, vel_base, coeff, n1, n2, n3,
+                    n1_block, n2_block, n3_block, n3 - kHalfLength,
+                    num_iterations);
+    }
     // Wait for the commands to complete. Enforce synchronization on the command
     // queue
     q.wait_and_throw();
 
     // End timer
-    PrintStats(t_dpc.Elapsed() * 1e3, n1, n2, n3, num_iterations);
+    double time_dpc = t_dpc.Elapsed() * 1e3;
+    PrintStats(time_dpc, n1, n2, n3, num_iterations);
+
+    // Run the temporal blocking variant, and compare its performance and
+    // results with the kernel above
+    if (time_block > 0) {
+      std::cout << " ***** Running SYCL temporal blocking variant *****\n";
+      double bandwidth = MeasureDeviceBandwidth(q, nsize);
+      PrintRooflineStats(time_dpc, n1, n2, n3, num_iterations, 1, bandwidth);
+
+      // Keep a copy of the output of the kernel above
+      float* sycl_ref = new float[nsize];
+      if (num_iterations % 2)
+        memcpy(sycl_ref, next_base, nsize * sizeof(float));
+      else
+        memcpy(sycl_ref, prev_base, nsize * sizeof(float));
+
+      Initialize(prev_base, next_base, vel_base, n1, n2, n3);
+
+      dpc_common::TimeInterval t_temporal;
+      Iso3dfdDeviceTemporal(q, next_base, prev_base, vel_base, coeff, n1, n2,
+                            n3, n1_block, n2_block, n3_block, n3 - kHalfLength,
+                            num_iterations, time_block);
+      q.wait_and_throw();
+
+      double time_temporal = t_temporal.Elapsed() * 1e3;
+      PrintStats(time_temporal, n1, n2, n3, num_iterations);
+      PrintRooflineStats(time_temporal, n1, n2, n3, num_iterations,
+                         time_block, bandwidth);
+      std::cout << "speedup over the default kernel: "
+                << time_dpc / time_temporal << "x\n";
+
+      if (num_iterations % 2) {
+        error = WithinEpsilon(next_base, sycl_ref, n1, n2, n3, kHalfLength, 0,
+                              0.1f);
+      } else {
+        error = WithinEpsilon(prev_base, sycl_ref, n1, n2, n3, kHalfLength, 0,
+                              0.1f);
+      }
+      if (error) {
+        std::cout << "Final wavefields from the temporal blocking and default "
+                  << "SYCL kernels are not equivalent: Fail\n";
+      } else {
+        std::cout << "Final wavefields from the temporal blocking and default "
+                  << "SYCL kernels are equivalent: Success\n";
+      }
+      std::cout << "--------------------------------------\n";
+      delete[] sycl_ref;
+    }
   }
 
   // If running both OpenMP/Serial and SYCL version
   // Comparing results
   if (omp && sycl) {
+    bool error_omp;
     if (num_iterations % 2) {
-      error = WithinEpsilon(next_base, temp, n1, n2, n3, kHalfLength, 0, 0.1f);
+      error_omp = WithinEpsilon(next_base, temp, n1, n2, n3, kHalfLength, 0, 0.1f);
     } else {
-      error = WithinEpsilon(prev_base, temp, n1, n2, n3, kHalfLength, 0, 0.1f);
+      error_omp =
+          WithinEpsilon(prev_base, temp, n1, n2, n3, kHalfLength, 0, 0.1f);
     }
-    if (error) {
+    error |= error_omp;
+    if (error_omp) {
       std::cout << "Final wavefields from SYCL device and CPU are not "
                 << "equivalent: Fail\n";
     } else {
@@ -173,35 +173,13 @@ void Iso3dfdIterationSLM(sycl::nd_item<3> it, float *next, float *prev,
 }
 
 /*
- * Device-Code - Optimized for GPU, CPU
- * SYCL implementation for single iteration of iso3dfd kernel
- * without using any shared local memory optimizations
- *
- *
- * ND-Range kernel is used to spawn work-items in x, y dimension
- * Each work-item can then traverse in the z-dimension
- *
- * z-dimension slicing can be used to vary the total number
- * global work-items.
- *
+ * Device-Code
+ * Updates the grid points [begin_z, end_z) of the column of the
+ * work-item, starting at position gid in the grid (begin_z < end_z)
  */
-void Iso3dfdIterationGlobal(sycl::nd_item<3> it, float *next, float *prev,
-                            float *vel, const float *coeff, int nx, int nxy,
-                            int bx, int by, int z_offset, int full_end_z) {
-  // We compute the start and the end position in the grid
-  // for each work-item.
-  // Each work-items local value gid is updated to track the
-  // current cell/grid point it is working with.
-  // This position is calculated with the help of slice-ID and number of
-  // grid points each work-item will process.
-  // Offset of kHalfLength is also used to account for HALO
-  auto begin_z = it.get_global_id(0) * z_offset + kHalfLength;
-  auto end_z = begin_z + z_offset;
-  if (end_z > full_end_z) end_z = full_end_z;
-
-  auto gid = (it.get_global_id(2) + bx) + ((it.get_global_id(1) + by) * nx) +
-             (begin_z * nxy);
-
+void Iso3dfdColumnGlobal(float *next, float *prev, float *vel,
+                         const float *coeff, int nx, int nxy, size_t gid,
+                         size_t begin_z, size_t end_z) {
   // front and back temporary arrays are used to ensure
   // the grid values in z-dimension are read once, shifted in
   // these array and re-used multiple times before being discarded
@@ -273,6 +251,84 @@ void Iso3dfdIterationGlobal(sycl::nd_item<3> it, float *next, float *prev,
   }
 }
 
+/*
+ * Device-Code - Optimized for GPU, CPU
+ * SYCL implementation for single iteration of iso3dfd kernel
+ * without using any shared local memory optimizations
+ *
+ *
+ * ND-Range kernel is used to spawn work-items in x, y dimension
+ * Each work-item can then traverse in the z-dimension
+ *
+ * z-dimension slicing can be used to vary the total number
+ * global work-items.
+ *
+ */
+void Iso3dfdIterationGlobal(sycl::nd_item<3> it, float *next, float *prev,
+                            float *vel, const float *coeff, int nx, int nxy,
+                            int bx, int by, int z_offset, int full_end_z) {
+  // We compute the start and the end position in the grid
+  // for each work-item.
+  // Each work-items local value gid is updated to track the
+  // current cell/grid point it is working with.
+  // This position is calculated with the help of slice-ID and number of
+  // grid points each work-item will process.
+  // Offset of kHalfLength is also used to account for HALO
+  auto begin_z = it.get_global_id(0) * z_offset + kHalfLength;
+  auto end_z = begin_z + z_offset;
+  if (end_z > full_end_z) end_z = full_end_z;
+
+  auto gid = (it.get_global_id(2) + bx) + ((it.get_global_id(1) + by) * nx) +
+             (begin_z * nxy);
+
+  Iso3dfdColumnGlobal(next, prev, vel, coeff, nx, nxy, gid, begin_z, end_z);
+}
+
+/*
+ * Device-Code - Temporal blocking, for GPU and CPU
+ * SYCL implementation for one step of the wavefront that advances
+ * several time steps over the grid in a single sweep along z
+ *
+ * The grid is cut along z into slabs of slab_z >= kHalfLength planes, so
+ * that the stencil of a slab only reaches into the neighboring slabs.
+ * Time step (first_step + level) of the time block is computed for slab
+ * (wave - 2 * level): the wavefront computes every time step of the block,
+ * each one two slabs behind the previous one. A slab is then updated once
+ * the slab ahead of it holds the previous time step, and before the slab
+ * behind it is overwritten by the next one, so that all the time steps of
+ * a wavefront step are independent and ping-pong through 'next' and
+ * 'prev' as in the other kernels.
+ *
+ * The time steps of the block work on a window of about 2 * time_block + 1
+ * slabs that slides along z, so the grid is read from memory once per time
+ * block instead of once per time step if this window fits in the cache.
+ *
+ * ND-Range kernel is used to spawn work-items in x, y dimension and
+ * one time step in the first dimension
+ */
+void Iso3dfdIterationWavefront(sycl::nd_item<3> it, float *next, float *prev,
+                               float *vel, const float *coeff, int nx,
+                               int nxy, int bx, int by, int slab_z,
+                               int full_end_z, int wave, int num_slabs,
+                               int first_step) {
+  int level = it.get_global_id(0);
+  int slab = wave - 2 * level;
+  if (slab < 0 || slab >= num_slabs) return;
+
+  size_t begin_z = slab * slab_z + kHalfLength;
+  size_t end_z = begin_z + slab_z;
+  if (end_z > full_end_z) end_z = full_end_z;
+
+  auto gid = (it.get_global_id(2) + bx) + ((it.get_global_id(1) + by) * nx) +
+             (begin_z * nxy);
+
+  // Alternate 'next' and 'prev' as the time steps advance
+  if ((first_step + level) % 2 == 0)
+    Iso3dfdColumnGlobal(next, prev, vel, coeff, nx, nxy, gid, begin_z, end_z);
+  else
+    Iso3dfdColumnGlobal(prev, next, vel, coeff, nx, nxy, gid, begin_z, end_z);
+}
+
 /*
  * Host-side SYCL Code
  *
@@ -416,3 +472,409 @@ bool Iso3dfdDevice(sycl::queue &q, float *ptr_next, float *ptr_prev,
   }  // end buffer scope
   return true;
 }
+
+/*
+ * Host-side SYCL Code
+ *
+ * Driver function for the temporal blocking variant of ISO3DFD.
+ * Advances the wavefield time_block time steps per sweep of the grid,
+ * with the wavefront kernel "Iso3dfdIterationWavefront"
+ *
+ * The results are identical to the ones of Iso3dfdDevice: after
+ * nIterations time steps, the last wavefield is in ptr_next if nIterations
+ * is odd, and in ptr_prev otherwise
+ */
+bool Iso3dfdDeviceTemporal(sycl::queue &q, float *ptr_next, float *ptr_prev,
+                           float *ptr_vel, float *ptr_coeff, size_t n1,
+                           size_t n2, size_t n3, size_t n1_block,
+                           size_t n2_block, size_t n3_block, size_t end_z,
+                           unsigned int nIterations, unsigned int time_block) {
+  auto nx = n1;
+  auto nxy = n1 * n2;
+
+  auto bx = kHalfLength;
+  auto by = kHalfLength;
+
+  // The slabs must be at least as thick as the stencil radius
+  size_t slab_z = std::max<size_t>(n3_block, kHalfLength);
+  size_t num_slabs = (n3 - 2 * kHalfLength + slab_z - 1) / slab_z;
+
+  // Display information about the selected device
+  PrintTargetInfo(q, n1_block, n2_block);
+  std::cout << " Using Wavefront Temporal Blocking: " << time_block
+            << " time steps per sweep, slabs of " << slab_z << " planes\n";
+
+  auto grid_size = nxy * n3;
+
+  {  // Begin buffer scope
+    // Create buffers using SYCL class buffer
+    buffer b_ptr_next(ptr_next, range(grid_size));
+    buffer b_ptr_prev(ptr_prev, range(grid_size));
+    buffer b_ptr_vel(ptr_vel, range(grid_size));
+    buffer b_ptr_coeff(ptr_coeff, range(kHalfLength + 1));
+
+    // Iterate over blocks of time steps
+    for (unsigned int i = 0; i < nIterations; i += time_block) {
+      unsigned int depth = std::min(time_block, nIterations - i);
+
+      // Sweep the wavefront along z. The last time step of the block
+      // trails the first one by 2 * (depth - 1) slabs
+      for (size_t wave = 0; wave < num_slabs + 2 * (depth - 1); wave++) {
+        // Submit command group for execution
+        q.submit([&](auto &h) {
+          // Create accessors
+          accessor next(b_ptr_next, h);
+          accessor prev(b_ptr_prev, h);
+          accessor vel(b_ptr_vel, h, read_only);
+          accessor coeff(b_ptr_coeff, h, read_only);
+
+          // Same work-groups as Iso3dfdDevice, with one time step of the
+          // block per index of the first dimension
+          auto local_nd_range = range(1, n2_block, n1_block);
+          auto global_nd_range =
+              range(depth, (n2 - 2 * kHalfLength), (n1 - 2 * kHalfLength));
+
+          h.parallel_for(
+              nd_range(global_nd_range, local_nd_range), [=](auto it) {
+                Iso3dfdIterationWavefront(
+                    it, next.get_pointer(), prev.get_pointer(),
+                    vel.get_pointer(), coeff.get_pointer(), nx, nxy, bx, by,
+                    slab_z, end_z, wave, num_slabs, i);
+              });
+        });
+      }
+    }
+  }  // end buffer scope
+  return true;
+}
+
+/*
+ * Host-side SYCL Code
+ *
+ * Measures the memory bandwidth of the device with a triad kernel over
+ * arrays of n elements, which moves 12 bytes per element (read a and b,
+ * write c), the same number of bytes per grid point as counted for the
+ * stencil kernels by PrintStats
+ *
+ * Returns the best bandwidth of a few runs, in GBytes/s
+ */
+double MeasureDeviceBandwidth(sycl::queue &q, size_t n) {
+  constexpr int kRuns = 5;
+  double best_time = 0.0;
+
+  buffer<float> b_a{range(n)};
+  buffer<float> b_b{range(n)};
+  buffer<float> b_c{range(n)};
+
+  q.submit([&](auto &h) {
+    accessor a(b_a, h, write_only, no_init);
+    accessor b(b_b, h, write_only, no_init);
+    accessor c(b_c, h, write_only, no_init);
+    h.parallel_for(range(n), [=](auto i) {
+      a[i] = 1.0f;
+      b[i] = 2.0f;
+      c[i] = 0.0f;
+    });
+  });
+  q.wait_and_throw();
+
+  // The first run is a warm-up
+  for (int run = 0; run <= kRuns; run++) {
+    auto start = std::chrono::steady_clock::now();
+    q.submit([&](auto &h) {
+      accessor a(b_a, h, read_only);
+      accessor b(b_b, h, read_only);
+      accessor c(b_c, h, write_only, no_init);
+      h.parallel_for(range(n), [=](auto i) { c[i] = a[i] + 0.5f * b[i]; });
+    });
+    q.wait_and_throw();
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    if (run > 0 && (best_time == 0.0 || time.count() < best_time))
+      best_time = time.count();
+  }
+
+  return 12.0 * n / best_time / 1e9;
+}
+
+/*
+ * Host-Code
+ * Devices used by the ranks of Iso3dfdMultiDevice: the NUMA domains of
+ * the device if it can be partitioned that way (e.g. the sockets of a
+ * multi-socket CPU), else the device itself
+ */
+std::vector<sycl::device> GetRankDevices(const sycl::device &root) {
+  try {
+    auto sub_devices = root.create_sub_devices<
+        info::partition_property::partition_by_affinity_domain>(
+        info::partition_affinity_domain::numa);
+    if (sub_devices.size() > 1) return sub_devices;
+  } catch (sycl::exception const &) {
+    // The device cannot be partitioned, use it as a whole
+  }
+  return {root};
+}
+
+// State of one rank of Iso3dfdMultiDevice
+struct Iso3dfdRank {
+  sycl::queue q;
+  // First grid plane and number of planes of the slab owned by the rank
+  size_t z0;
+  size_t nz;
+  // Wavefields and velocity of the slab, with kHalfLength halo planes on
+  // both sides, allocated on the device of the rank
+  float *next;
+  float *prev;
+  float *vel;
+  float *coeff;
+  // Host staging buffers for the first and last kHalfLength planes of
+  // the slab, read by the neighbors of the rank
+  float *send_lo;
+  float *send_hi;
+  // Time spent in kernels and in halo copies, in seconds
+  double compute_time;
+  double exchange_time;
+};
+
+/*
+ * Host-Code
+ * Execution time of a command submitted to a queue with profiling enabled
+ */
+static double EventTime(sycl::event &e) {
+  auto start = e.get_profiling_info<info::event_profiling::command_start>();
+  auto end = e.get_profiling_info<info::event_profiling::command_end>();
+  return (end - start) * 1e-9;
+}
+
+/*
+ * Host-Code
+ * Free the slab and staging buffers of a rank (the pointers that were
+ * allocated)
+ */
+static void FreeRank(Iso3dfdRank &rank) {
+  if (rank.next) sycl::free(rank.next, rank.q);
+  if (rank.prev) sycl::free(rank.prev, rank.q);
+  if (rank.vel) sycl::free(rank.vel, rank.q);
+  if (rank.coeff) sycl::free(rank.coeff, rank.q);
+  if (rank.send_lo) sycl::free(rank.send_lo, rank.q);
+  if (rank.send_hi) sycl::free(rank.send_hi, rank.q);
+}
+
+/*
+ * Host-side SYCL Code
+ *
+ * Driver function for ISO3DFD with a domain decomposition along z
+ * across num_ranks SYCL queues
+ *
+ * Each rank owns a slab of the grid, allocated with USM on its own device,
+ * plus kHalfLength halo planes on each side. At each time step, a rank
+ * first updates the kHalfLength planes at both ends of its slab, then
+ * sends them to its neighbors through host staging buffers while it
+ * updates the rest of its slab, so that the halo exchange is overlapped
+ * with the interior computation.
+ *
+ * The host arrays hold the initial wavefields on entry, and the final
+ * wavefields on exit, as with Iso3dfdDevice
+ */
+bool Iso3dfdMultiDevice(sycl::queue &q, float *ptr_next, float *ptr_prev,
+                        float *ptr_vel, float *ptr_coeff, size_t n1, size_t n2,
+                        size_t n3, size_t n1_block, size_t n2_block,
+                        size_t n3_block, unsigned int nIterations,
+                        unsigned int num_ranks) {
+  auto nx = n1;
+  auto nxy = n1 * n2;
+
+  auto bx = kHalfLength;
+  auto by = kHalfLength;
+
+  // Split the planes of the grid evenly across the ranks. The updates
+  // of both ends of a slab must not overlap
+  size_t planes = n3 - 2 * kHalfLength;
+  if (planes < num_ranks * 2 * kHalfLength) {
+    std::cout << " ERROR: Invalid Grid Size: n3 should be at least "
+              << 2 * kHalfLength << " per rank\n";
+    return false;
+  }
+
+  auto devices = GetRankDevices(q.get_device());
+  sycl::context ctx(devices);
+
+  // Display information about the selected device
+  PrintTargetInfo(q, n1_block, n2_block);
+  std::cout << " Using " << num_ranks << " ranks on " << devices.size()
+            << " device(s)\n";
+
+  size_t halo_size = kHalfLength * nxy;
+  size_t halo_bytes = halo_size * sizeof(float);
+
+  std::vector<Iso3dfdRank> ranks;
+  size_t z0 = kHalfLength;
+  for (unsigned int r = 0; r < num_ranks; r++) {
+    auto &device = devices[r % devices.size()];
+    Iso3dfdRank rank{
+        sycl::queue(ctx, device, property::queue::enable_profiling())};
+    rank.z0 = z0;
+    rank.nz = planes / num_ranks + (r < planes % num_ranks ? 1 : 0);
+    z0 += rank.nz;
+
+    size_t size = (rank.nz + 2 * kHalfLength) * nxy;
+    rank.next = malloc_device<float>(size, rank.q);
+    rank.prev = malloc_device<float>(size, rank.q);
+    rank.vel = malloc_device<float>(size, rank.q);
+    rank.coeff = malloc_device<float>(kHalfLength + 1, rank.q);
+    rank.send_lo = malloc_host<float>(halo_size, rank.q);
+    rank.send_hi = malloc_host<float>(halo_size, rank.q);
+    if (!rank.next || !rank.prev || !rank.vel || !rank.coeff ||
+        !rank.send_lo || !rank.send_hi) {
+      std::cout << " ERROR: Failed to allocate the slab of rank " << r
+                << "\n";
+      FreeRank(rank);
+      for (auto &allocated : ranks) FreeRank(allocated);
+      return false;
+    }
+
+    std::cout << " Rank " << r << ": planes " << rank.z0 - kHalfLength
+              << " to " << rank.z0 - kHalfLength + rank.nz - 1 << " on "
+              << device.get_info<sycl::info::device::name>() << "\n";
+
+    // Touch the slab with a kernel of the rank first, so that its pages are
+    // placed in the memory of the device (the NUMA domain on a CPU)
+    float *next = rank.next, *prev = rank.prev, *vel = rank.vel;
+    rank.q.submit([&](auto &h) {
+      h.parallel_for(range(size), [=](id<1> i) {
+        next[i] = 0.0f;
+        prev[i] = 0.0f;
+        vel[i] = 0.0f;
+      });
+    });
+    rank.q.wait();
+
+    // Copy the slab and its halos from the host arrays
+    size_t offset = (rank.z0 - kHalfLength) * nxy;
+    rank.q.memcpy(rank.next, ptr_next + offset, size * sizeof(float));
+    rank.q.memcpy(rank.prev, ptr_prev + offset, size * sizeof(float));
+    rank.q.memcpy(rank.vel, ptr_vel + offset, size * sizeof(float));
+    rank.q.memcpy(rank.coeff, ptr_coeff, (kHalfLength + 1) * sizeof(float));
+    rank.q.wait();
+
+    ranks.push_back(rank);
+  }
+
+  auto local_nd_range = range(1, n2_block, n1_block);
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Iterate over time steps
+  for (unsigned int i = 0; i < nIterations; i++) {
+    std::vector<sycl::event> compute(2 * num_ranks);
+    std::vector<sycl::event> sends;
+
+    for (unsigned int r = 0; r < num_ranks; r++) {
+      auto &rank = ranks[r];
+      // Alternate 'next' and 'prev' at every time step
+      float *next = (i % 2 == 0) ? rank.next : rank.prev;
+      float *prev = (i % 2 == 0) ? rank.prev : rank.next;
+      float *vel = rank.vel;
+      float *coeff = rank.coeff;
+      size_t nz = rank.nz;
+
+      // Update the first and last kHalfLength planes of the slab, one per
+      // index of the first dimension
+      compute[2 * r] = rank.q.submit([&](auto &h) {
+        auto global_nd_range =
+            range(2, (n2 - 2 * kHalfLength), (n1 - 2 * kHalfLength));
+        h.parallel_for(
+            nd_range(global_nd_range, local_nd_range), [=](auto it) {
+              size_t begin_z = (it.get_global_id(0) == 0) ? kHalfLength : nz;
+              size_t end_z = begin_z + kHalfLength;
+              auto gid = (it.get_global_id(2) + bx) +
+                         ((it.get_global_id(1) + by) * nx) + (begin_z * nxy);
+              Iso3dfdColumnGlobal(next, prev, vel, coeff, nx, nxy, gid,
+                                  begin_z, end_z);
+            });
+      });
+
+      // Send them to the neighbors
+      if (r > 0)
+        sends.push_back(rank.q.memcpy(rank.send_lo, next + kHalfLength * nxy,
+                                      halo_bytes, compute[2 * r]));
+      if (r < num_ranks - 1)
+        sends.push_back(rank.q.memcpy(rank.send_hi, next + nz * nxy,
+                                      halo_bytes, compute[2 * r]));
+
+      // Update the rest of the slab in the meantime
+      if (nz > 2 * kHalfLength) {
+        compute[2 * r + 1] = rank.q.submit([&](auto &h) {
+          auto global_nd_range =
+              range((nz - 2 * kHalfLength + n3_block - 1) / n3_block,
+                    (n2 - 2 * kHalfLength), (n1 - 2 * kHalfLength));
+          h.parallel_for(
+              nd_range(global_nd_range, local_nd_range), [=](auto it) {
+                size_t begin_z = it.get_global_id(0) * n3_block +
+                                 2 * kHalfLength;
+                size_t end_z = begin_z + n3_block;
+                if (end_z > nz) end_z = nz;
+                auto gid = (it.get_global_id(2) + bx) +
+                           ((it.get_global_id(1) + by) * nx) +
+                           (begin_z * nxy);
+                Iso3dfdColumnGlobal(next, prev, vel, coeff, nx, nxy, gid,
+                                    begin_z, end_z);
+              });
+        });
+      }
+    }
+
+    // Receive the halos once all the ranks have sent their planes
+    for (auto &e : sends) e.wait();
+
+    std::vector<sycl::event> receives;
+    for (unsigned int r = 0; r < num_ranks; r++) {
+      auto &rank = ranks[r];
+      float *next = (i % 2 == 0) ? rank.next : rank.prev;
+      if (r > 0)
+        receives.push_back(
+            rank.q.memcpy(next, ranks[r - 1].send_hi, halo_bytes));
+      if (r < num_ranks - 1)
+        receives.push_back(
+            rank.q.memcpy(next + (kHalfLength + rank.nz) * nxy,
+                          ranks[r + 1].send_lo, halo_bytes));
+    }
+    for (auto &rank : ranks) rank.q.wait_and_throw();
+
+    // Account the time of each command to its rank
+    size_t send = 0, receive = 0;
+    for (unsigned int r = 0; r < num_ranks; r++) {
+      auto &rank = ranks[r];
+      rank.compute_time += EventTime(compute[2 * r]);
+      if (rank.nz > 2 * kHalfLength)
+        rank.compute_time += EventTime(compute[2 * r + 1]);
+      int neighbors = (r > 0 ? 1 : 0) + (r < num_ranks - 1 ? 1 : 0);
+      for (int n = 0; n < neighbors; n++) {
+        rank.exchange_time += EventTime(sends[send++]);
+        rank.exchange_time += EventTime(receives[receive++]);
+      }
+    }
+  }
+
+  std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+
+  // Print the time spent by each rank in computation and in halo exchange
+  std::cout << " Time steps       : " << time.count() << " secs\n";
+  for (unsigned int r = 0; r < num_ranks; r++) {
+    std::cout << " Rank " << r << " compute  : " << ranks[r].compute_time
+              << " secs, exchange : " << ranks[r].exchange_time << " secs\n";
+  }
+
+  // Copy the slabs back to the host arrays and free them
+  for (auto &rank : ranks) {
+    size_t offset = rank.z0 * nxy;
+    size_t bytes = rank.nz * nxy * sizeof(float);
+    rank.q.memcpy(ptr_next + offset, rank.next + halo_size, bytes);
+    rank.q.memcpy(ptr_prev + offset, rank.prev + halo_size, bytes);
+    rank.q.wait_and_throw();
+
+    FreeRank(rank);
+  }
+  return true;
+}
@@ -86,7 +86,8 @@ void Usage(const std::string& programName) {
   std::cout << " Incorrect parameters \n";
   std::cout << " Usage: ";
   std::cout << programName
-            << " n1 n2 n3 b1 b2 b3 Iterations [omp|sycl] [gpu|cpu] \n\n";
+            << " n1 n2 n3 b1 b2 b3 Iterations [omp|sycl] [gpu|cpu]"
+            << " [tblock=T|ranks=N] \n\n";
   std::cout << " n1 n2 n3      : Grid sizes for the stencil \n";
   std::cout << " b1 b2 b3      : cache block sizes for cpu openmp version.\n";
   std::cout << " Iterations    : No. of timesteps. \n";
@@ -94,7 +95,13 @@ void Usage(const std::string& programName) {
             << " Default is to use both for validation \n";
   std::cout
       << " [gpu|cpu]     : Optional: Device to run the SYCL version"
-      << " Default is to use the GPU if available, if not fallback to CPU \n\n";
+      << " Default is to use the GPU if available, if not fallback to CPU \n";
+  std::cout << " [tblock=T]    : Optional: Also run the SYCL version with"
+            << " temporal blocking, T time steps per sweep of the grid,"
+            << " and compare it with the default kernel \n";
+  std::cout << " [ranks=N]     : Optional: Run the SYCL version on N ranks,"
+            << " each one owning a slab of the grid along n3, on the NUMA"
+            << " domains of the device if it has several \n\n";
 }
 
 /*
@@ -122,6 +129,37 @@ void PrintStats(double time, size_t n1, size_t n2, size_t n3,
   std::cout << "\n--------------------------------------\n";
 }
 
+/*
+ * Host-Code
+ * Utility function to print roofline-style stats
+ *
+ * The kernels move 12 bytes per grid point and time step from memory
+ * (see PrintStats). With temporal blocking, the grid is ideally read once
+ * per time_block time steps, which divides the bytes per grid point and
+ * time step by time_block. The throughput is bounded by the bandwidth of
+ * the device divided by these bytes.
+ */
+void PrintRooflineStats(double time, size_t n1, size_t n2, size_t n3,
+                        unsigned int nIterations, unsigned int time_block,
+                        double bandwidth) {
+  double points = (double)(n1 - 2 * kHalfLength) * (n2 - 2 * kHalfLength) *
+                  (n3 - 2 * kHalfLength) * nIterations;
+  double gpoints = points / (time * 1e6);
+  double bytes_per_point = 12.0 / time_block;
+  double flops_per_point = 7.0 * kHalfLength + 5.0;
+  double bound_gpoints = bandwidth / bytes_per_point;
+
+  std::cout << "time steps per sweep  : " << time_block << "\n";
+  std::cout << "throughput            : " << gpoints << " GPts/s\n";
+  std::cout << "effective bandwidth   : " << 12.0 * gpoints << " GBytes/s\n";
+  std::cout << "device bandwidth      : " << bandwidth << " GBytes/s\n";
+  std::cout << "arithmetic intensity  : " << flops_per_point / bytes_per_point
+            << " Flops/Byte\n";
+  std::cout << "roofline bound        : " << bound_gpoints << " GPts/s ("
+            << 100.0 * gpoints / bound_gpoints << "% reached)\n";
+  std::cout << "--------------------------------------\n";
+}
+
 /*
  * Host-Code
  * Utility function to calculate L2-norm between resulting buffer and reference
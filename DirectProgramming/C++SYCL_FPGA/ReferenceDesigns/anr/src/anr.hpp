@@ -35,8 +35,11 @@ using namespace sycl;
 
 // declare the kernel and pipe names globally to reduce name mangling
 class IntraPipeID;
+class StreamingIntraPipeID;
 class VerticalKernelID;
 class HorizontalKernelID;
+class StreamingVerticalKernelID;
+class StreamingHorizontalKernelID;
 
 //
 // A struct to carry the new (i.e., current) pixel, the original pixel, and the
@@ -279,28 +282,11 @@ struct HorizontalFunctor {
 };
 
 //
-// Submit all of the ANR kernels (vertical and horizontal)
+// Validate the image size against the template parameters of the ANR kernels
 //
-template <typename IndexT, typename InPipe, typename OutPipe,
-          unsigned filter_size, unsigned pixels_per_cycle,
+template <typename IndexT, unsigned filter_size, unsigned pixels_per_cycle,
           unsigned max_cols>
-std::vector<event> SubmitANRKernels(queue& q, int cols, int rows,
-                                    ANRParams params,
-                                    float* sig_i_lut_data_ptr) {
-  // the internal pipe between the vertical and horizontal kernels
-  using IntraPipeT =
-      fpga_tools::DataBundle<DataForwardStruct, pixels_per_cycle>;
-  using IntraPipe = ext::intel::pipe<IntraPipeID, IntraPipeT>;
-
-  // static asserts to validate template arguments
-  static_assert(filter_size > 1);
-  static_assert(max_cols > 1);
-  static_assert(pixels_per_cycle > 0);
-  static_assert(fpga_tools::IsPow2(pixels_per_cycle));
-  static_assert(max_cols > pixels_per_cycle);
-  static_assert(std::is_integral_v<IndexT>);
-
-  // validate the function arguments
+void ValidateANRSize(int cols, int rows) {
   int padded_cols = PadColumns<IndexT, filter_size>(cols);
   if (cols > max_cols) {
     std::cerr << "ERROR: cols exceeds the maximum (max_cols) "
@@ -334,6 +320,32 @@ std::vector<event> SubmitANRKernels(queue& q, int cols, int rows,
               << std::numeric_limits<IndexT>::max() << ")\n";
     std::terminate();
   }
+}
+
+//
+// Submit all of the ANR kernels (vertical and horizontal)
+//
+template <typename IndexT, typename InPipe, typename OutPipe,
+          unsigned filter_size, unsigned pixels_per_cycle,
+          unsigned max_cols>
+std::vector<event> SubmitANRKernels(queue& q, int cols, int rows,
+                                    ANRParams params,
+                                    float* sig_i_lut_data_ptr) {
+  // the internal pipe between the vertical and horizontal kernels
+  using IntraPipeT =
+      fpga_tools::DataBundle<DataForwardStruct, pixels_per_cycle>;
+  using IntraPipe = ext::intel::pipe<IntraPipeID, IntraPipeT>;
+
+  // static asserts to validate template arguments
+  static_assert(filter_size > 1);
+  static_assert(max_cols > 1);
+  static_assert(pixels_per_cycle > 0);
+  static_assert(fpga_tools::IsPow2(pixels_per_cycle));
+  static_assert(max_cols > pixels_per_cycle);
+  static_assert(std::is_integral_v<IndexT>);
+
+  // validate the function arguments
+  ValidateANRSize<IndexT, filter_size, pixels_per_cycle, max_cols>(cols, rows);
 
   // cast the rows and columns to the index type and use these
   // variables inside the kernel to avoid the device dealing with conversions
@@ -397,4 +409,103 @@ std::vector<event> SubmitANRKernels(queue& q, int cols, int rows,
   return {vertical_kernel, horizontal_kernel};
 }
 
+//
+// Submit the streaming ANR kernels (vertical and horizontal).
+// Unlike 'SubmitANRKernels', which is called once per frame with a fixed set
+// of parameters, these kernels are launched once and process 'frames' frames
+// back-to-back. The ANR parameters of each frame are read from the
+// 'VerticalParamsPipe' and 'HorizontalParamsPipe' side-channel pipes before the
+// frame is processed, so that they can change every frame without restarting
+// the kernels. The intensity sigma LUT and the spatial filter are rebuilt from
+// the parameters of each frame; the exp() and inverse LUTs do not depend on
+// the parameters, so they remain constexpr ROMs.
+//
+template <typename IndexT, typename InPipe, typename OutPipe,
+          typename VerticalParamsPipe, typename HorizontalParamsPipe,
+          unsigned filter_size, unsigned pixels_per_cycle,
+          unsigned max_cols>
+std::vector<event> SubmitStreamingANRKernels(queue& q, int cols, int rows,
+                                             int frames) {
+  // the internal pipe between the vertical and horizontal kernels
+  using IntraPipeT =
+      fpga_tools::DataBundle<DataForwardStruct, pixels_per_cycle>;
+  using IntraPipe = ext::intel::pipe<StreamingIntraPipeID, IntraPipeT>;
+
+  // static asserts to validate template arguments
+  static_assert(filter_size > 1);
+  static_assert(max_cols > 1);
+  static_assert(pixels_per_cycle > 0);
+  static_assert(fpga_tools::IsPow2(pixels_per_cycle));
+  static_assert(max_cols > pixels_per_cycle);
+  static_assert(std::is_integral_v<IndexT>);
+
+  // validate the function arguments
+  ValidateANRSize<IndexT, filter_size, pixels_per_cycle, max_cols>(cols, rows);
+  if (frames <= 0) {
+    std::cerr << "ERROR: frames must be strictly positive\n";
+    std::terminate();
+  }
+
+  // cast the rows and columns to the index type and use these
+  // variables inside the kernel to avoid the device dealing with conversions
+  const IndexT cols_k(cols);
+  const IndexT rows_k(rows);
+
+  constexpr int filter_size_eff = (filter_size + 1) / 2;  // ceil(filter_size/2)
+
+  // Functors or lambdas can be used for the vertical and horizontal kernels.
+  auto vertical_func = VerticalFunctor<filter_size>();
+  auto horizontal_func = HorizontalFunctor<filter_size>();
+
+  // submit the vertical kernel using a column stencil
+  auto vertical_kernel = q.single_task<StreamingVerticalKernelID>([=] {
+    // build the constexpr exp() and inverse LUT ROMs
+    constexpr ExpLUT exp_lut;
+    constexpr InvLUT inv_lut;
+
+    for (int frame = 0; frame < frames; frame++) {
+      // get the parameters of this frame from the side channel
+      ANRParams params = VerticalParamsPipe::read();
+
+      // rebuild the spatial filter and the intensity sigma LUT
+      auto spatial_power = BuildGaussianPowers1D<filter_size_eff>(params.sig_s);
+      IntensitySigmaLUT sig_i_lut(params);
+
+      // Start the column stencil for this frame.
+      ColumnStencil<PixelT, DataForwardStruct, IndexT, InPipe,
+                    IntraPipe, filter_size, max_cols, pixels_per_cycle>(rows_k,
+                    cols_k, PixelT(0), vertical_func, spatial_power, params,
+                    std::cref(exp_lut), std::cref(inv_lut),
+                    std::ref(sig_i_lut));
+    }
+  });
+
+  // submit the horizontal kernel using a row stencil
+  auto horizontal_kernel = q.single_task<StreamingHorizontalKernelID>([=] {
+    // build the constexpr exp() and inverse LUT ROMs
+    constexpr ExpLUT exp_lut;
+    constexpr InvLUT inv_lut;
+
+    for (int frame = 0; frame < frames; frame++) {
+      // get the parameters of this frame from the side channel
+      ANRParams params = HorizontalParamsPipe::read();
+
+      // rebuild the spatial filter and convert the alpha and (1-alpha) values
+      // to fixed-point
+      auto spatial_power = BuildGaussianPowers1D<filter_size_eff>(params.sig_s);
+      ANRParams::AlphaFixedT alpha_fixed(params.alpha);
+      ANRParams::AlphaFixedT one_minus_alpha_fixed(params.one_minus_alpha);
+
+      // Start the row stencil for this frame.
+      RowStencil<DataForwardStruct, PixelT, IndexT, IntraPipe, OutPipe,
+                  filter_size, pixels_per_cycle>(rows_k, cols_k,
+                  DataForwardStruct(0), horizontal_func, spatial_power,
+                  params, alpha_fixed, one_minus_alpha_fixed,
+                  std::cref(exp_lut), std::cref(inv_lut));
+    }
+  });
+
+  return {vertical_kernel, horizontal_kernel};
+}
+
 #endif /* __ANR_HPP__ */
@@ -21,6 +21,15 @@ constexpr unsigned kPixelsPerCycle = PIXELS_PER_CYCLE;
 static_assert(kPixelsPerCycle > 0);
 static_assert(fpga_tools::IsPow2(kPixelsPerCycle) > 0);
 
+// The clock frequency of the compiled kernels in MHz, which is reported in
+// the compile report. The number of pixels processed per cycle can only be
+// computed when it is known, so 0 means that it is unknown.
+#ifndef KERNEL_CLOCK_MHZ
+#define KERNEL_CLOCK_MHZ 0
+#endif
+constexpr double kKernelClockMHz = KERNEL_CLOCK_MHZ;
+static_assert(kKernelClockMHz >= 0);
+
 // The maximum number of columns in the image
 #ifndef MAX_COLS
 #define MAX_COLS 1920 // HD
@@ -17,9 +17,12 @@ using namespace fpga_tools;
 
 //
 // Kernel to read data from device memory and write it into the ANR input pipe.
+// The frames are read back-to-back from a ring of 'frame_buffers' consecutive
+// frame buffers: frame 'f' is read from buffer 'f % frame_buffers'.
 //
 template <typename KernelId, typename T, typename Pipe, int pixels_per_cycle>
-event SubmitInputDMA(queue &q, T *in_ptr, int rows, int cols, int frames) {
+event SubmitInputDMA(queue &q, T *in_ptr, int rows, int cols, int frames,
+                     int frame_buffers = 1) {
   using PipeType = DataBundle<T, pixels_per_cycle>;
 
 #if defined (IS_BSP)
@@ -37,6 +40,13 @@ event SubmitInputDMA(queue &q, T *in_ptr, int rows, int cols, int frames) {
     std::terminate();
   }
 
+  // validate the number of frame buffers
+  if (frame_buffers <= 0) {
+    std::cerr << "ERROR: the number of frame buffers must be strictly "
+              << "positive\n";
+    std::terminate();
+  }
+
   // the number of iterations is the number of total pixels (rows*cols)
   // divided by the number of pixels per cycle
   const int iterations = cols * rows / pixels_per_cycle;
@@ -54,14 +64,17 @@ event SubmitInputDMA(queue &q, T *in_ptr, int rows, int cols, int frames) {
     // loop_coalesce attribute
     [[intel::loop_coalesce(2)]]
     for (int f = 0; f < frames; f++) {
+      // the offset of the frame buffer to read this frame from
+      const int frame_offset = (f % frame_buffers) * rows * cols;
       for (int i = 0; i < iterations; i++) {
         PipeType pipe_data;
         #pragma unroll
         for (int k = 0; k < pixels_per_cycle; k++) {
+          const int idx = frame_offset + i * pixels_per_cycle + k;
 #if defined (IS_BSP)
-          pipe_data[k] = NonCachingLSU::load(in + i * pixels_per_cycle + k);
+          pipe_data[k] = NonCachingLSU::load(in + idx);
 #else 
-          pipe_data[k] = in[i * pixels_per_cycle + k];
+          pipe_data[k] = in[idx];
 #endif   
         }
         Pipe::write(pipe_data);
@@ -72,9 +85,12 @@ event SubmitInputDMA(queue &q, T *in_ptr, int rows, int cols, int frames) {
 
 //
 // Kernel to pull data out of the ANR output pipe and writes to device memory.
+// The frames are written back-to-back to a ring of 'frame_buffers' consecutive
+// frame buffers: frame 'f' is written to buffer 'f % frame_buffers'.
 //
 template <typename KernelId, typename T, typename Pipe, int pixels_per_cycle>
-event SubmitOutputDMA(queue &q, T *out_ptr, int rows, int cols, int frames) {
+event SubmitOutputDMA(queue &q, T *out_ptr, int rows, int cols, int frames,
+                      int frame_buffers = 1) {
   // validate the number of columns
   if ((cols % pixels_per_cycle) != 0) {
     std::cerr << "ERROR: the number of columns is not a multiple of the pixels "
@@ -82,6 +98,13 @@ event SubmitOutputDMA(queue &q, T *out_ptr, int rows, int cols, int frames) {
     std::terminate();
   }
 
+  // validate the number of frame buffers
+  if (frame_buffers <= 0) {
+    std::cerr << "ERROR: the number of frame buffers must be strictly "
+              << "positive\n";
+    std::terminate();
+  }
+
   // the number of iterations is the number of total pixels (rows*cols)
   // divided by the number of pixels per cycle
   const int iterations = cols * rows / pixels_per_cycle;
@@ -99,15 +122,53 @@ event SubmitOutputDMA(queue &q, T *out_ptr, int rows, int cols, int frames) {
     // loop_coalesce attribute
     [[intel::loop_coalesce(2)]]
     for (int f = 0; f < frames; f++) {
+      // the offset of the frame buffer to write this frame to
+      const int frame_offset = (f % frame_buffers) * rows * cols;
       for (int i = 0; i < iterations; i++) {
         auto pipe_data = Pipe::read();
         #pragma unroll
         for (int k = 0; k < pixels_per_cycle; k++) {
-          out[i * pixels_per_cycle + k] = pipe_data[k];
+          out[frame_offset + i * pixels_per_cycle + k] = pipe_data[k];
         }
       }
     }
 });
 }
 
+//
+// Kernel to read the per-frame parameters from device memory and write them
+// to the side-channel pipes of the vertical and horizontal ANR kernels. The
+// parameters of frame 'f' are 'params_ptr[f % param_count]'.
+//
+template <typename KernelId, typename T, typename VerticalPipe,
+          typename HorizontalPipe>
+event SubmitParamsDMA(queue &q, T *params_ptr, int param_count, int frames) {
+  // validate the number of parameter sets
+  if (param_count <= 0) {
+    std::cerr << "ERROR: the number of parameter sets must be strictly "
+              << "positive\n";
+    std::terminate();
+  }
+
+  return q.single_task<KernelId>([=]() [[intel::kernel_args_restrict]] {
+
+#if defined (IS_BSP)
+    sycl::ext::intel::device_ptr<T> params(params_ptr);
+#else 
+    T* params(params_ptr);
+#endif
+
+    int param_idx = 0;
+    for (int f = 0; f < frames; f++) {
+      // the writes block once the pipes are full, so the parameters only run
+      // ahead of the ANR kernels by the capacity of the pipes
+      T frame_params = params[param_idx];
+      VerticalPipe::write(frame_params);
+      HorizontalPipe::write(frame_params);
+
+      param_idx = (param_idx == param_count - 1) ? 0 : param_idx + 1;
+    }
+  });
+}
+
 #endif /* __DMA_KERNELS_HPP__ */
\ No newline at end of file
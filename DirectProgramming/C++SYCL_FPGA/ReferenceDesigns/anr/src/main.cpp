@@ -35,6 +35,11 @@ double RunANR(queue& q, PixelT* in_ptr, PixelT* out_ptr, int cols, int rows,
 
 bool Validate(PixelT* val, PixelT* ref, int rows, int cols,
               double psnr_thresh = kPSNRDefaultThreshold);
+
+int RunStreamingBenchmark(queue& q, std::vector<PixelT>& in_pixels,
+                          std::vector<PixelT>& ref_pixels, int cols, int rows,
+                          int runs, int frames, ANRParams params,
+                          double kernel_clock_mhz);
 ////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char* argv[]) {
@@ -53,6 +58,17 @@ int main(int argc, char* argv[]) {
   int frames = 8;
 #endif
 
+#if defined(STREAMING)
+  // the streaming benchmark processes many frames back-to-back
+#if defined(FPGA_EMULATOR)
+  frames = 6;
+#elif defined(FPGA_SIMULATOR)
+  frames = 3;
+#else
+  frames = 3000;
+#endif
+#endif
+
   // get the input data directory
   if (argc > 1) {
     data_dir = std::string(argv[1]);
@@ -68,6 +84,14 @@ int main(int argc, char* argv[]) {
     frames = atoi(argv[3]);
   }
 
+  // get the clock frequency of the compiled kernels in MHz, from the compile
+  // report, as the fourth command line argument. The default is the value
+  // given to CMake with -DKERNEL_CLOCK_MHZ, if any (see constants.hpp).
+  double kernel_clock_mhz = kKernelClockMHz;
+  if (argc > 4) {
+    kernel_clock_mhz = atof(argv[4]);
+  }
+
   // enforce at least two runs
   if (runs < 2) {
     std::cerr << "ERROR: 'runs' must be 2 or more\n";
@@ -79,6 +103,12 @@ int main(int argc, char* argv[]) {
     std::cerr << "ERROR: 'frames' must be atleast 1\n";
     std::terminate();
   }
+
+  // a clock frequency of 0 means that it is unknown
+  if (kernel_clock_mhz < 0) {
+    std::cerr << "ERROR: 'kernel_clock_mhz' must not be negative\n";
+    std::terminate();
+  }
   /////////////////////////////////////////////////////////////
 
 #if FPGA_SIMULATOR
@@ -114,6 +144,12 @@ int main(int argc, char* argv[]) {
   ParseFiles(data_dir, in_pixels, ref_pixels, cols, rows, params);
   pixel_count = cols * rows;
 
+#if defined(STREAMING)
+  // run the multi-frame streaming benchmark with per-frame parameters
+  return RunStreamingBenchmark(q, in_pixels, ref_pixels, cols, rows, runs,
+                               frames, params, kernel_clock_mhz);
+#endif
+
   // create the output pixels (initialize to all 0s)
   std::vector<PixelT> out_pixels(in_pixels.size(), 0);
 
@@ -271,6 +307,221 @@ double RunANR(queue& q, PixelT* in_ptr, PixelT* out_ptr, int cols, int rows,
   return diff.count();
 }
 
+// declare kernel and pipe names globally to reduce name mangling
+class StreamingInPipeID;
+class StreamingOutPipeID;
+class VerticalParamsPipeID;
+class HorizontalParamsPipeID;
+class StreamingInputKernelID;
+class StreamingOutputKernelID;
+class ParamsKernelID;
+
+// the number of parameter sets the streaming benchmark cycles through
+constexpr int kStreamingParamSets = 3;
+
+//
+// Run the ANR algorithm on the device on 'frames' frames back-to-back, with
+// the parameters of frame 'f' being 'params_ptr[f % param_count]'. The output
+// of frame 'f' is written to the frame buffer 'f % param_count' of 'out_ptr'.
+//
+double RunStreamingANR(queue& q, PixelT* in_ptr, PixelT* out_ptr,
+                       ANRParams* params_ptr, int cols, int rows, int frames,
+                       int param_count) {
+  // the input and output pipes for the pixels
+  using PipeType = DataBundle<PixelT, kPixelsPerCycle>;
+  using InPipe = sycl::ext::intel::pipe<StreamingInPipeID, PipeType>;
+  using OutPipe = sycl::ext::intel::pipe<StreamingOutPipeID, PipeType>;
+
+  // the side-channel pipes for the per-frame parameters
+  using VerticalParamsPipe =
+      sycl::ext::intel::pipe<VerticalParamsPipeID, ANRParams, 2>;
+  using HorizontalParamsPipe =
+      sycl::ext::intel::pipe<HorizontalParamsPipeID, ANRParams, 2>;
+
+  // launch the kernels that stream the parameters, and read from and write to
+  // the device
+  auto params_kernel_event =
+      SubmitParamsDMA<ParamsKernelID, ANRParams, VerticalParamsPipe,
+                      HorizontalParamsPipe>(q, params_ptr, param_count, frames);
+
+  auto input_kernel_event =
+      SubmitInputDMA<StreamingInputKernelID, PixelT, InPipe, kPixelsPerCycle>(
+          q, in_ptr, rows, cols, frames);
+
+  auto output_kernel_event =
+      SubmitOutputDMA<StreamingOutputKernelID, PixelT, OutPipe,
+                      kPixelsPerCycle>(q, out_ptr, rows, cols, frames,
+                                       param_count);
+
+  // launch the ANR kernels once for all the frames
+  auto anr_kernel_events =
+      SubmitStreamingANRKernels<IndexT, InPipe, OutPipe, VerticalParamsPipe,
+                                HorizontalParamsPipe, kFilterSize,
+                                kPixelsPerCycle, kMaxCols>(q, cols, rows,
+                                                           frames);
+
+  // wait for the input and output kernels to finish
+  auto start = high_resolution_clock::now();
+  input_kernel_event.wait();
+  output_kernel_event.wait();
+  auto end = high_resolution_clock::now();
+
+  // wait for the parameter and ANR kernels to finish
+  params_kernel_event.wait();
+  for (auto& e : anr_kernel_events) {
+    e.wait();
+  }
+
+  // return the duration in milliseconds, excluding memory transfers
+  duration<double, std::milli> diff = end - start;
+  return diff.count();
+}
+
+//
+// Run the multi-frame streaming benchmark. The frames cycle through
+// 'kStreamingParamSets' parameter sets, which are changed every frame:
+//   0: the parameters parsed from the configuration file
+//   1: the same parameters, with half the alpha
+//   2: the same parameters, with stronger spatial and intensity filtering
+// The outputs of set 0 are validated against the reference, the outputs of
+// set 1 against the average of the reference and the input, and the outputs of
+// set 2 must differ from the outputs of set 0.
+//
+int RunStreamingBenchmark(queue& q, std::vector<PixelT>& in_pixels,
+                          std::vector<PixelT>& ref_pixels, int cols, int rows,
+                          int runs, int frames, ANRParams params,
+                          double kernel_clock_mhz) {
+  if (frames < kStreamingParamSets) {
+    std::cerr << "ERROR: 'frames' must be at least " << kStreamingParamSets
+              << " in the streaming benchmark\n";
+    std::terminate();
+  }
+
+  int pixel_count = cols * rows;
+
+  // build the parameter sets
+  std::vector<ANRParams> frame_params(kStreamingParamSets, params);
+  frame_params[1].alpha = params.alpha / 2;
+  frame_params[1].one_minus_alpha = 1 - frame_params[1].alpha;
+  frame_params[2].sig_s = 2 * params.sig_s;
+  frame_params[2].sig_i_coeff = 2 * params.sig_i_coeff;
+
+  // allocate memory on the device for the input, the output frame buffers
+  // and the parameters
+  PixelT *in, *out;
+  ANRParams *params_ptr;
+#if defined (IS_BSP)
+  in = malloc_device<PixelT>(pixel_count, q);
+  out = malloc_device<PixelT>(pixel_count * kStreamingParamSets, q);
+  params_ptr = malloc_device<ANRParams>(kStreamingParamSets, q);
+#else
+  in = malloc_shared<PixelT>(pixel_count, q);
+  out = malloc_shared<PixelT>(pixel_count * kStreamingParamSets, q);
+  params_ptr = malloc_shared<ANRParams>(kStreamingParamSets, q);
+#endif
+  if ((in == nullptr) || (out == nullptr) || (params_ptr == nullptr)) {
+    std::cerr << "ERROR: could not allocate space for the streaming "
+              << "benchmark\n";
+    std::terminate();
+  }
+
+  // copy the input data and the parameters to the device memory
+  q.memcpy(in, in_pixels.data(), pixel_count * sizeof(PixelT)).wait();
+  q.memcpy(params_ptr, frame_params.data(),
+           kStreamingParamSets * sizeof(ANRParams)).wait();
+
+  // print out some info
+  std::cout << "Streaming benchmark\n";
+  std::cout << "Runs:             " << runs << "\n";
+  std::cout << "Columns:          " << cols << "\n";
+  std::cout << "Rows:             " << rows << "\n";
+  std::cout << "Frames:           " << frames << "\n";
+  std::cout << "Parameter Sets:   " << kStreamingParamSets << "\n";
+  std::cout << "Filter Size:      " << kFilterSize << "\n";
+  std::cout << "Pixels Per Cycle: " << kPixelsPerCycle << "\n";
+  std::cout << "Maximum Columns:  " << kMaxCols << "\n";
+  std::cout << "\n";
+
+  // track timing information in ms
+  std::vector<double> time(runs);
+  std::vector<PixelT> out_pixels(pixel_count * kStreamingParamSets, 0);
+
+  try {
+    // run the design multiple times to increase the accuracy of the timing
+    for (int i = 0; i < runs; i++) {
+      time[i] = RunStreamingANR(q, in, out, params_ptr, cols, rows, frames,
+                                kStreamingParamSets);
+    }
+
+    // Copy the output frame buffers back from the device
+    q.memcpy(out_pixels.data(), out,
+             pixel_count * kStreamingParamSets * sizeof(PixelT)).wait();
+  } catch (exception const& e) {
+    std::cout << "Caught a synchronous SYCL exception: " << e.what() << "\n";
+    std::terminate();
+  }
+
+  // free the allocated device memory
+  sycl::free(in, q);
+  sycl::free(out, q);
+  sycl::free(params_ptr, q);
+
+  // validate the output of each parameter set
+  PixelT* out_set_0 = out_pixels.data();
+  PixelT* out_set_1 = out_pixels.data() + pixel_count;
+  PixelT* out_set_2 = out_pixels.data() + 2 * pixel_count;
+
+  bool passed = Validate(out_set_0, ref_pixels.data(), rows, cols);
+
+  // The reference is alpha * filtered + (1 - alpha) * input, so with half the
+  // alpha the output is the average of the reference and the input, whatever
+  // the alpha of the configuration file
+  std::vector<PixelT> blend_ref_pixels(pixel_count);
+  for (int i = 0; i < pixel_count; i++) {
+    blend_ref_pixels[i] =
+        (TmpT(ref_pixels[i]) + TmpT(in_pixels[i])) / 2;
+  }
+  passed &= Validate(out_set_1, blend_ref_pixels.data(), rows, cols);
+
+  int changed_pixels = 0;
+  for (int i = 0; i < pixel_count; i++) {
+    changed_pixels += (out_set_2[i] != out_set_0[i]) ? 1 : 0;
+  }
+  if (changed_pixels == 0) {
+    std::cerr << "ERROR: the stronger filtering parameters did not change "
+              << "the output\n";
+    passed = false;
+  }
+
+  // print the performance results
+  if (passed) {
+    // NOTE: when run in emulation, these results do not accurately represent
+    // the performance of the kernels in actual FPGA hardware
+    double avg_time_ms =
+        std::accumulate(time.begin() + 1, time.end(), 0.0) / (runs - 1);
+    double frames_per_s = frames / (avg_time_ms * 1e-3);
+    double pixels_per_s = frames_per_s * pixel_count;
+
+    std::cout << "Execution time: " << avg_time_ms << " ms\n";
+    std::cout << "Throughput: " << frames_per_s << " frames/s\n";
+
+    // The device does not know the clock frequency of the compiled kernels
+    // (on an FPGA board it reports a nominal value, in emulation the host CPU
+    // clock), so the pixels per cycle are only reported when the kernel clock
+    // from the compile report was given
+    if (kernel_clock_mhz > 0) {
+      std::cout << "Pixels/cycle: " << pixels_per_s / (kernel_clock_mhz * 1e6)
+                << " (at " << kernel_clock_mhz << " MHz, the maximum is "
+                << kPixelsPerCycle << ")\n";
+    }
+    std::cout << "PASSED\n";
+    return 0;
+  } else {
+    std::cout << "FAILED\n";
+    return 1;
+  }
+}
+
 //
 // Helper to parse pixel data files
 //
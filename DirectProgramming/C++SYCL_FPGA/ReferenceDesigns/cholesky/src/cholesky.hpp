@@ -16,11 +16,13 @@
 
 // Forward declare the kernel and pipe names
 // (This prevents unwanted name mangling in the optimization report.)
-class CholeskyDDRToLocalMem;
-class Cholesky;
-class CholeskyLocalMemToDDR;
-class APipe;
-class LPipe;
+// The names are templated on the computation type so that the decomposition
+// can be instantiated in several precisions in the same program.
+template <typename T> class CholeskyDDRToLocalMem;
+template <typename T> class Cholesky;
+template <typename T> class CholeskyLocalMemToDDR;
+template <typename T> class APipe;
+template <typename T> class LPipe;
 
 /*
   Implementation of the Cholesky decomposition using multiple streaming kernels
@@ -44,14 +46,20 @@ void CholeskyDecompositionImpl(
 ) {
   constexpr int kAMatrixSize = dimension * dimension;
   constexpr int kLMatrixSize = dimension * (dimension + 1) / 2;
-  constexpr int kNumElementsPerDDRBurst = is_complex ? 4 : 8;
+  // A DDR burst is 32 bytes wide (8 floats), so the bursts of the half
+  // precision matrices hold twice as many elements. Matrices that have fewer
+  // dimension than that keep the single precision burst size.
+  constexpr int kDDRBurstBytes = 32;
+  constexpr int kElementsPerBurst = kDDRBurstBytes / sizeof(TT);
+  constexpr int kNumElementsPerDDRBurst =
+      (dimension >= kElementsPerBurst) ? kElementsPerBurst : (is_complex ? 4 : 8);
 
   using PipeType = fpga_tools::NTuple<TT, kNumElementsPerDDRBurst>;
 
   // Pipes to communicate the A and L matrices between kernels
-  using AMatrixPipe = sycl::ext::intel::pipe<APipe, PipeType, 3>;
+  using AMatrixPipe = sycl::ext::intel::pipe<APipe<T>, PipeType, 3>;
   using LMatrixPipe =
-      sycl::ext::intel::pipe<LPipe, TT, kNumElementsPerDDRBurst * 4>;
+      sycl::ext::intel::pipe<LPipe<T>, TT, kNumElementsPerDDRBurst * 4>;
 
   // Allocate FPGA DDR memory.
 #if defined (IS_BSP)
@@ -76,19 +84,19 @@ void CholeskyDecompositionImpl(
 
   // Launch a kernel that will repeatedly read the matrices on the FPGA DDR
   // and write their content to the AMatrixPipe pipe.
-  auto ddr_read_event = q.single_task<CholeskyDDRToLocalMem>([=] {
+  auto ddr_read_event = q.single_task<CholeskyDDRToLocalMem<T>>([=] {
     MatrixReadFromDDRToPipe<TT, dimension, dimension, kNumElementsPerDDRBurst,
                             AMatrixPipe>(a_device, matrix_count, repetitions);
   });
 
   // Read the A matrix from the AMatrixPipe pipe and compute the Cholesky
   // decomposition. Write the L output matrix to the LMatrixPipe pipe.
-  q.single_task<Cholesky>(
+  q.single_task<Cholesky<T>>(
       fpga_linalg::StreamingCholesky<T, is_complex, dimension, raw_latency,
                                      kNumElementsPerDDRBurst, AMatrixPipe,
                                      LMatrixPipe>());
 
-  auto ddr_write_event = q.single_task<CholeskyLocalMemToDDR>([=
+  auto ddr_write_event = q.single_task<CholeskyLocalMemToDDR<T>>([=
   ]() [[intel::kernel_args_restrict]] {
     // Read the L matrix from the LMatrixPipe pipe and copy it to the FPGA DDR
     // Number of DDR bursts of kNumElementsPerDDRBurst required to write
@@ -1,11 +1,14 @@
 #include <math.h>
 
 #include <sycl/sycl.hpp>
+#include <chrono>
 #include <list>
 #include <sycl/ext/intel/ac_types/ac_complex.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
 #include "cholesky.hpp"
+#include "cholesky_solve.hpp"
+#include "iterative_refinement.hpp"
 #include "exception_handler.hpp"
 
 // Use "#define DEBUG" to print debugging information such as matrices content
@@ -34,6 +37,48 @@ void CholeskyDecomposition(std::vector<T> &a_matrix, std::vector<T> &l_matrix,
                                    repetitions);
 }
 
+#if defined(SOLVE)
+/*
+  RHS_COLUMNS is defined by the build system when SOLVE is defined.
+  Solves AX=B for each of the matrix_count (A, B) pairs, where B holds
+  RHS_COLUMNS right-hand side vectors, using the Cholesky decomposition of A
+  followed by forward/backward substitutions.
+
+  Function arguments:
+  - a_matrix:    The input matrices.
+  - b_matrix:    The right-hand sides, stored column by column.
+  - x_matrix:    The solutions. The function will overwrite this matrix.
+  - q:           The device queue.
+  - matrix_count: Number of systems to solve.
+  - repetitions: The number of repetitions of the computation to execute.
+                 (for performance evaluation)
+*/
+template <typename T, bool is_complex>
+void CholeskySolve(std::vector<T> &a_matrix, std::vector<T> &b_matrix,
+                   std::vector<T> &x_matrix, sycl::queue &q, int matrix_count,
+                   int repetitions) {
+  CholeskySolveImpl<MATRIX_DIMENSION, RHS_COLUMNS, FIXED_ITERATIONS,
+                    is_complex, float>(a_matrix, b_matrix, x_matrix, q,
+                                       matrix_count, repetitions);
+}
+#endif
+
+#if defined(REFINEMENT)
+/*
+  Computes the Cholesky decomposition in half precision, for the
+  mixed-precision iterative refinement.
+  The arguments are the same as the ones of CholeskyDecomposition.
+*/
+template <typename T, bool is_complex>
+void CholeskyDecompositionHalf(std::vector<T> &a_matrix,
+                               std::vector<T> &l_matrix, sycl::queue &q,
+                               int matrix_count, int repetitions) {
+  CholeskyDecompositionImpl<MATRIX_DIMENSION, FIXED_ITERATIONS, is_complex,
+                            sycl::half>(a_matrix, l_matrix, q, matrix_count,
+                                        repetitions);
+}
+#endif
+
 /*
   Returns true if both the real and complex parts of the given ac_complex
   value are finite
@@ -55,6 +100,200 @@ float RandomValueInInterval(float min, float max) {
                    (static_cast<float>(RAND_MAX) / (max - min));
 }
 
+#if defined(SOLVE)
+/*
+  Generates random right-hand sides for the given A matrices, solves the
+  systems on the device and checks that AX=B.
+  Returns 0 on success.
+*/
+template <typename T, bool is_complex, size_t rows, size_t rhs_columns>
+int RunCholeskySolve(std::vector<T> &a_matrix, sycl::queue &q,
+                     size_t matrix_count, int repetitions) {
+  constexpr size_t kAMatrixSize = rows * rows;
+  constexpr size_t kBMatrixSize = rows * rhs_columns;
+
+  std::vector<T> b_matrix(kBMatrixSize * matrix_count);
+  std::vector<T> x_matrix(kBMatrixSize * matrix_count);
+
+  for (auto &b : b_matrix) {
+#if COMPLEX == 0
+    b = RandomValueInInterval(0, 1);
+#else
+    float real = RandomValueInInterval(0, 1);
+    float imag = RandomValueInInterval(0, 1);
+    b = ac_complex<float>{real, imag};
+#endif
+  }
+
+  std::cout << "Solving " << matrix_count << " system"
+            << (matrix_count > 1 ? "s" : "") << " with " << rhs_columns
+            << " right-hand side" << (rhs_columns > 1 ? "s " : " ")
+            << repetitions << " times" << std::endl;
+
+  CholeskySolve<T, is_complex>(a_matrix, b_matrix, x_matrix, q, matrix_count,
+                               repetitions);
+
+  // Floating-point error threshold value at which we decide that the design
+  // computed an incorrect value
+  constexpr float kErrorThreshold = 1e-4;
+
+  std::cout << "Verifying results..." << std::endl;
+  size_t error_count = 0;
+  for (size_t mat_idx = 0; mat_idx < matrix_count; mat_idx++) {
+    for (size_t rhs = 0; rhs < rhs_columns; rhs++) {
+      for (size_t i = 0; i < rows; i++) {
+        // Compute AX at index i,rhs
+        T ax_i{0};
+        for (size_t k = 0; k < rows; k++) {
+          ax_i += a_matrix[mat_idx * kAMatrixSize + k * rows + i] *
+                  x_matrix[mat_idx * kBMatrixSize + rhs * rows + k];
+        }
+
+        T x_i = x_matrix[mat_idx * kBMatrixSize + rhs * rows + i];
+        T b_i = b_matrix[mat_idx * kBMatrixSize + rhs * rows + i];
+#if COMPLEX == 0
+        bool ax_eq_b = abs(ax_i - b_i) < kErrorThreshold;
+#else
+        bool ax_eq_b = (abs(ax_i.r() - b_i.r()) < kErrorThreshold) &&
+                       (abs(ax_i.i() - b_i.i()) < kErrorThreshold);
+#endif
+
+        if (!ax_eq_b || !IsFinite(x_i)) {
+          if (error_count == 0) {
+            std::cerr << "Error in system " << mat_idx << ": B[" << i << "]["
+                      << rhs << "] = " << b_i << " but AX[" << i << "][" << rhs
+                      << "] = " << ax_i << std::endl;
+          }
+          error_count++;
+        }
+      }  // end of i
+    }    // end of rhs
+  }      // end of mat_idx
+
+  if (error_count > 0) {
+    std::cerr << std::endl << "FAILED" << std::endl;
+    std::cerr << std::endl
+              << "!!!!!!!!!!!!!! " << error_count << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::endl << "PASSED" << std::endl;
+  return 0;
+}
+#endif
+
+#if defined(REFINEMENT)
+/*
+  Benchmarks the mixed-precision iterative refinement against the single
+  precision path:
+  - the matrices are decomposed in single precision and the systems Ax=b are
+    solved with the resulting L, without refinement
+  - the matrices are decomposed in half precision and the solutions are
+    refined in double precision on the host
+  The backward errors of both solutions are reported, and the refined
+  solutions must reach double precision backward errors.
+  Returns 0 on success.
+*/
+template <typename T, bool is_complex, size_t rows>
+int RunRefinedCholesky(std::vector<T> &a_matrix, sycl::queue &q,
+                       size_t matrix_count, int repetitions) {
+  using TH = std::conditional_t<is_complex, ac_complex<sycl::half>, sycl::half>;
+  using TD = std::conditional_t<is_complex, ac_complex<double>, double>;
+
+  constexpr size_t kAMatrixSize = rows * rows;
+  constexpr size_t kLMatrixSize = rows * (rows + 1) / 2;
+
+  // Maximum number of refinement steps, and backward error at which the
+  // solutions are considered to be accurate to double precision
+  constexpr int kMaxRefinementSteps = 30;
+  constexpr double kDoubleBackwardErrorThreshold = 1e-15;
+
+  // One right-hand side per matrix
+  std::vector<T> b(rows * matrix_count);
+  for (auto &b_elem : b) {
+#if COMPLEX == 0
+    b_elem = RandomValueInInterval(0, 1);
+#else
+    float real = RandomValueInInterval(0, 1);
+    float imag = RandomValueInInterval(0, 1);
+    b_elem = ac_complex<float>{real, imag};
+#endif
+  }
+
+  std::vector<TD> a_double = fpga_tools::ConvertMatrix<TD>(a_matrix);
+  std::vector<TD> b_double = fpga_tools::ConvertMatrix<TD>(b);
+
+  // Single precision decomposition, without refinement
+  std::cout << "Single precision decomposition" << std::endl;
+  std::vector<T> l_single(kLMatrixSize * matrix_count);
+  CholeskyDecomposition<T, is_complex>(a_matrix, l_single, q, matrix_count,
+                                       repetitions);
+  std::vector<TD> l_single_double = fpga_tools::ConvertMatrix<TD>(l_single);
+
+  double single_backward_error = 0;
+  for (size_t mat_idx = 0; mat_idx < matrix_count; mat_idx++) {
+    std::vector<TD> a(a_double.begin() + mat_idx * kAMatrixSize,
+                      a_double.begin() + (mat_idx + 1) * kAMatrixSize);
+    std::vector<TD> l(l_single_double.begin() + mat_idx * kLMatrixSize,
+                      l_single_double.begin() + (mat_idx + 1) * kLMatrixSize);
+    std::vector<TD> b_vec(b_double.begin() + mat_idx * rows,
+                          b_double.begin() + (mat_idx + 1) * rows);
+    std::vector<TD> x(rows), r(rows);
+    CholeskySubstitutions(l, b_vec, x, rows);
+    single_backward_error = std::max(single_backward_error,
+                                     CholeskyResidual(a, b_vec, x, r, rows));
+  }
+  std::cout << "   Backward error:   " << single_backward_error << std::endl;
+
+  // Half precision decomposition, followed by double precision refinement
+  std::cout << "Half precision decomposition with double precision refinement"
+            << std::endl;
+  std::vector<TH> a_half = fpga_tools::ConvertMatrix<TH>(a_matrix);
+  std::vector<TH> l_half(kLMatrixSize * matrix_count);
+  CholeskyDecompositionHalf<TH, is_complex>(a_half, l_half, q, matrix_count,
+                                            repetitions);
+  std::vector<TD> l_half_double = fpga_tools::ConvertMatrix<TD>(l_half);
+
+  double refined_backward_error = 0;
+  int max_steps = 0;
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (size_t mat_idx = 0; mat_idx < matrix_count; mat_idx++) {
+    std::vector<TD> a(a_double.begin() + mat_idx * kAMatrixSize,
+                      a_double.begin() + (mat_idx + 1) * kAMatrixSize);
+    std::vector<TD> l(l_half_double.begin() + mat_idx * kLMatrixSize,
+                      l_half_double.begin() + (mat_idx + 1) * kLMatrixSize);
+    std::vector<TD> b_vec(b_double.begin() + mat_idx * rows,
+                          b_double.begin() + (mat_idx + 1) * rows);
+    std::vector<TD> x(rows);
+    double backward_error;
+    int steps = RefineCholeskySolve(a, l, b_vec, x, rows, kMaxRefinementSteps,
+                                    kDoubleBackwardErrorThreshold,
+                                    backward_error);
+    max_steps = std::max(max_steps, steps);
+    refined_backward_error = std::max(refined_backward_error, backward_error);
+  }
+  auto end_time = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> refinement_time = end_time - start_time;
+
+  std::cout << "   Refinement steps: " << max_steps << " (max)" << std::endl;
+  std::cout << "   Refinement time:  "
+            << refinement_time.count() / matrix_count * 1e6
+            << " us per system (host)" << std::endl;
+  std::cout << "   Backward error:   " << refined_backward_error << std::endl;
+
+  if (!(refined_backward_error < kDoubleBackwardErrorThreshold)) {
+    std::cerr << std::endl
+              << "The refined solutions did not reach a backward error of "
+              << kDoubleBackwardErrorThreshold << std::endl;
+    std::cerr << std::endl << "FAILED" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::endl << "PASSED" << std::endl;
+  return 0;
+}
+#endif
+
 int main(int argc, char *argv[]) {
   constexpr size_t kRandomSeed = 1138;
   constexpr size_t kRows = MATRIX_DIMENSION;
@@ -187,6 +426,17 @@ int main(int argc, char *argv[]) {
 
     }  // end of mat_idx
 
+#if defined(REFINEMENT)
+    return RunRefinedCholesky<T, kComplex, kRows>(a_matrix, q,
+                                                  kMatricesToDecompose,
+                                                  repetitions);
+#endif
+
+#if defined(SOLVE)
+    return RunCholeskySolve<T, kComplex, kRows, RHS_COLUMNS>(
+        a_matrix, q, kMatricesToDecompose, repetitions);
+#endif
+
     std::cout << "Computing the Cholesky decomposition of "
               << kMatricesToDecompose << " matri"
               << (kMatricesToDecompose > 1 ? "ces " : "x ") << repetitions
@@ -0,0 +1,153 @@
+#ifndef __CHOLESKY_SOLVE_HPP__
+#define __CHOLESKY_SOLVE_HPP__
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "memory_transfers.hpp"
+
+// Included from DirectProgramming/C++SYCL_FPGA/include/
+#include "streaming_cholesky.hpp"
+#include "streaming_cholesky_solve.hpp"
+#include "tuple.hpp"
+
+// Forward declare the kernel and pipe names
+// (This prevents unwanted name mangling in the optimization report.)
+class CholeskySolveADDRToLocalMem;
+class CholeskySolveBDDRToLocalMem;
+class CholeskySolveDecomposition;
+class CholeskySolve;
+class CholeskySolveLocalMemToDDR;
+class SolveAPipe;
+class SolveBPipe;
+class SolveLPipe;
+class SolveXPipe;
+
+/*
+  Implementation of the Cholesky-based linear solve AX=B using multiple
+  streaming kernels. The L matrix computed by the Cholesky decomposition
+  kernel is directly consumed by the forward/backward substitution kernel, so
+  neither L nor the inverse of A ever go to DDR.
+  Can be configured by datatype, matrix size (must use square matrices),
+  number of right-hand sides, real and complex.
+*/
+template <unsigned dimension,    // Number of columns/rows in the input matrix
+          unsigned rhs_columns,  // Number of right-hand sides per matrix
+          unsigned raw_latency,  // RAW latency for triangular loop optimization
+          bool is_complex,       // Selects between ac_complex<T> and T datatype
+          typename T,            // The datatype for the computation
+          typename TT = std::conditional_t<is_complex, ac_complex<T>, T>
+          // TT will be ac_complex<T> or T depending on is_complex
+          >
+void CholeskySolveImpl(
+    std::vector<TT> &a_matrix,  // Input matrix A
+    std::vector<TT> &b_matrix,  // Input right-hand sides B
+    std::vector<TT> &x_matrix,  // Output solutions X
+    sycl::queue &q,             // Device queue
+    int matrix_count,           // Number of systems to solve
+    int repetitions             // Number of repetitions, for performance
+                                // evaluation
+) {
+  constexpr int kAMatrixSize = dimension * dimension;
+  constexpr int kBMatrixSize = dimension * rhs_columns;
+  constexpr int kNumElementsPerDDRBurst = is_complex ? 4 : 8;
+
+  using PipeType = fpga_tools::NTuple<TT, kNumElementsPerDDRBurst>;
+
+  // Pipes to communicate the A, B, L and X matrices between kernels
+  using AMatrixPipe = sycl::ext::intel::pipe<SolveAPipe, PipeType, 3>;
+  using BMatrixPipe = sycl::ext::intel::pipe<SolveBPipe, PipeType, 3>;
+  using LMatrixPipe =
+      sycl::ext::intel::pipe<SolveLPipe, TT, kNumElementsPerDDRBurst * 4>;
+  using XMatrixPipe = sycl::ext::intel::pipe<SolveXPipe, PipeType, 3>;
+
+  // Allocate FPGA DDR memory.
+#if defined (IS_BSP)
+  TT *a_device = sycl::malloc_device<TT>(kAMatrixSize * matrix_count, q);
+  TT *b_device = sycl::malloc_device<TT>(kBMatrixSize * matrix_count, q);
+  TT *x_device = sycl::malloc_device<TT>(kBMatrixSize * matrix_count, q);
+#else
+  // malloc_device are not supported when targetting an FPGA part/family
+  TT *a_device = sycl::malloc_shared<TT>(kAMatrixSize * matrix_count, q);
+  TT *b_device = sycl::malloc_shared<TT>(kBMatrixSize * matrix_count, q);
+  TT *x_device = sycl::malloc_shared<TT>(kBMatrixSize * matrix_count, q);
+#endif
+
+  if ((a_device == nullptr) || (b_device == nullptr) ||
+      (x_device == nullptr)) {
+    std::cerr << "Error when allocating FPGA DDR" << std::endl;
+    std::cerr << "The FPGA DDR may be full" << std::endl;
+    std::cerr << "Try reducing the matrix sizes/count" << std::endl;
+    return;
+  }
+
+  // Copy the systems to solve to the FPGA DDR
+  q.memcpy(a_device, a_matrix.data(), kAMatrixSize * matrix_count * sizeof(TT))
+      .wait();
+  q.memcpy(b_device, b_matrix.data(), kBMatrixSize * matrix_count * sizeof(TT))
+      .wait();
+
+  // Launch the kernels that will repeatedly read the A and B matrices on the
+  // FPGA DDR and write their content to the AMatrixPipe/BMatrixPipe pipes.
+  auto ddr_read_event = q.single_task<CholeskySolveADDRToLocalMem>([=] {
+    MatrixReadFromDDRToPipe<TT, dimension, dimension, kNumElementsPerDDRBurst,
+                            AMatrixPipe>(a_device, matrix_count, repetitions);
+  });
+
+  q.single_task<CholeskySolveBDDRToLocalMem>([=] {
+    MatrixReadFromDDRToPipe<TT, dimension, rhs_columns, kNumElementsPerDDRBurst,
+                            BMatrixPipe>(b_device, matrix_count, repetitions);
+  });
+
+  // Read the A matrix from the AMatrixPipe pipe and compute the Cholesky
+  // decomposition. Write the L output matrix to the LMatrixPipe pipe.
+  q.single_task<CholeskySolveDecomposition>(
+      fpga_linalg::StreamingCholesky<T, is_complex, dimension, raw_latency,
+                                     kNumElementsPerDDRBurst, AMatrixPipe,
+                                     LMatrixPipe>());
+
+  // Read the L matrix from the LMatrixPipe pipe and the right-hand sides from
+  // the BMatrixPipe pipe. Write the solutions to the XMatrixPipe pipe.
+  q.single_task<CholeskySolve>(
+      fpga_linalg::StreamingCholeskySolve<T, is_complex, dimension, rhs_columns,
+                                          kNumElementsPerDDRBurst, LMatrixPipe,
+                                          BMatrixPipe, XMatrixPipe>());
+
+  // Read the X matrix from the XMatrixPipe pipe and copy it to the FPGA DDR
+  auto ddr_write_event = q.single_task<CholeskySolveLocalMemToDDR>([=] {
+    MatrixReadPipeToDDR<TT, dimension, rhs_columns, kNumElementsPerDDRBurst,
+                        XMatrixPipe>(x_device, matrix_count, repetitions);
+  });
+
+  ddr_write_event.wait();
+
+  // Compute the total time the execution lasted
+  auto start_time = ddr_read_event.template get_profiling_info<
+      sycl::info::event_profiling::command_start>();
+  auto end_time = ddr_write_event.template get_profiling_info<
+      sycl::info::event_profiling::command_end>();
+  double diff = (end_time - start_time) / 1.0e9;
+
+  // Make sure we throw any asynchronous errors if they have occurred during
+  // the computation
+  q.throw_asynchronous();
+
+  std::cout << "   Total duration:   " << diff << " s" << std::endl;
+  std::cout << "Throughput: " << ((repetitions * matrix_count) / diff) * 1e-3
+            << "k systems/s" << std::endl;
+
+  // Copy the X matrices result from the FPGA DDR to the host memory
+  q.memcpy(x_matrix.data(), x_device, kBMatrixSize * matrix_count * sizeof(TT))
+      .wait();
+
+  // Clean allocated FPGA memory
+  free(a_device, q);
+  free(b_device, q);
+  free(x_device, q);
+}
+
+#endif /* __CHOLESKY_SOLVE_HPP__ */
@@ -0,0 +1,127 @@
+#ifndef __ITERATIVE_REFINEMENT_HPP__
+#define __ITERATIVE_REFINEMENT_HPP__
+
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mixed_precision_utils.hpp"
+
+/*
+  Host-side mixed-precision iterative refinement of the solution of AX=B.
+
+  The Cholesky factor L of A is computed in a low precision format (on the
+  FPGA), and is only used to compute corrections. The residuals and the
+  solutions are kept in double precision:
+
+  x = (LL*)^-1 b
+  repeat:
+    r = b - Ax        (double precision)
+    d = (LL*)^-1 r    (forward/backward substitutions with the low precision L)
+    x = x + d
+  until the backward error of x is small enough
+
+  Each step reduces the error by a factor of about cond(A) * u, where u is the
+  unit roundoff of the format of L, so a few steps are enough for well
+  conditioned matrices to reach double precision residuals.
+
+  All matrices are stored using TD, which is double or ac_complex<double>.
+  A is stored column by column, L only contains the lower-left elements stored
+  row by row (as produced by the Cholesky kernel), and b and x are vectors.
+*/
+
+// Helper to write the refinement once for real and complex matrices
+inline double RefinementConj(double val) { return val; }
+inline ac_complex<double> RefinementConj(ac_complex<double> val) {
+  return val.conj();
+}
+
+/*
+  Solves LL*x = b with a forward and a backward substitution
+*/
+template <typename TD>
+void CholeskySubstitutions(const std::vector<TD> &l_matrix,
+                           const std::vector<TD> &b, std::vector<TD> &x,
+                           int size) {
+  // Index of the first element of a row in the packed L matrix
+  auto row_start = [](int row) { return row * (row + 1) / 2; };
+
+  // Forward substitution: Ly = b
+  std::vector<TD> y(size);
+  for (int row = 0; row < size; row++) {
+    TD sum = b[row];
+    for (int col = 0; col < row; col++) {
+      sum -= l_matrix[row_start(row) + col] * y[col];
+    }
+    y[row] = sum / l_matrix[row_start(row) + row];
+  }
+
+  // Backward substitution: L*x = y
+  for (int row = size - 1; row >= 0; row--) {
+    TD sum = y[row];
+    for (int col = row + 1; col < size; col++) {
+      sum -= RefinementConj(l_matrix[row_start(col) + row]) * x[col];
+    }
+    x[row] = sum / l_matrix[row_start(row) + row];
+  }
+}
+
+/*
+  Computes r = b - Ax and returns the normwise backward error of x:
+  ||b - Ax|| / (||A|| ||x|| + ||b||) using the infinity norm
+*/
+template <typename TD>
+double CholeskyResidual(const std::vector<TD> &a_matrix,
+                        const std::vector<TD> &b, const std::vector<TD> &x,
+                        std::vector<TD> &r, int size) {
+  double norm_a = 0, norm_b = 0, norm_x = 0, norm_r = 0;
+  for (int row = 0; row < size; row++) {
+    TD ax{0};
+    double row_norm = 0;
+    for (int col = 0; col < size; col++) {
+      ax += a_matrix[col * size + row] * x[col];
+      row_norm += fpga_tools::RefinementAbs(a_matrix[col * size + row]);
+    }
+    r[row] = b[row] - ax;
+
+    norm_a = std::max(norm_a, row_norm);
+    norm_b = std::max(norm_b, fpga_tools::RefinementAbs(b[row]));
+    norm_x = std::max(norm_x, fpga_tools::RefinementAbs(x[row]));
+    norm_r = std::max(norm_r, fpga_tools::RefinementAbs(r[row]));
+  }
+  return norm_r / (norm_a * norm_x + norm_b);
+}
+
+/*
+  Solves Ax=b from the low precision Cholesky factor L of A, and refines x
+  until its backward error is lower than 'tolerance' or 'max_iterations'
+  refinement steps were performed.
+  Returns the number of refinement steps performed, and sets
+  'backward_error' to the backward error of the returned x.
+*/
+template <typename TD>
+int RefineCholeskySolve(const std::vector<TD> &a_matrix,
+                        const std::vector<TD> &l_matrix,
+                        const std::vector<TD> &b, std::vector<TD> &x,
+                        int size, int max_iterations, double tolerance,
+                        double &backward_error) {
+  std::vector<TD> r(size), d(size);
+
+  CholeskySubstitutions(l_matrix, b, x, size);
+  backward_error = CholeskyResidual(a_matrix, b, x, r, size);
+
+  int iteration = 0;
+  while (iteration < max_iterations && backward_error > tolerance) {
+    CholeskySubstitutions(l_matrix, r, d, size);
+    for (int row = 0; row < size; row++) {
+      x[row] += d[row];
+    }
+    backward_error = CholeskyResidual(a_matrix, b, x, r, size);
+    iteration++;
+  }
+  return iteration;
+}
+
+#endif /* __ITERATIVE_REFINEMENT_HPP__ */
@@ -25,6 +25,15 @@ struct PixelWithSignals_ {
 };
 #pragma pack(pop)
 
+/// @brief Size of the window needed to run a chain of window stages with
+/// `LineBuffer2d::FilterFused()`: the stencil sizes of the stages, minus the
+/// overlap between consecutive stages. A `LineBuffer2d` that runs the chain
+/// must be instantiated with this `kStencilSize`.
+template <typename... WindowStages_T>
+constexpr short FusedStencilSize() {
+  return (short)(1 + ((WindowStages_T::kStencilSize - 1) + ... + 0));
+}
+
 template <typename PixelTypeIn, typename PixelTypeOut, short kStencilSize,
           short kMaxImgCols, short kParallelPixels>
 class LineBuffer2d {
@@ -71,9 +80,11 @@ class LineBuffer2d {
 
   // If we have multiple pixels in parallel, we need to insert some dummy
   // pixels before the 'real data' so the output has the same alignment as
-  // the input.
-  constexpr static short kBufferOffset = fpga_tools::Min(
-      (short)((kParallelPixels - (short)(kStencilSize / 2))), kParallelPixels);
+  // the input. The window centre lags the input by `kStencilSize / 2` pixels,
+  // which may be more than `kParallelPixels` for large (e.g. fused) windows.
+  constexpr static short kBufferOffset =
+      (kParallelPixels - (short)((kStencilSize / 2) % kParallelPixels)) %
+      kParallelPixels;
 
   constexpr static short kPreBufferSize = kParallelPixels + kBufferOffset;
 
@@ -150,6 +161,124 @@ class LineBuffer2d {
                                  bool is_new_frame, bool is_line_end,
                                  bool &start_of_frame, bool &end_of_line,
                                  FunctionArgs_T... window_fn_args) {
+    return FilterImpl(
+        new_pixels, is_new_frame, is_line_end, start_of_frame, end_of_line,
+        [&](short row, short col, PixelTypeIn *window) {
+          return window_function(row, col, rows, cols, window,
+                                 window_fn_args...);
+        });
+  }
+
+  /// @brief Variant of `Filter()` that runs a chain of window functions (for
+  /// example a denoise filter followed by a sharpening filter) on a single set
+  /// of line buffers, instead of instantiating one line buffer per filter.
+  ///
+  /// Each stage is a functor that exposes its window size as a `constexpr
+  /// static short kStencilSize` member, and a call operator with the same
+  /// parameters as a window function of `Filter()`:
+  /// `operator()(row, col, rows, cols, pixels)`. Each stage consumes the
+  /// results of the previous stage, so the first stage is computed once for
+  /// every position in the window of the second stage, and so on. The line
+  /// buffer must be instantiated with a `kStencilSize` equal to
+  /// `FusedStencilSize<WindowStages_T...>()`.
+  ///
+  /// Since the intermediate results are not stored, each stage must handle
+  /// image borders itself (e.g. by duplicating the border pixels that are
+  /// already in its window); the results of the previous stage at positions
+  /// outside the image are then never used, and the fused chain produces the
+  /// same output as running the stages one after the other.
+  ///
+  /// @tparam WindowStages_T types of the stages, in the order they are applied
+  /// @param[in] new_pixels input data
+  /// @param[in] is_new_frame Set this to `true` if the pixel(s) you pass in
+  /// `new_pixels` is/are at the start of a frame.
+  /// @param[in] is_line_end Set this to `true` if the pixel(s) you pass in
+  /// `new_pixels` is/are at the end of a line.
+  /// @param[out] start_of_frame This is set to `true` if the returned pixel(s)
+  /// is/are at the start of a new frame.
+  /// @param[out] end_of_line This is set to `true` if the returned pixel(s)
+  /// is/are at the end of a line.
+  /// @param[in] stages the window stages to apply
+  /// @return Result of the last stage
+  template <typename... WindowStages_T>
+  LineBufferDataBundleOut FilterFused(LineBufferDataBundleIn new_pixels,
+                                      bool is_new_frame, bool is_line_end,
+                                      bool &start_of_frame, bool &end_of_line,
+                                      WindowStages_T... stages) {
+    static_assert(sizeof...(WindowStages_T) > 0,
+                  "FilterFused() needs at least one window stage");
+    static_assert(FusedStencilSize<WindowStages_T...>() == kStencilSize,
+                  "The line buffer must be sized for the fused window of all "
+                  "the window stages");
+
+    return FilterImpl(new_pixels, is_new_frame, is_line_end, start_of_frame,
+                      end_of_line,
+                      [&](short row, short col, PixelTypeIn *window) {
+                        return ApplyStages<kStencilSize>(row, col, rows, cols,
+                                                         window, stages...);
+                      });
+  }
+
+ private:
+  /// @brief Apply a chain of window stages on a window of `kWindowSize` x
+  /// `kWindowSize` pixels centred on (`row`, `col`).
+  template <short kWindowSize, typename PixelTypeWindow, typename Stage_T,
+            typename... WindowStages_T>
+  static PixelTypeOut ApplyStages(short row, short col, short rows, short cols,
+                                  PixelTypeWindow *window, Stage_T stage,
+                                  WindowStages_T... stages) {
+    constexpr short kStageSize = Stage_T::kStencilSize;
+
+    if constexpr (sizeof...(WindowStages_T) == 0) {
+      return stage(row, col, rows, cols, window);
+    } else {
+      // the next stages need the result of this stage on a smaller window
+      constexpr short kResultsSize = kWindowSize - kStageSize + 1;
+      using PixelTypeStage = decltype(stage(row, col, rows, cols, window));
+
+      PixelTypeStage stage_results[kResultsSize * kResultsSize];
+
+#pragma unroll
+      for (short res_row = 0; res_row < kResultsSize; res_row++) {
+#pragma unroll
+        for (short res_col = 0; res_col < kResultsSize; res_col++) {
+          PixelTypeWindow stage_window[kStageSize * kStageSize];
+#pragma unroll
+          for (short w_row = 0; w_row < kStageSize; w_row++) {
+#pragma unroll
+            for (short w_col = 0; w_col < kStageSize; w_col++) {
+              stage_window[w_col + w_row * kStageSize] =
+                  window[(res_col + w_col) + (res_row + w_row) * kWindowSize];
+            }
+          }
+
+          // Results outside the image are never used by the next stage, so
+          // saturate their coordinates to keep the stage inside its window.
+          short stage_row = row + res_row - (kResultsSize / 2);
+          short stage_col = col + res_col - (kResultsSize / 2);
+          stage_row = fpga_tools::Min(stage_row, (short)(rows - 1));
+          stage_row = fpga_tools::Max(stage_row, (short)0);
+          stage_col = fpga_tools::Min(stage_col, (short)(cols - 1));
+          stage_col = fpga_tools::Max(stage_col, (short)0);
+
+          stage_results[res_col + res_row * kResultsSize] =
+              stage(stage_row, stage_col, rows, cols, stage_window);
+        }
+      }
+
+      return ApplyStages<kResultsSize>(row, col, rows, cols, stage_results,
+                                       stages...);
+    }
+  }
+
+  /// @brief Insert new pixels into the line buffer and run `window_op` on the
+  /// window of each parallel pixel. `window_op` is called with the row and
+  /// column of the pixel at the centre of the window, and the window itself.
+  template <typename WindowOp_T>
+  LineBufferDataBundleOut FilterImpl(LineBufferDataBundleIn new_pixels,
+                                     bool is_new_frame, bool is_line_end,
+                                     bool &start_of_frame, bool &end_of_line,
+                                     WindowOp_T window_op) {
     [[intel::fpga_register]]  // NO-FORMAT: Attribute
     BundledPixels new_pixels_structs;
 
@@ -260,8 +389,8 @@ class LineBuffer2d {
       }
 
       // in-line this function on a copy of the appropriate shifter data
-      PixelTypeOut window_result = window_function(
-          row_write, col_local, rows, cols, shifter_copy, window_fn_args...);
+      PixelTypeOut window_result =
+          window_op(row_write, col_local, shifter_copy);
       window_results[stencil_idx] = window_result;
     }
 
@@ -0,0 +1,105 @@
+//  Copyright (c) 2024 Intel Corporation
+//  SPDX-License-Identifier: MIT
+
+// benchmark_kernels.hpp
+
+#pragma once
+
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <sycl/sycl.hpp>
+
+#include "convolution_types.hpp"
+
+// These kernels stream frames between device memory and the convolution
+// kernels, so that the throughput of the convolution kernels can be measured
+// without being limited by the host pipes used by the testbench.
+
+//////////////////////////////////////////////////////
+// Stream frames from memory
+//////////////////////////////////////////////////////
+class ID_FrameSource;
+
+/// @brief Stream the same frame `frames` times to `PipeOut`, with the
+/// start-of-packet and end-of-packet signals that a VVP IP would generate,
+/// followed by `dummy_beats` beats to flush the line buffer.
+template <typename PipeOut>
+struct FrameSource {
+  conv2d::GreyPixelBundle *frame_ptr;
+  int rows;
+  int cols;
+  int frames;
+  int dummy_beats;
+
+  void operator()() const {
+    const int beats_per_line = cols / conv2d::kParallelPixels;
+    const int beats_per_frame = rows * beats_per_line;
+    const int frame_beats = frames * beats_per_frame;
+
+    int beat_in_frame = 0;
+    int beat_in_line = 0;
+
+    [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+    for (int beat = 0; beat < (frame_beats + dummy_beats); beat++) {
+      bool is_dummy = (beat >= frame_beats);
+
+      conv2d::GreyPixelBundle bundle{};
+      if (!is_dummy) {
+        bundle = frame_ptr[beat_in_frame];
+      }
+
+      // sop at the beginning of each frame, eop at the end of each line
+      bool sop = !is_dummy && (beat_in_frame == 0);
+      bool eop = !is_dummy && (beat_in_line == (beats_per_line - 1));
+      PipeOut::write(conv2d::GreyScaleBeat(bundle, sop, eop, 0));
+
+      beat_in_line++;
+      if (beat_in_line == beats_per_line) {
+        beat_in_line = 0;
+      }
+      beat_in_frame++;
+      if (beat_in_frame == beats_per_frame) {
+        beat_in_frame = 0;
+      }
+    }
+  }
+};
+
+//////////////////////////////////////////////////////
+// Stream frames to memory
+//////////////////////////////////////////////////////
+class ID_FrameSink;
+
+/// @brief Consume `total_beats` beats from `PipeIn`. The beats of the frames
+/// that follow the first start-of-packet signal are written to `frame_ptr`, so
+/// that it contains the last frame once the kernel completes.
+template <typename PipeIn>
+struct FrameSink {
+  conv2d::GreyPixelBundle *frame_ptr;
+  int rows;
+  int cols;
+  int total_beats;
+
+  void operator()() const {
+    const int beats_per_frame = rows * (cols / conv2d::kParallelPixels);
+
+    bool started = false;
+    int beat_in_frame = 0;
+
+    // Read every beat that was written to the convolution kernel, including
+    // the dummy beats, so that it never stalls on a full pipe.
+    [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+    for (int beat = 0; beat < total_beats; beat++) {
+      conv2d::GreyScaleBeat in_beat = PipeIn::read();
+
+      if (in_beat.sop) {
+        started = true;
+        beat_in_frame = 0;
+      }
+
+      if (started && (beat_in_frame < beats_per_frame)) {
+        frame_ptr[beat_in_frame] = in_beat.data;
+        beat_in_frame++;
+      }
+    }
+  }
+};
@@ -96,6 +96,8 @@ using VersionCSR = sycl::ext::intel::experimental::pipe<ID_VersionCSR, int, 0,
 /// @param[in] cols total columns in input image
 /// @param[out] r_select row of window to select
 /// @param[out] c_select column of window to select
+/// @tparam kSize size of the window
+template <short kSize = conv2d::kWindowSize>
 void SaturateWindowCoordinates(short w_row, short w_col, short row, short col,
                                short rows, short cols, short &r_select,
                                short &c_select) {
@@ -109,24 +111,95 @@ void SaturateWindowCoordinates(short w_row, short w_col, short row, short col,
 
   // logic to deal with image borders: border pixel duplication
   r_select = w_row;
-  int rDiff = w_row - (conv2d::kWindowSize / 2) + row;
+  int rDiff = w_row - (kSize / 2) + row;
   if (rDiff < 0) {
-    r_select = (conv2d::kWindowSize / 2) - row;
+    r_select = (kSize / 2) - row;
   }
   if (rDiff >= rows) {
-    r_select = (conv2d::kWindowSize / 2) + ((rows - 1) - row);
+    r_select = (kSize / 2) + ((rows - 1) - row);
   }
 
   c_select = w_col;
-  int cDiff = w_col - (conv2d::kWindowSize / 2) + col;
+  int cDiff = w_col - (kSize / 2) + col;
   if (cDiff < 0) {
-    c_select = (conv2d::kWindowSize / 2) - col;
+    c_select = (kSize / 2) - col;
   }
   if (cDiff >= cols) {
-    c_select = (conv2d::kWindowSize / 2) + ((cols - 1) - col);
+    c_select = (kSize / 2) + ((cols - 1) - col);
   }
 }
 
+/// @brief Window stage that performs a 2D Convolution on a `kSize` x `kSize`
+/// window. Stages can be chained with `LineBuffer2d::FilterFused()`, so that
+/// several filters share the same line buffer.
+/// @tparam kSize size of the window
+/// @tparam kSignedOutput if `true`, the range (-1.0, 1.0) of the convolution
+/// result is mapped to the range of a pixel (e.g. for edge detection).
+/// Otherwise the result is saturated to [0, 1.0) (e.g. for smoothing).
+template <short kSize, bool kSignedOutput = false>
+struct ConvolutionStage {
+  constexpr static short kStencilSize = kSize;
+
+  // Array of coefficients to use for convolution
+  std::array<float, kSize * kSize> coefficients;
+
+  /// @brief Window function that performs a 2D Convolution in a line buffer
+  /// framework
+  /// @param row y-coordinate of pixel at the center of the window
+  /// @param col x-coordinate of pixel at the center of the window
+  /// @param rows total rows in input image
+  /// @param cols total columns in input image
+  /// @param buffer Window of pixels from input image
+  /// @return pixel value to stream out
+  conv2d::PixelType operator()(short row, short col, short rows, short cols,
+                               conv2d::PixelType *buffer) const {
+    constexpr float kNormalizationFactor = (1 << conv2d::kBitsPerChannel);
+
+    float sum = 0.0f;
+#pragma unroll
+    for (int w_row = 0; w_row < kSize; w_row++) {
+#pragma unroll
+      for (int w_col = 0; w_col < kSize; w_col++) {
+        short c_select, r_select;
+
+        // handle the case where the center of the window is at the image
+        // edge. In this design, simply 'reflect' pixels that are already in
+        // the window.
+        SaturateWindowCoordinates<kSize>(w_row, w_col,  // NO-FORMAT: Alignment
+                                         row, col,      // NO-FORMAT: Alignment
+                                         rows, cols,    // NO-FORMAT: Alignment
+                                         r_select, c_select);
+        conv2d::PixelType pixel = buffer[c_select + r_select * kSize];
+
+        // converting `pixel` to a floating-point value uses lots of FPGA
+        // resources. If your expected coefficients have a narrow range, it
+        // will be worthwhile to convert these operations to fixed-point.
+        float normalized_pixel = (float)pixel / kNormalizationFactor;
+
+        float normalized_coeff = coefficients[w_col + w_row * kSize];
+
+        sum += normalized_pixel * normalized_coeff;
+      }
+    }
+
+    conv2d::PixelType return_val;
+    if constexpr (kSignedOutput) {
+      // map range (-1.0, 1.0) to [0, 1<<kBitsPerChannel)
+      constexpr float kOutputOffset = ((1 << conv2d::kBitsPerChannel) / 2);
+      return_val = ((int16_t)kOutputOffset + (int16_t)(sum * (kOutputOffset)));
+    } else {
+      // map range [0, 1.0) to [0, 1<<kBitsPerChannel)
+      constexpr float kMaxPixel = kNormalizationFactor - 1.0f;
+      float scaled = sum * kNormalizationFactor;
+      scaled = fpga_tools::Max(scaled, 0.0f);
+      scaled = fpga_tools::Min(scaled, kMaxPixel);
+      return_val = (conv2d::PixelType)scaled;
+    }
+
+    return return_val;
+  }
+};
+
 /// @brief Window function that performs a 2D Convolution in a line buffer
 /// framework
 /// @param row y-coordinate of pixel at the center of the window
@@ -140,46 +213,8 @@ conv2d::PixelType ConvolutionFunction(
     short row, short col, short rows, short cols, conv2d::PixelType *buffer,
     const std::array<float, conv2d::kWindowSize * conv2d::kWindowSize>
         coefficients) {
-  float sum = 0.0f;
-#pragma unroll
-  for (int w_row = 0; w_row < conv2d::kWindowSize; w_row++) {
-#pragma unroll
-    for (int w_col = 0; w_col < conv2d::kWindowSize; w_col++) {
-      short c_select, r_select;
-
-      // handle the case where the center of the window is at the image edge.
-      // In this design, simply 'reflect' pixels that are already in the
-      // window.
-      SaturateWindowCoordinates(w_row, w_col,  // NO-FORMAT: Alignment
-                                row, col,      // NO-FORMAT: Alignment
-                                rows, cols,    // NO-FORMAT: Alignment
-                                r_select, c_select);
-      conv2d::PixelType pixel =
-          buffer[c_select + r_select * conv2d::kWindowSize];
-
-      constexpr float kNormalizationFactor = (1 << conv2d::kBitsPerChannel);
-
-      // converting `pixel` to a floating-point value uses lots of FPGA
-      // resources. If your expected coefficients have a narrow range, it will
-      // be worthwhile to convert these operations to fixed-point.
-      float normalized_pixel = (float)pixel / kNormalizationFactor;
-
-      float normalized_coeff =
-          coefficients[w_col + w_row * conv2d::kWindowSize];
-
-      sum += normalized_pixel * normalized_coeff;
-    }
-  }
-
-  // map range [0, 1.0) to [0, 1<<kBitsPerChannel)
-  // conv2d::PixelType return_val = sum * (float)(1 << conv2d::kBitsPerChannel);
-
-  // map range (-1.0, 1.0) to [0, 1<<kBitsPerChannel)
-  constexpr float kOutputOffset = ((1 << conv2d::kBitsPerChannel) / 2);
-  conv2d::PixelType return_val =
-      ((int16_t)kOutputOffset + (int16_t)(sum * (kOutputOffset)));
-
-  return return_val;
+  ConvolutionStage<conv2d::kWindowSize, true> convolution{coefficients};
+  return convolution(row, col, rows, cols, buffer);
 }
 
 //////////////////////////////////////////////////////
@@ -301,6 +336,95 @@ struct Convolution2d {
   }
 };
 
+//////////////////////////////////////////////////////
+// Perform a chain of Convolutions on one line buffer
+//////////////////////////////////////////////////////
+
+// Window size of the denoise filter applied before the convolution
+constexpr short kDenoiseWindowSize = 3;
+
+using DenoiseStage = ConvolutionStage<kDenoiseWindowSize>;
+using EdgeStage = ConvolutionStage<conv2d::kWindowSize, true>;
+
+constexpr short kFusedWindowSize =
+    line_buffer_2d::FusedStencilSize<DenoiseStage, EdgeStage>();
+
+class ID_Convolution2dFused;
+
+/// @brief Same as `Convolution2d`, but first smooths the image with a denoise
+/// filter. Both filters share one line buffer, which is sized for the fused
+/// window of the two filters (5x5 for two 3x3 filters). This uses the same CSR
+/// pipes as `Convolution2d`, so a design should only contain one of these two
+/// kernels.
+template <typename PipeIn, typename PipeOut>
+struct Convolution2dFused {
+  // these defaults are not propagated to the RTL
+  int rows = 0;
+  int cols = 0;
+
+  // Coefficients of the denoise filter and of the convolution applied to the
+  // denoised image.
+  std::array<float, kDenoiseWindowSize * kDenoiseWindowSize> denoise_coeffs;
+  std::array<float, conv2d::kWindowSize * conv2d::kWindowSize> coeffs;
+
+  void operator()() const {
+    // Publish kernel version so that other IPs can poll it
+    VersionCSR::write(kKernelVersion);
+
+    // This instance of the line buffer is sized for the window of both
+    // filters.
+    line_buffer_2d::LineBuffer2d<conv2d::PixelType, conv2d::PixelType,
+                                 kFusedWindowSize, conv2d::kMaxCols,
+                                 conv2d::kParallelPixels>
+        myLineBuffer(rows, cols);
+
+    DenoiseStage denoise{denoise_coeffs};
+    EdgeStage edge{coeffs};
+
+    bool keep_going = true;
+    bool bypass = false;
+
+    [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+    while (keep_going) {
+      // do non-blocking reads so that the kernel can be interrupted at any
+      // time.
+      bool did_read_beat = false;
+      conv2d::GreyScaleBeat new_beat = PipeIn::read(did_read_beat);
+
+      bool did_read_bypass = false;
+      bool should_bypass = BypassCSR::read(did_read_bypass);
+
+      bool did_read_stop = false;
+      bool should_stop = StopCSR::read(did_read_stop);
+
+      if (did_read_bypass) {
+        bypass = should_bypass;
+      }
+
+      if (did_read_beat) {
+        conv2d::GreyScaleBeat output_beat;
+        if (bypass) {
+          output_beat = new_beat;
+        } else {
+          bool sop, eop;
+
+          // Run the denoise filter and the convolution as a single window
+          // function on the fused window.
+          conv2d::GreyPixelBundle output_bundle = myLineBuffer.FilterFused(
+              new_beat.data, new_beat.sop, new_beat.eop, sop, eop, denoise,
+              edge);
+          output_beat = conv2d::GreyScaleBeat(output_bundle, sop, eop, 0);
+        }
+        PipeOut::write(output_beat);
+      }
+
+      if (did_read_stop) {
+        keep_going = !should_stop;
+      }
+    }
+  }
+};
+
 //////////////////////////////////////////////////////
 // Convert Grayscale to RGB for the display
 //////////////////////////////////////////////////////
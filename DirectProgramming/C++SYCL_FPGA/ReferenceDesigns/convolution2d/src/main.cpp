@@ -9,11 +9,16 @@
 #define NUM_FRAMES 5
 #include <stdlib.h>  // malloc, free
 
+#include <algorithm>  // clamp
+#include <chrono>
 #include <fstream>  // ofstream
 #include <iostream>
+#include <random>
 #include <string>
+#include <vector>
 #include <sycl/sycl.hpp>
 
+#include "benchmark_kernels.hpp"
 #include "bmp_tools.hpp"
 #include "convolution_kernel.hpp"
 #include "exception_handler.hpp"
@@ -39,6 +44,16 @@
 #define TEST_CONV2D_ISOLATED 0
 #endif
 
+#ifndef FUSED_BENCHMARK
+#define FUSED_BENCHMARK 0
+#endif
+
+// clock frequency of the compiled kernels in MHz, from the compile report. 0
+// if it is unknown.
+#ifndef KERNEL_CLOCK_MHZ
+#define KERNEL_CLOCK_MHZ 0
+#endif
+
 #define M_DEFAULT_INPUT DEFAULT_INPUT
 #define M_DEFAULT_OUTPUT DEFAULT_OUTPUT
 #define M_DEFAULT_EXPECTED DEFAULT_EXPECTED
@@ -159,7 +174,188 @@ bool UpdateAndCheckImageDimensions(size_t &rows, size_t &cols, size_t rows_new,
   return image_size_ok;
 }
 
-#if TEST_CONV2D_ISOLATED
+#if FUSED_BENCHMARK
+// pipes between the benchmark kernels and the convolution kernel
+class ID_BenchInStr;
+using BenchInputStream =
+    sycl::ext::intel::pipe<ID_BenchInStr, conv2d::GreyScaleBeat, 8>;
+
+class ID_BenchOutStr;
+using BenchOutputStream =
+    sycl::ext::intel::pipe<ID_BenchOutStr, conv2d::GreyScaleBeat, 8>;
+
+// 3x3 Gaussian blur
+constexpr std::array<float, kDenoiseWindowSize * kDenoiseWindowSize>
+    gaussian_coeffs = {
+        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,  //
+        2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,  //
+        1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f   //
+};
+
+constexpr std::array<float, 9> sobel_coeffs = {
+    -1.0f / 6.0f, 0.0f, 1.0f / 6.0f,  //
+    -1.0f / 6.0f, 0.0f, 1.0f / 6.0f,  //
+    -1.0f / 6.0f, 0.0f, 1.0f / 6.0f   //
+};
+
+/// @brief Apply a window stage to a whole image on the host, duplicating the
+/// pixels at the image borders.
+/// @param[in] stage window stage to apply
+/// @param[in] in_img input image
+/// @param[out] out_img output image
+/// @param[in] rows total rows in the image
+/// @param[in] cols total columns in the image
+template <typename Stage>
+void ApplyStageOnHost(Stage stage, const std::vector<conv2d::PixelType> &in_img,
+                      std::vector<conv2d::PixelType> &out_img, int rows,
+                      int cols) {
+  constexpr int kSize = Stage::kStencilSize;
+  for (int row = 0; row < rows; row++) {
+    for (int col = 0; col < cols; col++) {
+      conv2d::PixelType window[kSize * kSize];
+      for (int w_row = 0; w_row < kSize; w_row++) {
+        for (int w_col = 0; w_col < kSize; w_col++) {
+          int img_row = std::clamp(row + w_row - kSize / 2, 0, rows - 1);
+          int img_col = std::clamp(col + w_col - kSize / 2, 0, cols - 1);
+          window[w_col + w_row * kSize] = in_img[img_col + img_row * cols];
+        }
+      }
+      out_img[col + row * cols] = stage(row, col, rows, cols, window);
+    }
+  }
+}
+
+/// @brief Measure the throughput of the `Convolution2dFused` kernel, which
+/// runs a denoise filter and a convolution on one line buffer. The frames are
+/// streamed from and to device memory, so that the measurement is not limited
+/// by host pipes. The last output frame is compared with the two filters
+/// applied one after the other on the host.
+/// @param[in] q SYCL queue
+/// @param[in] rows rows in each frame
+/// @param[in] cols columns in each frame
+/// @param[in] frames number of frames to stream through the kernel
+/// @param[in] kernel_clock_mhz clock frequency of the compiled kernels in MHz,
+/// or `0` if it is unknown
+/// @return `true` if the last output frame matches the host computation
+bool RunFusedBenchmark(sycl::queue q, int rows, int cols, int frames,
+                       double kernel_clock_mhz) {
+  std::cout << "\n**********************************\n"
+            << "Fused denoise + convolution benchmark: " << frames
+            << " frames of " << cols << " x " << rows << " pixels, "
+            << conv2d::kParallelPixels << " pixels in parallel"
+            << "\n**********************************\n"
+            << std::endl;
+
+  if (cols % conv2d::kParallelPixels != 0 || cols > (int)conv2d::kMaxCols) {
+    std::cerr << "ERROR: image cols = " << cols
+              << " not compatible with kernel compiled for "
+              << conv2d::kParallelPixels << " pixels in parallel and "
+              << conv2d::kMaxCols << " max columns." << std::endl;
+    return false;
+  }
+
+  const int pixel_count = rows * cols;
+  const int bundle_count = pixel_count / conv2d::kParallelPixels;
+
+  // random input frame
+  std::vector<conv2d::PixelType> in_img(pixel_count);
+  std::default_random_engine generator(7);
+  std::uniform_int_distribution<int> distribution(
+      0, (1 << conv2d::kBitsPerChannel) - 1);
+  for (auto &pixel : in_img) {
+    pixel = distribution(generator);
+  }
+
+  // expected output: the two filters applied one after the other
+  std::vector<conv2d::PixelType> denoised_img(pixel_count);
+  std::vector<conv2d::PixelType> expected_img(pixel_count);
+  ApplyStageOnHost(DenoiseStage{gaussian_coeffs}, in_img, denoised_img, rows,
+                   cols);
+  ApplyStageOnHost(EdgeStage{sobel_coeffs}, denoised_img, expected_img, rows,
+                   cols);
+
+  conv2d::GreyPixelBundle *in_ptr =
+      sycl::malloc_shared<conv2d::GreyPixelBundle>(bundle_count, q);
+  conv2d::GreyPixelBundle *out_ptr =
+      sycl::malloc_shared<conv2d::GreyPixelBundle>(bundle_count, q);
+  if ((in_ptr == nullptr) || (out_ptr == nullptr)) {
+    std::cerr << "ERROR: failed to allocate space for the frames."
+              << std::endl;
+    return false;
+  }
+
+  for (int i = 0; i < bundle_count; i++) {
+    for (int j = 0; j < (int)conv2d::kParallelPixels; j++) {
+      in_ptr[i][j] = in_img[i * conv2d::kParallelPixels + j];
+    }
+  }
+
+  // extra beats to flush out the line buffer
+  int dummy_beats = cols * kFusedWindowSize / conv2d::kParallelPixels;
+  int total_beats = frames * bundle_count + dummy_beats;
+
+  std::cout << "Launch Convolution2dFused kernel" << std::endl;
+  sycl::event e = q.single_task<ID_Convolution2dFused>(
+      Convolution2dFused<BenchInputStream, BenchOutputStream>{
+          rows, cols, gaussian_coeffs, sobel_coeffs});
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  sycl::event sink_event = q.single_task<ID_FrameSink>(
+      FrameSink<BenchOutputStream>{out_ptr, rows, cols, total_beats});
+  q.single_task<ID_FrameSource>(FrameSource<BenchInputStream>{
+      in_ptr, rows, cols, frames, dummy_beats});
+  sink_event.wait();
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+
+  // Stop the kernel in case testbench wants to run again with different kernel
+  // arguments.
+  StopCSR::write(q, true);
+  e.wait();
+
+  int mismatches = 0;
+  for (int i = 0; i < bundle_count; i++) {
+    for (int j = 0; j < (int)conv2d::kParallelPixels; j++) {
+      int idx = i * conv2d::kParallelPixels + j;
+      mismatches += (out_ptr[i][j] != expected_img[idx]) ? 1 : 0;
+    }
+  }
+
+  sycl::free(in_ptr, q);
+  sycl::free(out_ptr, q);
+
+  if (mismatches != 0) {
+    std::cerr << "ERROR: " << mismatches
+              << " pixels of the last frame do not match the host computation."
+              << std::endl;
+    return false;
+  }
+
+  // NOTE: when run in emulation, these results do not accurately represent
+  // the performance of the kernels in actual FPGA hardware
+  double time_s = std::chrono::duration<double>(end_time - start_time).count();
+  double frames_per_s = frames / time_s;
+  double pixels_per_s = frames_per_s * pixel_count;
+
+  std::cout << "Execution time: " << time_s * 1e3 << " ms" << std::endl;
+  std::cout << "Throughput: " << frames_per_s << " frames/s ("
+            << pixels_per_s * 1e-6 << " Mpixels/s)" << std::endl;
+
+  // Pixels/cycle is what shows whether the `PARALLEL_PIXELS` lanes of the
+  // line buffer are kept busy. It needs the fmax that Quartus achieved for
+  // this compile, which is neither the `-Xsclock` target nor anything the
+  // runtime can query, so it is only printed when it was passed in.
+  if (kernel_clock_mhz > 0) {
+    std::cout << "Pixels/cycle: " << pixels_per_s / (kernel_clock_mhz * 1e6)
+              << " (at " << kernel_clock_mhz << " MHz, the maximum is "
+              << conv2d::kParallelPixels << ")" << std::endl;
+  }
+
+  return true;
+}
+
+#elif TEST_CONV2D_ISOLATED
 constexpr std::array<float, 9> identity_coeffs = {
     0.0f, 0.0f, 0.0f,  //
     0.0f, 1.0f, 0.0f,  //
@@ -630,7 +826,29 @@ int main(int argc, char **argv) {
 
     bool all_passed = true;
 
-#if TEST_CONV2D_ISOLATED
+#if FUSED_BENCHMARK
+    // the kernel clock frequency in MHz can be given as the first command
+    // line argument, which overrides -DKERNEL_CLOCK_MHZ
+    double kernel_clock_mhz = KERNEL_CLOCK_MHZ;
+    if (argc > 1) {
+      kernel_clock_mhz = atof(argv[1]);
+    }
+    if (kernel_clock_mhz < 0) {
+      std::cerr << "ERROR: the kernel clock frequency must not be negative"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    // 4K UHD frames. The simulator only processes a few small frames, since
+    // simulating a full 4K frame would take too long.
+#if FPGA_SIMULATOR
+    all_passed &= RunFusedBenchmark(q, 16, 64, 2, kernel_clock_mhz);
+#elif FPGA_HARDWARE
+    all_passed &= RunFusedBenchmark(q, 2160, 3840, 64, kernel_clock_mhz);
+#else
+    all_passed &= RunFusedBenchmark(q, 2160, 3840, 2, kernel_clock_mhz);
+#endif
+#elif TEST_CONV2D_ISOLATED
     all_passed &= TestTinyFrameOnStencil(q, false);
     all_passed &= TestBypass(q, false);
 #else
@@ -0,0 +1,219 @@
+// ==============================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// This agreement shall be governed in all respects by the laws of the State of
+// California and by the laws of the United States of America.
+
+#ifndef __CRR_CPU_H__
+#define __CRR_CPU_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "CRR_common.hpp"
+
+// Multi-threaded CPU implementation of the CRR binomial tree, computing the
+// same three option prices per CRR problem as the FPGA kernel:
+// [0] : the tree extended by kOpt0 steps, used for Premium, Delta, Gamma and
+//       Theta
+// [1] : the tree with a bumped interest rate, used for Rho
+// [2] : the tree with a bumped volatility, used for Vega
+//
+// The nodes of one level are updated by a loop without loop-carried
+// dependencies (the exercise values are computed in a separate loop and the
+// tree values are double-buffered), so that the compiler can vectorize it.
+// Options are distributed dynamically across the threads.
+//
+// Trees [0] and [1] have the same up factor, so a node at a given level has
+// the same underlying price in both trees. The two trees are thus computed in
+// the same sweep, and the exercise values of each level are only computed
+// once.
+
+// Per-thread scratch space for the backward induction
+struct CrrCpuScratch {
+  std::vector<double> u2_pow;   // powers of u2
+  std::vector<double> exer;     // exercise values of the current level
+  std::vector<double> val[2];   // tree [0] values, double-buffered
+  std::vector<double> val_1[2]; // tree [1] values, double-buffered
+
+  void Resize(size_t size) {
+    if (u2_pow.size() < size) {
+      u2_pow.resize(size);
+      exer.resize(size);
+      for (int b = 0; b < 2; ++b) {
+        val[b].resize(size);
+        val_1[b].resize(size);
+      }
+    }
+  }
+};
+
+// Computes the values of one level of a tree from the values of the next
+// level, and the exercise values of the level.
+inline void CrrCpuLevel(int nodes, double c1, double c2,
+                        const double *__restrict next_level,
+                        const double *__restrict exer,
+                        double *__restrict level) {
+  for (int j = 0; j < nodes; ++j) {
+    level[j] = std::max(c1 * next_level[j] + c2 * next_level[j + 1], exer[j]);
+  }
+}
+
+// Computes the exercise values of the `nodes` nodes of a level, whose lowest
+// underlying price is `x_min`.
+inline void CrrCpuExercise(int nodes, double cp, double strike, double x_min,
+                           const double *__restrict u2_pow,
+                           double *__restrict exer) {
+  for (int j = 0; j < nodes; ++j) {
+    exer[j] = cp * (x_min * u2_pow[j] - strike);
+  }
+}
+
+// Computes powers of u2 up to u2^steps
+inline void CrrCpuPowers(int steps, double u2, double *u2_pow) {
+  u2_pow[0] = 1.0;
+  for (int j = 1; j <= steps; ++j) {
+    u2_pow[j] = u2_pow[j - 1] * u2;
+  }
+}
+
+// Solves the three trees of one CRR problem on the CPU
+inline InterRes CrrCpuSolve(const InputData &inp, const CRRInParams &vals,
+                            CrrCpuScratch &s) {
+  InterRes res;
+  const int n_steps = vals.n_steps;
+  const int m = n_steps + kOpt0;
+  const double cp = inp.cp;
+  s.Resize(m + 2);
+
+  // Trees [0] and [1]: both trees are swept together from the leaves of tree
+  // [0] (level m) to the root (level 0). Tree [1] starts at level n_steps.
+  CrrCpuPowers(m, vals.u2[0], s.u2_pow.data());
+  CrrCpuExercise(m + 1, cp, inp.strike, vals.umin[0], s.u2_pow.data(),
+                 s.exer.data());
+  double *cur = s.val[0].data(), *nxt = s.val[1].data();
+  double *cur_1 = s.val_1[0].data(), *nxt_1 = s.val_1[1].data();
+  for (int j = 0; j <= m; ++j) {
+    cur[j] = std::max(s.exer[j], 0.0);
+  }
+
+  double x_min = vals.umin[0];
+  for (int i = m - 1; i >= 0; --i) {
+    x_min *= vals.u[0];
+    CrrCpuExercise(i + 1, cp, inp.strike, x_min, s.u2_pow.data(),
+                   s.exer.data());
+
+    CrrCpuLevel(i + 1, vals.c1[0], vals.c2[0], cur, s.exer.data(), nxt);
+    std::swap(cur, nxt);
+
+    if (i == n_steps) {
+      // the leaves of tree [1] are at the same prices as level n_steps of
+      // tree [0]
+      for (int j = 0; j <= i; ++j) {
+        cur_1[j] = std::max(s.exer[j], 0.0);
+      }
+    } else if (i < n_steps) {
+      CrrCpuLevel(i + 1, vals.c1[1], vals.c2[1], cur_1, s.exer.data(), nxt_1);
+      std::swap(cur_1, nxt_1);
+    }
+
+    // derivative prices used for the Greeks
+    if (i == 4) {
+      res.pgreek[3] = cur[2];
+    }
+    if (i == 2) {
+      res.pgreek[0] = cur[0];
+      res.pgreek[1] = cur[1];
+      res.pgreek[2] = cur[2];
+    }
+  }
+  res.vals[0] = cur[0];
+  res.vals[1] = cur_1[0];
+
+  // Tree [2] has a different up factor, so it is computed on its own.
+  CrrCpuPowers(n_steps, vals.u2[2], s.u2_pow.data());
+  CrrCpuExercise(n_steps + 1, cp, inp.strike, vals.umin[2], s.u2_pow.data(),
+                 s.exer.data());
+  for (int j = 0; j <= n_steps; ++j) {
+    cur[j] = std::max(s.exer[j], 0.0);
+  }
+
+  x_min = vals.umin[2];
+  for (int i = n_steps - 1; i >= 0; --i) {
+    x_min *= vals.u[2];
+    CrrCpuExercise(i + 1, cp, inp.strike, x_min, s.u2_pow.data(),
+                   s.exer.data());
+    CrrCpuLevel(i + 1, vals.c1[2], vals.c2[2], cur, s.exer.data(), nxt);
+    std::swap(cur, nxt);
+  }
+  res.vals[2] = cur[0];
+
+  return res;
+}
+
+// Runs func(item, thread) for each item in [0, n_items) on n_threads threads
+template <typename Func>
+void CrrParallelFor(int n_items, int n_threads, Func func) {
+  n_threads = std::max(1, std::min(n_threads, n_items));
+  std::atomic<int> next_item(0);
+
+  auto worker = [&](int thread) {
+    for (int item = next_item++; item < n_items; item = next_item++) {
+      func(item, thread);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < n_threads; ++t) {
+    threads.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Solves the CRR problems of all the options on n_threads threads.
+// Returns the time taken, in seconds.
+inline double CrrCpuSolver(const std::vector<InputData> &inp,
+                           const std::vector<CRRInParams> &in_params,
+                           std::vector<InterRes> &res, int n_items,
+                           int n_threads) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<CrrCpuScratch> scratch(std::max(1, n_threads));
+  CrrParallelFor(n_items, n_threads, [&](int item, int thread) {
+    res[item] = CrrCpuSolve(inp[item], in_params[item], scratch[thread]);
+  });
+
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::duration<double>>(end - start)
+      .count();
+}
+
+#endif
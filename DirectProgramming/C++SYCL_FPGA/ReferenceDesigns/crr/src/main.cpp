@@ -92,16 +92,21 @@
 
 #include <sycl/sycl.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
+#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <numeric>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include "CRR_common.hpp"
+#include "CRR_cpu.hpp"
 
 #include "exception_handler.hpp"
 
@@ -530,6 +535,65 @@ void PrepareKernelData(vector<CRRInParams> &in_params,
   }
 }
 
+// Batch mode version of PrepareArrData + PrepareKernelData, which writes the
+// metadata of the 3 CRR sub-problems of one option directly to meta[0..2] and
+// per_step[0..2]. Only the elements read by the kernel (up to
+// n_steps + kOpt0) are computed.
+// Trees [0] and [1] have the same up factor, so the per-step data of the tree
+// with the bumped interest rate is reused from tree [0]. Tree [0] is kOpt0
+// steps deeper, so param_1[1] = param_1[0] * u^kOpt0, which gives
+// u2[1][i] = u2[0][i], p1powu[1][i] = p1powu[0][i + kOpt0] and
+// init_optval[1][i] = init_optval[0][i + kOpt0 / 2].
+void PrepareBatchKernelData(const CRRInParams &in, CRRMeta *meta,
+                            CRRPerStepMeta *per_step) {
+  // u^kOpt0 must be a whole power of u2 for init_optval to be reused
+  static_assert(kOpt0 % 2 == 0, "kOpt0 must be even to reuse tree [0]");
+  constexpr int kP1PowUShift = kOpt0;
+  constexpr int kInitOptvalShift = kOpt0 / 2;
+
+  const int m = in.n_steps + kOpt0;
+
+  for (int inner_func_index = 0; inner_func_index < 3; ++inner_func_index) {
+    CRRMeta &dst_crr_meta = meta[inner_func_index];
+    dst_crr_meta.u = in.u[inner_func_index];
+    dst_crr_meta.c1 = in.c1[inner_func_index];
+    dst_crr_meta.c2 = in.c2[inner_func_index];
+    dst_crr_meta.param_1 = in.param_1[inner_func_index];
+    dst_crr_meta.param_2 = in.param_2;
+    dst_crr_meta.n_steps =
+        (inner_func_index == 0) ? in.n_steps + kOpt0 : in.n_steps;
+  }
+
+  // Trees [0] and [1]
+  for (int i = 0; i <= m + kP1PowUShift; ++i) {
+    const double u2_pow = sycl::pow(in.u2[0], (double) i);
+    const double p1powu = in.param_1[0] * sycl::pow(in.u[0], (double) (i + 1));
+    const double init_optval = sycl::fmax(in.param_1[0] * u2_pow - in.param_2,
+                                          0.0);
+    if (i <= m) {
+      per_step[0].array_eles[i].u2 = u2_pow;
+      per_step[0].array_eles[i].p1powu = p1powu;
+      per_step[0].array_eles[i].init_optval = init_optval;
+      per_step[1].array_eles[i].u2 = u2_pow;
+    }
+    if (i >= kInitOptvalShift && i - kInitOptvalShift <= m) {
+      per_step[1].array_eles[i - kInitOptvalShift].init_optval = init_optval;
+    }
+    if (i >= kP1PowUShift) {
+      per_step[1].array_eles[i - kP1PowUShift].p1powu = p1powu;
+    }
+  }
+
+  // Tree [2] has a different up factor
+  for (int i = 0; i <= m; ++i) {
+    per_step[2].array_eles[i].u2 = sycl::pow(in.u2[2], (double) i);
+    per_step[2].array_eles[i].p1powu =
+        in.param_1[2] * sycl::pow(in.u[2], (double) (i + 1));
+    per_step[2].array_eles[i].init_optval = sycl::fmax(
+        in.param_1[2] * sycl::pow(in.u2[2], (double) i) - in.param_2, 0.0);
+  }
+}
+
 // Takes in the result from the kernel and stores the 3 option prices
 // belonging to the same CRR problem in one InterRes element
 void ProcessKernelResult(const vector<CRRResParams> &res_params,
@@ -574,94 +638,108 @@ OutputRes ComputeOutput(const InputData &inp, const CRRInParams &in_params,
   return res;
 }
 
-// Perform CRR solving using the CPU and compare FPGA results with CPU results
-// to test correctness.
-void TestCorrectness(int k, int n_crrs, bool &pass, const InputData &inp,
-                     CRRInParams &vals, const OutputRes &fpga_res) {
-  if (k == 0) {
-    std::cout << "\n============= Correctness Test ============= \n";
-    std::cout << "Running analytical correctness checks... \n";
-  }
-
-  // This CRR benchmark ensures a minimum 4 decimal points match between FPGA and CPU
-  // "threshold" is chosen to enforce this guarantee
-  float threshold = 0.00001;
-  int i, j, q;
-  double x;
-  int n_steps = vals.n_steps;
-  int m = n_steps + kOpt0;
-  vector<double> pvalue(kMaxNSteps3);
-  vector<double> pvalue_1(kMaxNSteps1);
-  vector<double> pvalue_2(kMaxNSteps1);
-  vector<double> pgreek(5);
-  InterRes cpu_res_params;
-  OutputRes cpu_res;
-
-  // option value computed at each final node
-  x = vals.umin[0];
-  for (i = 0; i <= m; i++, x *= vals.u2[0]) {
-    pvalue[i] = sycl::fmax(inp.cp * (x - inp.strike), 0.0);
-  }
+// Streaming batch mode: solves the CRR problems of n_items options in batches
+// of at most batch_size options. All the CRR problems of a kernel launch must
+// have the same number of time steps, so the options are grouped by n_steps
+// before being split in batches, and each batch is padded to a multiple of
+// OUTER_UNROLL options. The metadata of the next batch is prepared on
+// n_threads threads while the FPGA solves the current batch.
+// Returns the time taken, in seconds.
+double CrrBatchSolver(const vector<InputData> &inp,
+                      const vector<CRRInParams> &in_params,
+                      vector<OutputRes> &result, const int n_items,
+                      const int batch_size, const int n_threads, queue &q) {
+  auto start = std::chrono::steady_clock::now();
 
-  // backward recursion to evaluate option price
-  for (i = m - 1; i >= 0; i--) {
-    vals.umin[0] *= vals.u[0];
-    x = vals.umin[0];
-    for (j = 0; j <= i; j++, x *= vals.u2[0]) {
-      pvalue[j] = sycl::fmax(vals.c1[0] * pvalue[j] + vals.c2[0] * pvalue[j + 1],
-                       inp.cp * (x - inp.strike));
+  // Group the options by number of time steps
+  vector<int> order(n_items);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return in_params[a].n_steps < in_params[b].n_steps;
+  });
+
+  vector<vector<int>> batches;
+  for (int i = 0; i < n_items; ++i) {
+    const int opt = order[i];
+    if (batches.empty() || (int)batches.back().size() == batch_size ||
+        in_params[batches.back().back()].n_steps != in_params[opt].n_steps) {
+      batches.emplace_back();
     }
-    if (i == 4) {
-      pgreek[4] = pvalue[2];
-    }
-    if (i == 2) {
-      for (q = 0; q <= 2; q++) {
-        pgreek[q + 1] = pvalue[q];
-      }
-    }
-  }
-  cpu_res_params.vals[0] = pvalue[0];
-
-  // the above computation is repeated for each option price
-  x = vals.umin[1];
-  for (i = 0; i <= n_steps; i++, x *= vals.u2[1]) {
-    pvalue_1[i] = sycl::fmax(inp.cp * (x - inp.strike), 0.0);
+    batches.back().push_back(opt);
   }
 
-  for (i = n_steps - 1; i >= 0; i--) {
-    vals.umin[1] *= vals.u[1];
-    x = vals.umin[1];
-
-    for (j = 0; j <= i; j++, x *= vals.u2[1]) {
-      pvalue_1[j] =
-          sycl::fmax(vals.c1[1] * pvalue_1[j] + vals.c2[1] * pvalue_1[j + 1],
-               inp.cp * (x - inp.strike));
+  // The kernel solves OUTER_UNROLL CRR problems at a time. Batches are padded
+  // with copies of their last option, whose results are ignored.
+  vector<int> batch_items(batches.size());
+  for (size_t b = 0; b < batches.size(); ++b) {
+    batch_items[b] = batches[b].size();
+    while (batches[b].size() % OUTER_UNROLL != 0) {
+      batches[b].push_back(batches[b].back());
     }
   }
-  cpu_res_params.vals[1] = pvalue_1[0];
-
-  x = vals.umin[2];
-  for (i = 0; i <= n_steps; i++, x *= vals.u2[2]) {
-    pvalue_2[i] = sycl::fmax(inp.cp * (x - inp.strike), 0.0);
-  }
 
-  for (i = n_steps - 1; i >= 0; i--) {
-    vals.umin[2] *= vals.u[2];
-    x = vals.umin[2];
-    for (j = 0; j <= i; j++, x *= vals.u2[2]) {
-      pvalue_2[j] =
-          sycl::fmax(vals.c1[2] * pvalue_2[j] + vals.c2[2] * pvalue_2[j + 1],
-               inp.cp * (x - inp.strike));
+  std::cout << "Solving " << n_items << " options in " << batches.size()
+            << " batches\n";
+
+  // Two sets of kernel inputs, so that one batch can be prepared while the
+  // other one is solved
+  vector<CRRMeta> in_buff_params[2];
+  vector<CRRPerStepMeta> in_buff2_params[2];
+  vector<CRRResParams> res_params[2];
+
+  auto prepare = [&](int b, int set) {
+    const int n = batches[b].size();
+    in_buff_params[set].resize(n * 3);
+    in_buff2_params[set].resize(n * 3);
+    res_params[set].resize(n * 3);
+    CrrParallelFor(n, n_threads, [&](int k, int) {
+      PrepareBatchKernelData(in_params[batches[b][k]],
+                             &in_buff_params[set][k * 3],
+                             &in_buff2_params[set][k * 3]);
+    });
+  };
+
+  prepare(0, 0);
+  for (size_t b = 0; b < batches.size(); ++b) {
+    const int set = b % 2;
+    const int n = batches[b].size();
+
+    auto solve = std::async(std::launch::async, [&, set, n]() {
+      CrrSolver(n, in_buff_params[set], res_params[set], in_buff2_params[set],
+                q);
+    });
+
+    if (b + 1 < batches.size()) {
+      prepare(b + 1, 1 - set);
+    }
+    solve.wait();
+
+    // Post-processing of the solved batch
+    vector<InterRes> process_res(n);
+    ProcessKernelResult(res_params[set], process_res, n);
+    for (int k = 0; k < batch_items[b]; ++k) {
+      const int opt = batches[b][k];
+      result[opt] = ComputeOutput(inp[opt], in_params[opt], process_res[k]);
     }
   }
-  cpu_res_params.vals[2] = pvalue_2[0];
-  pgreek[0] = 0;
 
-  for (i = 1; i < 5; ++i) {
-    cpu_res_params.pgreek[i - 1] = pgreek[i];
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::duration<double>>(end - start)
+      .count();
+}
+
+// Compare FPGA results with the results of the CPU implementation to test
+// correctness.
+void TestCorrectness(int k, int n_crrs, bool &pass, const OutputRes &cpu_res,
+                     const OutputRes &fpga_res) {
+  if (k == 0) {
+    std::cout << "\n============= Correctness Test ============= \n";
+    std::cout << "Running analytical correctness checks... \n";
   }
 
-  cpu_res = ComputeOutput(inp, vals, cpu_res_params);
+  // This CRR benchmark ensures a minimum 4 decimal points match between FPGA and CPU
+  // "threshold" is chosen to enforce this guarantee
+  float threshold = 0.00001;
 
   if (abs(cpu_res.value - fpga_res.value) > threshold) {
     pass = false;
@@ -717,12 +795,17 @@ void TestCorrectness(int k, int n_crrs, bool &pass, const InputData &inp,
   }
 }
 
-// Print out the achieved CRR throughput
-void TestThroughput(const double &time, const int &n_crrs) {
+// Print out the achieved CRR throughput, and the throughput of the CPU
+// implementation as a baseline
+void TestThroughput(const double &time, const int &n_crrs,
+                    const double &cpu_time, const int &n_threads) {
   std::cout << "\n============= Throughput Test =============\n";
 
   std::cout << "   Avg throughput:   " << std::fixed << std::setprecision(1)
             << (n_crrs / time) << " assets/s\n";
+  std::cout << "   CPU throughput:   " << std::fixed << std::setprecision(1)
+            << (n_crrs / cpu_time) << " assets/s (" << n_threads
+            << " threads)\n";
 }
 
 int main(int argc, char *argv[]) {
@@ -737,12 +820,19 @@ int main(int argc, char *argv[]) {
   const string default_ofile = "src/data/ordered_outputs.csv";
 
   char str_buffer[kMaxStringLen] = {0};
+  char batch_buffer[kMaxStringLen] = {0};
+  char num_options_buffer[kMaxStringLen] = {0};
+  char threads_buffer[kMaxStringLen] = {0};
   for (int i = 1; i < argc; i++) {
     if (argv[i][0] == '-') {
       string sarg(argv[i]);
 
       FindGetArgString(sarg, "-o=", str_buffer, kMaxStringLen);
       FindGetArgString(sarg, "--output-file=", str_buffer, kMaxStringLen);
+      FindGetArgString(sarg, "--batch=", batch_buffer, kMaxStringLen);
+      FindGetArgString(sarg, "--num-options=", num_options_buffer,
+                       kMaxStringLen);
+      FindGetArgString(sarg, "--threads=", threads_buffer, kMaxStringLen);
     } else {
       infilename = string(argv[i]);
     }
@@ -806,11 +896,39 @@ int main(int argc, char *argv[]) {
     // Read inputs data from input file
     ReadInputFromFile(inputFile, inp);
 
+    // Batch mode settings. With --num-options, the options of the input file
+    // are repeated to price the requested number of options.
+    const int batch_size = strlen(batch_buffer) ? atoi(batch_buffer) : 0;
+    const int n_threads = strlen(threads_buffer)
+                              ? atoi(threads_buffer)
+                              : static_cast<int>(std::max(
+                                    1u, std::thread::hardware_concurrency()));
+    if (strlen(batch_buffer) && batch_size <= 0) {
+      std::cerr << "The batch size must be positive\n";
+      return 1;
+    }
+    if (n_threads <= 0) {
+      std::cerr << "The number of threads must be positive\n";
+      return 1;
+    }
+    if (strlen(num_options_buffer)) {
+      const int n_options = atoi(num_options_buffer);
+      if (n_options <= 0 || inp.empty()) {
+        std::cerr << "The number of options must be positive\n";
+        return 1;
+      }
+      const int n_file_options = inp.size();
+      for (int i = n_file_options; i < n_options; ++i) {
+        inp.push_back(inp[i % n_file_options]);
+      }
+      inp.resize(n_options);
+    }
+
 // Get the number of data from the input file
 // Emulator mode only goes through one input (or through OUTER_UNROLL inputs) to
 // ensure fast runtime
 #if defined(FPGA_EMULATOR)
-    int temp_crrs = 1;
+    int temp_crrs = strlen(num_options_buffer) ? inp.size() : 1;
 #else
     int temp_crrs = inp.size();
 #endif
@@ -828,43 +946,80 @@ int main(int argc, char *argv[]) {
     const int n_crrs = temp_crrs;
 
     vector<CRRInParams> in_params(n_crrs);
-    vector<CRRArrayEles> array_params(n_crrs);
-
     for (int j = 0; j < n_crrs; ++j) {
       in_params[j] = PrepareData(inp[j]);
-      array_params[j] = PrepareArrData(in_params[j]);
     }
 
-    // following vectors are arguments for CrrSolver
-    vector<CRRMeta> in_buff_params(n_crrs * 3);
-    vector<CRRPerStepMeta> in_buff2_params(n_crrs * 3);
+    vector<OutputRes> result(n_crrs);
+    double time;
+
+    if (batch_size > 0) {
+#ifdef FPGA_HARDWARE
+      // warmup run - use this run to warmup accelerator
+      vector<OutputRes> result_dummy(n_crrs);
+      CrrBatchSolver(inp, in_params, result_dummy, n_crrs, batch_size,
+                     n_threads, q);
+#endif
+
+      // Timed run - profile performance
+      time = CrrBatchSolver(inp, in_params, result, n_crrs, batch_size,
+                            n_threads, q);
+    } else {
+      // The kernel solves OUTER_UNROLL CRR problems at a time. As in the
+      // batch mode, the kernel inputs are padded to a multiple of
+      // OUTER_UNROLL options by repeating the last option, and the results
+      // of the padding are ignored.
+      const int n_padded =
+          ((n_crrs + (OUTER_UNROLL - 1)) / OUTER_UNROLL) * OUTER_UNROLL;
+      vector<CRRInParams> padded_params(in_params);
+      padded_params.resize(n_padded, in_params.back());
+
+      vector<CRRArrayEles> array_params(n_padded);
+      for (int j = 0; j < n_padded; ++j) {
+        array_params[j] = PrepareArrData(padded_params[j]);
+      }
+
+      // following vectors are arguments for CrrSolver
+      vector<CRRMeta> in_buff_params(n_padded * 3);
+      vector<CRRPerStepMeta> in_buff2_params(n_padded * 3);
 
-    // Prepare metadata as input to kernel
-    PrepareKernelData(in_params, array_params, in_buff_params, in_buff2_params,
-                      n_crrs);
+      // Prepare metadata as input to kernel
+      PrepareKernelData(padded_params, array_params, in_buff_params,
+                        in_buff2_params, n_padded);
 
 #ifdef FPGA_HARDWARE
-    // warmup run - use this run to warmup accelerator
-    vector<CRRResParams> res_params_dummy(n_crrs * 3);
-    CrrSolver(n_crrs, in_buff_params, res_params_dummy, in_buff2_params,
-               q);
+      // warmup run - use this run to warmup accelerator
+      vector<CRRResParams> res_params_dummy(n_padded * 3);
+      CrrSolver(n_padded, in_buff_params, res_params_dummy, in_buff2_params,
+                 q);
 #endif
 
-    // Timed run - profile performance
-    vector<CRRResParams> res_params(n_crrs * 3);
-    double time = CrrSolver(n_crrs, in_buff_params, res_params,
-                             in_buff2_params, q);
-    bool pass = true;
+      // Timed run - profile performance
+      vector<CRRResParams> res_params(n_padded * 3);
+      time = CrrSolver(n_padded, in_buff_params, res_params, in_buff2_params,
+                       q);
 
-    // Post-processing step
-    // process_res used to compute final results
-    vector<InterRes> process_res(n_crrs);
-    ProcessKernelResult(res_params, process_res, n_crrs);
+      // Post-processing step
+      // process_res used to compute final results
+      vector<InterRes> process_res(n_crrs);
+      ProcessKernelResult(res_params, process_res, n_crrs);
 
-    vector<OutputRes> result(n_crrs);
+      for (int i = 0; i < n_crrs; ++i) {
+        result[i] = ComputeOutput(inp[i], in_params[i], process_res[i]);
+      }
+    }
+
+    // Solve the same CRR problems with the CPU implementation, which is used
+    // both as the golden result and as a throughput baseline
+    vector<InterRes> cpu_process_res(n_crrs);
+    double cpu_time =
+        CrrCpuSolver(inp, in_params, cpu_process_res, n_crrs, n_threads);
+
+    bool pass = true;
     for (int i = 0; i < n_crrs; ++i) {
-      result[i] = ComputeOutput(inp[i], in_params[i], process_res[i]);
-      TestCorrectness(i, n_crrs, pass, inp[i], in_params[i], result[i]);
+      OutputRes cpu_result =
+          ComputeOutput(inp[i], in_params[i], cpu_process_res[i]);
+      TestCorrectness(i, n_crrs, pass, cpu_result, result[i]);
     }
 
     // Write outputs data to output file
@@ -872,7 +1027,7 @@ int main(int argc, char *argv[]) {
 
     WriteOutputToFile(outputFile, result);
 
-    TestThroughput(time, n_crrs);
+    TestThroughput(time, n_crrs, cpu_time, n_threads);
 
   } catch (sycl::exception const &e) {
     std::cerr << "Caught a synchronous SYCL exception: " << e.what() << "\n";
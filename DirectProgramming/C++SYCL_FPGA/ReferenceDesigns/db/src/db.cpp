@@ -17,10 +17,12 @@
 #include <sycl/sycl.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 #include <algorithm>
+#include <cctype>
 #include <chrono>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <set>
 #include <sstream>
@@ -31,32 +33,48 @@
 #include "db_utils/Date.hpp"
 #include "db_utils/LikeRegex.hpp"
 #include "dbdata.hpp"
+#include "device_db.hpp"
 
 #include "exception_handler.hpp"
 
 using namespace sycl;
 
+// the queries compiled into this program. By default, a single query is
+// selected at compile time with -DQUERY=<N>. Building with -DALL_QUERIES
+// (cmake -DQUERY=ALL) compiles all of the queries into one program, which can
+// then run several queries back to back with '--queries'
+#if defined(ALL_QUERIES)
+#define QUERY_ENABLED(n) 1
+constexpr unsigned int kDefaultQuery = 1;
+#else
+#define QUERY_ENABLED(n) (QUERY == (n))
+constexpr unsigned int kDefaultQuery = QUERY;
+#endif
+
 // include files depending on the query selected
-#if (QUERY == 1)
+#if QUERY_ENABLED(1)
 #include "query1/query1_kernel.hpp"
-bool DoQuery1(queue& q, Database& dbinfo, std::string& db_root_dir,
-              std::string& args, bool test, bool print, double& kernel_latency,
-              double& total_latency);
-#elif (QUERY == 9)
+bool DoQuery1(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+              std::string& db_root_dir, std::string& args, bool test,
+              bool print, double& kernel_latency, double& total_latency);
+#endif
+#if QUERY_ENABLED(9)
 #include "query9/query9_kernel.hpp"
-bool DoQuery9(queue& q, Database& dbinfo, std::string& db_root_dir,
-              std::string& args, bool test, bool print, double& kernel_latency,
-              double& total_latency);
-#elif (QUERY == 11)
+bool DoQuery9(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+              std::string& db_root_dir, std::string& args, bool test,
+              bool print, double& kernel_latency, double& total_latency);
+#endif
+#if QUERY_ENABLED(11)
 #include "query11/query11_kernel.hpp"
-bool DoQuery11(queue& q, Database& dbinfo, std::string& db_root_dir,
-               std::string& args, bool test, bool print, double& kernel_latency,
-               double& total_latency);
-#elif (QUERY == 12)
+bool DoQuery11(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+               std::string& db_root_dir, std::string& args, bool test,
+               bool print, double& kernel_latency, double& total_latency);
+#endif
+#if QUERY_ENABLED(12)
 #include "query12/query12_kernel.hpp"
-bool DoQuery12(queue& q, Database& dbinfo, std::string& db_root_dir,
-               std::string& args, bool test, bool print, double& kernel_latency,
-               double& total_latency);
+bool DoQuery12(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+               std::string& db_root_dir, std::string& args, bool test,
+               bool print, double& kernel_latency, double& total_latency);
 #endif
 
 //
@@ -75,6 +93,14 @@ void Help() {
                "and uses default input from TPCH documents\n";
   std::cout << "\t--print   print the query results to stdout\n";
   std::cout << "\t--runs    how many iterations of the query to run\n";
+  std::cout << "\t--queries=<QUERY>[:<ARGS>][;<QUERY>[:<ARGS>]...]"
+               "   run several queries back to back on a single load of "
+               "the database (requires a 'cmake .. -DQUERY=ALL' build)\n";
+  std::cout << "\t--no-snapshot    always parse the '*.tbl' files, even if a"
+               " '*.dbc' snapshot (see dbconvert) exists\n";
+  std::cout << "\t--chunk-rows=<ROWS>    stream the LINEITEM table through "
+               "the device in chunks of at most ROWS rows (query 1 only, "
+               "0 disables chunking)\n";
   std::cout << "\t--help    print this help message\n";
   std::cout << "\n";
 
@@ -103,7 +129,14 @@ void Help() {
             << "[--args=<SHIPMODE1,SHIPMODE2,DATE>]\n";
   std::cout << "\t ./db --dbroot=/path/to/database/files --test\n";
   std::cout << "\t ./db --dbroot=/path/to/database/files "
-            << "--args=MAIL,SHIP,1994-01-10\n";
+            << "--args=MAIL,SHIP,1994-01-01\n";
+  std::cout << "\n";
+
+  std::cout << "./db --dbroot=/path/to/database/files [--test] "
+            << "--queries=<QUERY>[:<ARGS>][;<QUERY>[:<ARGS>]...]\n";
+  std::cout << "\t ./db --dbroot=/path/to/database/files "
+            << "--queries=\"1:1998-12-01,90;9:GREEN;11:GERMANY;"
+            << "12:MAIL,SHIP,1994-01-01\"\n";
   std::cout << "\n";
 }
 
@@ -114,6 +147,99 @@ bool StrStartsWith(std::string& str, std::string prefix) {
   return str.find(prefix) == 0;
 }
 
+//
+// a query to run and its (comma separated) arguments
+//
+struct QueryJob {
+  unsigned int query;
+  std::string args;
+};
+
+//
+// parse a list of queries of the form '<QUERY>[:<ARGS>];<QUERY>[:<ARGS>];...'
+// e.g. '1:1998-12-01,90;12:MAIL,SHIP,1994-01-01'
+//
+std::vector<QueryJob> ParseQueryList(const std::string& str) {
+  std::vector<QueryJob> jobs;
+  std::stringstream ss(str);
+  std::string job_str;
+
+  while (std::getline(ss, job_str, ';')) {
+    if (job_str.empty()) {
+      continue;
+    }
+
+    size_t colon = job_str.find(':');
+    QueryJob job;
+    job.query = atoi(job_str.substr(0, colon).c_str());
+    job.args = (colon == std::string::npos) ? "" : job_str.substr(colon + 1);
+    jobs.push_back(job);
+  }
+
+  return jobs;
+}
+
+//
+// check that a query is supported and compiled into this program
+//
+bool CheckQuery(unsigned int query) {
+  if (!(query == 1 || query == 9 || query == 11 || query == 12)) {
+    std::cerr << "ERROR: unsupported query (" << query << "). "
+              << "Only queries 1, 9, 11 and 12 are supported\n";
+    return false;
+  }
+
+  bool compiled = (query == 1 && QUERY_ENABLED(1)) ||
+                  (query == 9 && QUERY_ENABLED(9)) ||
+                  (query == 11 && QUERY_ENABLED(11)) ||
+                  (query == 12 && QUERY_ENABLED(12));
+
+  if (!compiled) {
+    std::cerr << "ERROR: project not currently configured for query " << query
+              << "\n";
+    std::cerr << "\trerun CMake using the command: 'cmake .. -DQUERY=" << query
+              << "' or 'cmake .. -DQUERY=ALL'\n";
+    return false;
+  }
+
+  return true;
+}
+
+//
+// run a single iteration of a query
+//
+bool RunQuery(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+              unsigned int query, std::string& db_root_dir, std::string& args,
+              bool test, bool print, double& kernel_latency,
+              double& total_latency) {
+#if QUERY_ENABLED(1)
+  if (query == 1) {
+    return DoQuery1(q, dbinfo, ddb, db_root_dir, args, test, print,
+                    kernel_latency, total_latency);
+  }
+#endif
+#if QUERY_ENABLED(9)
+  if (query == 9) {
+    return DoQuery9(q, dbinfo, ddb, db_root_dir, args, test, print,
+                    kernel_latency, total_latency);
+  }
+#endif
+#if QUERY_ENABLED(11)
+  if (query == 11) {
+    return DoQuery11(q, dbinfo, ddb, db_root_dir, args, test, print,
+                     kernel_latency, total_latency);
+  }
+#endif
+#if QUERY_ENABLED(12)
+  if (query == 12) {
+    return DoQuery12(q, dbinfo, ddb, db_root_dir, args, test, print,
+                     kernel_latency, total_latency);
+  }
+#endif
+  std::cerr << "ERROR: unsupported query (" << query << ")\n";
+  return false;
+}
+
 //
 // main
 //
@@ -122,7 +248,8 @@ int main(int argc, char* argv[]) {
   Database dbinfo;
   std::string db_root_dir = ".";
   std::string args = "";
-  unsigned int query = QUERY;
+  std::string queries = "";
+  unsigned int query = kDefaultQuery;
   bool test_query = false;
 #if defined(FPGA_EMULATOR)
   unsigned int runs = 1;
@@ -132,6 +259,9 @@ int main(int argc, char* argv[]) {
   unsigned int runs = 5;
 #endif
   bool print_result = false;
+  bool use_snapshot = true;
+  size_t chunk_rows = kDefaultLineItemChunkRows;
+  bool chunk_rows_set = false;
   bool need_help = false;
 
   // parse the command line arguments
@@ -147,12 +277,35 @@ int main(int argc, char* argv[]) {
         db_root_dir = str_after_equals;
       } else if (StrStartsWith(arg, "--query=")) {
         query = atoi(str_after_equals.c_str());
+      } else if (StrStartsWith(arg, "--queries=")) {
+        queries = str_after_equals;
       } else if (StrStartsWith(arg, "--args=")) {
         args = str_after_equals;
       } else if (StrStartsWith(arg, "--test")) {
         test_query = true;
       } else if (StrStartsWith(arg, "--print")) {
         print_result = true;
+      } else if (StrStartsWith(arg, "--no-snapshot")) {
+        use_snapshot = false;
+      } else if (StrStartsWith(arg, "--chunk-rows=")) {
+        // a non-negative number of rows (std::stoull accepts a sign)
+        bool valid = !str_after_equals.empty() &&
+                     std::isdigit(str_after_equals[0]);
+        if (valid) {
+          try {
+            size_t pos;
+            chunk_rows = std::stoull(str_after_equals, &pos);
+            valid = (pos == str_after_equals.size());
+          } catch (std::exception const&) {
+            valid = false;
+          }
+        }
+        if (!valid) {
+          std::cerr << "ERROR: invalid number of rows in '" << arg << "'\n";
+          Help();
+          return 1;
+        }
+        chunk_rows_set = true;
       } else if (StrStartsWith(arg, "--runs")) {
 #ifndef FPGA_EMULATOR
         // for hardware, ensure at least two iterations to ensure we can run
@@ -175,19 +328,39 @@ int main(int argc, char* argv[]) {
     return 0;
   }
 
-  // make sure the query is supported
-  if (!(query == 1 || query == 9 || query == 11 || query == 12)) {
-    std::cerr << "ERROR: unsupported query (" << query << "). "
-              << "Only queries 1, 9, 11 and 12 are supported\n";
-    return 1;
+  // the queries to run: either the '--queries' list (session mode) or the
+  // single query given by '--query' and '--args'
+  bool session = !queries.empty();
+  std::vector<QueryJob> jobs;
+  if (session) {
+    jobs = ParseQueryList(queries);
+    if (jobs.empty()) {
+      std::cerr << "ERROR: no queries found in '--queries=" << queries
+                << "'\n";
+      return 1;
+    }
+    if (!args.empty()) {
+      std::cout << "WARNING: ignoring '--args', the arguments are given "
+                   "per query by '--queries'\n";
+    }
+  } else {
+    jobs.push_back({query, args});
   }
 
-  if (query != QUERY) {
-    std::cerr << "ERROR: project not currently configured for query " << query
-              << "\n";
-    std::cerr << "\trerun CMake using the command: 'cmake .. -DQUERY=" << query
-              << "'\n";
-    return 1;
+  // make sure the queries are supported
+  for (auto& job : jobs) {
+    if (!CheckQuery(job.query)) {
+      return 1;
+    }
+
+    // only query 1 streams LINEITEM in chunks, the other queries read the
+    // whole table from device memory
+    if (chunk_rows_set && job.query != 1) {
+      std::cerr << "ERROR: '--chunk-rows' is only supported by query 1 "
+                << "(not query " << job.query << ")\n";
+      Help();
+      return 1;
+    }
   }
 
   try {
@@ -212,62 +385,65 @@ int main(int argc, char* argv[]) {
               << std::endl;
 
     // parse the database files located in the 'db_root_dir' directory
-    bool success = dbinfo.Parse(db_root_dir);
+    // (or load their columnar snapshot, if one exists)
+    bool success = dbinfo.Parse(db_root_dir, use_snapshot);
     if (!success) {
       std::cerr << "ERROR: couldn't read the DB files\n";
       return 1;
     }
 
-    std::cout << "Database SF = " << kSF << "\n";
-
-    // make sure the parsed database files match the set scale factor
+    // detect the scale factor of the parsed database files and make sure
+    // the table sizes are consistent with it
     if (!dbinfo.ValidateSF()) {
       std::cerr << "ERROR: could not validate the "
                 << "scale factor of the parsed database files\n";
       return 1;
     }
 
-    // track timing information for each run
-    std::vector<double> total_latency(runs);
-    std::vector<double> kernel_latency(runs);
-
-    // run 'runs' iterations of the query
-    for (unsigned int run = 0; run < runs && success; run++) {
-      // run the selected query
-      if (query == 1) {
-#if (QUERY == 1)
-        success = DoQuery1(q, dbinfo, db_root_dir, args,
-                           test_query, print_result,
-                           kernel_latency[run], total_latency[run]);
-#endif
-      } else if (query == 9) {
-        // query9
-#if (QUERY == 9)
-        success = DoQuery9(q, dbinfo, db_root_dir, args,
-                           test_query, print_result,
-                           kernel_latency[run], total_latency[run]);
-#endif
-      } else if (query == 11) {
-        // query11
-#if (QUERY == 11)
-        success = DoQuery11(q, dbinfo, db_root_dir, args,
-                            test_query, print_result,
-                            kernel_latency[run], total_latency[run]);
-#endif
-      } else if (query == 12) {
-        // query12
-#if (QUERY == 12)
-        success = DoQuery12(q, dbinfo, db_root_dir, args,
-                            test_query, print_result,
-                            kernel_latency[run], total_latency[run]);
-#endif
-      } else {
-        std::cerr << "ERROR: unsupported query (" << query << ")\n";
+    std::cout << "Database SF = " << dbinfo.sf << "\n";
+
+    // make sure the database fits in the on-chip data structures of the
+    // queries
+    for (auto& job : jobs) {
+      if (!dbinfo.FitsOnChip(job.query)) {
         return 1;
       }
     }
 
-    if (success) {
+    // In session mode, the tables are transferred to the device once and
+    // stay resident for all queries. Otherwise, every run transfers the
+    // data it reads, so that the processing time reflects a full offload.
+    std::unique_ptr<DeviceDatabase> session_ddb;
+    if (session) {
+      session_ddb = std::make_unique<DeviceDatabase>(dbinfo, chunk_rows);
+    }
+
+    // the average latencies of each query
+    std::vector<double> total_latency_avgs, kernel_latency_avgs;
+
+    for (auto& job : jobs) {
+      // track timing information for each run
+      std::vector<double> total_latency(runs);
+      std::vector<double> kernel_latency(runs);
+
+      // run 'runs' iterations of the query
+      for (unsigned int run = 0; run < runs && success; run++) {
+        if (session) {
+          success = RunQuery(q, dbinfo, *session_ddb, job.query, db_root_dir,
+                             job.args, test_query, print_result,
+                             kernel_latency[run], total_latency[run]);
+        } else {
+          DeviceDatabase ddb(dbinfo, chunk_rows);
+          success = RunQuery(q, dbinfo, ddb, job.query, db_root_dir,
+                             job.args, test_query, print_result,
+                             kernel_latency[run], total_latency[run]);
+        }
+      }
+
+      if (!success) {
+        break;
+      }
+
       // don't analyze the runtime in emulation
 #if !defined(FPGA_EMULATOR) && !defined(FPGA_SIMULATOR)
       // compute the average total latency across all iterations,
@@ -280,13 +456,43 @@ int main(int argc, char* argv[]) {
         std::accumulate(kernel_latency.begin() + 1, kernel_latency.end(), 0.0) /
         (double)(runs - 1);
 
+      total_latency_avgs.push_back(total_latency_avg);
+      kernel_latency_avgs.push_back(kernel_latency_avg);
+
       // print the performance results
       std::cout << "Processing time: " << total_latency_avg << " ms\n";
       std::cout << "Kernel time: " << kernel_latency_avg << " ms\n";
       std::cout << "Throughput: " << ((1 / kernel_latency_avg) * 1e3)
                 << " queries/s\n";
+
+      // queries 1 and 12 scan the LINEITEM table, so their row throughput
+      // shows how the design scales with the scale factor
+      if (job.query == 1 || job.query == 12) {
+        std::cout << "LINEITEM throughput: "
+                  << (dbinfo.l.rows / kernel_latency_avg) * 1e-3
+                  << " Mrows/s (SF = " << dbinfo.sf << ")\n";
+      }
 #endif
+    }
 
+#if !defined(FPGA_EMULATOR) && !defined(FPGA_SIMULATOR)
+    // summarize the session
+    if (success && session) {
+      std::cout << "\nSession summary\n";
+      std::cout << "query|args|processing_time_ms|kernel_time_ms\n";
+      for (size_t i = 0; i < jobs.size(); i++) {
+        std::cout << jobs[i].query << "|" << jobs[i].args << "|"
+                  << total_latency_avgs[i] << "|" << kernel_latency_avgs[i]
+                  << "\n";
+      }
+      std::cout << "Total processing time: "
+                << std::accumulate(total_latency_avgs.begin(),
+                                   total_latency_avgs.end(), 0.0)
+                << " ms\n";
+    }
+#endif
+
+    if (success) {
       std::cout << "PASSED\n";
     } else {
       std::cout << "FAILED\n";
@@ -311,19 +517,23 @@ int main(int argc, char* argv[]) {
   return 0;
 }
 
-#if (QUERY == 1)
-bool DoQuery1(queue& q, Database& dbinfo, std::string& db_root_dir,
-              std::string& args, bool test, bool print, double& kernel_latency,
-              double& total_latency) {
+#if QUERY_ENABLED(1)
+bool DoQuery1(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+              std::string& db_root_dir, std::string& args, bool test,
+              bool print, double& kernel_latency, double& total_latency) {
   // NOTE: this is fixed based on the TPCH docs
   Date date = Date("1998-12-01");
   unsigned int DELTA = 90;
 
-  // parse the query arguments
+  // parse the query arguments, either '<DELTA>' or '<DATE>,<DELTA>'
   if (!test && !args.empty()) {
     std::stringstream ss(args);
     std::string tmp;
     std::getline(ss, tmp, ',');
+    if (tmp.find('-') != std::string::npos) {
+      date = Date(tmp);
+      std::getline(ss, tmp, ',');
+    }
     DELTA = atoi(tmp.c_str());
   } else {
     if (!args.empty()) {
@@ -352,7 +562,7 @@ bool DoQuery1(queue& q, Database& dbinfo, std::string& db_root_dir,
 
   // perform the query
   bool success =
-      SubmitQuery1(q, dbinfo, low_date_compact, sum_qty, sum_base_price,
+      SubmitQuery1(q, dbinfo, ddb, low_date_compact, sum_qty, sum_base_price,
                    sum_disc_price, sum_charge, avg_qty, avg_price, avg_discount,
                    count, kernel_latency, total_latency);
 
@@ -375,10 +585,10 @@ bool DoQuery1(queue& q, Database& dbinfo, std::string& db_root_dir,
 }
 #endif
 
-#if (QUERY == 9)
-bool DoQuery9(queue& q, Database& dbinfo, std::string& db_root_dir,
-              std::string& args, bool test, bool print, double& kernel_latency,
-              double& total_latency) {
+#if QUERY_ENABLED(9)
+bool DoQuery9(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+              std::string& db_root_dir, std::string& args, bool test,
+              bool print, double& kernel_latency, double& total_latency) {
   // the default colour regex based on the TPCH documents
   std::string colour = "GREEN";
 
@@ -401,7 +611,7 @@ bool DoQuery9(queue& q, Database& dbinfo, std::string& db_root_dir,
   std::array<DBDecimal, 25 * 2020> sum_profit;
 
   // perform the query
-  bool success = SubmitQuery9(q, dbinfo, colour, sum_profit, kernel_latency,
+  bool success = SubmitQuery9(q, dbinfo, ddb, colour, sum_profit, kernel_latency,
                               total_latency);
 
   if (success) {
@@ -420,10 +630,10 @@ bool DoQuery9(queue& q, Database& dbinfo, std::string& db_root_dir,
 }
 #endif
 
-#if (QUERY == 11)
-bool DoQuery11(queue& q, Database& dbinfo, std::string& db_root_dir,
-               std::string& args, bool test, bool print, double& kernel_latency,
-               double& total_latency) {
+#if QUERY_ENABLED(11)
+bool DoQuery11(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+               std::string& db_root_dir, std::string& args, bool test,
+               bool print, double& kernel_latency, double& total_latency) {
   // the default nation, based on the TPCH documents
   std::string nation = "GERMANY";
 
@@ -449,7 +659,7 @@ bool DoQuery11(queue& q, Database& dbinfo, std::string& db_root_dir,
   std::vector<DBDecimal> partkey_values(kPartTableSize);
 
   // perform the query
-  bool success = SubmitQuery11(q, dbinfo, nation, partkeys, partkey_values,
+  bool success = SubmitQuery11(q, dbinfo, ddb, nation, partkeys, partkey_values,
                                kernel_latency, total_latency);
 
   if (success) {
@@ -468,28 +678,35 @@ bool DoQuery11(queue& q, Database& dbinfo, std::string& db_root_dir,
 }
 #endif
 
-#if (QUERY == 12)
-bool DoQuery12(queue& q, Database& dbinfo, std::string& db_root_dir,
-               std::string& args, bool test, bool print, double& kernel_latency,
-               double& total_latency) {
+#if QUERY_ENABLED(12)
+bool DoQuery12(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+               std::string& db_root_dir, std::string& args, bool test,
+               bool print, double& kernel_latency, double& total_latency) {
   // the default query date and shipmodes, based on the TPCH documents
   Date date = Date("1994-01-01");
   std::string shipmode1 = "MAIL", shipmode2 = "SHIP";
 
-  // parse the query arguments
+  // parse the query arguments. The date (YYYY-MM-DD) may come before or
+  // after the two shipmodes
   if (!test && !args.empty()) {
     std::stringstream ss(args);
     std::string tmp;
+    std::vector<std::string> shipmodes;
 
-    std::getline(ss, tmp, ',');
-    date = Date(tmp);
+    while (std::getline(ss, tmp, ',')) {
+      if (!tmp.empty() && std::isdigit(tmp[0])) {
+        date = Date(tmp);
+      } else {
+        shipmodes.push_back(tmp);
+      }
+    }
 
-    if (ss.good()) {
-      std::getline(ss, shipmode1, ',');
+    if (shipmodes.size() > 0) {
+      shipmode1 = shipmodes[0];
     }
 
-    if (ss.good()) {
-      std::getline(ss, shipmode2, ',');
+    if (shipmodes.size() > 1) {
+      shipmode2 = shipmodes[1];
     }
   } else {
     if (!args.empty()) {
@@ -517,7 +734,7 @@ bool DoQuery12(queue& q, Database& dbinfo, std::string& db_root_dir,
 
   // perform the query
   bool success = SubmitQuery12(
-      q, dbinfo, low_date.ToCompact(), high_date.ToCompact(),
+      q, dbinfo, ddb, low_date.ToCompact(), high_date.ToCompact(),
       ShipmodeStrToInt(shipmode1), ShipmodeStrToInt(shipmode2), high_line_count,
       low_line_count, kernel_latency, total_latency);
 
@@ -0,0 +1,398 @@
+#ifndef __HASH_AGGREGATE_HPP__
+#define __HASH_AGGREGATE_HPP__
+#pragma once
+
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Misc.hpp"
+#include "StreamingData.hpp"
+#include "Tuple.hpp"
+#include "Unroller.hpp"
+
+//
+// A single group of the HashAggregate operator: the group key and the
+// (partial) aggregate of all rows with that key
+//
+template <typename KeyType, typename AggType>
+struct HashAggregateGroup {
+  HashAggregateGroup() : valid(false) {}
+  HashAggregateGroup(bool valid, KeyType key, AggType agg)
+      : valid(valid), key(key), agg(agg) {}
+
+  bool valid;
+  KeyType key;
+  AggType agg;
+};
+
+//
+// Default hash function for integral group keys (Knuth's multiplicative hash).
+// Only the low bits of the result are used to select a bucket, so the high
+// bits of the product are folded back into them.
+//
+struct HashAggregateHash {
+  template <typename KeyType>
+  unsigned int operator()(const KeyType& key) const {
+    unsigned int h = static_cast<unsigned int>(key) * 2654435761u;
+    return h ^ (h >> 16);
+  }
+};
+
+//
+// The number of buckets of every lane table of a HashAggregate operator that
+// holds up to 'max_groups' groups in buckets of 'ways' entries. The table is
+// sized for a load factor of at most 1/4, so that a bucket rarely overflows
+// before 'max_groups' distinct keys are seen, and the number of buckets is
+// rounded up to a power of 2. The output of HashAggregate is one window per
+// bucket.
+//
+template <int max_groups, int ways>
+constexpr int HashAggregateBuckets() {
+  static_assert(max_groups > 0, "Number of groups must be positive");
+  static_assert(ways > 0, "Number of ways must be positive and non-zero");
+  return Pow2(CeilLog2((4 * max_groups + ways - 1) / ways));
+}
+
+//
+// Group-by/aggregate operator
+//
+// Consumes windows of 'win_size' rows of type InType from InPipe (the same
+// StreamingData format used by MapJoin and MergeJoin) and aggregates the rows
+// by their group key. Once the producer is done, the groups are written to
+// OutPipe as windows of 'win_size * ways' HashAggregateGroups, one window
+// for each of the HashAggregateBuckets<max_groups, ways>() buckets.
+//
+// Assumptions:
+//    - InType has a 'valid' boolean member and a 'GroupKey()' function that
+//      returns a KeyType
+//    - KeyType can be compared with '=='
+//    - AggType() is the identity of the aggregation (e.g. all sums 0),
+//      'Accumulate(const InType&)' adds a row to the aggregate and
+//      'Merge(const AggType&)' combines two partial aggregates
+//
+// Every one of the 'win_size' lanes owns a private on-chip table, so each
+// lane can update a group every cycle without arbitrating with the others.
+// A table has HashAggregateBuckets<max_groups, ways>() buckets of 'ways'
+// entries, where 'max_groups' is the number of distinct groups the input is
+// expected to have; collisions in a bucket are resolved by using the next free
+// way (i.e. the table is set-associative). A key maps to the same bucket in
+// every lane, so the tables hold up to 'max_groups' groups with few overflows.
+// The last 'cache_depth' bucket updates of a lane are kept in registers and
+// forwarded to the next reads, which hides the read-modify-write latency of
+// the on-chip memory and keeps II=1 (see CachedMemory.hpp).
+//
+// A row whose key does not fit in its bucket (all ways hold other keys, which
+// is rare unless the input has more than 'max_groups' groups) is
+// sent to SpillPipe as a single-row group, in windows of 'win_size' groups
+// (only the windows with at least one spilled row are written). Once the
+// producer is done, a 'done' window is written to SpillPipe. The spilled rows
+// are aggregated by HashAggregateSpill (below), which must run in its own
+// kernel, and merged with the output groups on the host with
+// MergeHashAggregateSpill.
+//
+// When the table is drained, the 'ways' entries of a bucket in every lane are
+// merged, so every group appears at most once in the output.
+//
+// NOTE: like MapJoin, this function does not write the final 'done' window to
+// OutPipe; that is left to the caller.
+//
+template <typename InPipe, typename InType, int win_size,
+          typename OutPipe, typename SpillPipe, typename KeyType,
+          typename AggType, int max_groups, int ways = 4,
+          typename Hasher = HashAggregateHash, int cache_depth = 8>
+void HashAggregate() {
+  //////////////////////////////////////////////////////////////////////////////
+  // static asserts
+  static_assert(win_size > 0, "Window size must be positive and non-zero");
+  static_assert(ways > 0, "Number of ways must be positive and non-zero");
+  static_assert(cache_depth >= 0, "Cache depth must be non-negative");
+  static_assert(max_groups > 0, "Number of groups must be positive");
+  static_assert(std::is_same_v<bool, decltype(InType().valid)>,
+                "InType must have a 'valid' boolean member");
+  static_assert(std::is_same_v<KeyType, decltype(InType().GroupKey())>,
+                "InType must have a 'GroupKey()' function that returns a "
+                "KeyType");
+  static_assert(std::is_same_v<unsigned int,
+                               decltype(Hasher()(std::declval<KeyType>()))>,
+                "Hasher must return an 'unsigned int'");
+  //////////////////////////////////////////////////////////////////////////////
+
+  using Group = HashAggregateGroup<KeyType, AggType>;
+  constexpr int kNumBuckets = HashAggregateBuckets<max_groups, ways>();
+  constexpr int kOutWinSize = win_size * ways;
+
+  // a bucket of the on-chip table
+  struct Bucket {
+    bool used[ways];
+    KeyType key[ways];
+    AggType agg[ways];
+  };
+
+  // the on-chip tables, one per lane
+  Bucket table[win_size][kNumBuckets];
+
+  // the cache of the last bucket updates of every lane
+  [[intel::fpga_register]] Bucket cache_value[win_size][cache_depth + 1];
+  [[intel::fpga_register]] int cache_tag[win_size][cache_depth + 1];
+
+  // initialize the tables and the caches
+  [[intel::initiation_interval(1)]]
+  for (int b = 0; b < kNumBuckets; b++) {
+    UnrolledLoop<0, win_size>([&](auto l) {
+      #pragma unroll
+      for (int w = 0; w < ways; w++) {
+        table[l][b].used[w] = false;
+      }
+    });
+  }
+  UnrolledLoop<0, win_size>([&](auto l) {
+    #pragma unroll
+    for (int c = 0; c < cache_depth + 1; c++) {
+      cache_tag[l][c] = -1;
+    }
+  });
+
+  bool done = false;
+
+  ////////////////////////////////////////////////////////////////////////////
+  //// aggregate the input rows
+  [[intel::initiation_interval(1)]]
+  while (!done) {
+    // read from the input pipe
+    bool valid_pipe_read;
+    StreamingData<InType, win_size> in_data = InPipe::read(valid_pipe_read);
+
+    // check if the producer is done
+    done = in_data.done && valid_pipe_read;
+
+    if (!done && valid_pipe_read) {
+      bool any_spill = false;
+      StreamingData<Group, win_size> spill_data(false, true);
+
+      UnrolledLoop<0, win_size>([&](auto l) {
+        InType row = in_data.data.template get<l>();
+        spill_data.data.template get<l>().valid = false;
+
+        if (row.valid) {
+          const KeyType key = row.GroupKey();
+          const int idx = Hasher()(key) & (kNumBuckets - 1);
+
+          // read the bucket, forwarding any update still in flight
+          Bucket bucket = table[l][idx];
+          #pragma unroll
+          for (int c = 0; c < cache_depth + 1; c++) {
+            if (cache_tag[l][c] == idx) {
+              bucket = cache_value[l][c];
+            }
+          }
+
+          // look for the key, or the first free way
+          bool hit = false, has_free = false;
+          int hit_way = 0, free_way = 0;
+          #pragma unroll
+          for (int w = ways - 1; w >= 0; w--) {
+            if (bucket.used[w] && bucket.key[w] == key) {
+              hit = true;
+              hit_way = w;
+            }
+            if (!bucket.used[w]) {
+              has_free = true;
+              free_way = w;
+            }
+          }
+
+          if (hit || has_free) {
+            // update the bucket
+            const int way = hit ? hit_way : free_way;
+            #pragma unroll
+            for (int w = 0; w < ways; w++) {
+              if (w == way) {
+                if (!hit) {
+                  bucket.used[w] = true;
+                  bucket.key[w] = key;
+                  bucket.agg[w] = AggType();
+                }
+                bucket.agg[w].Accumulate(row);
+              }
+            }
+
+            table[l][idx] = bucket;
+
+            // shift the new value into the cache
+            cache_value[l][cache_depth] = bucket;
+            cache_tag[l][cache_depth] = idx;
+            #pragma unroll
+            for (int c = 0; c < cache_depth; c++) {
+              cache_value[l][c] = cache_value[l][c + 1];
+              cache_tag[l][c] = cache_tag[l][c + 1];
+            }
+          } else {
+            // the bucket is full, spill the row
+            AggType agg;
+            agg.Accumulate(row);
+            spill_data.data.template get<l>() = Group(true, key, agg);
+            any_spill = true;
+          }
+        }
+      });
+
+      if (any_spill) {
+        SpillPipe::write(spill_data);
+      }
+    }
+  }
+
+  // no more rows to spill
+  SpillPipe::write(StreamingData<Group, win_size>(true, false));
+  ////////////////////////////////////////////////////////////////////////////
+
+  ////////////////////////////////////////////////////////////////////////////
+  //// drain the tables
+  [[intel::initiation_interval(1)]]
+  for (int b = 0; b < kNumBuckets; b++) {
+    // a key maps to the same bucket in every lane, so all partial aggregates
+    // of a group are in bucket 'b' of the lane tables
+    Group groups[kOutWinSize];
+    UnrolledLoop<0, win_size>([&](auto l) {
+      Bucket bucket = table[l][b];
+      #pragma unroll
+      for (int w = 0; w < ways; w++) {
+        groups[l * ways + w] =
+            Group(bucket.used[w], bucket.key[w], bucket.agg[w]);
+      }
+    });
+
+    // merge duplicate groups into the first one
+    #pragma unroll
+    for (int i = 0; i < kOutWinSize; i++) {
+      #pragma unroll
+      for (int j = i + 1; j < kOutWinSize; j++) {
+        if (groups[i].valid && groups[j].valid &&
+            groups[i].key == groups[j].key) {
+          groups[i].agg.Merge(groups[j].agg);
+          groups[j].valid = false;
+        }
+      }
+    }
+
+    StreamingData<Group, kOutWinSize> out_data(false, true);
+    UnrolledLoop<0, kOutWinSize>([&](auto i) {
+      out_data.data.template get<i>() = groups[i];
+    });
+
+    OutPipe::write(out_data);
+  }
+  ////////////////////////////////////////////////////////////////////////////
+}
+
+//
+// Aggregates the rows spilled by HashAggregate
+//
+// Reads the windows of single-row groups written to SpillPipe by
+// HashAggregate, until the 'done' window, and aggregates them by key into
+// 'spill', a hash table in device memory with 'spill_capacity' entries and
+// linear probing. Every key is stored once, so the table only has to hold
+// the distinct keys that were spilled, not the spilled rows. The table is
+// cleared first, and its valid entries are the spilled groups.
+// 'spill_capacity' must be positive.
+//
+// The return value is the number of distinct keys placed in the table plus
+// the number of rows dropped because the table was full. If no row was
+// dropped, this is the number of spilled groups. Otherwise it is larger than
+// 'spill_capacity' and the result is incomplete, so the caller only has to
+// compare it with 'spill_capacity' to detect an overflow.
+//
+// This function reads and updates device memory for every spilled row, so it
+// is much slower than HashAggregate. It runs in its own kernel, so that
+// HashAggregate only stalls if the rows are spilled faster than they are
+// aggregated here (i.e. when the on-chip table is much too small).
+//
+template <typename SpillPipe, typename KeyType, typename AggType,
+          int win_size, typename Hasher = HashAggregateHash,
+          typename SpillPtr>
+size_t HashAggregateSpill(SpillPtr spill, size_t spill_capacity) {
+  using Group = HashAggregateGroup<KeyType, AggType>;
+
+  for (size_t i = 0; i < spill_capacity; i++) {
+    spill[i].valid = false;
+  }
+
+  size_t spill_count = 0;
+  bool done = false;
+
+  while (!done) {
+    StreamingData<Group, win_size> spill_data = SpillPipe::read();
+    done = spill_data.done;
+
+    if (!done && spill_data.valid) {
+      UnrolledLoop<0, win_size>([&](auto l) {
+        const Group group = spill_data.data.template get<l>();
+
+        if (group.valid) {
+          // find the key, or the first free entry, from the hash of the key
+          size_t pos = Hasher()(group.key) % spill_capacity;
+          bool placed = false;
+
+          for (size_t n = 0; n < spill_capacity && !placed; n++) {
+            Group entry = spill[pos];
+
+            if (!entry.valid) {
+              spill[pos] = group;
+              spill_count++;
+              placed = true;
+            } else if (entry.key == group.key) {
+              entry.agg.Merge(group.agg);
+              spill[pos] = entry;
+              placed = true;
+            }
+
+            pos = (pos + 1 == spill_capacity) ? 0 : pos + 1;
+          }
+
+          if (!placed) {
+            // the table is full
+            spill_count++;
+          }
+        }
+      });
+    }
+  }
+
+  return spill_count;
+}
+
+//
+// Host-side helper to merge the groups spilled by HashAggregate into the
+// groups it produced on the device. 'groups' holds the valid output groups,
+// each key at most once, and is extended with the keys only seen in 'spill'
+// (the table of 'spill_capacity' entries filled by HashAggregateSpill).
+//
+template <typename KeyType, typename AggType,
+          typename Hasher = HashAggregateHash>
+void MergeHashAggregateSpill(
+    std::vector<HashAggregateGroup<KeyType, AggType>>& groups,
+    const HashAggregateGroup<KeyType, AggType>* spill, size_t spill_capacity) {
+  // index of every key in 'groups'
+  std::unordered_map<KeyType, size_t, Hasher> index;
+  for (size_t i = 0; i < groups.size(); i++) {
+    index[groups[i].key] = i;
+  }
+
+  for (size_t i = 0; i < spill_capacity; i++) {
+    if (!spill[i].valid) {
+      continue;
+    }
+
+    auto it = index.find(spill[i].key);
+    if (it == index.end()) {
+      index[spill[i].key] = groups.size();
+      groups.push_back(spill[i]);
+    } else {
+      groups[it->second].agg.Merge(spill[i].agg);
+    }
+  }
+}
+
+#endif /* __HASH_AGGREGATE_HPP__ */
@@ -0,0 +1,268 @@
+#ifndef __HASH_JOIN_HPP__
+#define __HASH_JOIN_HPP__
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "Misc.hpp"
+#include "StreamingData.hpp"
+#include "Tuple.hpp"
+#include "Unroller.hpp"
+
+//
+// Default hash function for integral join keys (the 32-bit finalizer of
+// MurmurHash3). All bits of the key affect all bits of the result, so the low
+// bits can select the bucket and the high bits the partition.
+//
+struct HashJoinHash {
+  template <typename KeyType>
+  unsigned int operator()(const KeyType& key) const {
+    unsigned int h = static_cast<unsigned int>(key);
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+};
+
+//
+// Computes the number of partitions (i.e. the number of HashJoin passes)
+// needed to join a build table of 'build_rows' rows with an on-chip table of
+// 'num_buckets' buckets that hold 't1_max_duplicates' rows each.
+// 'fill_factor' is the fraction of the table a single partition is expected
+// to fill, which leaves room for uneven bucket occupancy.
+//
+// Returns 0 if the table cannot hold any rows (i.e. 'num_buckets',
+// 't1_max_duplicates' or 'fill_factor' is not positive).
+//
+inline int HashJoinPartitions(size_t build_rows, int num_buckets,
+                              int t1_max_duplicates,
+                              double fill_factor = 0.5) {
+  if (num_buckets <= 0 || t1_max_duplicates <= 0 || !(fill_factor > 0)) {
+    return 0;
+  }
+
+  const double capacity =
+      static_cast<double>(num_buckets) * t1_max_duplicates * fill_factor;
+  int partitions = 1;
+  while (partitions * capacity < build_rows) {
+    partitions++;
+  }
+  return partitions;
+}
+
+//
+// Joins two (unsorted) tables into a single table using a hash table
+// Assumptions:
+//      - Table 1 (the 'build' side) fits in the on-chip hash table, or the
+//      join is split into several partitions (see below)
+//      - At most 't1_max_duplicates' rows of table 1 hash to the same bucket,
+//      which includes rows with the same primary key
+//      - Table 2 (the 'probe' side) can have any number of rows with the
+//      same primary key
+//
+// The operator first reads all of table 1 from T1Pipe and inserts every row
+// into bucket 'Hasher(PrimaryKey()) % num_buckets' of an on-chip table. It
+// then streams table 2 from T2Pipe and joins every row with all table 1 rows
+// of its bucket that have the same key. Like DuplicateMergeJoin, the output
+// windows hold t1_max_duplicates * t2_win_size rows; the join of slot 'i' of
+// a bucket with row 'j' of the table 2 window is element
+// 'i * t2_win_size + j'.
+//
+// Multi-pass partitioning: if table 1 is too big for the on-chip table,
+// the caller runs the join 'num_partitions' times (e.g. the number computed
+// by HashJoinPartitions), streaming both tables again each time. Pass
+// 'partition' only considers the rows whose key hashes to that partition, so
+// the union of the outputs of all passes is the full join.
+//
+// The return value is the number of table 1 rows of this partition that did
+// not fit in their bucket (and were therefore not joined). A non-zero value
+// means the join must be rerun with more partitions (more partitions do not
+// help if a single key has more than 't1_max_duplicates' rows).
+//
+// NOTE: like the other join operators, this function does not write the final
+// 'done' window to OutPipe; that is left to the caller.
+//
+template<typename T1Pipe, typename T1Type, int t1_win_size,
+         typename T2Pipe, typename T2Type, int t2_win_size,
+         typename OutPipe, typename JoinType,
+         int num_buckets, int t1_max_duplicates,
+         typename Hasher = HashJoinHash, int cache_depth = 8>
+size_t HashJoin(int partition = 0, int num_partitions = 1) {
+  //////////////////////////////////////////////////////////////////////////////
+  // static asserts
+  static_assert(t1_win_size > 0,
+                "Table 1 window size must be positive and non-zero");
+  static_assert(t2_win_size > 0,
+                "Table 2 window size must be positive and non-zero");
+  static_assert(t1_max_duplicates > 0,
+                "Table 1 maximum duplicates be positive and non-zero");
+  static_assert(cache_depth >= 0, "Cache depth must be non-negative");
+  static_assert(num_buckets > 0 && Pow2(Log2(num_buckets)) == num_buckets,
+                "Number of buckets must be a power of 2");
+  static_assert(
+      std::is_same_v<unsigned int, decltype(T1Type().PrimaryKey())>,
+      "T1Type must have 'PrimaryKey()' function that returns an 'unsigned "
+      "int'");
+  static_assert(
+      std::is_same_v<unsigned int, decltype(T2Type().PrimaryKey())>,
+      "T2Type must have 'PrimaryKey()' function that returns an 'unsigned "
+      "int'");
+  static_assert(std::is_same_v<bool, decltype(T1Type().valid)>,
+                "T1Type must have a 'valid' boolean member");
+  static_assert(std::is_same_v<bool, decltype(T2Type().valid)>,
+                "T2Type must have a 'valid' boolean member");
+  static_assert(std::is_same_v<bool, decltype(JoinType().valid)>,
+                "JoinType must have a 'valid' boolean member");
+  //////////////////////////////////////////////////////////////////////////////
+
+  constexpr int kBucketBits = Log2(num_buckets);
+  constexpr int kOutWinSize = t1_max_duplicates * t2_win_size;
+
+  // a bucket of the on-chip table
+  struct Bucket {
+    int count;
+    unsigned int key[t1_max_duplicates];
+    T1Type row[t1_max_duplicates];
+  };
+
+  // the bucket of a key, and whether the key belongs to this partition.
+  // The partition is taken from the hash bits above the bucket index, so the
+  // rows of one partition are still spread over all buckets.
+  auto bucket_of = [&](unsigned int key, bool& in_partition) {
+    const unsigned int h = Hasher()(key);
+    in_partition = ((h >> kBucketBits) % num_partitions) == partition;
+    return static_cast<int>(h & (num_buckets - 1));
+  };
+
+  // the on-chip hash table
+  Bucket table[num_buckets];
+
+  // the cache of the last bucket updates of the build phase
+  [[intel::fpga_register]] Bucket cache_value[cache_depth + 1];
+  [[intel::fpga_register]] int cache_tag[cache_depth + 1];
+
+  // initialize the table and the cache
+  [[intel::initiation_interval(1)]]
+  for (int b = 0; b < num_buckets; b++) {
+    table[b].count = 0;
+  }
+  #pragma unroll
+  for (int c = 0; c < cache_depth + 1; c++) {
+    cache_tag[c] = -1;
+  }
+
+  size_t overflow = 0;
+
+  ////////////////////////////////////////////////////////////////////////////
+  //// build: insert table 1 into the hash table
+  bool t1_done = false;
+
+  [[intel::initiation_interval(1)]]
+  while (!t1_done) {
+    bool t1_win_valid;
+    StreamingData<T1Type, t1_win_size> t1_win = T1Pipe::read(t1_win_valid);
+
+    t1_done = t1_win.done && t1_win_valid;
+
+    if (!t1_done && t1_win_valid) {
+      // the rows of a window are inserted in order; a row sees the updates
+      // of the rows before it through the cache
+      UnrolledLoop<0, t1_win_size>([&](auto i) {
+        T1Type row = t1_win.data.template get<i>();
+        bool in_partition;
+        const unsigned int key = row.PrimaryKey();
+        const int idx = bucket_of(key, in_partition);
+
+        if (row.valid && in_partition) {
+          // read the bucket, forwarding any update still in flight
+          Bucket bucket = table[idx];
+          #pragma unroll
+          for (int c = 0; c < cache_depth + 1; c++) {
+            if (cache_tag[c] == idx) {
+              bucket = cache_value[c];
+            }
+          }
+
+          if (bucket.count < t1_max_duplicates) {
+            // append the row to the bucket
+            #pragma unroll
+            for (int d = 0; d < t1_max_duplicates; d++) {
+              if (d == bucket.count) {
+                bucket.key[d] = key;
+                bucket.row[d] = row;
+              }
+            }
+            bucket.count++;
+
+            table[idx] = bucket;
+
+            // shift the new value into the cache
+            cache_value[cache_depth] = bucket;
+            cache_tag[cache_depth] = idx;
+            #pragma unroll
+            for (int c = 0; c < cache_depth; c++) {
+              cache_value[c] = cache_value[c + 1];
+              cache_tag[c] = cache_tag[c + 1];
+            }
+          } else {
+            overflow++;
+          }
+        }
+      });
+    }
+  }
+  ////////////////////////////////////////////////////////////////////////////
+
+  ////////////////////////////////////////////////////////////////////////////
+  //// probe: join table 2 with the hash table
+  bool t2_done = false;
+
+  [[intel::initiation_interval(1)]]
+  while (!t2_done) {
+    bool t2_win_valid;
+    StreamingData<T2Type, t2_win_size> t2_win = T2Pipe::read(t2_win_valid);
+
+    t2_done = t2_win.done && t2_win_valid;
+
+    if (!t2_done && t2_win_valid) {
+      StreamingData<JoinType, kOutWinSize> join_data(false, true);
+
+      // initialize all validity to false
+      UnrolledLoop<0, kOutWinSize>([&](auto i) {
+        join_data.data.template get<i>().valid = false;
+      });
+
+      UnrolledLoop<0, t2_win_size>([&](auto j) {
+        const T2Type t2_row = t2_win.data.template get<j>();
+        bool in_partition;
+        const unsigned int t2_key = t2_row.PrimaryKey();
+        const int idx = bucket_of(t2_key, in_partition);
+
+        // the table is read-only in this phase, so every lane gets its own
+        // copy of it
+        const Bucket bucket = table[idx];
+
+        UnrolledLoop<0, t1_max_duplicates>([&](auto i) {
+          if (t2_row.valid && in_partition && i < bucket.count &&
+              bucket.key[i] == t2_key) {
+            // NOTE: order below important if Join() overrides valid
+            join_data.data.template get<i * t2_win_size + j>().valid = true;
+            join_data.data.template get<i * t2_win_size + j>().Join(
+                bucket.row[i], t2_row);
+          }
+        });
+      });
+
+      OutPipe::write(join_data);
+    }
+  }
+  ////////////////////////////////////////////////////////////////////////////
+
+  return overflow;
+}
+
+#endif /* __HASH_JOIN_HPP__ */
@@ -0,0 +1,633 @@
+//==============================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+//
+// Tests of the db_utils operators that are not used by one of the queries.
+// Every test streams random tables through the operator on the device and
+// checks the output against the same operation computed on the host.
+//
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "db_utils/HashAggregate.hpp"
+#include "db_utils/HashJoin.hpp"
+#include "db_utils/StreamingData.hpp"
+#include "db_utils/Tuple.hpp"
+#include "db_utils/Unroller.hpp"
+#include "dbdata.hpp"
+
+#include "exception_handler.hpp"
+
+using namespace sycl;
+
+namespace db_utils_test {
+
+// the number of rows streamed per cycle by the producers
+constexpr int kWinSize = 4;
+
+/////////////////////////////////////////////////////////////////////////////
+//// HashAggregate
+
+// the input has kAggKeys distinct keys. The first test sizes the on-chip
+// table for all of them, so (almost) no row is spilled; at most 1 in
+// kAggMaxSpillRatio groups may be spilled. The second test sizes the table
+// for kAggSmallGroups groups, so most groups are spilled and merged on the
+// host.
+constexpr int kAggWays = 4;
+constexpr int kAggOutWinSize = kWinSize * kAggWays;
+constexpr size_t kAggRows = 50000;
+constexpr unsigned int kAggKeys = 1000;
+constexpr int kAggMaxGroups = kAggKeys;
+constexpr int kAggSmallGroups = 128;
+constexpr size_t kAggMaxSpillRatio = 50;
+constexpr size_t kAggSpillCapacity = 2 * kAggKeys;
+
+//
+// A row of the aggregated table
+//
+class AggRow {
+ public:
+  AggRow() : valid(false), key(0), value(0) {}
+  AggRow(bool v_valid, DBIdentifier v_key, DBDecimal v_value)
+      : valid(v_valid), key(v_key), value(v_value) {}
+
+  DBIdentifier GroupKey() const { return key; }
+
+  bool valid;
+  DBIdentifier key;
+  DBDecimal value;
+};
+
+//
+// The aggregate of a group: the sum of the values and the number of rows
+//
+class SumCount {
+ public:
+  SumCount() : sum(0), count(0) {}
+
+  void Accumulate(const AggRow& row) {
+    sum += row.value;
+    count++;
+  }
+
+  void Merge(const SumCount& other) {
+    sum += other.sum;
+    count += other.count;
+  }
+
+  DBDecimal sum;
+  DBDecimal count;
+};
+
+using AggGroup = HashAggregateGroup<DBIdentifier, SumCount>;
+
+// the kernel and pipe names, one set per table size
+template <int max_groups>
+class AggProducer;
+template <int max_groups>
+class Aggregate;
+template <int max_groups>
+class AggSpill;
+template <int max_groups>
+class AggConsumer;
+template <int max_groups>
+class AggInPipeClass;
+template <int max_groups>
+class AggOutPipeClass;
+template <int max_groups>
+class AggSpillPipeClass;
+
+//
+// Streams 'rows' through a HashAggregate with a table sized for 'max_groups'
+// groups and returns the groups it produced, with the spilled groups merged
+// in, and the number of spilled groups
+//
+template <int max_groups>
+bool RunHashAggregate(queue& q, std::vector<AggRow>& rows,
+                      std::vector<AggGroup>& groups, size_t& spilled) {
+  using AggInPipe = pipe<AggInPipeClass<max_groups>,
+                         StreamingData<AggRow, kWinSize>>;
+  using AggOutPipe = pipe<AggOutPipeClass<max_groups>,
+                          StreamingData<AggGroup, kAggOutWinSize>>;
+  using AggSpillPipe = pipe<AggSpillPipeClass<max_groups>,
+                            StreamingData<AggGroup, kWinSize>, 64>;
+  constexpr int kAggBuckets = HashAggregateBuckets<max_groups, kAggWays>();
+
+  const size_t num_rows = rows.size();
+  const size_t iters = (num_rows + kWinSize - 1) / kWinSize;
+
+  std::vector<AggGroup> out(kAggBuckets * kAggOutWinSize);
+  std::vector<AggGroup> spill(kAggSpillCapacity);
+  std::vector<size_t> spill_count(1);
+
+  {
+    buffer rows_buf(rows);
+    buffer out_buf(out);
+    buffer spill_buf(spill);
+    buffer spill_count_buf(spill_count);
+
+    q.submit([&](handler& h) {
+      accessor rows_accessor(rows_buf, h, read_only);
+
+      h.single_task<AggProducer<max_groups>>([=]() [[intel::kernel_args_restrict]] {
+        [[intel::initiation_interval(1)]]
+        for (size_t i = 0; i < iters; i++) {
+          NTuple<kWinSize, AggRow> data;
+          UnrolledLoop<0, kWinSize>([&](auto j) {
+            const size_t idx = i * kWinSize + j;
+            data.template get<j>() =
+                (idx < num_rows) ? rows_accessor[idx] : AggRow();
+          });
+          AggInPipe::write(StreamingData<AggRow, kWinSize>(false, true, data));
+        }
+        AggInPipe::write(StreamingData<AggRow, kWinSize>(true, false));
+      });
+    });
+
+    q.submit([&](handler& h) {
+      h.single_task<Aggregate<max_groups>>([=]() [[intel::kernel_args_restrict]] {
+        HashAggregate<AggInPipe, AggRow, kWinSize, AggOutPipe, AggSpillPipe,
+                      DBIdentifier, SumCount, max_groups, kAggWays>();
+      });
+    });
+
+    q.submit([&](handler& h) {
+      accessor spill_accessor(spill_buf, h, read_write);
+      accessor spill_count_accessor(spill_count_buf, h, write_only, no_init);
+
+      h.single_task<AggSpill<max_groups>>([=]() [[intel::kernel_args_restrict]] {
+        spill_count_accessor[0] =
+            HashAggregateSpill<AggSpillPipe, DBIdentifier, SumCount, kWinSize>(
+                spill_accessor, kAggSpillCapacity);
+      });
+    });
+
+    q.submit([&](handler& h) {
+      accessor out_accessor(out_buf, h, write_only, no_init);
+
+      h.single_task<AggConsumer<max_groups>>([=]() [[intel::kernel_args_restrict]] {
+        // HashAggregate writes one window per bucket
+        for (int b = 0; b < kAggBuckets; b++) {
+          StreamingData<AggGroup, kAggOutWinSize> data = AggOutPipe::read();
+          UnrolledLoop<0, kAggOutWinSize>([&](auto i) {
+            out_accessor[b * kAggOutWinSize + i] = data.data.template get<i>();
+          });
+        }
+      });
+    });
+
+    q.wait();
+  }
+
+  if (spill_count[0] > kAggSpillCapacity) {
+    std::cerr << "ERROR: the spilled groups do not fit in the spill table ("
+              << kAggSpillCapacity << " entries)\n";
+    return false;
+  }
+
+  spilled = spill_count[0];
+  std::cout << "HashAggregate with a table for " << max_groups
+            << " groups spilled rows of " << spilled << " of " << kAggKeys
+            << " groups\n";
+
+  groups.clear();
+  for (auto& g : out) {
+    if (g.valid) {
+      groups.push_back(g);
+    }
+  }
+  MergeHashAggregateSpill(groups, spill.data(), kAggSpillCapacity);
+
+  return true;
+}
+
+//
+// Checks the groups produced by HashAggregate against the group-by on the host
+//
+bool CheckHashAggregate(const std::vector<AggGroup>& groups,
+                        const std::map<DBIdentifier, SumCount>& expected) {
+  std::map<DBIdentifier, SumCount> result;
+  for (auto& g : groups) {
+    if (result.count(g.key) != 0) {
+      std::cerr << "ERROR: HashAggregate produced key " << g.key
+                << " more than once\n";
+      return false;
+    }
+    result[g.key] = g.agg;
+  }
+
+  if (result.size() != expected.size()) {
+    std::cerr << "ERROR: HashAggregate produced " << result.size()
+              << " groups (expected " << expected.size() << ")\n";
+    return false;
+  }
+
+  for (auto& [key, agg] : expected) {
+    auto it = result.find(key);
+    if (it == result.end() || it->second.sum != agg.sum ||
+        it->second.count != agg.count) {
+      std::cerr << "ERROR: wrong aggregate for key " << key << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//
+// Checks HashAggregate against a group-by on the host, with a table sized for
+// all groups and with a table that is much too small
+//
+bool TestHashAggregate(queue& q) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<DBIdentifier> key_dist(0, kAggKeys - 1);
+  std::uniform_int_distribution<DBDecimal> value_dist(-1000, 1000);
+
+  std::vector<AggRow> rows(kAggRows);
+  for (size_t i = 0; i < kAggRows; i++) {
+    // every 7th row is invalid (e.g. filtered out by an upstream kernel)
+    rows[i] = AggRow(i % 7 != 0, key_dist(rng), value_dist(rng));
+  }
+
+  // the group-by on the host
+  std::map<DBIdentifier, SumCount> expected;
+  for (auto& row : rows) {
+    if (row.valid) {
+      expected[row.key].Accumulate(row);
+    }
+  }
+
+  // below capacity, only the rare bucket overflows are spilled
+  std::vector<AggGroup> groups;
+  size_t spilled;
+  if (!RunHashAggregate<kAggMaxGroups>(q, rows, groups, spilled) ||
+      !CheckHashAggregate(groups, expected)) {
+    return false;
+  }
+  if (spilled * kAggMaxSpillRatio > kAggKeys) {
+    std::cerr << "ERROR: HashAggregate spilled " << spilled << " of "
+              << kAggKeys << " groups with a table sized for " << kAggMaxGroups
+              << " groups\n";
+    return false;
+  }
+
+  // above capacity, most groups are spilled and merged on the host
+  if (!RunHashAggregate<kAggSmallGroups>(q, rows, groups, spilled) ||
+      !CheckHashAggregate(groups, expected)) {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//// HashJoin
+
+// table 1 has more rows than the on-chip table holds, so the join needs
+// several partitions. Every key is in table 1 at most twice, so the join
+// succeeds once the partitions are small enough.
+constexpr int kJoinBuckets = 256;
+constexpr int kJoinMaxDuplicates = 8;
+constexpr int kJoinMaxPartitions = 16;
+constexpr int kJoinOutWinSize = kJoinMaxDuplicates * kWinSize;
+constexpr size_t kJoinT1Rows = 1500;
+constexpr size_t kJoinT2Rows = 4000;
+constexpr unsigned int kJoinT1Keys = 2000;
+constexpr unsigned int kJoinT2Keys = 2500;
+
+//
+// A row of table 1 or table 2 of the join
+//
+class JoinRow {
+ public:
+  JoinRow() : valid(false), key(0), value(0) {}
+  JoinRow(bool v_valid, DBIdentifier v_key, DBDecimal v_value)
+      : valid(v_valid), key(v_key), value(v_value) {}
+
+  DBIdentifier PrimaryKey() const { return key; }
+
+  bool valid;
+  DBIdentifier key;
+  DBDecimal value;
+};
+
+//
+// A row of the joined table
+//
+class JoinedRow {
+ public:
+  JoinedRow() : valid(false), key(0), t1_value(0), t2_value(0) {}
+
+  void Join(const JoinRow& t1_row, const JoinRow& t2_row) {
+    key = t1_row.key;
+    t1_value = t1_row.value;
+    t2_value = t2_row.value;
+  }
+
+  bool valid;
+  DBIdentifier key;
+  DBDecimal t1_value;
+  DBDecimal t2_value;
+};
+
+// the kernel names
+class JoinT1Producer;
+class JoinT2Producer;
+class Join;
+class JoinConsumer;
+
+// the pipes
+using JoinT1Pipe =
+    pipe<class JoinT1PipeClass, StreamingData<JoinRow, kWinSize>>;
+using JoinT2Pipe =
+    pipe<class JoinT2PipeClass, StreamingData<JoinRow, kWinSize>>;
+using JoinOutPipe =
+    pipe<class JoinOutPipeClass, StreamingData<JoinedRow, kJoinOutWinSize>>;
+
+//
+// Streams the rows of 'rows' into Pipe, kWinSize rows at a time, followed by
+// the 'done' window
+//
+template <typename KernelName, typename Pipe>
+void SubmitJoinProducer(queue& q, buffer<JoinRow, 1>& rows_buf) {
+  const size_t num_rows = rows_buf.size();
+  const size_t iters = (num_rows + kWinSize - 1) / kWinSize;
+
+  q.submit([&](handler& h) {
+    accessor rows_accessor(rows_buf, h, read_only);
+
+    h.single_task<KernelName>([=]() [[intel::kernel_args_restrict]] {
+      [[intel::initiation_interval(1)]]
+      for (size_t i = 0; i < iters; i++) {
+        NTuple<kWinSize, JoinRow> data;
+        UnrolledLoop<0, kWinSize>([&](auto j) {
+          const size_t idx = i * kWinSize + j;
+          data.template get<j>() =
+              (idx < num_rows) ? rows_accessor[idx] : JoinRow();
+        });
+        Pipe::write(StreamingData<JoinRow, kWinSize>(false, true, data));
+      }
+      Pipe::write(StreamingData<JoinRow, kWinSize>(true, false));
+    });
+  });
+}
+
+//
+// Runs pass 'partition' of a HashJoin with 'num_partitions' partitions and
+// appends the joined rows to 'joined'. 'overflow' is set to the number of
+// table 1 rows that did not fit in the on-chip table. Returns false if the
+// join produced more than 'max_rows' rows.
+//
+bool RunHashJoin(queue& q, std::vector<JoinRow>& t1, std::vector<JoinRow>& t2,
+                 int partition, int num_partitions, size_t max_rows,
+                 std::vector<JoinedRow>& joined, size_t& overflow) {
+  std::vector<JoinedRow> out(max_rows);
+  std::vector<size_t> t1_overflow(1);
+  std::vector<size_t> out_rows(1);
+
+  {
+    buffer t1_buf(t1);
+    buffer t2_buf(t2);
+    buffer out_buf(out);
+    // every kernel has its own buffers, so that the runtime does not
+    // serialize kernels that communicate through pipes
+    buffer t1_overflow_buf(t1_overflow);
+    buffer out_rows_buf(out_rows);
+
+    SubmitJoinProducer<JoinT1Producer, JoinT1Pipe>(q, t1_buf);
+    SubmitJoinProducer<JoinT2Producer, JoinT2Pipe>(q, t2_buf);
+
+    q.submit([&](handler& h) {
+      accessor t1_overflow_accessor(t1_overflow_buf, h, write_only, no_init);
+
+      h.single_task<Join>([=]() [[intel::kernel_args_restrict]] {
+        t1_overflow_accessor[0] =
+            HashJoin<JoinT1Pipe, JoinRow, kWinSize, JoinT2Pipe, JoinRow,
+                     kWinSize, JoinOutPipe, JoinedRow, kJoinBuckets,
+                     kJoinMaxDuplicates>(partition, num_partitions);
+
+        // join is done
+        JoinOutPipe::write(StreamingData<JoinedRow, kJoinOutWinSize>(true,
+                                                                     false));
+      });
+    });
+
+    q.submit([&](handler& h) {
+      accessor out_accessor(out_buf, h, write_only, no_init);
+      accessor out_rows_accessor(out_rows_buf, h, write_only, no_init);
+
+      h.single_task<JoinConsumer>([=]() [[intel::kernel_args_restrict]] {
+        size_t n = 0;
+        bool done = false;
+
+        while (!done) {
+          StreamingData<JoinedRow, kJoinOutWinSize> data = JoinOutPipe::read();
+          done = data.done;
+
+          if (!done && data.valid) {
+            UnrolledLoop<0, kJoinOutWinSize>([&](auto i) {
+              const JoinedRow row = data.data.template get<i>();
+              if (row.valid) {
+                if (n < max_rows) {
+                  out_accessor[n] = row;
+                }
+                n++;
+              }
+            });
+          }
+        }
+
+        out_rows_accessor[0] = n;
+      });
+    });
+
+    q.wait();
+  }
+
+  overflow = t1_overflow[0];
+
+  if (out_rows[0] > max_rows) {
+    std::cerr << "ERROR: HashJoin produced too many rows (" << out_rows[0]
+              << ")\n";
+    return false;
+  }
+
+  joined.insert(joined.end(), out.begin(), out.begin() + out_rows[0]);
+
+  return true;
+}
+
+//
+// Checks HashJoin against a join on the host
+//
+bool TestHashJoin(queue& q) {
+  std::mt19937 rng(5678);
+  std::uniform_int_distribution<DBIdentifier> t2_key_dist(0, kJoinT2Keys - 1);
+  std::uniform_int_distribution<DBDecimal> value_dist(0, 1000000);
+
+  // every key twice, in random order
+  std::vector<DBIdentifier> t1_keys;
+  for (DBIdentifier key = 0; key < kJoinT1Keys; key++) {
+    t1_keys.push_back(key);
+    t1_keys.push_back(key);
+  }
+  std::shuffle(t1_keys.begin(), t1_keys.end(), rng);
+
+  std::vector<JoinRow> t1(kJoinT1Rows), t2(kJoinT2Rows);
+  for (size_t i = 0; i < kJoinT1Rows; i++) {
+    t1[i] = JoinRow(i % 11 != 0, t1_keys[i], value_dist(rng));
+  }
+  for (size_t i = 0; i < kJoinT2Rows; i++) {
+    t2[i] = JoinRow(i % 13 != 0, t2_key_dist(rng), value_dist(rng));
+  }
+
+  // the join on the host
+  using Result = std::tuple<DBIdentifier, DBDecimal, DBDecimal>;
+  std::unordered_multimap<DBIdentifier, DBDecimal> t1_map;
+  for (auto& row : t1) {
+    if (row.valid) {
+      t1_map.emplace(row.key, row.value);
+    }
+  }
+  std::vector<Result> expected;
+  for (auto& row : t2) {
+    if (row.valid) {
+      auto range = t1_map.equal_range(row.key);
+      for (auto it = range.first; it != range.second; it++) {
+        expected.emplace_back(row.key, it->second, row.value);
+      }
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  if (HashJoinPartitions(kJoinT1Rows, kJoinBuckets, kJoinMaxDuplicates, 0) !=
+      0) {
+    std::cerr << "ERROR: HashJoinPartitions accepted a fill factor of 0\n";
+    return false;
+  }
+
+  // table 1 does not fit in the on-chip table, so a single pass must report
+  // the rows it dropped
+  std::vector<JoinedRow> joined;
+  size_t overflow;
+  if (!RunHashJoin(q, t1, t2, 0, 1, expected.size(), joined, overflow)) {
+    return false;
+  }
+  if (overflow == 0) {
+    std::cerr << "ERROR: HashJoin did not report the table 1 rows that did "
+              << "not fit in a single pass\n";
+    return false;
+  }
+
+  // start from the estimated number of partitions, and add partitions until
+  // no bucket overflows
+  int num_partitions =
+      HashJoinPartitions(kJoinT1Rows, kJoinBuckets, kJoinMaxDuplicates);
+  while (true) {
+    joined.clear();
+    size_t total_overflow = 0;
+    for (int p = 0; p < num_partitions; p++) {
+      if (!RunHashJoin(q, t1, t2, p, num_partitions, expected.size(), joined,
+                       overflow)) {
+        return false;
+      }
+      total_overflow += overflow;
+    }
+
+    if (total_overflow == 0) {
+      break;
+    }
+
+    std::cout << "HashJoin dropped " << total_overflow << " table 1 rows "
+              << "with " << num_partitions << " partitions\n";
+    num_partitions++;
+
+    if (num_partitions > kJoinMaxPartitions) {
+      std::cerr << "ERROR: HashJoin still drops rows with "
+                << kJoinMaxPartitions << " partitions\n";
+      return false;
+    }
+  }
+
+  std::cout << "HashJoin joined " << joined.size() << " rows in "
+            << num_partitions << " partitions\n";
+
+  std::vector<Result> result;
+  for (auto& row : joined) {
+    result.emplace_back(row.key, row.t1_value, row.t2_value);
+  }
+  std::sort(result.begin(), result.end());
+
+  if (result != expected) {
+    std::cerr << "ERROR: HashJoin produced " << result.size() << " rows "
+              << "that do not match the " << expected.size()
+              << " rows of the host join\n";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace db_utils_test
+
+using namespace db_utils_test;
+
+int main(int argc, char* argv[]) {
+  bool success = true;
+
+  try {
+#if FPGA_SIMULATOR
+    auto selector = sycl::ext::intel::fpga_simulator_selector_v;
+#elif FPGA_HARDWARE
+    auto selector = sycl::ext::intel::fpga_selector_v;
+#else  // #if FPGA_EMULATOR
+    auto selector = sycl::ext::intel::fpga_emulator_selector_v;
+#endif
+
+    queue q(selector, fpga_tools::exception_handler);
+
+    std::cout << "Running on device: "
+              << q.get_device().get_info<info::device::name>().c_str()
+              << std::endl;
+
+    if (TestHashAggregate(q)) {
+      std::cout << "HashAggregate: PASSED\n";
+    } else {
+      std::cout << "HashAggregate: FAILED\n";
+      success = false;
+    }
+
+    if (TestHashJoin(q)) {
+      std::cout << "HashJoin: PASSED\n";
+    } else {
+      std::cout << "HashJoin: FAILED\n";
+      success = false;
+    }
+  } catch (exception const& e) {
+    // Catches exceptions in the host code
+    std::cout << "Caught a SYCL host exception:\n" << e.what() << "\n";
+    // Most likely the runtime couldn't find FPGA hardware!
+    if (e.code().value() == CL_DEVICE_NOT_FOUND) {
+      std::cout << "If you are targeting an FPGA, please ensure that your "
+                   "system has a correctly configured FPGA board.\n";
+      std::cout << "If you are targeting the FPGA emulator, compile with "
+                   "-DFPGA_EMULATOR.\n";
+      std::cout << "If you are targeting the FPGA simulator, compile with "
+                   "-DFPGA_SIMULATOR.\n";
+    }
+    std::terminate();
+  }
+
+  return success ? 0 : 1;
+}
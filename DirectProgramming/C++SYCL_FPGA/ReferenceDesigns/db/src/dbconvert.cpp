@@ -0,0 +1,90 @@
+//==============================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+//
+// One-time converter from the TPC-H '*.tbl' text files to the columnar
+// snapshot format ('*.dbc') that the 'db' program loads at startup.
+// This program runs on the host only and does not need an FPGA.
+//
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "dbdata.hpp"
+
+//
+// print help for the program
+//
+void Help() {
+  std::cout << "USAGE:\n";
+  std::cout << "\t./dbconvert --dbroot=<database root directory> "
+               "[--out=<snapshot directory>]\n";
+  std::cout << "\n";
+  std::cout << "Optional Arguments:\n";
+  std::cout << "\t--out     directory to write the '*.dbc' snapshot files to."
+               " Defaults to the database root directory\n";
+  std::cout << "\t--help    print this help message\n";
+  std::cout << "\n";
+}
+
+//
+// determine if a string starts with a prefix
+//
+bool StrStartsWith(std::string& str, std::string prefix) {
+  return str.find(prefix) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  std::string db_root_dir = ".";
+  std::string out_dir = "";
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+
+    if (arg == "--help" || arg == "-h") {
+      Help();
+      return 0;
+    } else {
+      std::string str_after_equals = arg.substr(arg.find("=") + 1);
+
+      if (StrStartsWith(arg, "--dbroot=")) {
+        db_root_dir = str_after_equals;
+      } else if (StrStartsWith(arg, "--out=")) {
+        out_dir = str_after_equals;
+      } else {
+        std::cout << "WARNING: ignoring unknown argument '" << arg << "'\n";
+      }
+    }
+  }
+
+  if (out_dir.empty()) {
+    out_dir = db_root_dir;
+  }
+
+  Database dbinfo;
+
+  // always parse the text files, even if an older snapshot exists
+  auto start = std::chrono::high_resolution_clock::now();
+  if (!dbinfo.Parse(db_root_dir, false)) {
+    std::cerr << "ERROR: couldn't read the DB files\n";
+    return 1;
+  }
+  auto parsed = std::chrono::high_resolution_clock::now();
+
+  if (!dbinfo.WriteSnapshot(out_dir, db_root_dir)) {
+    std::cerr << "ERROR: couldn't write the DB snapshot\n";
+    return 1;
+  }
+  auto written = std::chrono::high_resolution_clock::now();
+
+  std::chrono::duration<double, std::milli> parse_time = parsed - start;
+  std::chrono::duration<double, std::milli> write_time = written - parsed;
+  std::cout << "Parse time: " << parse_time.count() << " ms\n";
+  std::cout << "Snapshot write time: " << write_time.count() << " ms\n";
+
+  return 0;
+}
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "dbdata.hpp"
+#include "dbparser.hpp"
 #include "db_utils/Date.hpp"
 
 // choose a file separator based on the platform (Windows or Linux)
@@ -35,37 +36,6 @@ std::vector<std::string> SplitRowStr(const std::string& row) {
   return columns;
 }
 
-//
-// appends 'n' characters of a string to a vector
-//
-void AppendStringToCharVec(std::vector<char>& v, const std::string& str,
-                           const unsigned int n) {
-  // append the 'n' characters, padding with null terminators ('\0')
-  const size_t str_n = str.size();
-  for (size_t i = 0; i < n; i++) {
-    v.push_back(i < str_n ? str[i] : '\0');
-  }
-}
-
-//
-// convert a money string (i.e. '1209.12' dollars) to
-// the internal 'cents' representation (i.e. '120912' cents)
-//
-DBDecimal MoneyFloatToCents(const std::string& money_float_str) {
-  // parse money string
-  std::istringstream ss(money_float_str);
-  std::string dollars_str, cents_str;
-
-  std::getline(ss, dollars_str, '.');
-  std::getline(ss, cents_str, '.');
-  
-  DBDecimal dollars = atoi(dollars_str.c_str());
-  DBDecimal cents = atoi(cents_str.c_str());
-
-  // convert to fixed point format (i.e. in cents)
-  return dollars * 100 + cents;
-}
-
 //
 // convert a SHIPMODE string to the internal representation (integer)
 //
@@ -126,9 +96,20 @@ void trim(std::string& s) {
 
 //
 // the main parsing function
-// parses '*.tbl' files location in directory 'db_root_dir'
-//
-bool Database::Parse(std::string db_root_dir) {
+// parses '*.tbl' files location in directory 'db_root_dir'. Each table is
+// split into chunks that are parsed concurrently (see dbparser.hpp)
+//
+bool Database::Parse(std::string db_root_dir, bool use_snapshot) {
+  bool rebuild_snapshot = false;
+  if (use_snapshot && HasSnapshot(db_root_dir)) {
+    if (LoadSnapshot(db_root_dir)) {
+      return true;
+    }
+    std::cout << "WARNING: could not load the database snapshot, "
+              << "parsing the '*.tbl' files and rebuilding it\n";
+    rebuild_snapshot = true;
+  }
+
   std::cout << "Parsing database files in: " << db_root_dir << std::endl;
 
   bool success = true;
@@ -141,6 +122,12 @@ bool Database::Parse(std::string db_root_dir) {
   success &= ParsePartSupplierTable(db_root_dir + kSeparator + "partsupp.tbl", ps);
   success &= ParseNationTable(db_root_dir + kSeparator + "nation.tbl", n);
 
+  // replace the stale snapshot, so the next run can load it again
+  if (success && rebuild_snapshot &&
+      !WriteSnapshot(db_root_dir, db_root_dir)) {
+    std::cout << "WARNING: could not rebuild the database snapshot\n";
+  }
+
   return success;
 }
 
@@ -150,65 +137,63 @@ bool Database::Parse(std::string db_root_dir) {
 bool Database::ParseLineItemTable(std::string f, LineItemTable& tbl) {
   std::cout << "Parsing LINEITEM table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 16,
+      [&](size_t rows) {
+        // the numeric columns are padded with kPaddingRows zeros
+        const size_t padded_rows = rows + kPaddingRows;
+        tbl.orderkey.assign(padded_rows, 0);
+        tbl.partkey.assign(padded_rows, 0);
+        tbl.suppkey.assign(padded_rows, 0);
+        tbl.linenumber.assign(padded_rows, 0);
+        tbl.quantity.assign(padded_rows, 0);
+        tbl.extendedprice.assign(padded_rows, 0);
+        tbl.discount.assign(padded_rows, 0);
+        tbl.tax.assign(padded_rows, 0);
+        tbl.returnflag.assign(padded_rows, 0);
+        tbl.linestatus.assign(padded_rows, 0);
+        tbl.shipdate.assign(padded_rows, 0);
+        tbl.commitdate.assign(padded_rows, 0);
+        tbl.receiptdate.assign(padded_rows, 0);
+        tbl.shipinstruct.resize(rows * 25);
+        tbl.shipmode.assign(padded_rows, 0);
+        tbl.comment.resize(rows * 44);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.orderkey[r] = TblToInt(column_data[0]);
+        tbl.partkey[r] = TblToInt(column_data[1]);
+        tbl.suppkey[r] = TblToInt(column_data[2]);
+        tbl.linenumber[r] = TblToInt(column_data[3]);
+        tbl.quantity[r] = TblToInt(column_data[4]);
+
+        tbl.extendedprice[r] = TblToCents(column_data[5]);
+        tbl.discount[r] = TblToCents(column_data[6]);
+        tbl.tax[r] = TblToCents(column_data[7]);
+
+        tbl.returnflag[r] = column_data[8].at(0);
+        tbl.linestatus[r] = column_data[9].at(0);
+
+        tbl.shipdate[r] = TblToDate(column_data[10]);
+        tbl.commitdate[r] = TblToDate(column_data[11]);
+        tbl.receiptdate[r] = TblToDate(column_data[12]);
+
+        TblToChars(tbl.shipinstruct, r, 25, column_data[13]);
+        TblToChars(tbl.comment, r, 44, column_data[15]);
+
+        tbl.shipmode[r] = TblToShipmode(column_data[14]);
+        if (tbl.shipmode[r] < 0) {
+          std::cerr << "ERROR: unknown SHIPMODE '" << column_data[14]
+                    << "' in row " << r << " of " << f << "\n";
+          return false;
+        }
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse LINEITEM table\n";
     return false;
   }
-
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 16);
-
-    tbl.orderkey.push_back(std::stoll(column_data[0]));
-    tbl.partkey.push_back(std::stoll(column_data[1]));
-    tbl.suppkey.push_back(std::stoll(column_data[2]));
-    tbl.linenumber.push_back(std::stoll(column_data[3]));
-    tbl.quantity.push_back(std::stoll(column_data[4]));
-
-    tbl.extendedprice.push_back(MoneyFloatToCents(column_data[5]));
-    tbl.discount.push_back(MoneyFloatToCents(column_data[6]));
-    tbl.tax.push_back(MoneyFloatToCents(column_data[7]));
-
-    tbl.returnflag.push_back(column_data[8].at(0));
-    tbl.linestatus.push_back(column_data[9].at(0));
-
-    tbl.shipdate.push_back(Date(column_data[10]).ToCompact());
-    tbl.commitdate.push_back(Date(column_data[11]).ToCompact());
-    tbl.receiptdate.push_back(Date(column_data[12]).ToCompact());
-
-    AppendStringToCharVec(tbl.shipinstruct, column_data[13], 25);
-    tbl.shipmode.push_back(ShipmodeStrToInt(column_data[14]));
-    AppendStringToCharVec(tbl.comment, column_data[15], 44);
-
-    tbl.rows++;
-  }
-
-  for (size_t i = 0; i < kPaddingRows; i++) {
-    tbl.orderkey.push_back(0);
-    tbl.partkey.push_back(0);
-    tbl.suppkey.push_back(0);
-    tbl.linenumber.push_back(0);
-    tbl.quantity.push_back(0);
-
-    tbl.extendedprice.push_back(0);
-    tbl.discount.push_back(0);
-    tbl.tax.push_back(0);
-
-    tbl.returnflag.push_back(0);
-    tbl.linestatus.push_back(0);
-
-    tbl.shipdate.push_back(0);
-    tbl.commitdate.push_back(0);
-    tbl.receiptdate.push_back(0);
-
-    tbl.shipmode.push_back(0);
-  }
+  tbl.rows = rows;
 
   std::cout << "Finished parsing LINEITEM table with " << tbl.rows << " rows\n";
 
@@ -221,45 +206,38 @@ bool Database::ParseLineItemTable(std::string f, LineItemTable& tbl) {
 bool Database::ParseOrdersTable(std::string f, OrdersTable& tbl) {
   std::cout << "Parsing ORDERS table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 9,
+      [&](size_t rows) {
+        const size_t padded_rows = rows + kPaddingRows;
+        tbl.orderkey.assign(padded_rows, 0);
+        tbl.custkey.assign(padded_rows, 0);
+        tbl.orderstatus.assign(padded_rows, 0);
+        tbl.totalprice.assign(padded_rows, 0);
+        tbl.orderdate.assign(padded_rows, 0);
+        tbl.orderpriority.assign(padded_rows, 0);
+        tbl.clerk.resize(rows * 15);
+        tbl.shippriority.assign(padded_rows, 0);
+        tbl.comment.resize(rows * 80);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.orderkey[r] = TblToInt(column_data[0]);
+        tbl.custkey[r] = TblToInt(column_data[1]);
+        tbl.orderstatus[r] = column_data[2][0];
+        tbl.totalprice[r] = TblToCents(column_data[3]);
+        tbl.orderdate[r] = TblToDate(column_data[4]);
+        tbl.orderpriority[r] = (int)(column_data[5][0] - '0');
+        TblToChars(tbl.clerk, r, 15, column_data[6]);
+        tbl.shippriority[r] = TblToInt(column_data[7]);
+        TblToChars(tbl.comment, r, 80, column_data[8]);
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse ORDERS table\n";
     return false;
   }
-
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 9);
-
-    // store date for this row
-    tbl.orderkey.push_back(std::stoll(column_data[0]));
-    tbl.custkey.push_back(std::stoll(column_data[1]));
-    tbl.orderstatus.push_back(column_data[2][0]);
-    tbl.totalprice.push_back(MoneyFloatToCents(column_data[3]));
-    tbl.orderdate.push_back(Date(column_data[4]).ToCompact());
-    tbl.orderpriority.push_back((int)(column_data[5][0] - '0'));
-    AppendStringToCharVec(tbl.clerk, column_data[6], 15);
-    tbl.shippriority.push_back(std::stoi(column_data[7]));
-    AppendStringToCharVec(tbl.comment, column_data[8], 80);
-
-    tbl.rows++;
-  }
-
-  for (size_t i = 0; i < kPaddingRows; i++) {
-    tbl.orderkey.push_back(0);
-    tbl.custkey.push_back(0);
-    tbl.orderstatus.push_back(0);
-    tbl.totalprice.push_back(0);
-    tbl.orderdate.push_back(0);
-    tbl.orderpriority.push_back(0);
-    tbl.shippriority.push_back(0);
-  }
-
+  tbl.rows = rows;
 
   std::cout << "Finished parsing ORDERS table with " << tbl.rows << " rows\n";
 
@@ -272,42 +250,46 @@ bool Database::ParseOrdersTable(std::string f, OrdersTable& tbl) {
 bool Database::ParsePartsTable(std::string f, PartsTable& tbl) {
   std::cout << "Parsing PARTS table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 9,
+      [&](size_t rows) {
+        const size_t padded_rows = rows + kPaddingRows;
+        tbl.partkey.assign(padded_rows, 0);
+        tbl.name.resize(padded_rows * 55);
+        tbl.mfgr.resize(rows * 25);
+        tbl.brand.resize(rows * 10);
+        tbl.type.resize(rows * 25);
+        tbl.size.assign(padded_rows, 0);
+        tbl.container.resize(rows * 10);
+        tbl.retailprice.assign(padded_rows, 0);
+        tbl.comment.resize(rows * 23);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.partkey[r] = TblToInt(column_data[0]);
+
+        // formatting part name: all uppercase
+        TblToChars(tbl.name, r, 55, column_data[1]);
+        std::transform(&tbl.name[r * 55], &tbl.name[r * 55] + 55,
+                       &tbl.name[r * 55], ::toupper);
+
+        TblToChars(tbl.mfgr, r, 25, column_data[2]);
+        TblToChars(tbl.brand, r, 10, column_data[3]);
+        TblToChars(tbl.type, r, 25, column_data[4]);
+        tbl.size[r] = TblToInt(column_data[5]);
+        TblToChars(tbl.container, r, 10, column_data[6]);
+        tbl.retailprice[r] = TblToCents(column_data[7]);
+        TblToChars(tbl.comment, r, 23, column_data[8]);
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse PARTS table\n";
     return false;
   }
-
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 9);
-
-    tbl.partkey.push_back(std::stoll(column_data[0]));
-
-    // formatting part name: no spaces, all uppercase
-    transform(column_data[1].begin(), column_data[1].end(),
-              column_data[1].begin(), ::toupper);
-    AppendStringToCharVec(tbl.name, column_data[1], 55);
-
-    AppendStringToCharVec(tbl.mfgr, column_data[2], 25);
-    AppendStringToCharVec(tbl.brand, column_data[3], 10);
-    AppendStringToCharVec(tbl.type, column_data[4], 25);
-    tbl.size.push_back(std::stoi(column_data[5]));
-    AppendStringToCharVec(tbl.container, column_data[6], 10);
-    tbl.retailprice.push_back(MoneyFloatToCents(column_data[7]));
-    AppendStringToCharVec(tbl.comment, column_data[8], 23);
-
-    tbl.rows++;
-  }
+  tbl.rows = rows;
 
   for (size_t i = 0; i < kPaddingRows; i++) {
-    tbl.partkey.push_back(0);
-    AppendStringToCharVec(tbl.name, "INVALID", 55);
+    TblToChars(tbl.name, tbl.rows + i, 55, "INVALID");
   }
 
   std::cout << "Finished parsing PARTS table with " << tbl.rows << " rows\n";
@@ -321,37 +303,37 @@ bool Database::ParsePartsTable(std::string f, PartsTable& tbl) {
 bool Database::ParseSupplierTable(std::string f, SupplierTable& tbl) {
   std::cout << "Parsing SUPPLIER table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 7,
+      [&](size_t rows) {
+        const size_t padded_rows = rows + kPaddingRows;
+        tbl.suppkey.assign(padded_rows, 0);
+        tbl.name.resize(padded_rows * 25);
+        tbl.address.resize(rows * 40);
+        tbl.nationkey.assign(padded_rows, 0);
+        tbl.phone.resize(rows * 15);
+        tbl.acctbal.assign(padded_rows, 0);
+        tbl.comment.resize(rows * 101);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.suppkey[r] = TblToInt(column_data[0]);
+        TblToChars(tbl.name, r, 25, column_data[1]);
+        TblToChars(tbl.address, r, 40, column_data[2]);
+        tbl.nationkey[r] = (unsigned char)(TblToInt(column_data[3]));
+        TblToChars(tbl.phone, r, 15, column_data[4]);
+        tbl.acctbal[r] = TblToCents(column_data[5]);
+        TblToChars(tbl.comment, r, 101, column_data[6]);
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse SUPPLIER table\n";
     return false;
   }
-
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 7);
-
-    tbl.suppkey.push_back(std::stoll(column_data[0]));
-    AppendStringToCharVec(tbl.name, column_data[1], 25);
-    AppendStringToCharVec(tbl.address, column_data[2], 40);
-    tbl.nationkey.push_back((unsigned char)(std::stoul(column_data[3])));
-    AppendStringToCharVec(tbl.phone, column_data[4], 15);
-    tbl.acctbal.push_back(MoneyFloatToCents(column_data[5]));
-    AppendStringToCharVec(tbl.comment, column_data[6], 101);
-
-    tbl.rows++;
-  }
+  tbl.rows = rows;
 
   for (size_t i = 0; i < kPaddingRows; i++) {
-    tbl.suppkey.push_back(0);
-    AppendStringToCharVec(tbl.name, "INVALID", 25);
-    tbl.nationkey.push_back(0);
-    tbl.acctbal.push_back(0);
+    TblToChars(tbl.name, tbl.rows + i, 25, "INVALID");
   }
 
   std::cout << "Finished parsing SUPPLIER table with " << tbl.rows << " rows\n";
@@ -365,36 +347,30 @@ bool Database::ParseSupplierTable(std::string f, SupplierTable& tbl) {
 bool Database::ParsePartSupplierTable(std::string f, PartSupplierTable& tbl) {
   std::cout << "Parsing PARTSUPPLIER table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 5,
+      [&](size_t rows) {
+        const size_t padded_rows = rows + kPaddingRows;
+        tbl.partkey.assign(padded_rows, 0);
+        tbl.suppkey.assign(padded_rows, 0);
+        tbl.availqty.assign(padded_rows, 0);
+        tbl.supplycost.assign(padded_rows, 0);
+        tbl.comment.resize(rows * 199);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.partkey[r] = TblToInt(column_data[0]);
+        tbl.suppkey[r] = TblToInt(column_data[1]);
+        tbl.availqty[r] = TblToInt(column_data[2]);
+        tbl.supplycost[r] = TblToCents(column_data[3]);
+        TblToChars(tbl.comment, r, 199, column_data[4]);
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse PARTSUPPLIER table\n";
     return false;
   }
-
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 5);
-
-    tbl.partkey.push_back(std::stoll(column_data[0]));
-    tbl.suppkey.push_back(std::stoll(column_data[1]));
-    tbl.availqty.push_back(std::stoi(column_data[2]));
-    tbl.supplycost.push_back(MoneyFloatToCents(column_data[3]));
-    AppendStringToCharVec(tbl.comment, column_data[4], 199);
-
-    tbl.rows++;
-  }
-
-  for (size_t i = 0; i < kPaddingRows; i++) {
-    tbl.partkey.push_back(0);
-    tbl.suppkey.push_back(0);
-    tbl.availqty.push_back(0);
-    tbl.supplycost.push_back(0);
-  }
+  tbl.rows = rows;
 
   std::cout << "Finished parsing PARTSUPPLIER table with " << tbl.rows
             << " rows\n";
@@ -408,41 +384,43 @@ bool Database::ParsePartSupplierTable(std::string f, PartSupplierTable& tbl) {
 bool Database::ParseNationTable(std::string f, NationTable& tbl) {
   std::cout << "Parsing NATION table from: " << f << "\n";
 
-  // populate data row by row (as presented in the file)
-  std::ifstream ifs(f);
-  std::string line;
-  tbl.rows = 0;
-
-  if (!ifs.is_open()) {
+  long long rows = ParseTblParallel(
+      f, 4,
+      [&](size_t rows) {
+        tbl.nationkey.assign(rows, 0);
+        tbl.name.resize(rows * kNationNameSize);
+        tbl.regionkey.assign(rows, 0);
+        tbl.comment.resize(rows * 152);
+      },
+      [&](const TblRow& column_data, size_t r) {
+        tbl.nationkey[r] = TblToInt(column_data[0]);
+
+        // convention: all upper case, no leading or trailing whitespace
+        std::string_view nationname = column_data[1];
+        while (!nationname.empty() && std::isspace(nationname.front())) {
+          nationname.remove_prefix(1);
+        }
+        while (!nationname.empty() && std::isspace(nationname.back())) {
+          nationname.remove_suffix(1);
+        }
+        TblToChars(tbl.name, r, kNationNameSize, nationname);
+        std::transform(&tbl.name[r * kNationNameSize],
+                       &tbl.name[r * kNationNameSize] + kNationNameSize,
+                       &tbl.name[r * kNationNameSize], ::toupper);
+
+        tbl.regionkey[r] = TblToInt(column_data[2]);
+        TblToChars(tbl.comment, r, 152, column_data[3]);
+        return true;
+      });
+
+  if (rows < 0) {
     std::cout << "Failed to parse NATION table\n";
     return false;
   }
+  tbl.rows = rows;
 
-  while (std::getline(ifs, line)) {
-    // split row into column strings by separator ('|')
-    std::vector<std::string> column_data = SplitRowStr(line);
-    assert(column_data.size() == 4);
-
-    DBIdentifier nationkey = std::stoll(column_data[0]);
-    std::string nationname = column_data[1];
-
-    tbl.nationkey.push_back(nationkey);
-
-    // convention: all upper case
-    trim(nationname);
-    transform(nationname.begin(), nationname.end(), nationname.begin(),
-              ::toupper);
-    AppendStringToCharVec(tbl.name, nationname, 25);
-
-    tbl.regionkey.push_back(std::stoll(column_data[2]));
-    AppendStringToCharVec(tbl.comment, column_data[3], 152);
-
-    // add entry into map
-    tbl.name_key_map[nationname] = nationkey;
-    tbl.key_name_map[nationkey] = nationname;
-
-    tbl.rows++;
-  }
+  // add the entries into the maps
+  tbl.BuildNameMaps();
 
   std::cout << "Finished parsing NATION table with " << tbl.rows << " rows\n";
 
@@ -450,39 +428,64 @@ bool Database::ParseNationTable(std::string f, NationTable& tbl) {
 }
 
 //
-// Checks the size of each parsed table against the expected size based
-// on the selected scale factor
+// build the name <-> key maps from the name column
 //
-bool Database::ValidateSF() {
-  bool ret = true;
+void NationTable::BuildNameMaps() {
+  name_key_map.clear();
+  for (size_t i = 0; i < rows; i++) {
+    const char* name_ptr = &name[i * kNationNameSize];
+    std::string nationname(
+        name_ptr, std::find(name_ptr, name_ptr + kNationNameSize, '\0'));
+    name_key_map[nationname] = nationkey[i];
+    key_name_map[nationkey[i]] = nationname;
+  }
+}
 
-  if (l.rows != kLineItemTableSize) {
-    std::cerr << "LineItem table size has " << l.rows << " rows"
-              << " when it should have " << kLineItemTableSize << "\n";
-    ret = false;
+//
+// Detects the scale factor of the parsed database and checks the size of
+// each table against it. The SUPPLIER table has exactly SF*10000 rows, the
+// other tables (except LINEITEM) are strict multiples of the scale factor.
+//
+bool Database::ValidateSF() {
+  if (s.rows == 0) {
+    std::cerr << "Supplier table is empty\n";
+    return false;
   }
 
-  if (o.rows != kOrdersTableSize) {
+  sf = static_cast<double>(s.rows) / kSupplierRowsPerSF;
+
+  auto expected_rows = [&](int rows_per_sf) {
+    return static_cast<size_t>(std::llround(sf * rows_per_sf));
+  };
+
+  bool ret = true;
+
+  if (o.rows != expected_rows(kOrdersRowsPerSF)) {
     std::cerr << "Orders table size has " << o.rows << " rows"
-              << " when it should have " << kOrdersTableSize << "\n";
+              << " when it should have " << expected_rows(kOrdersRowsPerSF)
+              << "\n";
     ret = false;
   }
 
-  if (p.rows != kPartTableSize) {
-    std::cerr << "Parts table size has " << p.rows << " rows"
-              << " when it should have " << kPartTableSize << "\n";
+  // every order has between 1 and 7 line items
+  if (l.rows < o.rows || l.rows > 7 * o.rows) {
+    std::cerr << "LineItem table size has " << l.rows << " rows"
+              << " when it should have between " << o.rows << " and "
+              << 7 * o.rows << "\n";
     ret = false;
   }
 
-  if (s.rows != kSupplierTableSize) {
-    std::cerr << "Supplier table size has " << s.rows << " rows"
-              << " when it should have " << kSupplierTableSize << "\n";
+  if (p.rows != expected_rows(kPartRowsPerSF)) {
+    std::cerr << "Parts table size has " << p.rows << " rows"
+              << " when it should have " << expected_rows(kPartRowsPerSF)
+              << "\n";
     ret = false;
   }
 
-  if (ps.rows != kPartSupplierTableSize) {
+  if (ps.rows != expected_rows(kPartSupplierRowsPerSF)) {
     std::cerr << "PartSupplier table size has " << ps.rows << " rows"
-              << " when it should have " << kPartSupplierTableSize << "\n";
+              << " when it should have "
+              << expected_rows(kPartSupplierRowsPerSF) << "\n";
     ret = false;
   }
 
@@ -495,6 +498,29 @@ bool Database::ValidateSF() {
   return ret;
 }
 
+//
+// Checks that the parsed database fits in the on-chip data structures of
+// 'query', which are sized at compile time for a scale factor of kSF
+//
+bool Database::FitsOnChip(unsigned int query) {
+  bool fits = true;
+
+  if (query == 9 || query == 11) {
+    fits &= (p.rows <= kPartTableSize) && (s.rows <= kSupplierTableSize);
+  }
+  if (query == 9) {
+    fits &= (l.rows <= kLineItemTableSize);
+  }
+
+  if (!fits) {
+    std::cerr << "ERROR: query " << query << " was compiled for a database "
+              << "with a scale factor of at most " << kSF << ", but the "
+              << "database has a scale factor of " << sf << "\n";
+  }
+
+  return fits;
+}
+
 //
 // validate the results of Query 1
 //
@@ -564,7 +590,7 @@ bool Database::ValidateQ1(std::string db_root_dir,
     double sum_disc_price_res =
         (double)(sum_disc_price[idx]) / (100.00 * 100.00);
     double sum_charge_res =
-        (double)(sum_charge[idx]) / (100.00 * 100.00 * 100.00);
+        (double)(sum_charge[idx]) / (100.00 * 100.00);
     double avg_qty_res = (double)(avg_qty[idx]);
     double avg_price_res = (double)(avg_price[idx]) / (100.00);
     double avg_disc_res = (double)(avg_discount[idx]) / (100.00);
@@ -834,7 +860,7 @@ void Database::PrintQ1(std::array<DBDecimal, 3 * 2>& sum_qty,
       std::cout << rf[rf_idx] << "|" << ls[ls_idx] << "|" << sum_qty[i] << "|"
                 << (double)(sum_base_price[i]) / 100.0 << "|"
                 << (double)(sum_disc_price[i]) / (100.00 * 100.00) << "|"
-                << (double)(sum_charge[i]) / (100.00 * 100.00 * 100.00) << "|"
+                << (double)(sum_charge[i]) / (100.00 * 100.00) << "|"
                 << avg_qty[i] << "|" << (double)(avg_price[i]) / 100.0 << "|"
                 << (double)(avg_discount[i]) / 100.0 << "|" << count[i] << "\n";
     }
@@ -15,11 +15,17 @@ using DBInt = unsigned int;
 using DBDecimal = long long;
 using DBDate = unsigned int;
 
-// Set the scale factor
+// Set the scale factor of the on-chip data structures
 //
-// The default (and only option) scale factor for
-// emulation is 0.01; a scale factor of 1 for emulation
-// takes far too long.
+// The size of the tables is detected at runtime from the parsed database
+// files (see Database::ValidateSF), so the same binary can process databases
+// of any scale factor. However, queries 9 and 11 keep per-PART and
+// per-SUPPLIER state in on-chip memory, which is sized at compile time for a
+// database of at most kSF. Queries 1 and 12 stream the tables and do not
+// depend on kSF.
+//
+// The default scale factor for emulation is 0.01; a scale factor of 1 for
+// emulation takes far too long.
 //
 // The default scale factor for hardware is 1. However,
 // the SF_SMALL flag allows the hardware design to be compiled
@@ -36,24 +42,30 @@ constexpr float kSF = 1.0f;
 // 16 was chosen because it is the largest access granularity
 constexpr size_t kPaddingRows = 16;
 
-// ensure the selected scale factor is supported
-static_assert((kSF == 0.01f || kSF == 1.0f), "Unsupported Scale Factor (kSF)");
-
-// table sizes based on the Scale Factor (kSF)
-constexpr int kPartTableSize = kSF * 200000;
-constexpr int kPartSupplierTableSize = kSF * 800000;
-constexpr int kOrdersTableSize = kSF * 1500000;
-constexpr int kSupplierTableSize = kSF * 10000;
-constexpr int kCustomerTableSize = kSF * 150000;
-
-// LINEITEM table is not a strict multiple of kSF
+// the number of rows of each table per unit of scale factor
+constexpr int kPartRowsPerSF = 200000;
+constexpr int kPartSupplierRowsPerSF = 800000;
+constexpr int kOrdersRowsPerSF = 1500000;
+constexpr int kSupplierRowsPerSF = 10000;
+constexpr int kCustomerRowsPerSF = 150000;
+
+// the maximum table sizes supported by the on-chip data structures, based on
+// the Scale Factor (kSF)
+constexpr int kPartTableSize = kSF * kPartRowsPerSF;
+constexpr int kPartSupplierTableSize = kSF * kPartSupplierRowsPerSF;
+constexpr int kOrdersTableSize = kSF * kOrdersRowsPerSF;
+constexpr int kSupplierTableSize = kSF * kSupplierRowsPerSF;
+constexpr int kCustomerTableSize = kSF * kCustomerRowsPerSF;
+
+// LINEITEM table is not a strict multiple of kSF. For the scale factors
+// other than 0.01 and 1, this is an upper bound on the table size.
 constexpr int LineItemTableSizeFnc() {
   if (kSF == 0.01f) {
     return 60175;
   } else if (kSF == 1.0f) {
     return 6001215;
   } else {
-    return 0;  // error, should be caught by kSF static_assert
+    return kSF * 6001500;
   }
 }
 
@@ -65,6 +77,9 @@ constexpr int kLineStatusSize = 2;
 constexpr int kReturnFlagSize = 3;
 constexpr int kQuery1OutSize = kReturnFlagSize * kLineStatusSize;
 
+// width of the fixed-size NATION name column
+constexpr int kNationNameSize = 25;
+
 // helpers
 DBDate DateFromString(std::string& date_str);
 int ShipmodeStrToInt(std::string& shipmode_str);
@@ -155,6 +170,9 @@ struct NationTable {
   std::unordered_map<std::string, unsigned char> name_key_map;
   std::array<std::string, kNationTableSize> key_name_map;
   size_t rows;
+
+  // (re)build name_key_map and key_name_map from the name column
+  void BuildNameMaps();
 };
 
 // the database
@@ -166,10 +184,23 @@ struct Database {
   PartSupplierTable ps;
   NationTable n;
 
-  bool Parse(std::string db_root_dir);
+  // the scale factor of the parsed database (see ValidateSF)
+  double sf = 0;
+
+  // parses the database in 'db_root_dir'. If 'use_snapshot' is set and a
+  // columnar snapshot ('*.dbc', see dbsnapshot.hpp) of every table exists,
+  // it is loaded instead of the '*.tbl' files. A snapshot that is out of date
+  // with the '*.tbl' files is rebuilt from them.
+  bool Parse(std::string db_root_dir, bool use_snapshot = true);
+
+  // columnar snapshot functions (dbsnapshot.cpp)
+  bool HasSnapshot(std::string dir);
+  bool WriteSnapshot(std::string dir, std::string tbl_dir);
+  bool LoadSnapshot(std::string dir);
 
   // validation functions
   bool ValidateSF();
+  bool FitsOnChip(unsigned int query);
 
   bool ValidateQ1(std::string db_root_dir,
                   std::array<DBDecimal, 3 * 2>& sum_qty,
@@ -0,0 +1,267 @@
+#ifndef __DBPARSER_HPP__
+#define __DBPARSER_HPP__
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "db_utils/Date.hpp"
+#include "dbdata.hpp"
+
+//
+// Parallel, allocation-free parser for the TPC-H '*.tbl' files.
+//
+// The file is read into memory once and split into newline-aligned ranges
+// that are parsed concurrently. A first pass counts the rows of every range
+// so that the column vectors can be sized up front and every thread knows the
+// index of its first row. The second pass splits each row on its '|'
+// separators (16 bytes at a time with SSE2, when available) and converts the
+// fields in place from the file buffer, writing straight into the columns.
+//
+
+// the maximum number of columns in any table (LINEITEM)
+constexpr size_t kMaxTblColumns = 16;
+
+// don't bother splitting files smaller than this across threads
+constexpr size_t kMinBytesPerThread = 1 << 20;
+
+// the fields of a single row, pointing into the file buffer
+using TblRow = std::array<std::string_view, kMaxTblColumns>;
+
+//
+// find the first '|' or '\n' in [p, end), or 'end' if there is none
+//
+inline const char* FindFieldEnd(const char* p, const char* end) {
+#if defined(__SSE2__)
+  const __m128i bar = _mm_set1_epi8('|');
+  const __m128i newline = _mm_set1_epi8('\n');
+  while (end - p >= 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, bar),
+                                              _mm_cmpeq_epi8(bytes, newline)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#endif
+  while (p < end && *p != '|' && *p != '\n') {
+    p++;
+  }
+  return p;
+}
+
+//
+// split the row starting at 'p' into 'fields'. Returns the number of fields
+// and sets 'p' to the start of the next row.
+//
+inline size_t SplitTblRow(const char*& p, const char* end, TblRow& fields) {
+  size_t n = 0;
+  while (p < end) {
+    const char* field_end = FindFieldEnd(p, end);
+    bool end_of_row = (field_end == end || *field_end == '\n');
+
+    // a trailing '|' at the end of the row does not start a new field
+    std::string_view field(p, field_end - p);
+    if (end_of_row && !field.empty() && field.back() == '\r') {
+      field.remove_suffix(1);
+    }
+    if (!(end_of_row && field.empty() && n > 0)) {
+      if (n < kMaxTblColumns) {
+        fields[n] = field;
+      }
+      n++;
+    }
+
+    p = (field_end == end) ? end : field_end + 1;
+    if (end_of_row) {
+      break;
+    }
+  }
+  return n;
+}
+
+//
+// field conversions from the text of a '.tbl' field to the column types.
+// They convert in place from the file buffer, without allocating.
+//
+inline long long TblToInt(std::string_view s) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < s.size() && (s[i] == '-' || s[i] == '+')) {
+    negative = (s[i] == '-');
+    i++;
+  }
+  long long val = 0;
+  for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++) {
+    val = val * 10 + (s[i] - '0');
+  }
+  return negative ? -val : val;
+}
+
+// money string (i.e. '1209.12' dollars) to cents (i.e. '120912' cents)
+inline DBDecimal TblToCents(std::string_view s) {
+  size_t dot = s.find('.');
+  bool negative = (!s.empty() && s[0] == '-');
+  DBDecimal dollars = TblToInt(s.substr(0, dot));
+  DBDecimal cents = 0;
+  if (dot != std::string_view::npos) {
+    std::string_view cents_str = s.substr(dot + 1, 2);
+    cents = TblToInt(cents_str) * (cents_str.size() == 1 ? 10 : 1);
+  }
+  return dollars * 100 + (negative ? -cents : cents);
+}
+
+// 'YYYY-MM-DD' to the compact date format (see Date::ToCompact)
+inline DBDate TblToDate(std::string_view s) {
+  size_t dash1 = s.find('-');
+  size_t dash2 = s.find('-', dash1 + 1);
+  int y = TblToInt(s.substr(0, dash1));
+  int m = TblToInt(s.substr(dash1 + 1, dash2 - dash1 - 1));
+  int d = TblToInt(s.substr(dash2 + 1));
+  return Date(y, m, d).ToCompact();
+}
+
+// the SHIPMODE string to the internal representation (see ShipmodeStrToInt),
+// or -1 if the string is not a known SHIPMODE
+inline int TblToShipmode(std::string_view s) {
+  static constexpr std::array<std::string_view, 7> kShipmodes = {
+      "REG AIR", "AIR", "RAIL", "SHIP", "TRUCK", "MAIL", "FOB"};
+  for (size_t i = 0; i < kShipmodes.size(); i++) {
+    if (s == kShipmodes[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+//
+// copy a field into the fixed-width slot 'row' of a character column,
+// padding with null terminators ('\0')
+//
+inline void TblToChars(std::vector<char>& col, size_t row, size_t width,
+                       std::string_view s) {
+  char* dst = col.data() + row * width;
+  size_t n = std::min(width, s.size());
+  std::memcpy(dst, s.data(), n);
+  std::memset(dst + n, 0, width - n);
+}
+
+//
+// Parse the table in file 'f' with 'num_columns' columns.
+//  'resize(rows)' is called once with the number of rows in the file and must
+//    size every column of the table
+//  'parse_row(fields, row)' is called (concurrently) for every row and
+//    returns false (after printing an error) if a field fails to convert
+// Returns the number of rows parsed, or -1 on failure.
+//
+template <typename ResizeFunc, typename RowFunc>
+long long ParseTblParallel(const std::string& f, size_t num_columns,
+                           ResizeFunc&& resize, RowFunc&& parse_row) {
+  // read the whole file
+  std::ifstream ifs(f, std::ios::binary | std::ios::ate);
+  if (!ifs.is_open()) {
+    return -1;
+  }
+  std::vector<char> data(static_cast<size_t>(ifs.tellg()));
+  ifs.seekg(0);
+  ifs.read(data.data(), data.size());
+  if (!ifs.good()) {
+    return -1;
+  }
+  const char* begin = data.data();
+  const char* end = begin + data.size();
+
+  // split the file into newline-aligned chunks
+  size_t hw_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t num_chunks =
+      std::max<size_t>(1, std::min(hw_threads, data.size() / kMinBytesPerThread));
+  std::vector<const char*> bounds(num_chunks + 1);
+  bounds[0] = begin;
+  bounds[num_chunks] = end;
+  for (size_t c = 1; c < num_chunks; c++) {
+    const char* p = begin + (data.size() * c) / num_chunks;
+    p = std::max(p, bounds[c - 1]);
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    bounds[c] = (nl == nullptr) ? end : nl + 1;
+  }
+
+  // run 'func(chunk)' for every chunk on its own thread
+  auto for_each_chunk = [&](auto&& func) {
+    std::vector<std::thread> threads;
+    for (size_t c = 1; c < num_chunks; c++) {
+      threads.emplace_back(func, c);
+    }
+    func(0);
+    for (auto& t : threads) {
+      t.join();
+    }
+  };
+
+  // pass 1: count the (non-empty) rows of every chunk
+  std::vector<size_t> chunk_rows(num_chunks + 1, 0);
+  for_each_chunk([&](size_t c) {
+    size_t rows = 0;
+    const char* p = bounds[c];
+    while (p < bounds[c + 1]) {
+      const char* nl =
+          static_cast<const char*>(std::memchr(p, '\n', bounds[c + 1] - p));
+      const char* row_end = (nl == nullptr) ? bounds[c + 1] : nl;
+      if (row_end > p && !(row_end - p == 1 && *p == '\r')) {
+        rows++;
+      }
+      p = row_end + 1;
+    }
+    chunk_rows[c + 1] = rows;
+  });
+
+  // the index of the first row of every chunk
+  for (size_t c = 1; c <= num_chunks; c++) {
+    chunk_rows[c] += chunk_rows[c - 1];
+  }
+  const size_t total_rows = chunk_rows[num_chunks];
+  resize(total_rows);
+
+  // pass 2: split and convert the rows
+  std::atomic<bool> success(true);
+  for_each_chunk([&](size_t c) {
+    TblRow fields;
+    size_t row = chunk_rows[c];
+    const char* p = bounds[c];
+    while (p < bounds[c + 1] && success) {
+      const char* row_start = p;
+      size_t n = SplitTblRow(p, bounds[c + 1], fields);
+      if (n == 0 || (n == 1 && fields[0].empty())) {
+        continue;
+      }
+      if (n != num_columns) {
+        std::cerr << "ERROR: row " << row << " of " << f << " has " << n
+                  << " columns (expected " << num_columns << "): '"
+                  << std::string(row_start, p - row_start) << "'\n";
+        success = false;
+        break;
+      }
+      if (!parse_row(fields, row)) {
+        success = false;
+        break;
+      }
+      row++;
+    }
+  });
+
+  return success ? static_cast<long long>(total_rows) : -1;
+}
+
+#endif /* __DBPARSER_HPP__ */
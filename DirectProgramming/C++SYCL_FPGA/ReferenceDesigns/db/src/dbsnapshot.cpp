@@ -0,0 +1,394 @@
+//==============================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(WIN32) || defined(_WIN32) || defined(_MSC_VER)
+#define DB_SNAPSHOT_NO_MMAP
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dbdata.hpp"
+#include "dbsnapshot.hpp"
+
+// choose a file separator based on the platform (Windows or Linux)
+#if defined(WIN32) || defined(_WIN32) || defined(_MSC_VER)
+constexpr char kSeparator = '\\';
+#else
+constexpr char kSeparator = '/';
+#endif
+
+//
+// round 'x' up to the next multiple of 'a'
+//
+static uint64_t AlignUp(uint64_t x, uint64_t a) {
+  return ((x + a - 1) / a) * a;
+}
+
+//
+// get the size and modification time of the '.tbl' file 'path'
+//
+bool GetSnapshotSource(const std::string& path, SnapshotSource& source) {
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  source.size = size;
+  source.mtime = mtime.time_since_epoch().count();
+  return true;
+}
+
+//
+// write all columns of the table to 'path'
+//
+bool SnapshotWriter::Write(const std::string& path) const {
+  std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+  if (!ofs.is_open()) {
+    std::cerr << "ERROR: could not open " << path << " for writing\n";
+    return false;
+  }
+
+  SnapshotHeader header = {};
+  std::copy(std::begin(kSnapshotMagic), std::end(kSnapshotMagic),
+            header.magic);
+  header.version = kSnapshotVersion;
+  header.num_columns = columns_.size();
+  header.rows = rows_;
+  header.source_size = source_.size;
+  header.source_mtime = source_.mtime;
+
+  // compute the (aligned) location of every column in the file
+  std::vector<SnapshotColumn> descs(columns_.size());
+  uint64_t offset = AlignUp(sizeof(SnapshotHeader) +
+                                columns_.size() * sizeof(SnapshotColumn),
+                            kSnapshotAlignment);
+  for (size_t i = 0; i < columns_.size(); i++) {
+    descs[i].offset = offset;
+    descs[i].elements = columns_[i].elements;
+    descs[i].elem_size = columns_[i].elem_size;
+    descs[i].reserved = 0;
+    offset = AlignUp(offset + columns_[i].elements * columns_[i].elem_size,
+                     kSnapshotAlignment);
+  }
+
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(descs.data()),
+            descs.size() * sizeof(SnapshotColumn));
+
+  // write the column data, padding with zeros up to each column's offset
+  const std::vector<char> zeros(kSnapshotAlignment, 0);
+  for (size_t i = 0; i < columns_.size(); i++) {
+    uint64_t pos = static_cast<uint64_t>(ofs.tellp());
+    ofs.write(zeros.data(), descs[i].offset - pos);
+    ofs.write(columns_[i].data, columns_[i].elements * columns_[i].elem_size);
+  }
+
+  if (!ofs.good()) {
+    std::cerr << "ERROR: failed writing snapshot " << path << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+//
+// map the snapshot file into memory and validate its header
+//
+bool SnapshotReader::Open(const std::string& path) {
+  Close();
+
+#if defined(DB_SNAPSHOT_NO_MMAP)
+  std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+  if (!ifs.is_open()) {
+    return false;
+  }
+  size_ = static_cast<size_t>(ifs.tellg());
+  file_data_.resize(size_);
+  ifs.seekg(0);
+  ifs.read(file_data_.data(), size_);
+  if (!ifs.good()) {
+    Close();
+    return false;
+  }
+  base_ = file_data_.data();
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+
+  void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    size_ = 0;
+    return false;
+  }
+
+  // every column is read exactly once from start to end. The madvise advice
+  // values are not flags, so each one needs its own call. They are only
+  // hints, so a failure is reported but does not stop the load.
+  if (madvise(addr, size_, MADV_SEQUENTIAL) != 0) {
+    std::cerr << "WARNING: madvise(MADV_SEQUENTIAL) failed for " << path
+              << ": " << std::strerror(errno) << "\n";
+  }
+  if (madvise(addr, size_, MADV_WILLNEED) != 0) {
+    std::cerr << "WARNING: madvise(MADV_WILLNEED) failed for " << path
+              << ": " << std::strerror(errno) << "\n";
+  }
+  base_ = static_cast<const char*>(addr);
+#endif
+
+  if (size_ < sizeof(SnapshotHeader)) {
+    Close();
+    return false;
+  }
+
+  std::copy(base_, base_ + sizeof(SnapshotHeader),
+            reinterpret_cast<char*>(&header_));
+
+  if (!std::equal(std::begin(kSnapshotMagic), std::end(kSnapshotMagic),
+                  header_.magic) ||
+      header_.version != kSnapshotVersion ||
+      size_ < sizeof(SnapshotHeader) +
+                  header_.num_columns * sizeof(SnapshotColumn)) {
+    std::cerr << "ERROR: " << path << " is not a valid database snapshot\n";
+    Close();
+    return false;
+  }
+
+  next_column_ = 0;
+  return true;
+}
+
+//
+// unmap the snapshot file
+//
+void SnapshotReader::Close() {
+#if defined(DB_SNAPSHOT_NO_MMAP)
+  file_data_.clear();
+  file_data_.shrink_to_fit();
+#else
+  if (base_ != nullptr) {
+    munmap(const_cast<char*>(base_), size_);
+  }
+#endif
+  base_ = nullptr;
+  size_ = 0;
+  header_ = {};
+  next_column_ = 0;
+}
+
+//
+// get the descriptor of the next column, checking it against the expected
+// element size and the bounds of the file
+//
+const SnapshotColumn* SnapshotReader::NextColumn(size_t elem_size) {
+  if (base_ == nullptr || next_column_ >= header_.num_columns) {
+    return nullptr;
+  }
+
+  const SnapshotColumn* desc = reinterpret_cast<const SnapshotColumn*>(
+      base_ + sizeof(SnapshotHeader)) + next_column_;
+  next_column_++;
+
+  if (desc->elem_size != elem_size ||
+      desc->offset + desc->elements * desc->elem_size > size_) {
+    return nullptr;
+  }
+
+  return desc;
+}
+
+//
+// The columns of each table, in the order they are stored in the snapshot.
+// 'f' is called once per column vector, so the same list is used for reading
+// and writing.
+//
+template <typename F>
+void ForEachColumn(LineItemTable& t, F&& f) {
+  f(t.orderkey); f(t.partkey); f(t.suppkey); f(t.linenumber);
+  f(t.quantity); f(t.extendedprice); f(t.discount); f(t.tax);
+  f(t.returnflag); f(t.linestatus);
+  f(t.shipdate); f(t.commitdate); f(t.receiptdate);
+  f(t.shipinstruct); f(t.shipmode); f(t.comment);
+}
+
+template <typename F>
+void ForEachColumn(OrdersTable& t, F&& f) {
+  f(t.orderkey); f(t.custkey); f(t.orderstatus); f(t.totalprice);
+  f(t.orderdate); f(t.orderpriority); f(t.clerk); f(t.shippriority);
+  f(t.comment);
+}
+
+template <typename F>
+void ForEachColumn(PartsTable& t, F&& f) {
+  f(t.partkey); f(t.name); f(t.mfgr); f(t.brand); f(t.type); f(t.size);
+  f(t.container); f(t.retailprice); f(t.comment);
+}
+
+template <typename F>
+void ForEachColumn(SupplierTable& t, F&& f) {
+  f(t.suppkey); f(t.name); f(t.address); f(t.nationkey); f(t.phone);
+  f(t.acctbal); f(t.comment);
+}
+
+template <typename F>
+void ForEachColumn(PartSupplierTable& t, F&& f) {
+  f(t.partkey); f(t.suppkey); f(t.availqty); f(t.supplycost); f(t.comment);
+}
+
+template <typename F>
+void ForEachColumn(NationTable& t, F&& f) {
+  f(t.nationkey); f(t.name); f(t.regionkey); f(t.comment);
+}
+
+//
+// write a single table snapshot, recording the '.tbl' file 'tbl_path' it was
+// parsed from
+//
+template <typename Table>
+bool WriteTableSnapshot(const std::string& path, const std::string& tbl_path,
+                        Table& tbl) {
+  SnapshotSource source;
+  if (!GetSnapshotSource(tbl_path, source)) {
+    std::cerr << "ERROR: could not stat " << tbl_path << "\n";
+    return false;
+  }
+
+  SnapshotWriter writer(tbl.rows, source);
+  ForEachColumn(tbl, [&](auto& col) { writer.AddColumn(col); });
+  return writer.Write(path);
+}
+
+//
+// load a single table snapshot. The snapshot is rejected if the '.tbl' file
+// 'tbl_path' has changed since it was written. If the '.tbl' file does not
+// exist, the snapshot is the only copy of the table and is loaded as is.
+//
+template <typename Table>
+bool LoadTableSnapshot(const std::string& path, const std::string& tbl_path,
+                       Table& tbl) {
+  SnapshotReader reader;
+  if (!reader.Open(path)) {
+    return false;
+  }
+
+  SnapshotSource source;
+  if (GetSnapshotSource(tbl_path, source) && source != reader.Source()) {
+    std::cout << "WARNING: " << path << " is out of date, " << tbl_path
+              << " has changed since it was written\n";
+    return false;
+  }
+
+  bool success = true;
+  ForEachColumn(tbl, [&](auto& col) { success &= reader.ReadColumn(col); });
+
+  if (!success) {
+    std::cerr << "ERROR: column layout of " << path
+              << " does not match this version of the design\n";
+    return false;
+  }
+
+  tbl.rows = reader.Rows();
+  return true;
+}
+
+//
+// check if a snapshot of every table exists in 'dir'
+//
+bool Database::HasSnapshot(std::string dir) {
+  for (const char* name : {"lineitem", "orders", "part", "supplier",
+                           "partsupp", "nation"}) {
+    std::ifstream ifs(dir + kSeparator + name + kSnapshotExtension);
+    if (!ifs.is_open()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// write the (already parsed) database as a set of '.dbc' files in 'dir'. The
+// tables were parsed from the '.tbl' files in 'tbl_dir'.
+//
+bool Database::WriteSnapshot(std::string dir, std::string tbl_dir) {
+  std::cout << "Writing database snapshot to: " << dir << std::endl;
+
+  auto path = [&](const char* name) {
+    return dir + kSeparator + name + kSnapshotExtension;
+  };
+  auto tbl = [&](const char* name) {
+    return tbl_dir + kSeparator + name + ".tbl";
+  };
+
+  bool success = true;
+  success &= WriteTableSnapshot(path("lineitem"), tbl("lineitem"), l);
+  success &= WriteTableSnapshot(path("orders"), tbl("orders"), o);
+  success &= WriteTableSnapshot(path("part"), tbl("part"), p);
+  success &= WriteTableSnapshot(path("supplier"), tbl("supplier"), s);
+  success &= WriteTableSnapshot(path("partsupp"), tbl("partsupp"), ps);
+  success &= WriteTableSnapshot(path("nation"), tbl("nation"), n);
+
+  return success;
+}
+
+//
+// load the database from the '.dbc' files in 'dir'
+//
+bool Database::LoadSnapshot(std::string dir) {
+  std::cout << "Loading database snapshot from: " << dir << std::endl;
+
+  auto path = [&](const char* name) {
+    return dir + kSeparator + name + kSnapshotExtension;
+  };
+  auto tbl = [&](const char* name) {
+    return dir + kSeparator + name + ".tbl";
+  };
+
+  bool success = true;
+  success &= LoadTableSnapshot(path("lineitem"), tbl("lineitem"), l);
+  success &= LoadTableSnapshot(path("orders"), tbl("orders"), o);
+  success &= LoadTableSnapshot(path("part"), tbl("part"), p);
+  success &= LoadTableSnapshot(path("supplier"), tbl("supplier"), s);
+  success &= LoadTableSnapshot(path("partsupp"), tbl("partsupp"), ps);
+  success &= LoadTableSnapshot(path("nation"), tbl("nation"), n);
+
+  if (!success) {
+    return false;
+  }
+
+  // rebuild the nation name lookup maps from the name column
+  n.BuildNameMaps();
+
+  std::cout << "Loaded snapshot with " << l.rows << " LINEITEM, " << o.rows
+            << " ORDERS, " << p.rows << " PARTS, " << s.rows << " SUPPLIER, "
+            << ps.rows << " PARTSUPPLIER and " << n.rows << " NATION rows\n";
+
+  return true;
+}
@@ -0,0 +1,146 @@
+//==============================================================
+// Copyright Intel Corporation
+//
+// SPDX-License-Identifier: MIT
+// =============================================================
+
+#ifndef __DBSNAPSHOT_HPP__
+#define __DBSNAPSHOT_HPP__
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//
+// Columnar binary snapshot of a database table.
+//
+// Parsing the '.tbl' text files dominates the startup time of the design at
+// large scale factors. A snapshot stores each column of a table exactly as it
+// is laid out in the host vectors (including the padding rows), so loading it
+// is a memory map followed by one copy per column.
+//
+// The header records the size and modification time of the '.tbl' file the
+// snapshot was built from. A snapshot whose source file has changed since
+// (e.g. the tables were regenerated at another scale factor) is not loaded.
+//
+// File layout ('<table>.dbc'):
+//    SnapshotHeader
+//    SnapshotColumn[num_columns]
+//    column data, each column starting on a kSnapshotAlignment boundary
+//
+constexpr char kSnapshotMagic[8] = {'D', 'B', 'C', 'O', 'L', 'S', 'N', 'P'};
+constexpr uint32_t kSnapshotVersion = 2;
+constexpr uint64_t kSnapshotAlignment = 4096;
+constexpr char kSnapshotExtension[] = ".dbc";
+
+//
+// The '.tbl' file a snapshot was built from
+//
+struct SnapshotSource {
+  uint64_t size = 0;   // size of the file in bytes
+  int64_t mtime = 0;   // last modification time, in file clock ticks
+
+  bool operator==(const SnapshotSource& o) const {
+    return size == o.size && mtime == o.mtime;
+  }
+  bool operator!=(const SnapshotSource& o) const { return !(*this == o); }
+};
+
+// get the size and modification time of 'path', returns false if the file
+// does not exist
+bool GetSnapshotSource(const std::string& path, SnapshotSource& source);
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_columns;
+  uint64_t rows;
+  uint64_t source_size;   // see SnapshotSource
+  int64_t source_mtime;
+};
+
+struct SnapshotColumn {
+  uint64_t offset;     // byte offset of the column from the start of the file
+  uint64_t elements;   // number of elements in the column (including padding)
+  uint32_t elem_size;  // sizeof() of a single element
+  uint32_t reserved;
+};
+
+//
+// Collects the columns of a table and writes them to a snapshot file
+//
+class SnapshotWriter {
+ public:
+  SnapshotWriter(size_t rows, const SnapshotSource& source)
+      : rows_(rows), source_(source) {}
+
+  template <typename T>
+  void AddColumn(const std::vector<T>& col) {
+    columns_.push_back({reinterpret_cast<const char*>(col.data()), col.size(),
+                        sizeof(T)});
+  }
+
+  bool Write(const std::string& path) const;
+
+ private:
+  struct ColumnRef {
+    const char* data;
+    size_t elements;
+    size_t elem_size;
+  };
+
+  size_t rows_;
+  SnapshotSource source_;
+  std::vector<ColumnRef> columns_;
+};
+
+//
+// Memory maps a snapshot file and copies its columns, in order, into the
+// host vectors of a table
+//
+class SnapshotReader {
+ public:
+  SnapshotReader() = default;
+  ~SnapshotReader() { Close(); }
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  bool Open(const std::string& path);
+  void Close();
+
+  size_t Rows() const { return header_.rows; }
+  SnapshotSource Source() const {
+    SnapshotSource source;
+    source.size = header_.source_size;
+    source.mtime = header_.source_mtime;
+    return source;
+  }
+
+  // read the next column into 'col', returns false if the column does not
+  // match the type or the layout recorded in the file
+  template <typename T>
+  bool ReadColumn(std::vector<T>& col) {
+    const SnapshotColumn* desc = NextColumn(sizeof(T));
+    if (desc == nullptr) {
+      return false;
+    }
+    col.resize(desc->elements);
+    std::memcpy(col.data(), base_ + desc->offset, desc->elements * sizeof(T));
+    return true;
+  }
+
+ private:
+  const SnapshotColumn* NextColumn(size_t elem_size);
+
+  const char* base_ = nullptr;
+  size_t size_ = 0;
+  SnapshotHeader header_ = {};
+  uint32_t next_column_ = 0;
+#if defined(WIN32) || defined(_WIN32) || defined(_MSC_VER)
+  std::vector<char> file_data_;
+#endif
+};
+
+#endif /* __DBSNAPSHOT_HPP__ */
@@ -0,0 +1,92 @@
+#ifndef __DEVICE_DB_HPP__
+#define __DEVICE_DB_HPP__
+#pragma once
+
+#include <sycl/sycl.hpp>
+
+#include "dbdata.hpp"
+
+using namespace sycl;
+
+//
+// The SYCL buffers for the database columns read by the query kernels.
+//
+// The buffers wrap the host vectors of a (parsed) Database, so a column is
+// only transferred to the device the first time a kernel reads it. Since the
+// kernels only read these buffers, the device copy stays valid for as long as
+// the DeviceDatabase is alive. Reusing one DeviceDatabase across several
+// queries (see the '--queries' session mode in db.cpp) therefore keeps the
+// tables resident on the device.
+//
+// The LINEITEM table can be much larger than the device memory at high scale
+// factors. Queries that support it (query 1) therefore stream LINEITEM through
+// the device in chunks of at most 'lineitem_chunk_rows' rows when the table
+// is larger than that, instead of reading the buffers below.
+//
+// the default maximum number of LINEITEM rows resident on the device at once
+constexpr size_t kDefaultLineItemChunkRows = 1 << 23;
+
+struct DeviceDatabase {
+  explicit DeviceDatabase(
+      Database& db, size_t lineitem_chunk_rows = kDefaultLineItemChunkRows)
+      : lineitem_chunk_rows(lineitem_chunk_rows),
+        l_orderkey(db.l.orderkey),
+        l_partkey(db.l.partkey),
+        l_suppkey(db.l.suppkey),
+        l_quantity(db.l.quantity),
+        l_extendedprice(db.l.extendedprice),
+        l_discount(db.l.discount),
+        l_tax(db.l.tax),
+        l_returnflag(db.l.returnflag),
+        l_linestatus(db.l.linestatus),
+        l_shipdate(db.l.shipdate),
+        l_commitdate(db.l.commitdate),
+        l_receiptdate(db.l.receiptdate),
+        l_shipmode(db.l.shipmode),
+        o_orderkey(db.o.orderkey),
+        o_orderdate(db.o.orderdate),
+        o_orderpriority(db.o.orderpriority),
+        p_name(db.p.name),
+        s_nationkey(db.s.nationkey),
+        ps_partkey(db.ps.partkey),
+        ps_suppkey(db.ps.suppkey),
+        ps_availqty(db.ps.availqty),
+        ps_supplycost(db.ps.supplycost) {}
+
+  // the maximum number of LINEITEM rows streamed to the device at once
+  size_t lineitem_chunk_rows;
+
+  // LINEITEM
+  buffer<DBIdentifier, 1> l_orderkey;
+  buffer<DBIdentifier, 1> l_partkey;
+  buffer<DBIdentifier, 1> l_suppkey;
+  buffer<DBDecimal, 1> l_quantity;
+  buffer<DBDecimal, 1> l_extendedprice;
+  buffer<DBDecimal, 1> l_discount;
+  buffer<DBDecimal, 1> l_tax;
+  buffer<char, 1> l_returnflag;
+  buffer<char, 1> l_linestatus;
+  buffer<DBDate, 1> l_shipdate;
+  buffer<DBDate, 1> l_commitdate;
+  buffer<DBDate, 1> l_receiptdate;
+  buffer<int, 1> l_shipmode;
+
+  // ORDERS
+  buffer<DBIdentifier, 1> o_orderkey;
+  buffer<DBDate, 1> o_orderdate;
+  buffer<int, 1> o_orderpriority;
+
+  // PARTS
+  buffer<char, 1> p_name;
+
+  // SUPPLIER
+  buffer<unsigned char, 1> s_nationkey;
+
+  // PARTSUPPLIER
+  buffer<DBIdentifier, 1> ps_partkey;
+  buffer<DBIdentifier, 1> ps_suppkey;
+  buffer<int, 1> ps_availqty;
+  buffer<DBDecimal, 1> ps_supplycost;
+};
+
+#endif /* __DEVICE_DB_HPP__ */
@@ -1,5 +1,8 @@
 #include <stdio.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "query1_kernel.hpp"
 
 #include "../db_utils/Accumulator.hpp"
@@ -8,6 +11,8 @@
 
 using namespace std::chrono;
 
+namespace query1 {
+
 // how many elements to compute per cycle
 #if defined(FPGA_SIMULATOR)
 constexpr int kElementsPerCycle = 2;
@@ -15,10 +20,336 @@ constexpr int kElementsPerCycle = 2;
 constexpr int kElementsPerCycle = 12;
 #endif
 
-// the kernel name
+static_assert(kElementsPerCycle <= kPaddingRows,
+              "The LINEITEM columns must be padded for kElementsPerCycle");
+
+// the kernel names
 class Query1;
+class Query1Chunk;
+
+// the number of LINEITEM chunk buffers on the device (double buffering)
+constexpr int kChunkBuffers = 2;
+
+// the sums computed for every (returnflag, linestatus) group
+constexpr int kNumSums = 6;
+
+//
+// the per-group accumulators of the query
+//
+struct Query1Accumulators {
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> sum_qty;
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> sum_base_price;
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> sum_disc_price;
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> sum_charge;
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> sum_discount;
+  RegisterAccumulator<DBDecimal, kQuery1OutSize, unsigned char> count;
+
+  void Init() {
+    sum_qty.Init();
+    sum_base_price.Init();
+    sum_disc_price.Init();
+    sum_charge.Init();
+    sum_discount.Init();
+    count.Init();
+  }
+};
+
+//
+// Stream 'rows' rows of the LINEITEM columns (kElementsPerCycle rows at a
+// time) and accumulate them into 'acc'. The columns are either accessors
+// (whole table) or device pointers (chunks of the table).
+//
+template <typename DecimalCol, typename CharCol, typename DateCol>
+void AccumulateRows(size_t rows, DBDate low_date, DecimalCol quantity,
+                    DecimalCol extendedprice, DecimalCol discount_col,
+                    DecimalCol tax_col, CharCol returnflag, CharCol linestatus,
+                    DateCol shipdate_col, Query1Accumulators& acc) {
+  const size_t iters = (rows + kElementsPerCycle - 1) / kElementsPerCycle;
+
+  [[intel::initiation_interval(1)]]
+  for (size_t r = 0; r < iters; r++) {
+    // locals
+    DBDecimal qty[kElementsPerCycle];
+    DBDecimal extendedprice_tmp[kElementsPerCycle];
+    DBDecimal discount[kElementsPerCycle];
+    DBDecimal tax[kElementsPerCycle];
+    DBDecimal disc_price_tmp[kElementsPerCycle];
+    DBDecimal charge_tmp[kElementsPerCycle];
+    DBDecimal count_tmp[kElementsPerCycle];
+    unsigned char out_idx[kElementsPerCycle];
+    bool row_valid[kElementsPerCycle];
+
+    // multiple elements per cycle
+#pragma unroll
+    for (size_t p = 0; p < kElementsPerCycle; ++p) {
+      // is data in range of the table
+      // (data size may not be divisible by kElementsPerCycle)
+      size_t idx = r * kElementsPerCycle + p;
+      bool in_range = idx < rows;
+
+      // get this rows shipdate
+      DBDate shipdate = shipdate_col[idx];
+
+      // determine if the row is valid
+      row_valid[p] = in_range && (shipdate <= low_date);
+
+      // read or set values based on the validity of the data
+      qty[p] = quantity[idx];
+      extendedprice_tmp[p] = extendedprice[idx];
+      discount[p] = discount_col[idx];
+      tax[p] = tax_col[idx];
+      char rf = returnflag[idx];
+      char ls = linestatus[idx];
+      count_tmp[p] = 1;
+
+      // convert returnflag and linestatus into an index
+      unsigned char rf_idx;
+      if (rf == 'R') {
+        rf_idx = 0;
+      } else if (rf == 'A') {
+        rf_idx = 1;
+      } else {  // == 'N'
+        rf_idx = 2;
+      }
+      unsigned char ls_idx;
+      if (ls == 'O') {
+        ls_idx = 0;
+      } else {  // == 'F'
+        ls_idx = 1;
+      }
+      out_idx[p] = ls_idx * kReturnFlagSize + rf_idx;
+
+      // intermediate calculations
+      disc_price_tmp[p] = extendedprice_tmp[p] * (100 - discount[p]);
+
+      // The exact charge is in 1/1000000 dollars, so its 64-bit sum for the
+      // largest group would overflow at about SF=80. It is rounded to the
+      // 1/10000 dollar scale of disc_price, which only overflows at several
+      // thousand SF.
+      charge_tmp[p] = (disc_price_tmp[p] * (100 + tax[p]) + 50) / 100;
+    }
+
+    // reduction accumulation
+#pragma unroll
+    for (size_t p = 0; p < kElementsPerCycle; ++p) {
+      acc.sum_qty.Accumulate(out_idx[p], row_valid[p] ? qty[p] : 0);
+      acc.sum_base_price.Accumulate(out_idx[p],
+                                    row_valid[p] ? extendedprice_tmp[p] : 0);
+      acc.sum_disc_price.Accumulate(out_idx[p],
+                                    row_valid[p] ? disc_price_tmp[p] : 0);
+      acc.sum_charge.Accumulate(out_idx[p], row_valid[p] ? charge_tmp[p] : 0);
+      acc.count.Accumulate(out_idx[p], row_valid[p] ? count_tmp[p] : 0);
+      acc.sum_discount.Accumulate(out_idx[p], row_valid[p] ? discount[p] : 0);
+    }
+  }
+}
+
+//
+// the LINEITEM columns of one chunk on the device
+//
+struct LineItemChunk {
+  DBDecimal* quantity;
+  DBDecimal* extendedprice;
+  DBDecimal* discount;
+  DBDecimal* tax;
+  char* returnflag;
+  char* linestatus;
+  DBDate* shipdate;
+};
+
+}  // namespace query1
+
+using namespace query1;
+
+//
+// Run query 1 by streaming the LINEITEM table through the device in chunks of
+// 'chunk_rows' rows. While the kernel processes one chunk, the next chunk is
+// copied into the other chunk buffer. Every kernel adds its sums to running
+// totals in device memory, from which the averages are computed at the end.
+//
+bool SubmitQuery1Chunked(queue& q, Database& dbinfo, size_t chunk_rows,
+                         DBDate low_date,
+                         std::array<DBDecimal, kQuery1OutSize>& sum_qty,
+                         std::array<DBDecimal, kQuery1OutSize>& sum_base_price,
+                         std::array<DBDecimal, kQuery1OutSize>& sum_disc_price,
+                         std::array<DBDecimal, kQuery1OutSize>& sum_charge,
+                         std::array<DBDecimal, kQuery1OutSize>& avg_qty,
+                         std::array<DBDecimal, kQuery1OutSize>& avg_price,
+                         std::array<DBDecimal, kQuery1OutSize>& avg_discount,
+                         std::array<DBDecimal, kQuery1OutSize>& count,
+                         double& kernel_latency, double& total_latency) {
+  if (!q.get_device().has(aspect::usm_device_allocations)) {
+    std::cerr << "ERROR: streaming LINEITEM in chunks requires USM device "
+                 "allocations\n";
+    return false;
+  }
+
+  const size_t rows = dbinfo.l.rows;
+  const size_t num_chunks = (rows + chunk_rows - 1) / chunk_rows;
+
+  // the chunk buffers are padded, like the host tables
+  const size_t chunk_alloc_rows = chunk_rows + kPaddingRows;
+
+  // allocate the chunk buffers and the running totals on the device
+  LineItemChunk chunks[kChunkBuffers];
+  bool alloc_success = true;
+  for (int b = 0; b < kChunkBuffers; b++) {
+    chunks[b].quantity = malloc_device<DBDecimal>(chunk_alloc_rows, q);
+    chunks[b].extendedprice = malloc_device<DBDecimal>(chunk_alloc_rows, q);
+    chunks[b].discount = malloc_device<DBDecimal>(chunk_alloc_rows, q);
+    chunks[b].tax = malloc_device<DBDecimal>(chunk_alloc_rows, q);
+    chunks[b].returnflag = malloc_device<char>(chunk_alloc_rows, q);
+    chunks[b].linestatus = malloc_device<char>(chunk_alloc_rows, q);
+    chunks[b].shipdate = malloc_device<DBDate>(chunk_alloc_rows, q);
+    alloc_success &=
+        chunks[b].quantity != nullptr && chunks[b].extendedprice != nullptr &&
+        chunks[b].discount != nullptr && chunks[b].tax != nullptr &&
+        chunks[b].returnflag != nullptr && chunks[b].linestatus != nullptr &&
+        chunks[b].shipdate != nullptr;
+  }
+  DBDecimal* totals = malloc_device<DBDecimal>(kNumSums * kQuery1OutSize, q);
+  alloc_success &= totals != nullptr;
+
+  auto free_all = [&]() {
+    for (int b = 0; b < kChunkBuffers; b++) {
+      free(chunks[b].quantity, q);
+      free(chunks[b].extendedprice, q);
+      free(chunks[b].discount, q);
+      free(chunks[b].tax, q);
+      free(chunks[b].returnflag, q);
+      free(chunks[b].linestatus, q);
+      free(chunks[b].shipdate, q);
+    }
+    free(totals, q);
+  };
+
+  if (!alloc_success) {
+    std::cerr << "ERROR: failed to allocate the LINEITEM chunk buffers ("
+              << chunk_rows << " rows per chunk)\n";
+    free_all();
+    return false;
+  }
+
+  // start timer
+  high_resolution_clock::time_point host_start = high_resolution_clock::now();
+
+  event init_event =
+      q.memset(totals, 0, kNumSums * kQuery1OutSize * sizeof(DBDecimal));
+
+  std::vector<std::vector<event>> copy_events(num_chunks);
+  std::vector<event> kernel_events(num_chunks);
 
-bool SubmitQuery1(queue& q, Database& dbinfo, DBDate low_date,
+  // copy chunk 'c' into its chunk buffer, once the kernel that last used the
+  // buffer is done with it
+  auto copy_chunk = [&](size_t c) {
+    LineItemChunk& chunk = chunks[c % kChunkBuffers];
+    const size_t first = c * chunk_rows;
+    const size_t n = std::min(chunk_rows, rows - first);
+
+    std::vector<event> deps;
+    if (c >= kChunkBuffers) {
+      deps.push_back(kernel_events[c - kChunkBuffers]);
+    }
+
+    auto copy = [&](auto* dst, auto& src) {
+      copy_events[c].push_back(
+          q.memcpy(dst, src.data() + first, n * sizeof(*dst), deps));
+    };
+    copy(chunk.quantity, dbinfo.l.quantity);
+    copy(chunk.extendedprice, dbinfo.l.extendedprice);
+    copy(chunk.discount, dbinfo.l.discount);
+    copy(chunk.tax, dbinfo.l.tax);
+    copy(chunk.returnflag, dbinfo.l.returnflag);
+    copy(chunk.linestatus, dbinfo.l.linestatus);
+    copy(chunk.shipdate, dbinfo.l.shipdate);
+  };
+
+  // prime the chunk buffers
+  for (size_t c = 0; c < std::min<size_t>(kChunkBuffers, num_chunks); c++) {
+    copy_chunk(c);
+  }
+
+  for (size_t c = 0; c < num_chunks; c++) {
+    const LineItemChunk chunk = chunks[c % kChunkBuffers];
+    const size_t n = std::min(chunk_rows, rows - c * chunk_rows);
+
+    /////////////////////////////////////////////////////////////////////////
+    //// Query1Chunk Kernel
+    kernel_events[c] = q.submit([&](handler& h) {
+      h.depends_on(copy_events[c]);
+      h.depends_on(c == 0 ? init_event : kernel_events[c - 1]);
+
+      h.single_task<Query1Chunk>([=]() [[intel::kernel_args_restrict]] {
+        Query1Accumulators acc;
+        acc.Init();
+
+        AccumulateRows(n, low_date, chunk.quantity, chunk.extendedprice,
+                       chunk.discount, chunk.tax, chunk.returnflag,
+                       chunk.linestatus, chunk.shipdate, acc);
+
+        // add the sums of this chunk to the running totals
+#pragma unroll
+        for (size_t i = 0; i < kQuery1OutSize; i++) {
+          totals[0 * kQuery1OutSize + i] += acc.sum_qty.Get(i);
+          totals[1 * kQuery1OutSize + i] += acc.sum_base_price.Get(i);
+          totals[2 * kQuery1OutSize + i] += acc.sum_disc_price.Get(i);
+          totals[3 * kQuery1OutSize + i] += acc.sum_charge.Get(i);
+          totals[4 * kQuery1OutSize + i] += acc.sum_discount.Get(i);
+          totals[5 * kQuery1OutSize + i] += acc.count.Get(i);
+        }
+      });
+    });
+    /////////////////////////////////////////////////////////////////////////
+
+    // refill this chunk buffer with the chunk after next while the next
+    // chunk is processed
+    if (c + kChunkBuffers < num_chunks) {
+      copy_chunk(c + kChunkBuffers);
+    }
+  }
+
+  // copy back the totals and compute the averages
+  std::array<DBDecimal, kNumSums * kQuery1OutSize> host_totals;
+  q.memcpy(host_totals.data(), totals, sizeof(host_totals),
+           kernel_events[num_chunks - 1])
+      .wait();
+
+  for (size_t i = 0; i < kQuery1OutSize; i++) {
+    sum_qty[i] = host_totals[0 * kQuery1OutSize + i];
+    sum_base_price[i] = host_totals[1 * kQuery1OutSize + i];
+    sum_disc_price[i] = host_totals[2 * kQuery1OutSize + i];
+    sum_charge[i] = host_totals[3 * kQuery1OutSize + i];
+    count[i] = host_totals[5 * kQuery1OutSize + i];
+
+    avg_qty[i] = (count[i] == 0) ? 0 : (sum_qty[i] / count[i]);
+    avg_price[i] = (count[i] == 0) ? 0 : (sum_base_price[i] / count[i]);
+    avg_discount[i] =
+        (count[i] == 0) ? 0 : (host_totals[4 * kQuery1OutSize + i] / count[i]);
+  }
+
+  high_resolution_clock::time_point host_end = high_resolution_clock::now();
+  duration<double, std::milli> diff = host_end - host_start;
+
+  // gather profiling info from the start of the first kernel to the end of
+  // the last one, which includes any time spent waiting for transfers
+  auto kernel_start_time =
+      kernel_events[0]
+          .get_profiling_info<info::event_profiling::command_start>();
+  auto kernel_end_time =
+      kernel_events[num_chunks - 1]
+          .get_profiling_info<info::event_profiling::command_end>();
+
+  // calculating the kernel execution time in ms
+  kernel_latency = (kernel_end_time - kernel_start_time) * 1e-6;
+  total_latency = diff.count();
+
+  free_all();
+
+  return true;
+}
+
+bool SubmitQuery1(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+                  DBDate low_date,
                   std::array<DBDecimal, kQuery1OutSize>& sum_qty,
                   std::array<DBDecimal, kQuery1OutSize>& sum_base_price,
                   std::array<DBDecimal, kQuery1OutSize>& sum_disc_price,
@@ -28,14 +359,23 @@ bool SubmitQuery1(queue& q, Database& dbinfo, DBDate low_date,
                   std::array<DBDecimal, kQuery1OutSize>& avg_discount,
                   std::array<DBDecimal, kQuery1OutSize>& count,
                   double& kernel_latency, double& total_latency) {
+  // stream LINEITEM in chunks if it is too large to be resident on the device
+  const size_t chunk_rows = ddb.lineitem_chunk_rows;
+  if (chunk_rows > 0 && dbinfo.l.rows > chunk_rows) {
+    return SubmitQuery1Chunked(q, dbinfo, chunk_rows, low_date, sum_qty,
+                               sum_base_price, sum_disc_price, sum_charge,
+                               avg_qty, avg_price, avg_discount, count,
+                               kernel_latency, total_latency);
+  }
+
   // create space for input buffers
-  buffer quantity_buf(dbinfo.l.quantity);
-  buffer extendedprice_buf(dbinfo.l.extendedprice);
-  buffer discount_buf(dbinfo.l.discount);
-  buffer tax_buf(dbinfo.l.tax);
-  buffer returnflag_buf(dbinfo.l.returnflag);
-  buffer linestatus_buf(dbinfo.l.linestatus);
-  buffer shipdate_buf(dbinfo.l.shipdate);
+  auto& quantity_buf = ddb.l_quantity;
+  auto& extendedprice_buf = ddb.l_extendedprice;
+  auto& discount_buf = ddb.l_discount;
+  auto& tax_buf = ddb.l_tax;
+  auto& returnflag_buf = ddb.l_returnflag;
+  auto& linestatus_buf = ddb.l_linestatus;
+  auto& shipdate_buf = ddb.l_shipdate;
 
   // setup the output buffers
   buffer sum_qty_buf(sum_qty);
@@ -47,8 +387,7 @@ bool SubmitQuery1(queue& q, Database& dbinfo, DBDate low_date,
   buffer avg_discount_buf(avg_discount);
   buffer count_buf(count);
 
-  const int rows = dbinfo.l.rows; 
-  const size_t iters = (rows + kElementsPerCycle - 1) / kElementsPerCycle;
+  const size_t rows = dbinfo.l.rows;
 
   // start timer
   high_resolution_clock::time_point host_start = high_resolution_clock::now();
@@ -77,114 +416,31 @@ bool SubmitQuery1(queue& q, Database& dbinfo, DBDate low_date,
 
     h.single_task<Query1>([=]() [[intel::kernel_args_restrict]] {
       // local accumulation buffers
-      RegisterAccumulator<DBDecimal, 6, unsigned char> sum_qty_local;
-      RegisterAccumulator<DBDecimal, 6, unsigned char> sum_base_price_local;
-      RegisterAccumulator<DBDecimal, 6, unsigned char> sum_disc_price_local;
-      RegisterAccumulator<DBDecimal, 6, unsigned char> sum_charge_local;
-      RegisterAccumulator<DBDecimal, 6, unsigned char> avg_discount_local;
-      RegisterAccumulator<DBDecimal, 6, unsigned char> count_local;
+      Query1Accumulators acc;
 
       // initialize the accumulators
-      sum_qty_local.Init();
-      sum_base_price_local.Init();
-      sum_disc_price_local.Init();
-      sum_charge_local.Init();
-      avg_discount_local.Init();
-      count_local.Init();
+      acc.Init();
 
       // stream each row in the DB (kElementsPerCycle rows at a time)
-      [[intel::initiation_interval(1)]]
-      for (size_t r = 0; r < iters; r++) {
-        // locals
-        DBDecimal qty[kElementsPerCycle];
-        DBDecimal extendedprice[kElementsPerCycle];
-        DBDecimal discount[kElementsPerCycle];
-        DBDecimal tax[kElementsPerCycle];
-        DBDecimal disc_price_tmp[kElementsPerCycle];
-        DBDecimal charge_tmp[kElementsPerCycle];
-        DBDecimal count_tmp[kElementsPerCycle];
-        unsigned char out_idx[kElementsPerCycle];
-        bool row_valid[kElementsPerCycle];
-
-        // multiple elements per cycle
-#pragma unroll
-        for (size_t p = 0; p < kElementsPerCycle; ++p) {
-          // is data in range of the table
-          // (data size may not be divisible by kElementsPerCycle)
-          size_t idx = r * kElementsPerCycle + p;
-          bool in_range = idx < rows;
-
-          // get this rows shipdate
-          DBDate shipdate = shipdate_accessor[idx];
-
-          // determine if the row is valid
-          row_valid[p] = in_range && (shipdate <= low_date);
-
-          // read or set values based on the validity of the data
-          qty[p] = quantity_accessor[idx];
-          extendedprice[p] = extendedprice_accessor[idx];
-          discount[p] = discount_accessor[idx];
-          tax[p] = tax_accessor[idx];
-          char rf = returnflag_accessor[idx];
-          char ls = linestatus_accessor[idx];
-          count_tmp[p] = 1;
-
-          // convert returnflag and linestatus into an index
-          unsigned char rf_idx;
-          if (rf == 'R') {
-            rf_idx = 0;
-          } else if (rf == 'A') {
-            rf_idx = 1;
-          } else {  // == 'N'
-            rf_idx = 2;
-          }
-          unsigned char ls_idx;
-          if (ls == 'O') {
-            ls_idx = 0;
-          } else {  // == 'F'
-            ls_idx = 1;
-          }
-          out_idx[p] = ls_idx * kReturnFlagSize + rf_idx;
-
-          // intermediate calculations
-          disc_price_tmp[p] = extendedprice[p] * (100 - discount[p]);
-          charge_tmp[p] =
-              extendedprice[p] * (100 - discount[p]) * (100 + tax[p]);
-        }
-
-        // reduction accumulation
-#pragma unroll
-        for (size_t p = 0; p < kElementsPerCycle; ++p) {
-          sum_qty_local.Accumulate(out_idx[p],
-                                   row_valid[p] ? qty[p] : 0);
-          sum_base_price_local.Accumulate(out_idx[p],
-                                          row_valid[p] ? extendedprice[p] : 0);
-          sum_disc_price_local.Accumulate(out_idx[p],
-                                          row_valid[p] ? disc_price_tmp[p] : 0);
-          sum_charge_local.Accumulate(out_idx[p],
-                                      row_valid[p] ? charge_tmp[p] : 0);
-          count_local.Accumulate(out_idx[p],
-                                 row_valid[p] ? count_tmp[p] : 0);
-          avg_discount_local.Accumulate(out_idx[p],
-                                        row_valid[p] ? discount[p] : 0);
-        }
-      }
+      AccumulateRows(rows, low_date, quantity_accessor, extendedprice_accessor,
+                     discount_accessor, tax_accessor, returnflag_accessor,
+                     linestatus_accessor, shipdate_accessor, acc);
 
 // perform averages and push back to global memory
 #pragma unroll
       for (size_t i = 0; i < kQuery1OutSize; i++) {
-        DBDecimal count = count_local.Get(i);
+        DBDecimal count = acc.count.Get(i);
 
-        sum_qty_accessor[i] = sum_qty_local.Get(i);
-        sum_base_price_accessor[i] = sum_base_price_local.Get(i);
-        sum_disc_price_accessor[i] = sum_disc_price_local.Get(i);
-        sum_charge_accessor[i] = sum_charge_local.Get(i);
+        sum_qty_accessor[i] = acc.sum_qty.Get(i);
+        sum_base_price_accessor[i] = acc.sum_base_price.Get(i);
+        sum_disc_price_accessor[i] = acc.sum_disc_price.Get(i);
+        sum_charge_accessor[i] = acc.sum_charge.Get(i);
 
-        avg_qty_accessor[i] = (count == 0) ? 0 : (sum_qty_local.Get(i) / count);
+        avg_qty_accessor[i] = (count == 0) ? 0 : (acc.sum_qty.Get(i) / count);
         avg_price_accessor[i] =
-            (count == 0) ? 0 : (sum_base_price_local.Get(i) / count);
+            (count == 0) ? 0 : (acc.sum_base_price.Get(i) / count);
         avg_discount_accessor[i] =
-            (count == 0) ? 0 : (avg_discount_local.Get(i) / count);
+            (count == 0) ? 0 : (acc.sum_discount.Get(i) / count);
 
         count_accessor[i] = count;
       }
@@ -6,10 +6,12 @@
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
 #include "../dbdata.hpp"
+#include "../device_db.hpp"
 
 using namespace sycl;
 
-bool SubmitQuery1(queue& q, Database& dbinfo, DBDate low_date,
+bool SubmitQuery1(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+                  DBDate low_date,
                   std::array<DBDecimal, kQuery1OutSize>& sum_qty,
                   std::array<DBDecimal, kQuery1OutSize>& sum_base_price,
                   std::array<DBDecimal, kQuery1OutSize>& sum_disc_price,
@@ -10,6 +10,10 @@
 
 using namespace sycl;
 
+// the types of this query are in their own namespace so that all queries can
+// be compiled into a single program (see the QUERY=ALL build in CMakeLists.txt)
+namespace query11 {
+
 //
 // A single row of the PARTSUPPLIER table
 // with a subset of the columns (needed for this query)
@@ -108,4 +112,6 @@ using ProducePartSupplierPipe =
 using PartSupplierPartsPipe =
   pipe<class PartSupplierPartsPipeClass, SupplierPartSupplierJoinedPipeData>;
 
+}  // namespace query11
+
 #endif /* __PIPE_TYPES_H__ */
@@ -15,6 +15,8 @@
 
 using namespace std::chrono;
 
+namespace query11 {
+
 // kernel class names
 class ProducePartSupplier;
 class JoinPartSupplierParts;
@@ -43,7 +45,12 @@ using SortInPipe = pipe<class SortInputPipe, SortType>;
 using SortOutPipe = pipe<class SortOutputPipe, SortType>;
 ///////////////////////////////////////////////////////////////////////////////
 
-bool SubmitQuery11(queue& q, Database& dbinfo, std::string& nation,
+}  // namespace query11
+
+using namespace query11;
+
+bool SubmitQuery11(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+                    std::string& nation,
                     std::vector<DBIdentifier>& partkeys,
                     std::vector<DBDecimal>& values,
                     double& kernel_latency, double& total_latency) {
@@ -57,13 +64,13 @@ bool SubmitQuery11(queue& q, Database& dbinfo, std::string& nation,
 
   // create space for the input buffers
   // SUPPLIER
-  buffer s_nationkey_buf(dbinfo.s.nationkey);
+  auto& s_nationkey_buf = ddb.s_nationkey;
   
   // PARTSUPPLIER
-  buffer ps_partkey_buf(dbinfo.ps.partkey);
-  buffer ps_suppkey_buf(dbinfo.ps.suppkey);
-  buffer ps_availqty_buf(dbinfo.ps.availqty);
-  buffer ps_supplycost_buf(dbinfo.ps.supplycost);
+  auto& ps_partkey_buf = ddb.ps_partkey;
+  auto& ps_suppkey_buf = ddb.ps_suppkey;
+  auto& ps_availqty_buf = ddb.ps_availqty;
+  auto& ps_supplycost_buf = ddb.ps_supplycost;
 
   // setup the output buffers
   buffer partkeys_buf(partkeys);
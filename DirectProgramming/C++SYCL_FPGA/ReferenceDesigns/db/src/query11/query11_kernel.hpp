@@ -6,10 +6,11 @@
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
 #include "../dbdata.hpp"
+#include "../device_db.hpp"
 
 using namespace sycl;
 
-bool SubmitQuery11(queue& q, Database& dbinfo,
+bool SubmitQuery11(queue& q, Database& dbinfo, DeviceDatabase& ddb,
                    std::string& nation,
                    std::vector<DBIdentifier>& partkeys,
                    std::vector<DBDecimal>& values,
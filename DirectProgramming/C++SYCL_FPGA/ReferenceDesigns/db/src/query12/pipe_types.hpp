@@ -10,6 +10,10 @@
 
 using namespace sycl;
 
+// the types of this query are in their own namespace so that all queries can
+// be compiled into a single program (see the QUERY=ALL build in CMakeLists.txt)
+namespace query12 {
+
 //
 // A single row of the ORDERS table
 // with a subset of the columns (needed for this query)
@@ -126,4 +130,6 @@ using LineItemProducerStartPipe =
 
 #endif
 
+}  // namespace query12
+
 #endif /* __PIPE_TYPES_H__ */
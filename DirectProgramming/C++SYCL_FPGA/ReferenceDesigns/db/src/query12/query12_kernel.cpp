@@ -11,6 +11,8 @@
 
 using namespace std::chrono;
 
+namespace query12 {
+
 // kernel class names
 class LineItemProducer;
 class OrdersProducer;
@@ -18,22 +20,27 @@ class Join;
 class Compute;
 class StartProduction;
 
-bool SubmitQuery12(queue& q, Database& dbinfo, DBDate low_date,
+}  // namespace query12
+
+using namespace query12;
+
+bool SubmitQuery12(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+                    DBDate low_date,
                     DBDate high_date, int shipmode1, int shipmode2,
                     std::array<DBDecimal, 2>& high_line_count,
                     std::array<DBDecimal, 2>& low_line_count,
                     double& kernel_latency, double& total_latency) {
   // create space for the input buffers
   // LINEITEM table
-  buffer l_orderkey_buf(dbinfo.l.orderkey);
-  buffer l_shipmode_buf(dbinfo.l.shipmode);
-  buffer l_commitdate_buf(dbinfo.l.commitdate);
-  buffer l_shipdate_buf(dbinfo.l.shipdate);
-  buffer l_receiptdate_buf(dbinfo.l.receiptdate);
+  auto& l_orderkey_buf = ddb.l_orderkey;
+  auto& l_shipmode_buf = ddb.l_shipmode;
+  auto& l_commitdate_buf = ddb.l_commitdate;
+  auto& l_shipdate_buf = ddb.l_shipdate;
+  auto& l_receiptdate_buf = ddb.l_receiptdate;
 
   // ORDERS table
-  buffer o_orderkey_buf(dbinfo.o.orderkey);
-  buffer o_orderpriority_buf(dbinfo.o.orderpriority);
+  auto& o_orderkey_buf = ddb.o_orderkey;
+  auto& o_orderpriority_buf = ddb.o_orderpriority;
 
   // setup the output buffers
   buffer high_line_count_buf(high_line_count);
@@ -6,10 +6,11 @@
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
 #include "../dbdata.hpp"
+#include "../device_db.hpp"
 
 using namespace sycl;
 
-bool SubmitQuery12(queue& q, Database& dbinfo,
+bool SubmitQuery12(queue& q, Database& dbinfo, DeviceDatabase& ddb,
                    DBDate low_date, DBDate high_date,
                    int shipmode1, int shipmode2,
                    std::array<DBDecimal, 2>& high_line_count,
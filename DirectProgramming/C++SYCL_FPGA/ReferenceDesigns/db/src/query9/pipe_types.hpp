@@ -10,6 +10,10 @@
 
 using namespace sycl;
 
+// the types of this query are in their own namespace so that all queries can
+// be compiled into a single program (see the QUERY=ALL build in CMakeLists.txt)
+namespace query9 {
+
 //
 // A single row of the PARTSUPPLIER table
 // with a subset of the columns (needed for this query)
@@ -269,4 +273,6 @@ using PartSupplierPipe =
 using FinalPipe =
     sycl::pipe<class FinalPipeClass, FinalPipeData>;
 
+}  // namespace query9
+
 #endif /* __PIPE_TYPES_H__ */
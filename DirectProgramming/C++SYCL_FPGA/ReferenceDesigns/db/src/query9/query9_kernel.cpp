@@ -20,6 +20,8 @@
 
 using namespace std::chrono;
 
+namespace query9 {
+
 //
 // NOTE: See the README file for a diagram of how the different kernels are
 // connected
@@ -80,7 +82,12 @@ void Shuffle(NTuple<tuple_size, TupleType>& input,
   });
 }
 
-bool SubmitQuery9(queue& q, Database& dbinfo, std::string colour,
+}  // namespace query9
+
+using namespace query9;
+
+bool SubmitQuery9(queue& q, Database& dbinfo, DeviceDatabase& ddb,
+                  std::string colour,
                   std::array<DBDecimal, 25 * 2020>& sum_profit,
                   double& kernel_latency, double& total_latency) {
   // copy the regex string to character array, pad with NULL characters
@@ -94,27 +101,27 @@ bool SubmitQuery9(queue& q, Database& dbinfo, std::string colour,
   buffer regex_word_buf(regex_word);
 
   // PARTS
-  buffer p_name_buf(dbinfo.p.name);
+  auto& p_name_buf = ddb.p_name;
 
   // SUPPLIER
-  buffer s_nationkey_buf(dbinfo.s.nationkey);
+  auto& s_nationkey_buf = ddb.s_nationkey;
 
   // PARTSUPPLIER
-  buffer ps_partkey_buf(dbinfo.ps.partkey);
-  buffer ps_suppkey_buf(dbinfo.ps.suppkey);
-  buffer ps_supplycost_buf(dbinfo.ps.supplycost);
+  auto& ps_partkey_buf = ddb.ps_partkey;
+  auto& ps_suppkey_buf = ddb.ps_suppkey;
+  auto& ps_supplycost_buf = ddb.ps_supplycost;
 
   // ORDERS
-  buffer o_orderkey_buf(dbinfo.o.orderkey);
-  buffer o_orderdate_buf(dbinfo.o.orderdate);
+  auto& o_orderkey_buf = ddb.o_orderkey;
+  auto& o_orderdate_buf = ddb.o_orderdate;
 
   // LINEITEM
-  buffer l_orderkey_buf(dbinfo.l.orderkey);
-  buffer l_partkey_buf(dbinfo.l.partkey);
-  buffer l_suppkey_buf(dbinfo.l.suppkey);
-  buffer l_quantity_buf(dbinfo.l.quantity);
-  buffer l_extendedprice_buf(dbinfo.l.extendedprice);
-  buffer l_discount_buf(dbinfo.l.discount);
+  auto& l_orderkey_buf = ddb.l_orderkey;
+  auto& l_partkey_buf = ddb.l_partkey;
+  auto& l_suppkey_buf = ddb.l_suppkey;
+  auto& l_quantity_buf = ddb.l_quantity;
+  auto& l_extendedprice_buf = ddb.l_extendedprice;
+  auto& l_discount_buf = ddb.l_discount;
 
   // setup the output buffer (the profit for each nation and year)
   buffer sum_profit_buf(sum_profit);
@@ -6,10 +6,11 @@
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
 #include "../dbdata.hpp"
+#include "../device_db.hpp"
 
 using namespace sycl;
 
-bool SubmitQuery9(queue& q, Database& dbinfo,
+bool SubmitQuery9(queue& q, Database& dbinfo, DeviceDatabase& ddb,
                   std::string colour,
                   std::array<DBDecimal, 25 * 2020>& sum_profit,
                   double& kernel_latency, double& total_latency);
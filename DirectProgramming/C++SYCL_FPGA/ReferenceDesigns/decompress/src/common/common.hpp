@@ -391,4 +391,75 @@ sycl::event SubmitConsumer(sycl::queue& q, unsigned out_count_padded,
   });
 }
 
+//
+// A streaming version of the consumer kernel. Instead of reading a known
+// number of bytes, it reads from OutPipe until either 'out_chunk_size' bytes
+// have been written to 'out_ptr' or the decompression engine signals that it
+// is done. The number of valid bytes written and whether the engine is done
+// are written to 'count_ptr' and 'done_ptr', respectively.
+//
+// The host launches this kernel once per output chunk, into the slots of a
+// ring buffer, so the output can be drained without knowing its total size.
+//
+//  Template parameters:
+//    Id: the type to use for the kernel ID
+//    OutPipe: a SYCL pipe that streams bytes from the decompression engine,
+//      'literals_per_cycle' at a time
+//    literals_per_cycle: the number of bytes to read from pipe and write to the
+//      pointer at once.
+//
+//  Arguments:
+//    q: the SYCL queue
+//    out_chunk_size: the maximum number of bytes to write to out_ptr. This
+//      must be a multiple of literals_per_cycle.
+//    out_ptr: a pointer to the output chunk
+//    count_ptr: a pointer to the number of valid bytes in the output chunk
+//    done_ptr: a pointer to a flag that is set if the engine is done
+//
+template <typename Id, typename OutPipe, unsigned literals_per_cycle>
+sycl::event SubmitStreamingConsumer(sycl::queue& q, unsigned out_chunk_size,
+                                    unsigned char* out_ptr,
+                                    unsigned* count_ptr, bool* done_ptr) {
+  assert(out_chunk_size % literals_per_cycle == 0);
+  auto iteration_count = out_chunk_size / literals_per_cycle;
+  return q.single_task<Id>([=] {
+#if defined (IS_BSP)
+    sycl::ext::intel::device_ptr<unsigned char> out(out_ptr);
+    sycl::ext::intel::device_ptr<unsigned> count_out(count_ptr);
+    sycl::ext::intel::device_ptr<bool> done_out(done_ptr);
+#else
+    unsigned char* out(out_ptr);
+    unsigned* count_out(count_ptr);
+    bool* done_out(done_ptr);
+#endif
+
+    // every write from the engine has 'literals_per_cycle' valid bytes,
+    // except possibly the last one, so the valid bytes of the chunk are
+    // contiguous
+    unsigned i = 0;
+    unsigned count = 0;
+    bool done = false;
+    [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+    while (!done && i < iteration_count) {
+      bool valid;
+      auto d = OutPipe::read(valid);
+      if (valid) {
+        if (d.flag) {
+          done = true;
+        } else {
+#pragma unroll
+          for (int j = 0; j < literals_per_cycle; j++) {
+            out[i * literals_per_cycle + j] = d.data[j];
+          }
+          count += d.data.valid_count;
+          i++;
+        }
+      }
+    }
+
+    *count_out = count;
+    *done_out = done;
+  });
+}
+
 #endif /* __COMMON_HPP__ */
@@ -2,7 +2,13 @@
 #define __GZIP_DECOMPRESSOR_HPP__
 
 #include <sycl/sycl.hpp>
+#include <algorithm>
 #include <chrono>
+#include <climits>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
 #include <sycl/ext/intel/ac_types/ac_int.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
@@ -11,18 +17,29 @@
 #include "../common/lz77_decoder.hpp"
 #include "../common/simple_crc32.hpp"
 #include "constexpr_math.hpp"  // included from ../../../../include
+#include "gzip_member_index.hpp"
 #include "gzip_metadata_reader.hpp"
 #include "huffman_decoder.hpp"
 #include "metaprogramming_utils.hpp"  // included from ../../../../include
+#include "unrolled_loop.hpp"  // included from ../../../../include
 
-// declare the kernel and pipe names globally to reduce name mangling
+// declare the kernel and pipe names globally to reduce name mangling.
+// They are templated on the engine index so that several independent
+// decompression engines can be instantiated in the same design.
+template <int engine>
 class GzipMetadataReaderKernelID;
+template <int engine>
 class HuffmanDecoderKernelID;
+template <int engine>
 class LZ77DecoderKernelID;
+template <int engine>
 class ByteStackerKernelID;
 
+template <int engine>
 class GzipMetadataToHuffmanPipeID;
+template <int engine>
 class HuffmanToLZ77PipeID;
+template <int engine>
 class LZ77ToByteStackerPipeID;
 
 // the depth of the pipe between the Huffman decoder and the LZ77 decoder.
@@ -41,6 +58,8 @@ constexpr int kHuffmanToLZ77PipeDepth = 64;
 //    literals_per_cycle: the maximum number of literals written to the output
 //      stream every cycle. This sets how many literals can be read from the
 //      LZ77 history buffer at once.
+//    engine: the index of the decompression engine. Every engine is a
+//      separate copy of the kernels, so engines can run concurrently.
 //
 //  Arguments:
 //    q: the SYCL queue
@@ -49,9 +68,10 @@ constexpr int kHuffmanToLZ77PipeDepth = 64;
 //    crc_out: an output buffer for the CRC in the GZIP footer
 //    count_out: an output buffer for the uncompressed size in the GZIP footer
 //
-template <typename InPipe, typename OutPipe, unsigned literals_per_cycle>
+template <typename InPipe, typename OutPipe, unsigned literals_per_cycle,
+          int engine = 0>
 std::vector<sycl::event> SubmitGzipDecompressKernels(
-    sycl::queue &q, int in_count, GzipHeaderData *hdr_data_out, int *crc_out,
+    sycl::queue &q, size_t in_count, GzipHeaderData *hdr_data_out, int *crc_out,
     int *count_out) {
   // check that the input and output pipe types are actually pipes
   static_assert(fpga_tools::is_sycl_pipe_v<InPipe>);
@@ -63,83 +83,139 @@ std::vector<sycl::event> SubmitGzipDecompressKernels(
 
   // the inter-kernel pipes for the GZIP decompression engine
   using GzipMetadataToHuffmanPipe =
-      sycl::ext::intel::pipe<GzipMetadataToHuffmanPipeID,
+      sycl::ext::intel::pipe<GzipMetadataToHuffmanPipeID<engine>,
                              FlagBundle<ByteSet<1>>>;
   using HuffmanToLZ77Pipe =
-      sycl::ext::intel::pipe<HuffmanToLZ77PipeID, FlagBundle<GzipLZ77InputData>,
+      sycl::ext::intel::pipe<HuffmanToLZ77PipeID<engine>,
+                             FlagBundle<GzipLZ77InputData>,
                              kHuffmanToLZ77PipeDepth>;
 
   // submit the GZIP decompression kernels
   auto header_event =
-      SubmitGzipMetadataReader<GzipMetadataReaderKernelID, InPipe,
+      SubmitGzipMetadataReader<GzipMetadataReaderKernelID<engine>, InPipe,
                                GzipMetadataToHuffmanPipe>(
           q, in_count, hdr_data_out, crc_out, count_out);
   auto huffman_event =
-      SubmitHuffmanDecoder<HuffmanDecoderKernelID, GzipMetadataToHuffmanPipe,
-                           HuffmanToLZ77Pipe>(q);
+      SubmitHuffmanDecoder<HuffmanDecoderKernelID<engine>,
+                           GzipMetadataToHuffmanPipe, HuffmanToLZ77Pipe>(q);
 
   // the design only needs a ByteStacker kernel when literals_per_cycle > 1
   if constexpr (literals_per_cycle > 1) {
     using LZ77ToByteStackerPipe =
-        sycl::ext::intel::pipe<LZ77ToByteStackerPipeID,
+        sycl::ext::intel::pipe<LZ77ToByteStackerPipeID<engine>,
                                FlagBundle<BytePack<literals_per_cycle>>>;
 
     auto lz77_event =
-        SubmitLZ77Decoder<LZ77DecoderKernelID, HuffmanToLZ77Pipe,
+        SubmitLZ77Decoder<LZ77DecoderKernelID<engine>, HuffmanToLZ77Pipe,
                           LZ77ToByteStackerPipe, literals_per_cycle,
                           kGzipMaxLZ77Distance, kGzipMaxLZ77Length>(q);
     auto byte_stacker_event =
-        SubmitByteStacker<ByteStackerKernelID, LZ77ToByteStackerPipe, OutPipe,
-                          literals_per_cycle>(q);
+        SubmitByteStacker<ByteStackerKernelID<engine>, LZ77ToByteStackerPipe,
+                          OutPipe, literals_per_cycle>(q);
 
     return {header_event, huffman_event, lz77_event, byte_stacker_event};
   } else {
     auto lz77_event =
-        SubmitLZ77Decoder<LZ77DecoderKernelID, HuffmanToLZ77Pipe, OutPipe,
-                          literals_per_cycle, kGzipMaxLZ77Distance,
+        SubmitLZ77Decoder<LZ77DecoderKernelID<engine>, HuffmanToLZ77Pipe,
+                          OutPipe, literals_per_cycle, kGzipMaxLZ77Distance,
                           kGzipMaxLZ77Length>(q);
     return {header_event, huffman_event, lz77_event};
   }
 }
 
 // declare kernel and pipe names at the global scope to reduce name mangling
+template <int engine>
 class ProducerId;
+template <int engine>
 class ConsumerId;
+template <int engine>
 class InPipeId;
+template <int engine>
 class OutPipeId;
+class StreamingConsumerId;
 
-// the input and output pipe
-using InPipe = sycl::ext::intel::pipe<InPipeId, ByteSet<1>>;
-using OutPipe =
-    sycl::ext::intel::pipe<OutPipeId, FlagBundle<BytePack<kLiteralsPerCycle>>>;
+// the input and output pipe of each engine
+template <int engine>
+using InPipe = sycl::ext::intel::pipe<InPipeId<engine>, ByteSet<1>>;
+template <int engine>
+using OutPipe = sycl::ext::intel::pipe<OutPipeId<engine>,
+                                       FlagBundle<BytePack<kLiteralsPerCycle>>>;
+
+// the default size of the input and output chunks in streaming mode
+constexpr size_t kDefaultStreamingChunkSize = 1 << 20;
+
+// the range of chunk sizes accepted in streaming mode. Every chunk costs a
+// producer or consumer launch, so very small chunks only add launch overhead,
+// and the streaming consumer counts the bytes of a chunk with an 'unsigned'.
+constexpr size_t kMinStreamingChunkSize = 1 << 12;
+constexpr size_t kMaxStreamingChunkSize = 1 << 30;
 
 //
 // The GZIP decompressor. See ../common/common.hpp for more information.
 //
-template <unsigned literals_per_cycle>
+// A GZIP file can contain multiple independent members (see
+// gzip_member_index.hpp). The members are distributed round-robin across
+// 'num_engines' copies of the decompression engine, which run concurrently,
+// and the outputs are written in member order to a single output buffer.
+//
+template <unsigned literals_per_cycle, int num_engines = 1>
 class GzipDecompressor : public DecompressorBase {
  public:
+  static_assert(num_engines > 0);
+
+  //
+  // Loads a '.gzi' block index to find the members of the next file to
+  // decompress. Returns false if the index file does not exist or is invalid,
+  // in which case the members are found from the file itself.
+  //
+  bool LoadMemberIndex(const std::string &index_filename) {
+    member_offsets_.clear();
+    if (!ReadGzipIndex(index_filename, member_offsets_)) {
+      member_offsets_.clear();
+      return false;
+    }
+    return true;
+  }
+
+  //
+  // Forgets the '.gzi' block index loaded by LoadMemberIndex, so the members
+  // of the next file are found from the file itself
+  //
+  void ClearMemberIndex() { member_offsets_.clear(); }
+
   std::optional<std::vector<unsigned char>> DecompressBytes(
       sycl::queue &q, std::vector<unsigned char> &in_bytes, int runs,
       bool print_stats) {
     int in_count = in_bytes.size();
 
-    // read the expected output size from the last 4 bytes of the file
-    std::vector<unsigned char> last_4_bytes(in_bytes.end() - 4, in_bytes.end());
-    unsigned out_count = *(reinterpret_cast<unsigned *>(last_4_bytes.data()));
-    std::vector<unsigned char> out_bytes(out_count);
-
-    // round up the output count to the nearest multiple of literals_per_cycle,
-    // which allows us to not predicate the last writes to the output buffer
-    // from the device.
-    int out_count_padded =
-        fpga_tools::RoundUpToMultiple(out_count, literals_per_cycle);
+    // find the independent members of the file
+    std::vector<GzipMember> members = FindGzipMembers(in_bytes,
+                                                      member_offsets_);
+    int num_members = members.size();
+    if (num_members == 0) {
+      return {};
+    }
 
-    // the GZIP header data. This is parsed by the GZIPMetadataReader kernel
-    GzipHeaderData hdr_data_h;
+    // the location of every member's output in the output buffer. Each member
+    // output is padded to a multiple of literals_per_cycle, which allows us to
+    // not predicate the last writes to the output buffer from the device.
+    std::vector<size_t> out_offset(num_members + 1);
+    std::vector<size_t> out_bytes_offset(num_members + 1);
+    out_offset[0] = out_bytes_offset[0] = 0;
+    for (int m = 0; m < num_members; m++) {
+      out_offset[m + 1] =
+          out_offset[m] + fpga_tools::RoundUpToMultiple(members[m].out_count,
+                                                        literals_per_cycle);
+      out_bytes_offset[m + 1] = out_bytes_offset[m] + members[m].out_count;
+    }
+    size_t out_count_padded = out_offset[num_members];
+    size_t out_count = out_bytes_offset[num_members];
+    std::vector<unsigned char> out_bytes(out_count);
 
-    // the GZIP footer data. This is parsed by the GZIPMetadataReader kernel.
-    unsigned int crc_h, count_h;
+    // the GZIP header and footer data of every member. These are parsed by
+    // the GZIPMetadataReader kernel
+    std::vector<GzipHeaderData> hdr_data_h(num_members);
+    std::vector<unsigned int> crc_h(num_members), count_h(num_members);
 
     // track timing information in ms
     std::vector<double> time_ms(runs);
@@ -147,11 +223,11 @@ class GzipDecompressor : public DecompressorBase {
     // input and output data pointers on the device using USM device allocations
     unsigned char *in, *out;
 
-    // the GZIP header data (see gzip_header_data.hpp)
+    // the GZIP header data (see gzip_header_data.hpp) of every member
     GzipHeaderData *hdr_data;
 
-    // the GZIP footer data, where 'count' is the expected number of bytes
-    // in the uncompressed file
+    // the GZIP footer data of every member, where 'count' is the expected
+    // number of bytes in the uncompressed member
     int *crc, *count;
 
     bool passed = true;
@@ -163,20 +239,21 @@ class GzipDecompressor : public DecompressorBase {
         std::cerr << "ERROR: could not allocate space for 'in'\n";
         std::terminate();
       }
-      if ((out = sycl::malloc_device<unsigned char>(out_count_padded, q)) ==
-          nullptr) {
+      if ((out = sycl::malloc_device<unsigned char>(
+               std::max(out_count_padded, size_t(1)), q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'out'\n";
         std::terminate();
       }
-      if ((hdr_data = sycl::malloc_device<GzipHeaderData>(1, q)) == nullptr) {
+      if ((hdr_data = sycl::malloc_device<GzipHeaderData>(num_members, q)) ==
+          nullptr) {
         std::cerr << "ERROR: could not allocate space for 'hdr_data'\n";
         std::terminate();
       }
-      if ((crc = sycl::malloc_device<int>(1, q)) == nullptr) {
+      if ((crc = sycl::malloc_device<int>(num_members, q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'crc'\n";
         std::terminate();
       }
-      if ((count = sycl::malloc_device<int>(1, q)) == nullptr) {
+      if ((count = sycl::malloc_device<int>(num_members, q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'count'\n";
         std::terminate();
       }
@@ -186,20 +263,21 @@ class GzipDecompressor : public DecompressorBase {
         std::cerr << "ERROR: could not allocate space for 'in'\n";
         std::terminate();
       }
-      if ((out = sycl::malloc_shared<unsigned char>(out_count_padded, q)) ==
-          nullptr) {
+      if ((out = sycl::malloc_shared<unsigned char>(
+               std::max(out_count_padded, size_t(1)), q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'out'\n";
         std::terminate();
       }
-      if ((hdr_data = sycl::malloc_shared<GzipHeaderData>(1, q)) == nullptr) {
+      if ((hdr_data = sycl::malloc_shared<GzipHeaderData>(num_members, q)) ==
+          nullptr) {
         std::cerr << "ERROR: could not allocate space for 'hdr_data'\n";
         std::terminate();
       }
-      if ((crc = sycl::malloc_shared<int>(1, q)) == nullptr) {
+      if ((crc = sycl::malloc_shared<int>(num_members, q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'crc'\n";
         std::terminate();
       }
-      if ((count = sycl::malloc_shared<int>(1, q)) == nullptr) {
+      if ((count = sycl::malloc_shared<int>(num_members, q)) == nullptr) {
         std::cerr << "ERROR: could not allocate space for 'count'\n";
         std::terminate();
       }
@@ -209,73 +287,111 @@ class GzipDecompressor : public DecompressorBase {
       // finish
       q.memcpy(in, in_bytes.data(), in_count * sizeof(unsigned char)).wait();
 
+      if (num_members > 1) {
+        std::cout << "Decompressing " << num_members << " GZIP members using "
+                  << num_engines << " engine(s)" << std::endl;
+      }
+
       // run the design multiple times to increase the accuracy of the timing
       for (int i = 0; i < runs; i++) {
         std::cout << "Launching kernels for run " << i << std::endl;
 
-        auto producer_event =
-            SubmitProducer<ProducerId, InPipe, 1>(q, in_count, in);
-        auto consumer_event =
-            SubmitConsumer<ConsumerId, OutPipe, literals_per_cycle>(
-                q, out_count_padded, out);
-
-        auto gzip_decompress_events =
-            SubmitGzipDecompressKernels<InPipe, OutPipe, literals_per_cycle>(
-                q, in_count, hdr_data, crc, count);
-
         auto s = std::chrono::high_resolution_clock::now();
-        producer_event.wait();
-        consumer_event.wait();
-        auto e = std::chrono::high_resolution_clock::now();
 
-        // wait for the decompression kernels to finish
-        for (auto &e : gzip_decompress_events) {
-          e.wait();
+        // every engine is driven by its own host thread, which decompresses
+        // members 'engine', 'engine + num_engines', ... one after the other.
+        // An engine starts its next member as soon as it is done with the
+        // previous one, so the engines stay busy even if the members have
+        // different sizes.
+        std::vector<std::thread> engine_threads;
+        fpga_tools::UnrolledLoop<num_engines>([&](auto engine) {
+          constexpr int e = decltype(engine)::value;
+          engine_threads.emplace_back([&] {
+            for (int m = e; m < num_members; m += num_engines) {
+              auto producer_event =
+                  SubmitProducer<ProducerId<e>, InPipe<e>, 1>(
+                      q, members[m].size, in + members[m].offset);
+              auto consumer_event =
+                  SubmitConsumer<ConsumerId<e>, OutPipe<e>,
+                                 literals_per_cycle>(
+                      q, out_offset[m + 1] - out_offset[m],
+                      out + out_offset[m]);
+
+              auto gzip_decompress_events =
+                  SubmitGzipDecompressKernels<InPipe<e>, OutPipe<e>,
+                                              literals_per_cycle, e>(
+                      q, members[m].size, hdr_data + m, crc + m, count + m);
+
+              producer_event.wait();
+              consumer_event.wait();
+
+              // wait for the decompression kernels to finish
+              for (auto &event : gzip_decompress_events) {
+                event.wait();
+              }
+            }
+          });
+        });
+        for (auto &t : engine_threads) {
+          t.join();
         }
 
+        auto e = std::chrono::high_resolution_clock::now();
+
         std::cout << "All kernels have finished for run " << i << std::endl;
 
         // duration in milliseconds
         time_ms[i] = std::chrono::duration<double, std::milli>(e - s).count();
 
-        // Copy the output back from the device
-        q.memcpy(out_bytes.data(), out, out_count * sizeof(unsigned char))
-            .wait();
-        q.memcpy(&hdr_data_h, hdr_data, sizeof(GzipHeaderData)).wait();
-        q.memcpy(&crc_h, crc, sizeof(int)).wait();
-        q.memcpy(&count_h, count, sizeof(int)).wait();
-
-        // validating the output
-        // check the magic header we read
-        if (hdr_data_h.MagicNumber() != 0x1f8b) {
-          auto save_flags = std::cerr.flags();
-          std::cerr << "ERROR: Incorrect magic header value of 0x" << std::hex
-                    << std::setw(4) << std::setfill('0')
-                    << hdr_data_h.MagicNumber() << " (should be 0x1f8b)\n";
-          std::cerr.flags(save_flags);
-          passed = false;
-        }
-
-        // check the number of bytes we read
-        if (count_h != out_count) {
-          std::cerr << "ERROR: Out counts do not match: " << count_h
-                    << " != " << out_count << "(count_h != out_count)\n";
-          passed = false;
+        // Copy the output back from the device, reassembling the members in
+        // order by skipping the padding after each member's output
+        for (int m = 0; m < num_members; m++) {
+          q.memcpy(out_bytes.data() + out_bytes_offset[m], out + out_offset[m],
+                   members[m].out_count * sizeof(unsigned char));
         }
-
-        // compute the CRC of the output data
-        auto crc32_out = SimpleCRC32(0, out_bytes.data(), out_count);
-
-        // check that the computed CRC matches the expectation (crc_h is the
-        // CRC-32 that is in the GZIP footer).
-        if (crc32_out != crc_h) {
-          auto save_flags = std::cout.flags();
-          std::cerr << std::hex << std::setw(4) << std::setfill('0');
-          std::cerr << "ERROR: output data CRC does not match the expected CRC "
-                    << "0x" << crc32_out << " != 0x" << crc_h
-                    << " (result != expected)\n";
-          std::cout.flags(save_flags);
-          passed = false;
+        q.memcpy(hdr_data_h.data(), hdr_data,
+                 num_members * sizeof(GzipHeaderData));
+        q.memcpy(crc_h.data(), crc, num_members * sizeof(int));
+        q.memcpy(count_h.data(), count, num_members * sizeof(int));
+        q.wait();
+
+        // validating the output of every member
+        for (int m = 0; m < num_members; m++) {
+          // check the magic header we read
+          if (hdr_data_h[m].MagicNumber() != 0x1f8b) {
+            auto save_flags = std::cerr.flags();
+            std::cerr << "ERROR: Incorrect magic header value of 0x" << std::hex
+                      << std::setw(4) << std::setfill('0')
+                      << hdr_data_h[m].MagicNumber() << " (should be 0x1f8b)"
+                      << " in member " << std::dec << m << "\n";
+            std::cerr.flags(save_flags);
+            passed = false;
+          }
+
+          // check the number of bytes we read
+          if (count_h[m] != members[m].out_count) {
+            std::cerr << "ERROR: Out counts do not match: " << count_h[m]
+                      << " != " << members[m].out_count
+                      << "(count_h != out_count) in member " << m << "\n";
+            passed = false;
+          }
+
+          // compute the CRC of the output data
+          auto crc32_out = SimpleCRC32(
+              0, out_bytes.data() + out_bytes_offset[m], members[m].out_count);
+
+          // check that the computed CRC matches the expectation (crc_h is the
+          // CRC-32 that is in the GZIP footer).
+          if (crc32_out != crc_h[m]) {
+            auto save_flags = std::cerr.flags();
+            std::cerr << std::hex << std::setw(4) << std::setfill('0');
+            std::cerr << "ERROR: output data CRC does not match the expected "
+                      << "CRC 0x" << crc32_out << " != 0x" << crc_h[m]
+                      << " (result != expected) in member " << std::dec << m
+                      << "\n";
+            std::cerr.flags(save_flags);
+            passed = false;
+          }
         }
       }
     } catch (sycl::exception const &e) {
@@ -302,10 +418,10 @@ class GzipDecompressor : public DecompressorBase {
         avg_time_ms = time_ms[0];
       }
 
-      double compression_ratio = (double)(count_h) / (double)(in_count);
+      double compression_ratio = (double)(out_count) / (double)(in_count);
 
       // the number of input and output megabytes, respectively
-      size_t out_mb = count_h * sizeof(unsigned char) * 1e-6;
+      size_t out_mb = out_count * sizeof(unsigned char) * 1e-6;
 
       std::cout << "Execution time: " << avg_time_ms << " ms\n";
       std::cout << "Output Throughput: " << (out_mb / (avg_time_ms * 1e-3))
@@ -320,6 +436,267 @@ class GzipDecompressor : public DecompressorBase {
       return {};
     }
   }
+
+  //
+  // Decompresses 'in_filename' to 'out_filename' in constant memory. Unlike
+  // DecompressFile, the input is never fully read into memory and the output
+  // size is not needed up front (the size in the GZIP footer is only used to
+  // validate the result):
+  //    - a host thread reads the input in chunks of 'chunk_size' bytes into
+  //      two device buffers, and launches a producer kernel on one buffer
+  //      while the next chunk is read and copied into the other
+  //    - the output is drained by a streaming consumer kernel into a ring of
+  //      two device buffers of 'chunk_size' bytes; each chunk is copied to the
+  //      host and written to the output file while the next chunk is
+  //      being filled
+  // This only uses a single engine and supports single-member GZIP files.
+  //
+  bool DecompressFileStreaming(sycl::queue &q, const std::string &in_filename,
+                               const std::string &out_filename,
+                               size_t chunk_size, bool write_output) {
+    if (chunk_size < kMinStreamingChunkSize ||
+        chunk_size > kMaxStreamingChunkSize) {
+      std::cerr << "ERROR: the streaming chunk size must be between "
+                << kMinStreamingChunkSize << " and " << kMaxStreamingChunkSize
+                << " bytes\n";
+      return false;
+    }
+
+    std::cout << "Streaming decompression of '" << in_filename
+              << "' in chunks of " << chunk_size << " bytes" << std::endl;
+
+    std::ifstream fin(in_filename, std::ios::binary | std::ios::ate);
+    if (!fin.good() || !fin.is_open()) {
+      std::cerr << "ERROR: could not open " << in_filename << " for reading\n";
+      return false;
+    }
+    size_t in_count = fin.tellg();
+    fin.seekg(0);
+
+    // the smallest GZIP file is a 10 byte header and an 8 byte footer
+    if (in_count < 18) {
+      std::cerr << "ERROR: '" << in_filename << "' is too small to be a GZIP "
+                << "file\n";
+      return false;
+    }
+
+    std::ofstream fout;
+    if (write_output) {
+      fout.open(out_filename, std::ios::binary);
+      if (!fout.good() || !fout.is_open()) {
+        std::cerr << "ERROR: could not open " << out_filename
+                  << " for writing\n";
+        return false;
+      }
+    }
+
+    // the output chunks must be a multiple of literals_per_cycle
+    size_t in_chunk_size = chunk_size;
+    size_t out_chunk_size =
+        fpga_tools::RoundUpToMultiple(chunk_size, size_t(literals_per_cycle));
+    constexpr int kBuffers = 2;
+
+    // host staging buffers for one input and one output chunk
+    std::vector<unsigned char> in_chunk_h(in_chunk_size);
+    std::vector<unsigned char> out_chunk_h(out_chunk_size);
+
+    // the GZIP header and footer data, parsed by the GZIPMetadataReader kernel
+    GzipHeaderData hdr_data_h;
+    unsigned int crc_h, count_h;
+
+    // device buffers
+    unsigned char *in, *out;
+    unsigned *out_count;
+    bool *out_done;
+    GzipHeaderData *hdr_data;
+    int *crc, *count;
+
+    bool passed = true;
+    size_t out_total = 0;
+    unsigned crc32_out = 0;
+    int out_chunks = 0;
+    double first_output_ms = 0, total_ms = 0;
+
+    try {
+#if defined (IS_BSP)
+      in = sycl::malloc_device<unsigned char>(kBuffers * in_chunk_size, q);
+      out = sycl::malloc_device<unsigned char>(kBuffers * out_chunk_size, q);
+      out_count = sycl::malloc_device<unsigned>(kBuffers, q);
+      out_done = sycl::malloc_device<bool>(kBuffers, q);
+      hdr_data = sycl::malloc_device<GzipHeaderData>(1, q);
+      crc = sycl::malloc_device<int>(1, q);
+      count = sycl::malloc_device<int>(1, q);
+#else
+      in = sycl::malloc_shared<unsigned char>(kBuffers * in_chunk_size, q);
+      out = sycl::malloc_shared<unsigned char>(kBuffers * out_chunk_size, q);
+      out_count = sycl::malloc_shared<unsigned>(kBuffers, q);
+      out_done = sycl::malloc_shared<bool>(kBuffers, q);
+      hdr_data = sycl::malloc_shared<GzipHeaderData>(1, q);
+      crc = sycl::malloc_shared<int>(1, q);
+      count = sycl::malloc_shared<int>(1, q);
+#endif
+      if (in == nullptr || out == nullptr || out_count == nullptr ||
+          out_done == nullptr || hdr_data == nullptr || crc == nullptr ||
+          count == nullptr) {
+        std::cerr << "ERROR: could not allocate the streaming buffers\n";
+        std::terminate();
+      }
+
+      auto s = std::chrono::high_resolution_clock::now();
+
+      // the decompression engine runs for the whole file
+      auto gzip_decompress_events =
+          SubmitGzipDecompressKernels<InPipe<0>, OutPipe<0>,
+                                      literals_per_cycle, 0>(
+              q, in_count, hdr_data, crc, count);
+
+      // feed the input chunks. The producers share the input pipe, so
+      // producer 'k' is only launched once producer 'k - 1' is done, by which
+      // time the buffer of producer 'k - 2' is free for chunk 'k'.
+      std::thread producer_thread([&] {
+        sycl::event producer_event;
+        size_t offset = 0;
+        for (int k = 0; offset < in_count; k++) {
+          size_t len = std::min(in_chunk_size, in_count - offset);
+          unsigned char *slot = in + (k % kBuffers) * in_chunk_size;
+          if (!fin.read(reinterpret_cast<char *>(in_chunk_h.data()), len)) {
+            std::cerr << "ERROR: failed reading " << in_filename << "\n";
+            std::terminate();
+          }
+          q.memcpy(slot, in_chunk_h.data(), len).wait();
+          if (k > 0) {
+            producer_event.wait();
+          }
+          producer_event =
+              SubmitProducer<ProducerId<0>, InPipe<0>, 1>(q, len, slot);
+          offset += len;
+        }
+        producer_event.wait();
+      });
+
+      // drain the output chunks. Consumer 'k + 1' is launched into the other
+      // buffer as soon as consumer 'k' is done, before chunk 'k' is copied to
+      // the host and written to the output file.
+      auto consumer_event =
+          SubmitStreamingConsumer<StreamingConsumerId, OutPipe<0>,
+                                  literals_per_cycle>(
+              q, out_chunk_size, out, out_count, out_done);
+      bool done = false;
+      for (int k = 0; !done; k++) {
+        int slot = k % kBuffers;
+        consumer_event.wait();
+
+        unsigned chunk_count;
+        bool chunk_done;
+        // NOTE: q.wait() would also wait for the decompression kernels
+        q.memcpy(&chunk_count, out_count + slot, sizeof(unsigned)).wait();
+        q.memcpy(&chunk_done, out_done + slot, sizeof(bool)).wait();
+        done = chunk_done;
+
+        if (!done) {
+          int next_slot = (k + 1) % kBuffers;
+          consumer_event =
+              SubmitStreamingConsumer<StreamingConsumerId, OutPipe<0>,
+                                      literals_per_cycle>(
+                  q, out_chunk_size, out + next_slot * out_chunk_size,
+                  out_count + next_slot, out_done + next_slot);
+        }
+
+        if (chunk_count > 0) {
+          q.memcpy(out_chunk_h.data(), out + slot * out_chunk_size,
+                   chunk_count * sizeof(unsigned char))
+              .wait();
+          if (out_chunks == 0) {
+            first_output_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::high_resolution_clock::now() -
+                                  s)
+                                  .count();
+          }
+          crc32_out = SimpleCRC32(crc32_out, out_chunk_h.data(), chunk_count);
+          if (write_output) {
+            fout.write(reinterpret_cast<char *>(out_chunk_h.data()),
+                       chunk_count);
+          }
+          out_total += chunk_count;
+          out_chunks++;
+        }
+      }
+
+      producer_thread.join();
+      for (auto &event : gzip_decompress_events) {
+        event.wait();
+      }
+
+      auto e = std::chrono::high_resolution_clock::now();
+      total_ms = std::chrono::duration<double, std::milli>(e - s).count();
+
+      q.memcpy(&hdr_data_h, hdr_data, sizeof(GzipHeaderData)).wait();
+      q.memcpy(&crc_h, crc, sizeof(int)).wait();
+      q.memcpy(&count_h, count, sizeof(int)).wait();
+    } catch (sycl::exception const &e) {
+      std::cout << "Caught a synchronous SYCL exception: " << e.what() << "\n";
+      std::terminate();
+    }
+
+    sycl::free(in, q);
+    sycl::free(out, q);
+    sycl::free(out_count, q);
+    sycl::free(out_done, q);
+    sycl::free(hdr_data, q);
+    sycl::free(crc, q);
+    sycl::free(count, q);
+
+    // validating the output
+    if (hdr_data_h.MagicNumber() != 0x1f8b) {
+      auto save_flags = std::cerr.flags();
+      std::cerr << "ERROR: Incorrect magic header value of 0x" << std::hex
+                << std::setw(4) << std::setfill('0')
+                << hdr_data_h.MagicNumber() << " (should be 0x1f8b)\n";
+      std::cerr.flags(save_flags);
+      passed = false;
+    }
+
+    // the GZIP footer holds the output size modulo 2^32
+    if (count_h != static_cast<unsigned>(out_total)) {
+      std::cerr << "ERROR: Out counts do not match: " << count_h
+                << " != " << static_cast<unsigned>(out_total)
+                << "(count_h != out_count)\n";
+      passed = false;
+    }
+
+    if (crc32_out != crc_h) {
+      auto save_flags = std::cerr.flags();
+      std::cerr << std::hex << std::setw(4) << std::setfill('0');
+      std::cerr << "ERROR: output data CRC does not match the expected CRC "
+                << "0x" << crc32_out << " != 0x" << crc_h
+                << " (result != expected)\n";
+      std::cerr.flags(save_flags);
+      passed = false;
+    }
+
+    if (passed) {
+      // NOTE: when run in emulation, these results do not accurately represent
+      // the performance of the kernels on real FPGA hardware
+      double out_mb = out_total * sizeof(unsigned char) * 1e-6;
+      std::cout << "Output chunks: " << out_chunks << "\n";
+      std::cout << "Device buffer memory: "
+                << (kBuffers * (in_chunk_size + out_chunk_size)) * 1e-6
+                << " MB\n";
+      std::cout << "Time to first output bytes: " << first_output_ms
+                << " ms\n";
+      std::cout << "Execution time: " << total_ms << " ms\n";
+      std::cout << "Output Throughput: " << (out_mb / (total_ms * 1e-3))
+                << " MB/s\n";
+      std::cout << "Compression Ratio: "
+                << (double)(out_total) / (double)(in_count) << ":1\n";
+    }
+
+    return passed;
+  }
+
+ private:
+  // the member offsets from a '.gzi' block index, if one was loaded
+  std::vector<size_t> member_offsets_;
 };
 
 #endif /* __GZIP_DECOMPRESSOR_HPP__ */
@@ -0,0 +1,163 @@
+#ifndef __GZIP_MEMBER_INDEX_HPP__
+#define __GZIP_MEMBER_INDEX_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//
+// A GZIP file is a concatenation of one or more independent 'members', each
+// with its own header, DEFLATE data, and footer. Since members do not share
+// any history, they can be decompressed in parallel by separate decompression
+// engines and the outputs concatenated in order.
+//
+// This file contains the host-side code that finds the members of a file:
+//    - BGZF files (e.g., produced by 'bgzip') store the size of every member
+//      in an 'extra' header field, so the members can be walked directly.
+//    - For other multi-member files (e.g., produced by concatenating GZIP
+//      files or by 'pigz --independent' split into members), the members are
+//      found using a '.gzi' block index: a little-endian uint64 count followed
+//      by 'count' {compressed offset, uncompressed offset} pairs of uint64
+//      values, one for every member except the first (this is the index
+//      format written by 'bgzip --index').
+//    - Otherwise, the file is treated as a single member.
+//
+
+//
+// The location of a GZIP member in the compressed file and its
+// uncompressed size (from the member's footer)
+//
+struct GzipMember {
+  size_t offset;
+  size_t size;
+  unsigned out_count;
+};
+
+//
+// Reads the member offsets from a '.gzi' block index file. Returns false if
+// the file does not exist or is malformed.
+//
+inline bool ReadGzipIndex(const std::string& filename,
+                          std::vector<size_t>& offsets) {
+  std::ifstream fin(filename, std::ios::binary);
+  if (!fin.is_open()) {
+    return false;
+  }
+
+  uint64_t count;
+  if (!fin.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+    return false;
+  }
+
+  offsets.clear();
+  offsets.push_back(0);
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t entry[2];
+    if (!fin.read(reinterpret_cast<char*>(entry), sizeof(entry))) {
+      std::cerr << "ERROR: truncated GZIP index file '" << filename << "'\n";
+      return false;
+    }
+    offsets.push_back(entry[0]);
+  }
+
+  return true;
+}
+
+//
+// Returns the total size of the BGZF member starting at 'offset', or 0 if
+// the member does not have a BGZF 'BC' extra subfield. This includes the
+// empty end-of-file member that 'bgzip' appends to every file.
+//
+inline size_t BgzfMemberSize(const std::vector<unsigned char>& in,
+                             size_t offset) {
+  // fixed header (10 bytes) + XLEN (2 bytes)
+  if (offset + 12 > in.size() || in[offset] != 0x1f ||
+      in[offset + 1] != 0x8b || in[offset + 2] != 8 ||
+      (in[offset + 3] & 0x04) == 0) {
+    return 0;
+  }
+
+  // walk the extra subfields looking for 'BC'
+  size_t xlen = in[offset + 10] | (in[offset + 11] << 8);
+  size_t pos = offset + 12;
+  size_t end = pos + xlen;
+  while (pos + 4 <= end && end <= in.size()) {
+    unsigned char si1 = in[pos];
+    unsigned char si2 = in[pos + 1];
+    size_t slen = in[pos + 2] | (in[pos + 3] << 8);
+    if (si1 == 'B' && si2 == 'C' && slen == 2 && pos + 6 <= end) {
+      // BSIZE is the total member size minus 1
+      return (in[pos + 4] | (in[pos + 5] << 8)) + 1;
+    }
+    pos += 4 + slen;
+  }
+
+  return 0;
+}
+
+//
+// Finds the members of the GZIP file 'in'. If 'index_offsets' is not empty,
+// it holds the offset of every member (see ReadGzipIndex), which must be
+// strictly increasing and each point at a GZIP header. Otherwise, the
+// members are found from the BGZF header fields or, if the file is not BGZF,
+// the whole file is a single member.
+//
+inline std::vector<GzipMember> FindGzipMembers(
+    const std::vector<unsigned char>& in,
+    const std::vector<size_t>& index_offsets) {
+  std::vector<size_t> offsets;
+
+  if (!index_offsets.empty()) {
+    // a stale or mismatched index would point the engines at the middle of a
+    // member, so every offset must be past the previous one and start with
+    // the GZIP magic number
+    for (size_t i = 0; i < index_offsets.size(); i++) {
+      size_t offset = index_offsets[i];
+      if ((i > 0 && offset <= index_offsets[i - 1]) ||
+          offset + 2 > in.size() || in[offset] != 0x1f ||
+          in[offset + 1] != 0x8b) {
+        std::cerr << "ERROR: GZIP index entry " << i << " (offset " << offset
+                  << ") is not the start of a GZIP member\n";
+        return {};
+      }
+    }
+    offsets = index_offsets;
+  } else {
+    // try to walk the file as BGZF
+    size_t offset = 0;
+    while (offset < in.size()) {
+      size_t size = BgzfMemberSize(in, offset);
+      if (size == 0) {
+        break;
+      }
+      offsets.push_back(offset);
+      offset += size;
+    }
+
+    // not (entirely) BGZF, treat the file as a single member
+    if (offset != in.size()) {
+      offsets = {0};
+    }
+  }
+
+  std::vector<GzipMember> members;
+  for (size_t i = 0; i < offsets.size(); i++) {
+    size_t begin = offsets[i];
+    size_t end = (i + 1 < offsets.size()) ? offsets[i + 1] : in.size();
+    if (end <= begin + 18 || end > in.size()) {
+      std::cerr << "ERROR: invalid GZIP member at offset " << begin << "\n";
+      return {};
+    }
+
+    // the uncompressed size is in the last 4 bytes of the member
+    unsigned out_count = in[end - 4] | (in[end - 3] << 8) |
+                         (in[end - 2] << 16) | (in[end - 1] << 24);
+    members.push_back({begin, end - begin, out_count});
+  }
+
+  return members;
+}
+
+#endif /* __GZIP_MEMBER_INDEX_HPP__ */
@@ -27,7 +27,7 @@
 //    out_count: the parsed uncompressed size from the GZIP footer
 //
 template <typename InPipe, typename OutPipe>
-void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
+void GzipMetadataReader(size_t in_count, GzipHeaderData& hdr_data, int& crc,
                         int& out_count) {
   // ensure the InPipe and OutPipe are SYCL pipes
   static_assert(fpga_tools::is_sycl_pipe_v<InPipe>);
@@ -56,8 +56,8 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
       if flags & 0x04 != 0: Flag = Errata, read 2 bytes for 'length',
                                    read 'length' more bytes
       if flags & 0x08 != 0: Filename, read nullterminated string
-      if flags & 0x02 != 0: CRC-16, read 2 bytes
       if flags & 0x10 != 0: Comment, read nullterminated string
+      if flags & 0x02 != 0: CRC-16, read 2 bytes
 
   ===== DATA =====
     1 or more consecutive DEFLATE compressed blocks
@@ -71,7 +71,9 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
   // SYCL pipe 'InPipe, strips away and parses the HEADER and FOOTER, and
   // forwards the DATA to the next kernel through the SYCL pipe 'OutPipe'
 
-  int i = 0;
+  // the byte counter is 64 bits wide, so that files larger than 2 GB can be
+  // streamed through the decompressor
+  size_t i = 0;
   bool i_in_range = 0 < in_count;
   bool i_next_in_range = 1 < in_count;
   short state_counter = 0;
@@ -137,10 +139,10 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
           state = GzipHeaderState::Errata;
         } else if (header_flags & 0x08) {
           state = GzipHeaderState::Filename;
-        } else if (header_flags & 0x02) {
-          state = GzipHeaderState::CRC;
         } else if (header_flags & 0x10) {
           state = GzipHeaderState::Comment;
+        } else if (header_flags & 0x02) {
+          state = GzipHeaderState::CRC;
         } else {
           state = GzipHeaderState::SteadyState;
         }
@@ -149,35 +151,34 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
       case GzipHeaderState::Errata: {
         if (state_counter == 0) {
           errata_len |= curr_byte;
-          state_counter++;
         } else if (state_counter == 1) {
           errata_len |= (curr_byte << 8);
-          state_counter++;
-        } else {
-          if ((state_counter - 2) == errata_len) {
-            if (header_flags & 0x08) {
-              state = GzipHeaderState::Filename;
-            } else if (header_flags & 0x02) {
-              state = GzipHeaderState::CRC;
-            } else if (header_flags & 0x10) {
-              state = GzipHeaderState::Comment;
-            } else {
-              state = GzipHeaderState::SteadyState;
-            }
-            state_counter = 0;
+        }
+        state_counter++;
+
+        // move on once the 2 length bytes and 'errata_len' bytes of the extra
+        // field (e.g., the BGZF block size) have been consumed
+        if (state_counter >= 2 && (state_counter - 2) == errata_len) {
+          if (header_flags & 0x08) {
+            state = GzipHeaderState::Filename;
+          } else if (header_flags & 0x10) {
+            state = GzipHeaderState::Comment;
+          } else if (header_flags & 0x02) {
+            state = GzipHeaderState::CRC;
           } else {
-            state_counter++;
+            state = GzipHeaderState::SteadyState;
           }
+          state_counter = 0;
         }
         break;
       }
       case GzipHeaderState::Filename: {
         header_filename[state_counter] = curr_byte;
         if (curr_byte == '\0') {
-          if (header_flags & 0x02) {
-            state = GzipHeaderState::CRC;
-          } else if (header_flags & 0x10) {
+          if (header_flags & 0x10) {
             state = GzipHeaderState::Comment;
+          } else if (header_flags & 0x02) {
+            state = GzipHeaderState::CRC;
           } else {
             state = GzipHeaderState::SteadyState;
           }
@@ -191,22 +192,20 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
         if (state_counter == 0) {
           header_crc[0] = curr_byte;
           state_counter++;
-        } else if (state_counter == 1) {
-          header_crc[1] = curr_byte;
-          state_counter++;
         } else {
-          if (header_flags & 0x10) {
-            state = GzipHeaderState::Comment;
-          } else {
-            state = GzipHeaderState::SteadyState;
-          }
+          header_crc[1] = curr_byte;
+          state = GzipHeaderState::SteadyState;
           state_counter = 0;
         }
         break;
       }
       case GzipHeaderState::Comment: {
         if (curr_byte == '\0') {
-          state = GzipHeaderState::SteadyState;
+          if (header_flags & 0x02) {
+            state = GzipHeaderState::CRC;
+          } else {
+            state = GzipHeaderState::SteadyState;
+          }
           state_counter = 0;
         } else {
           state_counter++;
@@ -219,7 +218,7 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
     }
 
     i_in_range = i_next_in_range;
-    i_next_in_range = i < (in_count - 2);
+    i_next_in_range = (i + 2) < in_count;
     i++;
   }
 
@@ -239,7 +238,7 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
 
     if (valid_pipe_read) {
       // keep track of the last 8 bytes
-      int remaining_bytes = (in_count - i - 1);
+      size_t remaining_bytes = (in_count - i - 1);
       if (remaining_bytes < 8) {
         if (remaining_bytes < 4) {
           size_bytes[3 - remaining_bytes] = curr_byte;
@@ -250,7 +249,7 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
       OutPipe::write(OutPipeBundleT(pipe_data, (i == (in_count - 1))));
 
       i_in_range = i_next_in_range;
-      i_next_in_range = i < (in_count - 2);
+      i_next_in_range = (i + 2) < in_count;
       i++;
     }
   }
@@ -280,7 +279,7 @@ void GzipMetadataReader(int in_count, GzipHeaderData& hdr_data, int& crc,
 // Creates a kernel from the GZIP metadata reader function
 //
 template <typename Id, typename InPipe, typename OutPipe>
-sycl::event SubmitGzipMetadataReader(sycl::queue& q, int in_count,
+sycl::event SubmitGzipMetadataReader(sycl::queue& q, size_t in_count,
                                      GzipHeaderData* hdr_data_ptr, int* crc_ptr,
                                      int* out_count_ptr) {
   return q.single_task<Id>([=]() [[intel::kernel_args_restrict]] {
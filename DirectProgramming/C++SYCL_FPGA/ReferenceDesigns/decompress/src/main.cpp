@@ -1,6 +1,7 @@
 #include <sycl/sycl.hpp>
 #include <algorithm>
 #include <array>
+#include <cstdio>
 #include <fstream>
 #include <limits>
 #include <numeric>
@@ -48,24 +49,48 @@ constexpr unsigned kLiteralsPerCycle = LITERALS_PER_CYCLE;
 static_assert(kLiteralsPerCycle > 0);
 static_assert(fpga_tools::IsPow2(kLiteralsPerCycle));
 
+// the number of GZIP decompression engines can be set from the command line
+// use the macro -DNUM_ENGINES=<num_engines>
+// The independent members of a multi-member GZIP file (e.g., BGZF) are
+// decompressed in parallel by the engines.
+#if not defined(NUM_ENGINES)
+#define NUM_ENGINES 1
+#endif
+constexpr int kNumEngines = NUM_ENGINES;
+static_assert(kNumEngines > 0);
+
+// the depth of the hash chain searched by the SNAPPY compressor can be set
+// from the command line using the macro -DHASH_CHAIN_DEPTH=<depth>
+// A deeper chain finds longer matches at the cost of throughput.
+#if not defined(HASH_CHAIN_DEPTH)
+#define HASH_CHAIN_DEPTH 4
+#endif
+constexpr unsigned kHashChainDepth = HASH_CHAIN_DEPTH;
+static_assert(kHashChainDepth > 0);
+
 // include files and aliases specific to GZIP and SNAPPY decompression
 #if defined(GZIP)
 #include "gzip/gzip_decompressor.hpp"
 #else
+#include "snappy/snappy_compressor.hpp"
 #include "snappy/snappy_data_gen.hpp"
 #include "snappy/snappy_decompressor.hpp"
 #endif
 
 // aliases and testing functions specific to GZIP and SNAPPY decompression
 #if defined(GZIP)
-using GzipDecompressorT = GzipDecompressor<kLiteralsPerCycle>;
+using GzipDecompressorT = GzipDecompressor<kLiteralsPerCycle, kNumEngines>;
 bool RunGzipTest(sycl::queue& q, GzipDecompressorT decompressor,
                  const std::string test_dir);
 std::string decompressor_name = "GZIP";
 #else
 using SnappyDecompressorT = SnappyDecompressor<kLiteralsPerCycle>;
+using SnappyCompressorT = SnappyCompressor<kLiteralsPerCycle, kHashChainDepth>;
 bool RunSnappyTest(sycl::queue& q, SnappyDecompressorT decompressor,
                    const std::string test_dir);
+std::optional<std::vector<unsigned char>> RunSnappyRoundTrip(
+    sycl::queue& q, SnappyDecompressorT& decompressor,
+    std::vector<unsigned char>& in_bytes, int runs, bool print_stats);
 std::string decompressor_name = "SNAPPY";
 #endif
 
@@ -73,6 +98,13 @@ std::string decompressor_name = "SNAPPY";
 void PrintUsage(std::string exe_name) {
   std::cerr << "USAGE: \n"
             << exe_name << " <input filename> <output filename> [runs]\n"
+#if defined(GZIP)
+            << exe_name
+            << " --stream[=<chunk bytes>] <input filename> <output filename>\n"
+#else
+            << exe_name
+            << " --compress <input filename> <output filename> [runs]\n"
+#endif
             << exe_name << " <test directory>" << std::endl;
 }
 
@@ -93,6 +125,62 @@ int main(int argc, char* argv[]) {
   int runs;
   bool default_test_mode = false;
 
+#if defined(GZIP)
+  // the '--stream' option decompresses the file in chunks, in constant memory
+  bool stream_mode = false;
+  size_t stream_chunk_size = kDefaultStreamingChunkSize;
+  if (argc > 1 && std::string(argv[1]).rfind("--stream", 0) == 0) {
+    std::string arg(argv[1]);
+    if (arg.size() > 9 && arg[8] == '=') {
+      // the chunk size must be a plain number of bytes in the accepted range
+      std::string value = arg.substr(9);
+      bool valid = value.find_first_not_of("0123456789") == std::string::npos;
+      if (valid) {
+        try {
+          stream_chunk_size = std::stoull(value);
+        } catch (const std::exception&) {
+          valid = false;
+        }
+      }
+      if (!valid || stream_chunk_size < kMinStreamingChunkSize ||
+          stream_chunk_size > kMaxStreamingChunkSize) {
+        std::cerr << "ERROR: the streaming chunk size must be between "
+                  << kMinStreamingChunkSize << " and " << kMaxStreamingChunkSize
+                  << " bytes\n";
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (arg.size() != 8) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    if (argc != 4) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    stream_mode = true;
+
+    // remove the option from the arguments
+    for (int i = 1; i < argc - 1; i++) argv[i] = argv[i + 1];
+    argc--;
+  }
+#else
+  // the '--compress' option compresses the file, and then decompresses it
+  // again to check the result
+  bool compress_mode = false;
+  if (argc > 1 && std::string(argv[1]) == "--compress") {
+    if (argc < 4) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    compress_mode = true;
+
+    // remove the option from the arguments
+    for (int i = 1; i < argc - 1; i++) argv[i] = argv[i + 1];
+    argc--;
+  }
+#endif
+
   if (argc == 1 || argc == 2) {
     default_test_mode = true;
   } else if (argc > 4) {
@@ -121,7 +209,12 @@ int main(int argc, char* argv[]) {
     }
   }
 
+#if defined(SNAPPY)
+  std::cout << "Using " << decompressor_name
+            << (compress_mode ? " compression\n" : " decompression\n");
+#else
   std::cout << "Using " << decompressor_name << " decompression\n";
+#endif
   std::cout << std::endl;
 
 #if FPGA_SIMULATOR
@@ -157,9 +250,42 @@ int main(int argc, char* argv[]) {
     passed = RunSnappyTest(q, decompressor, test_dir);
 #endif
   } else {
-    // decompress a specific file specified at the command line
-    passed = decompressor.DecompressFile(q, in_filename, out_filename, runs,
-                                         true, true);
+#if defined(GZIP)
+    if (stream_mode) {
+      passed = decompressor.DecompressFileStreaming(
+          q, in_filename, out_filename, stream_chunk_size, true);
+    } else {
+      // use the '.gzi' block index of the file, if there is one, to find the
+      // independent members of the file
+      if (decompressor.LoadMemberIndex(in_filename + ".gzi")) {
+        std::cout << "Using GZIP block index " << in_filename << ".gzi\n";
+      }
+
+      // decompress a specific file specified at the command line
+      passed = decompressor.DecompressFile(q, in_filename, out_filename, runs,
+                                           true, true);
+    }
+#else
+    if (compress_mode) {
+      // compress a specific file specified at the command line and check
+      // that it decompresses back to the original
+      std::cout << "Compressing '" << in_filename << "' " << runs
+                << ((runs == 1) ? " time" : " times") << std::endl;
+      auto in_bytes = ReadInputFile(in_filename);
+      auto result = RunSnappyRoundTrip(q, decompressor, in_bytes, runs, true);
+      passed = result != std::nullopt;
+      if (passed) {
+        std::cout << "Writing output data to '" << out_filename << "'"
+                  << std::endl;
+        std::cout << std::endl;
+        WriteOutputFile(out_filename, result.value());
+      }
+    } else {
+      // decompress a specific file specified at the command line
+      passed = decompressor.DecompressFile(q, in_filename, out_filename, runs,
+                                           true, true);
+    }
+#endif
   }
 
   if (passed) {
@@ -182,6 +308,84 @@ void PrintTestResults(std::string test_name, bool passed) {
 }
 
 #if defined(GZIP)
+//
+// Decompresses the multi-member GZIP file 'in_filename' and compares the
+// output with the file 'ref_filename'. If 'use_index' is true, the members
+// are found with the '.gzi' block index next to the file. If 'bgzf_eof' is
+// true, the file must end with the empty end-of-file member written by
+// 'bgzip', which is then decompressed like any other member.
+//
+bool RunGzipMembersTest(sycl::queue& q, GzipDecompressorT& decompressor,
+                        const std::string& in_filename,
+                        const std::string& ref_filename, bool use_index,
+                        bool bgzf_eof) {
+  if (use_index && !decompressor.LoadMemberIndex(in_filename + ".gzi")) {
+    std::cerr << "ERROR: could not read the GZIP block index " << in_filename
+              << ".gzi\n";
+    return false;
+  }
+
+  auto in_bytes = ReadInputFile(in_filename);
+  if (bgzf_eof) {
+    auto members = FindGzipMembers(in_bytes, {});
+    if (members.size() < 2 || members.back().out_count != 0) {
+      std::cerr << "ERROR: " << in_filename
+                << " does not end with an empty BGZF EOF member\n";
+      return false;
+    }
+  }
+
+  auto result = decompressor.DecompressBytes(q, in_bytes, 1, false);
+  decompressor.ClearMemberIndex();
+
+  auto ref_bytes = ReadInputFile(ref_filename);
+  return (result != std::nullopt) && (result.value() == ref_bytes);
+}
+
+//
+// Decompresses 'in_filename' with the '.gzi' block index of a different file.
+// The index offsets do not point at the members of 'in_filename', so the
+// decompression must be rejected before any kernel is launched.
+//
+bool RunGzipStaleIndexTest(sycl::queue& q, GzipDecompressorT& decompressor,
+                           const std::string& in_filename,
+                           const std::string& index_filename) {
+  if (!decompressor.LoadMemberIndex(index_filename)) {
+    std::cerr << "ERROR: could not read the GZIP block index "
+              << index_filename << "\n";
+    return false;
+  }
+
+  auto in_bytes = ReadInputFile(in_filename);
+  auto result = decompressor.DecompressBytes(q, in_bytes, 1, false);
+  decompressor.ClearMemberIndex();
+
+  return result == std::nullopt;
+}
+
+//
+// Decompresses the GZIP file 'in_filename' in streaming mode, in chunks of
+// 'chunk_size' bytes, and compares the output with the output of the
+// non-streaming decompression of the same file.
+//
+bool RunGzipStreamingTest(sycl::queue& q, GzipDecompressorT& decompressor,
+                          const std::string& in_filename, size_t chunk_size) {
+  // the streaming mode writes its output to a file
+  const std::string stream_out_filename = "streaming_test.out";
+  bool streamed = decompressor.DecompressFileStreaming(
+      q, in_filename, stream_out_filename, chunk_size, true);
+  if (!streamed) {
+    std::remove(stream_out_filename.c_str());
+    return false;
+  }
+  auto stream_bytes = ReadInputFile(stream_out_filename);
+  std::remove(stream_out_filename.c_str());
+
+  auto in_bytes = ReadInputFile(in_filename);
+  auto result = decompressor.DecompressBytes(q, in_bytes, 1, false);
+  return (result != std::nullopt) && (result.value() == stream_bytes);
+}
+
 bool RunGzipTest(sycl::queue& q, GzipDecompressorT decompressor,
                  const std::string test_dir) {
 
@@ -204,6 +408,13 @@ bool RunGzipTest(sycl::queue& q, GzipDecompressorT decompressor,
   std::string dynamic_compress_filename = test_dir + "/dynamic_compressed.gz";
   std::string tp_test_filename = test_dir + "/tp_test.gz";
 
+  // the same text, compressed as 4 concatenated members whose headers use
+  // the optional FEXTRA, FNAME, FCOMMENT and FHCRC fields (with a '.gzi'
+  // block index), and as a BGZF file that ends with the empty EOF member
+  std::string multi_member_filename = test_dir + "/multi_member.gz";
+  std::string bgzf_filename = test_dir + "/bgzf.gz";
+  std::string members_ref_filename = test_dir + "/members_ref.txt";
+
   std::cout << ">>>>> Uncompressed File Test <<<<<" << std::endl;
   bool uncompressed_test_pass = decompressor.DecompressFile(
       q, uncompressed_filename, "", 1, false, false);
@@ -222,6 +433,34 @@ bool RunGzipTest(sycl::queue& q, GzipDecompressorT decompressor,
   PrintTestResults("Dynamically Compressed File Test", dynamic_test_pass);
   std::cout << std::endl;
 
+  std::cout << ">>>>> Multi-Member File Test <<<<<" << std::endl;
+  bool multi_member_test_pass = RunGzipMembersTest(
+      q, decompressor, multi_member_filename, members_ref_filename, true,
+      false);
+  PrintTestResults("Multi-Member File Test", multi_member_test_pass);
+  std::cout << std::endl;
+
+  std::cout << ">>>>> BGZF File Test <<<<<" << std::endl;
+  bool bgzf_test_pass = RunGzipMembersTest(q, decompressor, bgzf_filename,
+                                           members_ref_filename, false, true);
+  PrintTestResults("BGZF File Test", bgzf_test_pass);
+  std::cout << std::endl;
+
+  std::cout << ">>>>> Stale Index Test <<<<<" << std::endl;
+  bool stale_index_test_pass = RunGzipStaleIndexTest(
+      q, decompressor, bgzf_filename, multi_member_filename + ".gzi");
+  PrintTestResults("Stale Index Test", stale_index_test_pass);
+  std::cout << std::endl;
+
+  // decompress the dynamically compressed file again in streaming mode, with
+  // the smallest chunks so that both the input and the output span several
+  // chunks, and compare the result with the non-streaming output
+  std::cout << ">>>>> Streaming Test <<<<<" << std::endl;
+  bool streaming_test_pass = RunGzipStreamingTest(
+      q, decompressor, dynamic_compress_filename, kMinStreamingChunkSize);
+  PrintTestResults("Streaming Test", streaming_test_pass);
+  std::cout << std::endl;
+
   std::cout << ">>>>> Throughput Test <<<<<" << std::endl;
   constexpr int kTPTestRuns = 5;
   bool tp_test_pass = decompressor.DecompressFile(q, tp_test_filename, "",
@@ -230,7 +469,8 @@ bool RunGzipTest(sycl::queue& q, GzipDecompressorT decompressor,
   std::cout << std::endl;
 
   return uncompressed_test_pass && static_test_pass && dynamic_test_pass &&
-         tp_test_pass;    
+         multi_member_test_pass && bgzf_test_pass && stale_index_test_pass &&
+         streaming_test_pass && tp_test_pass;
 #endif
 
 }
@@ -305,9 +545,47 @@ bool RunSnappyTest(sycl::queue& q, SnappyDecompressorT decompressor,
   PrintTestResults("Throughput Test", test_tp_pass);
   std::cout << std::endl;
 
+  std::cout << ">>>>> Round Trip Test <<<<<" << std::endl;
+  auto round_trip_ret =
+      RunSnappyRoundTrip(q, decompressor, ref_bytes, kTPTestRuns, true);
+  bool round_trip_pass = round_trip_ret != std::nullopt;
+  PrintTestResults("Round Trip Test", round_trip_pass);
+  std::cout << std::endl;
+
   return alice_test_pass && test1_pass && test2_pass && test3_pass &&
-         test_tp_pass;
+         test_tp_pass && round_trip_pass;
 #endif
 
 }
+
+//
+// Compresses 'in_bytes' with the SNAPPY compressor, decompresses the result
+// with 'decompressor' and checks that it matches 'in_bytes'. Returns the
+// compressed bytes if the round trip succeeded.
+//
+std::optional<std::vector<unsigned char>> RunSnappyRoundTrip(
+    sycl::queue& q, SnappyDecompressorT& decompressor,
+    std::vector<unsigned char>& in_bytes, int runs, bool print_stats) {
+  SnappyCompressorT compressor;
+
+  if (print_stats) {
+    std::cout << "Compression (hash chain depth " << kHashChainDepth << ")\n";
+  }
+  auto compressed = compressor.CompressBytes(q, in_bytes, runs, print_stats);
+  if (compressed == std::nullopt) {
+    return {};
+  }
+
+  if (print_stats) {
+    std::cout << "Decompression\n";
+  }
+  auto decompressed =
+      decompressor.DecompressBytes(q, compressed.value(), runs, print_stats);
+  if (decompressed == std::nullopt || decompressed.value() != in_bytes) {
+    std::cerr << "ERROR: the decompressed data does not match the input\n";
+    return {};
+  }
+
+  return compressed;
+}
 #endif
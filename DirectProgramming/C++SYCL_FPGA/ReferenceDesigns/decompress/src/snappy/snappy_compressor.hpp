@@ -0,0 +1,283 @@
+#ifndef __SNAPPY_COMPRESSOR_HPP__
+#define __SNAPPY_COMPRESSOR_HPP__
+
+#include <sycl/sycl.hpp>
+#include <chrono>
+#include <optional>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+
+#include "../common/byte_stacker.hpp"
+#include "../common/common.hpp"
+#include "constexpr_math.hpp"         // included from ../../../../include
+#include "metaprogramming_utils.hpp"  // included from ../../../../include
+#include "snappy_matcher.hpp"
+#include "snappy_writer.hpp"
+
+// declare the kernel and pipe names globally to reduce name mangling
+class SnappyMatcherKernelID;
+class SnappyWriterKernelID;
+class SnappyCompressByteStackerKernelID;
+
+class SnappyMatcherToWriterPipeID;
+class SnappyWriterToByteStackerPipeID;
+
+//
+// Submits the kernels for the Snappy compression engine and returns a list of
+// SYCL events from each kernel launch.
+//
+// Template parameters:
+//    InPipe: the input pipe that streams in uncompressed data,
+//      'literals_per_cycle' bytes at a time
+//    OutPipe: the output pipe that streams out compressed data,
+//      'literals_per_cycle' at a time
+//    literals_per_cycle: the number of bytes the matcher reads and compares
+//      at once, and the number of bytes streamed out the output stream.
+//    hash_chain_depth: the number of match candidates the matcher compares
+//      for every position. See snappy_matcher.hpp.
+//
+//  Arguments:
+//    q: the SYCL queue
+//    in_count: the number of uncompressed bytes
+//
+template <typename InPipe, typename OutPipe, unsigned literals_per_cycle,
+          unsigned hash_chain_depth>
+std::vector<sycl::event> SubmitSnappyCompressKernels(sycl::queue& q,
+                                                     unsigned in_count) {
+  // check that the input and output pipe types are actually pipes
+  static_assert(fpga_tools::is_sycl_pipe_v<InPipe>);
+  static_assert(fpga_tools::is_sycl_pipe_v<OutPipe>);
+
+  // 'literals_per_cycle' must be greater than 0 and a power of 2
+  static_assert(literals_per_cycle > 0);
+  static_assert(fpga_tools::IsPow2(literals_per_cycle));
+
+  // the inter-kernel pipes for the snappy compression engine
+  constexpr int SnappyMatcherToWriterPipeDepth = 16;
+  using SnappyMatcherToWriterPipe = sycl::ext::intel::pipe<
+      SnappyMatcherToWriterPipeID,
+      FlagBundle<SnappyLZ77InputData<literals_per_cycle>>,
+      SnappyMatcherToWriterPipeDepth>;
+
+  auto matcher_event =
+      SubmitSnappyMatcher<SnappyMatcherKernelID, InPipe,
+                          SnappyMatcherToWriterPipe, literals_per_cycle,
+                          hash_chain_depth>(q, in_count);
+
+  // the writer writes partial packs (e.g., the tag bytes), so the design only
+  // needs a ByteStacker kernel when literals_per_cycle > 1
+  if constexpr (literals_per_cycle > 1) {
+    using SnappyWriterToByteStackerPipe =
+        sycl::ext::intel::pipe<SnappyWriterToByteStackerPipeID,
+                               FlagBundle<BytePack<literals_per_cycle>>>;
+
+    auto writer_event =
+        SubmitSnappyWriter<SnappyWriterKernelID, SnappyMatcherToWriterPipe,
+                           SnappyWriterToByteStackerPipe, literals_per_cycle>(
+            q, in_count);
+    auto byte_stacker_event =
+        SubmitByteStacker<SnappyCompressByteStackerKernelID,
+                          SnappyWriterToByteStackerPipe, OutPipe,
+                          literals_per_cycle>(q);
+
+    return {matcher_event, writer_event, byte_stacker_event};
+  } else {
+    auto writer_event =
+        SubmitSnappyWriter<SnappyWriterKernelID, SnappyMatcherToWriterPipe,
+                           OutPipe, literals_per_cycle>(q, in_count);
+    return {matcher_event, writer_event};
+  }
+}
+
+// declare kernel and pipe names at the global scope to reduce name mangling
+class CompressProducerId;
+class CompressConsumerId;
+class CompressInPipeId;
+class CompressOutPipeId;
+
+// the input and output pipe
+using CompressInPipe =
+    sycl::ext::intel::pipe<CompressInPipeId, ByteSet<kLiteralsPerCycle>>;
+using CompressOutPipe =
+    sycl::ext::intel::pipe<CompressOutPipeId,
+                           FlagBundle<BytePack<kLiteralsPerCycle>>>;
+
+//
+// The SNAPPY compressor. It produces a raw Snappy stream (the format read by
+// the SnappyDecompressor), not the Snappy framing format.
+//
+template <unsigned literals_per_cycle, unsigned hash_chain_depth>
+class SnappyCompressor {
+ public:
+  std::optional<std::vector<unsigned char>> CompressBytes(
+      sycl::queue& q, std::vector<unsigned char>& in_bytes, int runs,
+      bool print_stats) {
+    bool passed = true;
+    unsigned in_count = in_bytes.size();
+    int in_count_padded =
+        fpga_tools::RoundUpToMultiple(in_count, kLiteralsPerCycle);
+
+    // the largest possible Snappy stream for 'in_count' bytes (the bound used
+    // by the software Snappy compressor). The extra 'kLiteralsPerCycle' bytes
+    // guarantee the consumer always has room to read the 'done' flag.
+    unsigned out_count_padded = fpga_tools::RoundUpToMultiple(
+        32 + in_count + in_count / 6 + kLiteralsPerCycle, kLiteralsPerCycle);
+
+    // host variables for output from device
+    unsigned out_count_host;
+    bool done_host;
+
+    // track timing information in ms
+    std::vector<double> time(runs);
+
+    // input and output data pointers on the device using USM device allocations
+    unsigned char *in, *out;
+    unsigned* out_count;
+    bool* done;
+
+    std::vector<unsigned char> out_bytes;
+
+    try {
+#if defined (IS_BSP)
+      // allocate memory on the device for the input and output
+      if ((in = sycl::malloc_device<unsigned char>(in_count_padded, q)) ==
+          nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'in'\n";
+        std::terminate();
+      }
+      if ((out = sycl::malloc_device<unsigned char>(out_count_padded, q)) ==
+          nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'out'\n";
+        std::terminate();
+      }
+      if ((out_count = sycl::malloc_device<unsigned>(1, q)) == nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'out_count'\n";
+        std::terminate();
+      }
+      if ((done = sycl::malloc_device<bool>(1, q)) == nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'done'\n";
+        std::terminate();
+      }
+#else
+      // allocate shared memory
+      if ((in = sycl::malloc_shared<unsigned char>(in_count_padded, q)) ==
+          nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'in'\n";
+        std::terminate();
+      }
+      if ((out = sycl::malloc_shared<unsigned char>(out_count_padded, q)) ==
+          nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'out'\n";
+        std::terminate();
+      }
+      if ((out_count = sycl::malloc_shared<unsigned>(1, q)) == nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'out_count'\n";
+        std::terminate();
+      }
+      if ((done = sycl::malloc_shared<bool>(1, q)) == nullptr) {
+        std::cerr << "ERROR: could not allocate space for 'done'\n";
+        std::terminate();
+      }
+#endif
+
+      // copy the input data to the device memory and wait for the copy to
+      // finish. The padding bytes are never compressed (the matcher only
+      // looks at the first 'in_count' bytes).
+      q.memcpy(in, in_bytes.data(), in_count * sizeof(unsigned char)).wait();
+
+      // run the design multiple times to increase the accuracy of the timing
+      for (int i = 0; i < runs; i++) {
+        std::cout << "Launching kernels for run " << i << std::endl;
+
+        // run the producer and consumer kernels. The consumer stops at the
+        // 'done' flag and reports the number of compressed bytes.
+        auto producer_event =
+            SubmitProducer<CompressProducerId, CompressInPipe,
+                           literals_per_cycle>(q, in_count_padded, in);
+        auto consumer_event =
+            SubmitStreamingConsumer<CompressConsumerId, CompressOutPipe,
+                                    literals_per_cycle>(
+                q, out_count_padded, out, out_count, done);
+
+        // run the compression kernels
+        auto snappy_compress_events =
+            SubmitSnappyCompressKernels<CompressInPipe, CompressOutPipe,
+                                        literals_per_cycle, hash_chain_depth>(
+                q, in_count);
+
+        // wait for the producer and consumer to finish
+        auto s = std::chrono::high_resolution_clock::now();
+        producer_event.wait();
+        consumer_event.wait();
+        auto e = std::chrono::high_resolution_clock::now();
+
+        // wait for the compression kernels to finish
+        for (auto& e : snappy_compress_events) {
+          e.wait();
+        }
+
+        std::cout << "All kernels finished for run " << i << std::endl;
+
+        // calculate the time the kernels ran for, in milliseconds
+        time[i] = std::chrono::duration<double, std::milli>(e - s).count();
+
+        // copy the output back from the device
+        q.memcpy(&out_count_host, out_count, sizeof(unsigned)).wait();
+        q.memcpy(&done_host, done, sizeof(bool)).wait();
+
+        if (!done_host) {
+          std::cerr << "ERROR: the compressed output did not fit in the "
+                    << "output buffer\n";
+          passed = false;
+        } else {
+          out_bytes.resize(out_count_host);
+          q.memcpy(out_bytes.data(), out,
+                   out_count_host * sizeof(unsigned char))
+              .wait();
+        }
+      }
+    } catch (sycl::exception const& e) {
+      std::cout << "Caught a synchronous SYCL exception: " << e.what() << "\n";
+      std::terminate();
+    }
+
+    // free the allocated device memory
+    sycl::free(in, q);
+    sycl::free(out, q);
+    sycl::free(out_count, q);
+    sycl::free(done, q);
+
+    // print the performance results
+    if (passed && print_stats) {
+      // NOTE: when run in emulation, these results do not accurately represent
+      // the performance of the kernels on real FPGA hardware
+      double avg_time_ms;
+      if (runs > 1) {
+        avg_time_ms =
+            std::accumulate(time.begin() + 1, time.end(), 0.0) / (runs - 1);
+      } else {
+        avg_time_ms = time[0];
+      }
+
+      double compression_ratio =
+          (double)(in_count) / (double)(out_count_host);
+
+      // the number of input megabytes
+      double in_mb = in_count * sizeof(unsigned char) * 1e-6;
+
+      std::cout << "Execution time: " << avg_time_ms << " ms\n";
+      std::cout << "Input Throughput: " << (in_mb / (avg_time_ms * 1e-3))
+                << " MB/s\n";
+      std::cout << "Compression Ratio: " << compression_ratio << ":1"
+                << "\n";
+    }
+
+    if (passed) {
+      return out_bytes;
+    } else {
+      return {};
+    }
+  }
+};
+
+#endif /* __SNAPPY_COMPRESSOR_HPP__ */
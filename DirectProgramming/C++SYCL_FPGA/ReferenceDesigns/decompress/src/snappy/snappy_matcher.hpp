@@ -0,0 +1,234 @@
+#ifndef __SNAPPY_MATCHER_HPP__
+#define __SNAPPY_MATCHER_HPP__
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+
+#include "../common/common.hpp"
+#include "constexpr_math.hpp"         // included from ../../../../include
+#include "metaprogramming_utils.hpp"  // included from ../../../../include
+
+// the number of bits in the hash of the next 4 bytes used to find matches
+constexpr unsigned kSnappyHashBits = 13;
+
+// the minimum length of a copy. Shorter copies do not save space.
+constexpr unsigned kSnappyMinMatch = 4;
+
+// the default number of bytes the matcher works on at once. Copies never
+// cross a block boundary, so this also bounds the copy distance, which must be
+// less than 65536 to fit in a Snappy copy command with a 2-byte offset.
+constexpr unsigned kSnappyCompressBlockSize = 1 << 15;
+
+// after this many bytes without a match, the matcher only looks for a match
+// every 'literals_per_cycle' bytes (like the skipping heuristic of the
+// software Snappy compressor), which speeds up incompressible data
+constexpr unsigned kSnappySkipThreshold = 32;
+
+//
+// Hashes 4 consecutive bytes, 'b0' being the first
+//
+inline unsigned SnappyHash(unsigned char b0, unsigned char b1,
+                           unsigned char b2, unsigned char b3) {
+  unsigned v = b0 | (b1 << 8) | (b2 << 16) | (b3 << 24);
+  return (v * 0x1e35a7bd) >> (32 - kSnappyHashBits);
+}
+
+//
+// Streams in uncompressed bytes from InPipe 'literals_per_cycle' at a time
+// and finds LZ77 matches in them. Generates LZ77InputData (see
+// ../common/common.hpp) to the OutPipe: either an array of up to
+// 'literals_per_cycle' literals with a valid count, or a {length, distance}
+// pair for a copy. This is the same stream the SnappyReader kernel produces
+// for the LZ77 decoder, in the opposite direction.
+//
+// The input is processed in blocks of 'block_size' bytes that are stored
+// on-chip. For every position, the last position with the same hash of the
+// next 4 bytes is found in a hash table and the chain of earlier positions
+// with that hash is followed for up to 'hash_chain_depth' candidates. Each
+// candidate is compared 'literals_per_cycle' bytes at a time and the longest
+// match is kept. A deeper chain finds longer matches (better compression
+// ratio) at the cost of more cycles per position (lower throughput).
+//
+//  Template parameters:
+//    InPipe: a SYCL pipe that streams in uncompressed data,
+//      'literals_per_cycle' bytes at a time.
+//    OutPipe: a SYCL pipe that streams out LZ77InputData to the SnappyWriter
+//    literals_per_cycle: the number of bytes read from the input, compared
+//      and written to the output at once.
+//    hash_chain_depth: the maximum number of match candidates to compare for
+//      every position
+//    block_size: the number of bytes matched at once
+//
+//  Arguments:
+//    in_count: the number of uncompressed bytes
+//
+template <typename InPipe, typename OutPipe, unsigned literals_per_cycle,
+          unsigned hash_chain_depth, unsigned block_size>
+void SnappyMatcher(unsigned in_count) {
+  // ensure the InPipe and OutPipe are SYCL pipes
+  static_assert(fpga_tools::is_sycl_pipe_v<InPipe>);
+  static_assert(fpga_tools::is_sycl_pipe_v<OutPipe>);
+
+  // the input and output pipe data types
+  using InPipeBundleT = decltype(InPipe::read());
+  using OutPipeBundleT = decltype(OutPipe::read());
+  using OutDataT = SnappyLZ77InputData<literals_per_cycle>;
+
+  // make sure the input and output types are correct
+  static_assert(std::is_same_v<InPipeBundleT, ByteSet<literals_per_cycle>>);
+  static_assert(std::is_same_v<OutPipeBundleT, FlagBundle<OutDataT>>);
+
+  static_assert(hash_chain_depth > 0);
+  static_assert(block_size % literals_per_cycle == 0);
+  static_assert(block_size <= kSnappyMaxLZ77Distance);
+
+  constexpr unsigned kHashSize = 1 << kSnappyHashBits;
+
+  // the current block, with room for comparisons that run past its end
+  unsigned char block[block_size + literals_per_cycle];
+
+  // 'head' holds the last position (+1) with a given hash, and 'prev' the
+  // previous position (+1) with the same hash as a position in the block.
+  // Positions are global, so entries from earlier blocks are ignored without
+  // clearing the tables.
+  unsigned head[kHashSize];
+  unsigned prev[block_size];
+
+  for (unsigned h = 0; h < kHashSize; h++) {
+    head[h] = 0;
+  }
+
+  for (unsigned base = 0; base < in_count; base += block_size) {
+    unsigned remaining = in_count - base;
+    unsigned len = (remaining < block_size) ? remaining : block_size;
+    unsigned pack_count = (len + literals_per_cycle - 1) / literals_per_cycle;
+
+    // read the block into on-chip memory
+    [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+    for (unsigned i = 0; i < pack_count; i++) {
+      auto pipe_data = InPipe::read();
+#pragma unroll
+      for (int j = 0; j < literals_per_cycle; j++) {
+        block[i * literals_per_cycle + j] = pipe_data[j];
+      }
+    }
+
+    OutDataT literals;
+    literals.is_literal = true;
+    unsigned literal_count = 0;
+    unsigned misses = 0;
+    unsigned pos = 0;
+
+    while (pos < len) {
+      unsigned best_length = 0;
+      unsigned best_distance = 0;
+
+      if (pos + kSnappyMinMatch <= len) {
+        unsigned hash = SnappyHash(block[pos], block[pos + 1], block[pos + 2],
+                                   block[pos + 3]);
+        unsigned max_length = (len - pos < kSnappyMaxLZ77Length)
+                                  ? len - pos
+                                  : unsigned(kSnappyMaxLZ77Length);
+
+        // follow the hash chain
+        unsigned candidate = head[hash];
+        for (unsigned d = 0; d < hash_chain_depth && candidate > base; d++) {
+          unsigned candidate_pos = candidate - 1 - base;
+
+          // extend the match 'literals_per_cycle' bytes at a time
+          unsigned length = 0;
+          bool extending = true;
+          while (extending) {
+            unsigned matching = 0;
+            bool all_match = true;
+#pragma unroll
+            for (int j = 0; j < literals_per_cycle; j++) {
+              all_match &= (length + j < max_length) &&
+                           (block[candidate_pos + length + j] ==
+                            block[pos + length + j]);
+              if (all_match) matching++;
+            }
+            length += matching;
+            extending = (matching == literals_per_cycle) &&
+                        (length < max_length);
+          }
+
+          if (length > best_length) {
+            best_length = length;
+            best_distance = pos - candidate_pos;
+          }
+
+          candidate = prev[candidate_pos];
+        }
+
+        // insert this position in the hash chain
+        prev[pos] = head[hash];
+        head[hash] = base + pos + 1;
+      }
+
+      if (best_length >= kSnappyMinMatch) {
+        // flush the pending literals and write the copy
+        if (literal_count > 0) {
+          literals.valid_count = literal_count;
+          OutPipe::write(OutPipeBundleT(literals));
+          literal_count = 0;
+        }
+        OutDataT copy;
+        copy.is_literal = false;
+        copy.length = best_length;
+        copy.distance = best_distance;
+        OutPipe::write(OutPipeBundleT(copy));
+        pos += best_length;
+        misses = 0;
+      } else if (misses >= kSnappySkipThreshold && literal_count == 0 &&
+                 pos + literals_per_cycle <= len) {
+        // no recent matches, write 'literals_per_cycle' literals at once
+        OutDataT skipped;
+        skipped.is_literal = true;
+#pragma unroll
+        for (int j = 0; j < literals_per_cycle; j++) {
+          skipped.literal[j] = block[pos + j];
+        }
+        skipped.valid_count = literals_per_cycle;
+        OutPipe::write(OutPipeBundleT(skipped));
+        pos += literals_per_cycle;
+      } else {
+        // add a single literal
+#pragma unroll
+        for (int j = 0; j < literals_per_cycle; j++) {
+          if (j == literal_count) literals.literal[j] = block[pos];
+        }
+        literal_count++;
+        pos++;
+        misses++;
+        if (literal_count == literals_per_cycle) {
+          literals.valid_count = literal_count;
+          OutPipe::write(OutPipeBundleT(literals));
+          literal_count = 0;
+        }
+      }
+    }
+
+    // flush the literals at the end of the block
+    if (literal_count > 0) {
+      literals.valid_count = literal_count;
+      OutPipe::write(OutPipeBundleT(literals));
+    }
+  }
+
+  // notify downstream that we are done
+  OutPipe::write(OutPipeBundleT(true));
+}
+
+template <typename Id, typename InPipe, typename OutPipe,
+          unsigned literals_per_cycle, unsigned hash_chain_depth,
+          unsigned block_size = kSnappyCompressBlockSize>
+sycl::event SubmitSnappyMatcher(sycl::queue& q, unsigned in_count) {
+  return q.single_task<Id>([=] {
+    SnappyMatcher<InPipe, OutPipe, literals_per_cycle, hash_chain_depth,
+                  block_size>(in_count);
+  });
+}
+
+#endif /* __SNAPPY_MATCHER_HPP__ */
@@ -0,0 +1,174 @@
+#ifndef __SNAPPY_WRITER_HPP__
+#define __SNAPPY_WRITER_HPP__
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+
+#include "../common/common.hpp"
+#include "constexpr_math.hpp"         // included from ../../../../include
+#include "metaprogramming_utils.hpp"  // included from ../../../../include
+
+// the longest literal string the writer buffers before writing it out. A
+// literal string of up to 60 bytes has its length in the tag byte.
+constexpr unsigned kSnappyMaxLiteralString = 60;
+
+//
+// Streams in LZ77InputData (see ../common/common.hpp) from the SnappyMatcher
+// and writes the Snappy format stream (the preamble, literal strings, and
+// copies) to the OutPipe as arrays of bytes with a valid count. This is the
+// inverse of the SnappyReader kernel.
+//
+// Literals are buffered into literal strings of up to
+// kSnappyMaxLiteralString bytes, since the length of a literal string comes
+// before its bytes. Copies use the 2-byte form (1-byte offset) when possible
+// and the 3-byte form (2-byte offset) otherwise.
+//
+//  Template parameters:
+//    InPipe: a SYCL pipe that streams in LZ77InputData from the matcher
+//    OutPipe: a SYCL pipe that streams out an array of bytes and a
+//      'valid_count', which is in the range [0, literals_per_cycle]
+//    literals_per_cycle: the maximum number of literals read from the input
+//      (and written to the output) at once.
+//
+//  Arguments:
+//    in_count: the number of uncompressed bytes, written in the preamble
+//
+template <typename InPipe, typename OutPipe, unsigned literals_per_cycle>
+void SnappyWriter(unsigned in_count) {
+  // ensure the InPipe and OutPipe are SYCL pipes
+  static_assert(fpga_tools::is_sycl_pipe_v<InPipe>);
+  static_assert(fpga_tools::is_sycl_pipe_v<OutPipe>);
+
+  // the input and output pipe data types
+  using InPipeBundleT = decltype(InPipe::read());
+  using OutPipeBundleT = decltype(OutPipe::read());
+  using OutDataT = BytePack<literals_per_cycle>;
+
+  // make sure the input and output types are correct
+  static_assert(
+      std::is_same_v<InPipeBundleT,
+                     FlagBundle<SnappyLZ77InputData<literals_per_cycle>>>);
+  static_assert(std::is_same_v<OutPipeBundleT, FlagBundle<OutDataT>>);
+  static_assert(literals_per_cycle <= kSnappyMaxLiteralString);
+
+  // the preamble and the copy commands are at most 5 bytes
+  constexpr unsigned kMaxCommandBytes = 5;
+
+  // writes 'count' bytes of 'bytes' to the output, 'literals_per_cycle' at
+  // a time
+  auto write_bytes = [&](const unsigned char(&bytes)[kMaxCommandBytes],
+                         unsigned count) {
+    for (unsigned i = 0; i < count; i += literals_per_cycle) {
+      OutDataT out_data;
+#pragma unroll
+      for (int j = 0; j < literals_per_cycle; j++) {
+        out_data.byte[j] = (i + j < kMaxCommandBytes) ? bytes[i + j] : 0;
+      }
+      unsigned remaining = count - i;
+      out_data.valid_count = (remaining < literals_per_cycle)
+                                 ? remaining
+                                 : literals_per_cycle;
+      OutPipe::write(OutPipeBundleT(out_data));
+    }
+  };
+
+  // the preamble is the uncompressed length as a varint
+  unsigned char preamble[kMaxCommandBytes];
+  unsigned preamble_count = 0;
+  unsigned preamble_value = in_count;
+  bool writing_preamble = true;
+  while (writing_preamble) {
+    unsigned char b = preamble_value & 0x7F;
+    preamble_value >>= 7;
+    writing_preamble = preamble_value != 0;
+    preamble[preamble_count] = b | (writing_preamble ? 0x80 : 0);
+    preamble_count++;
+  }
+  write_bytes(preamble, preamble_count);
+
+  // the buffered literal string
+  unsigned char literal_string[kSnappyMaxLiteralString + literals_per_cycle];
+  unsigned literal_count = 0;
+
+  // writes out the buffered literal string, if any
+  auto flush_literals = [&] {
+    if (literal_count > 0) {
+      unsigned char tag[kMaxCommandBytes];
+      tag[0] = (literal_count - 1) << 2;
+      write_bytes(tag, 1);
+
+      for (unsigned i = 0; i < literal_count; i += literals_per_cycle) {
+        OutDataT out_data;
+#pragma unroll
+        for (int j = 0; j < literals_per_cycle; j++) {
+          out_data.byte[j] = literal_string[i + j];
+        }
+        unsigned remaining = literal_count - i;
+        out_data.valid_count = (remaining < literals_per_cycle)
+                                   ? remaining
+                                   : literals_per_cycle;
+        OutPipe::write(OutPipeBundleT(out_data));
+      }
+      literal_count = 0;
+    }
+  };
+
+  bool done = false;
+  while (!done) {
+    bool data_valid;
+    auto pipe_data = InPipe::read(data_valid);
+    done = pipe_data.flag && data_valid;
+
+    if (data_valid && !done) {
+      if (pipe_data.data.is_literal) {
+        // append the literals to the literal string
+        unsigned count = pipe_data.data.valid_count;
+        if (literal_count + count > kSnappyMaxLiteralString) {
+          flush_literals();
+        }
+#pragma unroll
+        for (int j = 0; j < literals_per_cycle; j++) {
+          if (j < count) {
+            literal_string[literal_count + j] = pipe_data.data.literal[j];
+          }
+        }
+        literal_count += count;
+      } else {
+        // the literals before the copy must be written first
+        flush_literals();
+
+        unsigned length = pipe_data.data.length;
+        unsigned distance = pipe_data.data.distance;
+        unsigned char copy[kMaxCommandBytes];
+        if (length <= 11 && distance < 2048) {
+          // copy with a 1-byte offset: 3 bits of length - 4, 11 bits of offset
+          copy[0] = 0x01 | ((length - 4) << 2) | ((distance >> 8) << 5);
+          copy[1] = distance & 0xFF;
+          write_bytes(copy, 2);
+        } else {
+          // copy with a 2-byte offset: 6 bits of length - 1, 16 bits of offset
+          copy[0] = 0x02 | ((length - 1) << 2);
+          copy[1] = distance & 0xFF;
+          copy[2] = (distance >> 8) & 0xFF;
+          write_bytes(copy, 3);
+        }
+      }
+    }
+  }
+
+  flush_literals();
+
+  // notify downstream that we are done
+  OutPipe::write(OutPipeBundleT(true));
+}
+
+template <typename Id, typename InPipe, typename OutPipe,
+          unsigned literals_per_cycle>
+sycl::event SubmitSnappyWriter(sycl::queue& q, unsigned in_count) {
+  return q.single_task<Id>([=] {
+    SnappyWriter<InPipe, OutPipe, literals_per_cycle>(in_count);
+  });
+}
+
+#endif /* __SNAPPY_WRITER_HPP__ */
@@ -21,8 +21,16 @@ constexpr int minimum_filesize = kVec + 1;
 
 bool help = false;
 
+// The compression ratio (compressed size as a percentage of the input size)
+// and the throughput measured by CompressFile().
+struct CompressionStats {
+  double ratio;
+  double mbps;
+};
+
 int CompressFile(queue &q, std::string &input_file, std::vector<std::string> outfilenames,
-                 int iterations, bool report);
+                 int iterations, bool report, bool dynamic_huffman,
+                 struct CompressionStats *stats = nullptr);
 
 void Help(void) {
   // Command line arguments.
@@ -37,6 +45,10 @@ void Help(void) {
   std::cout << "  -h,--help                                : this help text\n";
   std::cout
       << "  -o=<filename>,--output-file=<filename>   : specify output file\n";
+  std::cout << "  -d,--dynamic                             : use dynamic "
+               "Huffman trees\n";
+  std::cout << "  -b,--benchmark                           : compare static "
+               "and dynamic Huffman trees\n";
 }
 
 bool FindGetArg(std::string &arg, const char *str, int defaultval, int *val) {
@@ -90,10 +102,13 @@ int main(int argc, char *argv[]) {
 
   char str_buffer[kMaxStringLen] = {0};
 
+  bool dynamic_huffman = false;
+  bool benchmark = false;
+
   // Check the number of arguments specified
-  if (argc != 3) {
+  if (argc < 3 || argc > 4) {
     std::cerr << "Incorrect number of arguments. Correct usage: " << argv[0]
-              << " <input-file> -o=<output-file>\n";
+              << " <input-file> -o=<output-file> [-d|--dynamic|-b|--benchmark]\n";
     return 1;
   }
 
@@ -106,6 +121,12 @@ int main(int argc, char *argv[]) {
       if (std::string(argv[i]) == "--help") {
         help = true;
       }
+      if (sarg == "-d" || sarg == "--dynamic") {
+        dynamic_huffman = true;
+      }
+      if (sarg == "-b" || sarg == "--benchmark") {
+        benchmark = true;
+      }
 
       FindGetArgString(sarg, "-o=", str_buffer, kMaxStringLen);
       FindGetArgString(sarg, "--output-file=", str_buffer, kMaxStringLen);
@@ -159,19 +180,45 @@ int main(int argc, char *argv[]) {
     std::cout << "Launching High-Bandwidth DMA GZIP application with " << kNumEngines
               << " engines\n";
 
+    // compresses the file with static or dynamic Huffman trees
+    auto run = [&](bool dynamic, struct CompressionStats *stats) {
+      std::cout << "Using " << (dynamic ? "dynamic" : "static")
+                << " Huffman trees\n";
 #ifdef FPGA_EMULATOR
-    CompressFile(q, infilename, outfilenames, 1, true);
+      return CompressFile(q, infilename, outfilenames, 1, true, dynamic, stats);
 #elif FPGA_SIMULATOR
-    CompressFile(q, infilename, outfilenames, 2, true);
+      return CompressFile(q, infilename, outfilenames, 2, true, dynamic, stats);
 #else
-    // warmup run - use this run to warmup accelerator. There are some steps in
-    // the runtime that are only executed on the first kernel invocation but not
-    // on subsequent invocations. So execute all that stuff here before we
-    // measure performance (in the next call to CompressFile().
-    CompressFile(q, infilename, outfilenames, 1, false);
-    // profile performance
-    CompressFile(q, infilename, outfilenames, 200, true);
+      // warmup run - use this run to warmup accelerator. There are some steps
+      // in the runtime that are only executed on the first kernel invocation
+      // but not on subsequent invocations. So execute all that stuff here
+      // before we measure performance (in the next call to CompressFile().
+      CompressFile(q, infilename, outfilenames, 1, false, dynamic);
+      // profile performance
+      return CompressFile(q, infilename, outfilenames, 200, true, dynamic,
+                          stats);
 #endif
+    };
+
+    if (benchmark) {
+      // compress the same file with both kinds of trees and compare
+      struct CompressionStats static_stats, dynamic_stats;
+      if (run(false, &static_stats) || run(true, &dynamic_stats)) {
+        return 1;
+      }
+
+      // NOTE: when run in emulation, the throughput does not accurately
+      // represent the performance of the kernels on real FPGA hardware
+      std::cout << "\nHuffman trees   Compression Ratio   Throughput (MB/s)\n";
+      std::cout << "static          " << static_stats.ratio << "%            "
+                << static_stats.mbps << "\n";
+      std::cout << "dynamic         " << dynamic_stats.ratio << "%            "
+                << dynamic_stats.mbps << "\n";
+    } else {
+      if (run(dynamic_huffman, nullptr)) {
+        return 1;
+      }
+    }
   } catch (sycl::exception const &e) {
     // Catches exceptions in the host code
     std::cerr << "Caught a SYCL host exception:\n" << e.what() << "\n";
@@ -207,11 +254,15 @@ struct KernelInfo {
   struct GzipOutInfo out_info[kMinBufferSize];
   int iteration;
   bool last_block;
+
+  // the LZ output of the block, stored by the dynamic Huffman kernel
+  buffer<struct DistLen, 1> *lz_buf;
 };
 
 // returns 0 on success, otherwise a non-zero failure code.
 int CompressFile(queue &q, std::string &input_file, std::vector<std::string> outfilenames,
-                 int iterations, bool report) {
+                 int iterations, bool report, bool dynamic_huffman,
+                 struct CompressionStats *stats) {
   size_t isz;
   char *pinbuf;
 
@@ -319,6 +370,11 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
                                 : new buffer<char, 1>(input_alloc_size);
       kinfo[eng][i].pobuf =
           i >= 3 ? kinfo[eng][i - 3].pobuf : new buffer<char, 1>(outputSize);
+      // one LZ output per kVec input bytes, plus the last one
+      kinfo[eng][i].lz_buf =
+          !dynamic_huffman ? nullptr
+          : i >= 3         ? kinfo[eng][i - 3].lz_buf
+                           : new buffer<struct DistLen, 1>(isz / kVec + 1);
       kinfo[eng][i].pobuf_decompress = (char *)malloc(kinfo[eng][i].file_size);
     }
   }
@@ -344,11 +400,7 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
   }
 
 
-#ifdef FPGA_EMULATOR
-#elif FPGA_SIMULATOR
-#else
   auto start = std::chrono::steady_clock::now();
-#endif
 
   
   /*************************************************/
@@ -371,7 +423,8 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
       SubmitGzipTasks(q, kinfo[eng][i].file_size, kinfo[eng][i].pibuf,
                       kinfo[eng][i].pobuf, kinfo[eng][i].gzip_out_buf,
                       kinfo[eng][i].current_crc, kinfo[eng][i].last_block,
-                      e_k_crc[eng], e_k_lz[eng], e_k_huff[eng], eng, i);
+                      e_k_crc[eng], e_k_lz[eng], e_k_huff[eng], eng, i,
+                      dynamic_huffman, kinfo[eng][i].lz_buf);
 
       // Transfer the output (compressed) data from device to host.
       e_output_dma[eng][i] = q.submit([&](handler &h) {
@@ -405,13 +458,9 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
   }
 
 // Stop the timer.
-#ifdef FPGA_EMULATOR
-#elif FPGA_SIMULATOR
-#else
   auto end = std::chrono::steady_clock::now();
   double diff_total = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
   double gbps = iterations * isz / (double)diff_total / 1000000000.0;
-#endif
 
   // Check the compressed file size from each iteration. Make sure the size is actually
   // less-than-or-equal to the input size. Also calculate the remaining CRC.
@@ -513,6 +562,11 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
     std::cout << "Compression Ratio " << compression_ratio * 100 << "%\n";
   }
 
+  if (stats != nullptr) {
+    stats->ratio = (double)compressed_sz[0] / (double)isz / iterations * 100;
+    stats->mbps = kNumEngines * gbps * 1000;
+  }
+
   // Cleanup anything that was allocated by this routine.
   for (int eng = 0; eng < kNumEngines; eng++) {
     for (int i = 0; i < buffers_count; i++) {
@@ -521,6 +575,7 @@ int CompressFile(queue &q, std::string &input_file, std::vector<std::string> out
         delete kinfo[eng][i].current_crc;
         delete kinfo[eng][i].pibuf;
         delete kinfo[eng][i].pobuf;
+        delete kinfo[eng][i].lz_buf;
         if (prepin) {
           free(kinfo[eng][i].poutput_buffer, q.get_context());
         } else {
@@ -598,19 +598,19 @@ int GetHuffBits(int len, int dist, unsigned char ch) {
   return bits;
 }
 
-// assembles up to kVecX2 unsigned char values based on given huffman encoding
-// writes up to kMaxHuffcodeBits * kVecX2 bits to memory
-bool HufEnc(char *len, short *dist, unsigned char *data, unsigned int *outdata,
-            unsigned int *leftover, unsigned short *leftover_size) {
+// assembles kVec codes of up to 32 bits each, given their lengths (code_len)
+// and their bits (code_bits, least significant bit first), into the output.
+// Writes kVec * 32 bits to outdata (and returns true) whenever enough bits
+// have been collected; the remaining bits are carried in leftover.
+bool PackBits(unsigned short *code_len, unsigned int *code_bits,
+              unsigned int *outdata, unsigned int *leftover,
+              unsigned short *leftover_size) {
   // array that contains the bit position of each symbol
   unsigned short bitpos[kVec + 1];
   bitpos[0] = 0;
 
-  Unroller<0, kVec>::step([&](int i) {
-    bitpos[i + 1] = bitpos[i] + (IsValid(len[i], dist[i], data[i])
-                                     ? GetHuffLen(len[i], dist[i], data[i])
-                                     : 0);
-  });
+  Unroller<0, kVec>::step(
+      [&](int i) { bitpos[i + 1] = bitpos[i] + code_len[i]; });
 
   // leftover is an array that carries huffman encoded data not yet written to
   // memory adjust leftover_size with the number of bits to write this time
@@ -642,20 +642,12 @@ bool HufEnc(char *len, short *dist, unsigned char *data, unsigned int *outdata,
 
   Unroller<0, kVec>::step([&](int i) {
     // Codes can be more than 16 bits, so use uint32
-    unsigned int curr_code = GetHuffBits(len[i], dist[i], data[i]);
+    unsigned int curr_code = code_bits[i];
     unsigned char bitpos_in_short = bitpos[i] & 0x01F;
 
     unsigned long long temp = (unsigned long long)curr_code << bitpos_in_short;
-    unsigned int temp1 = (unsigned int)temp;
-    unsigned int temp2 = temp >> 32ULL;
-
-    if (IsValid(len[i], dist[i], data[i])) {
-      code[i].x = temp1;
-      code[i].y = temp2;
-    } else {
-      code[i].x = temp1;
-      code[i].y = temp2;
-    }
+    code[i].x = (unsigned int)temp;
+    code[i].y = temp >> 32ULL;
   });
 
   // Iterate over all destination locations and gather the required data
@@ -701,12 +693,505 @@ bool HufEnc(char *len, short *dist, unsigned char *data, unsigned int *outdata,
   return write;
 }
 
+// assembles up to kVecX2 unsigned char values based on given huffman encoding
+// writes up to kMaxHuffcodeBits * kVecX2 bits to memory
+bool HufEnc(char *len, short *dist, unsigned char *data, unsigned int *outdata,
+            unsigned int *leftover, unsigned short *leftover_size) {
+  unsigned short code_len[kVec];
+  unsigned int code_bits[kVec];
+
+  Unroller<0, kVec>::step([&](int i) {
+    code_len[i] = IsValid(len[i], dist[i], data[i])
+                      ? GetHuffLen(len[i], dist[i], data[i])
+                      : 0;
+    code_bits[i] = GetHuffBits(len[i], dist[i], data[i]);
+  });
+
+  return PackBits(code_len, code_bits, outdata, leftover, leftover_size);
+}
+
+//-------------------------------------
+//   Dynamic Huffman trees
+//-------------------------------------
+
+// Maps a match length (kMinMatch to kMaxMatch) to its length code (0 to
+// kLengthCodes - 1, the symbol is kLiterals + 1 + code) and the value and
+// number of its extra bits.
+void GetLengthCode(int len, int *code, int *extra, int *extra_len) {
+  int base_length[kLengthCodes] = {
+      0,  1,  2,  3,  4,  5,  6,  7,  8,   10,  12,  14,  16,  20, 24,
+      28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 0,
+  };
+
+  int extra_lbits[kLengthCodes]  // extra bits for each length code
+      = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+  // the code is the last one whose base is not larger than the length.
+  // The longest match (kMaxMatch) has a code of its own.
+  int lc = len - kMinMatch;
+  int c = 0;
+  Unroller<1, kLengthCodes - 1>::step(
+      [&](int i) { c += (base_length[i] <= lc) ? 1 : 0; });
+  c = (len == kMaxMatch) ? kLengthCodes - 1 : c;
+
+  *code = c;
+  *extra = lc - base_length[c];
+  *extra_len = extra_lbits[c];
+}
+
+// Maps a match distance (1 to kMaxDistance) to its distance code and the
+// value and number of its extra bits.
+void GetDistCode(int dist, int *code, int *extra, int *extra_len) {
+  int extra_dbits[kDCodes]  // extra bits for each distance code
+      = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+         6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  int base_dist[kDCodes] = {
+      0,    1,    2,    3,    4,    6,    8,    12,    16,    24,
+      32,   48,   64,   96,   128,  192,  256,  384,   512,   768,
+      1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384, 24576,
+  };
+
+  // the code is the last one whose base is not larger than the distance
+  int d = dist - 1;
+  int c = 0;
+  Unroller<1, kDCodes>::step([&](int i) { c += (base_dist[i] <= d) ? 1 : 0; });
+
+  *code = c;
+  *extra = d - base_dist[c];
+  *extra_len = extra_dbits[c];
+}
+
+// Computes the lengths of a Huffman code for the n symbol frequencies in
+// freq, with no code longer than max_bits. Unused symbols get a length of 0.
+// If fewer than two symbols are used, symbols 0 and 1 are used so that the
+// code is complete, like gzip does.
+void BuildCodeLengths(const unsigned int *freq, int n, int max_bits,
+                      unsigned char *lengths) {
+  // the used symbols sorted by increasing frequency, and the weight and parent
+  // of each node of the tree (the leaves first, then the internal nodes)
+  short sorted[kLCodes];
+  unsigned int weight[2 * kLCodes];
+  short parent[2 * kLCodes];
+  short depth[2 * kLCodes];
+
+  // the number of codes of each length. The tree can be as deep as the number
+  // of symbols before it is limited to max_bits.
+  short bl_count[kLCodes + 1];
+
+  int used = 0;
+  for (int s = 0; s < n; s++) {
+    used += (freq[s] != 0) ? 1 : 0;
+  }
+
+  int count = 0;
+  for (int s = 0; s < n; s++) {
+    lengths[s] = 0;
+    unsigned int f = (used < 2 && s < 2 && freq[s] == 0) ? 1 : freq[s];
+
+    // insertion sort
+    if (f != 0) {
+      int j = count;
+      while (j > 0 && weight[j - 1] > f) {
+        sorted[j] = sorted[j - 1];
+        weight[j] = weight[j - 1];
+        j--;
+      }
+      sorted[j] = s;
+      weight[j] = f;
+      count++;
+    }
+  }
+
+  // build the tree by repeatedly merging the two lightest nodes. The leaves
+  // are sorted and the internal nodes are created in order of weight, so the
+  // lightest node is at the front of one of the two queues.
+  int next_leaf = 0;
+  int next_node = count;
+  int last_node = count;
+  for (int k = 0; k < count - 1; k++) {
+    int pick[2];
+    for (int p = 0; p < 2; p++) {
+      bool use_leaf = next_leaf < count &&
+                      (next_node == last_node ||
+                       weight[next_leaf] <= weight[next_node]);
+      pick[p] = use_leaf ? next_leaf++ : next_node++;
+    }
+    weight[last_node] = weight[pick[0]] + weight[pick[1]];
+    parent[pick[0]] = last_node;
+    parent[pick[1]] = last_node;
+    last_node++;
+  }
+
+  // the depth of each node, from the root down. Parents always come after
+  // their children.
+  int max_len = count > max_bits ? count : max_bits;
+  for (int len = 0; len <= max_len; len++) {
+    bl_count[len] = 0;
+  }
+  int max_depth = 0;
+  depth[last_node - 1] = 0;
+  for (int node = last_node - 2; node >= 0; node--) {
+    depth[node] = depth[parent[node]] + 1;
+    if (node < count) {
+      bl_count[depth[node]]++;
+      max_depth = depth[node] > max_depth ? depth[node] : max_depth;
+    }
+  }
+
+  // limit the code lengths to max_bits: move pairs of the deepest leaves up a
+  // level, and make room for them by moving a shallower leaf down a level
+  for (int len = max_depth; len > max_bits; len--) {
+    while (bl_count[len] > 0) {
+      int j = len - 2;
+      while (bl_count[j] == 0) j--;
+      bl_count[len] -= 2;
+      bl_count[len - 1] += 1;
+      bl_count[j + 1] += 2;
+      bl_count[j] -= 1;
+    }
+  }
+
+  // give the longest codes to the least frequent symbols
+  int k = 0;
+  for (int len = max_bits; len > 0; len--) {
+    for (int c = 0; c < bl_count[len]; c++) {
+      lengths[sorted[k++]] = len;
+    }
+  }
+}
+
+// Computes the canonical Huffman codes for the n code lengths in lengths, as
+// defined by the DEFLATE format. The codes are bit reversed, since they are
+// written to the output least significant bit first.
+void BuildCanonicalCodes(const unsigned char *lengths, int n,
+                         unsigned short *codes) {
+  unsigned short bl_count[kMaxBits + 1];
+  unsigned short next_code[kMaxBits + 1];
+
+  Unroller<0, kMaxBits + 1>::step([&](int i) { bl_count[i] = 0; });
+  for (int s = 0; s < n; s++) {
+    bl_count[lengths[s]]++;
+  }
+  bl_count[0] = 0;
+
+  unsigned short code = 0;
+  next_code[0] = 0;
+  Unroller<1, kMaxBits + 1>::step([&](int bits) {
+    code = (code + bl_count[bits - 1]) << 1;
+    next_code[bits] = code;
+  });
+
+  for (int s = 0; s < n; s++) {
+    int len = lengths[s];
+    unsigned short c = next_code[len]++;
+    unsigned short reversed = 0;
+    Unroller<0, kMaxBits>::step([&](int i) {
+      reversed |= (i < len) ? (((c >> i) & 1) << (len - 1 - i)) : 0;
+    });
+    codes[s] = len ? reversed : 0;
+  }
+}
+
 template <int engineID>
 class CRC;
 template <int engineID>
 class LZReduction;
 template <int engineID>
 class StaticHuffman;
+template <int engineID>
+class DynamicHuffman;
+// Submits the DynamicHuffman kernel, which encodes the LZ output of a block
+// (read from InPipe and, for the last kVec bytes, InPipeLast) as a single
+// DEFLATE block with dynamic Huffman trees (BTYPE=2):
+//    1. A histogram of the literal/length and distance symbols of the block is
+//       computed while the LZ output is stored in lz_buf.
+//    2. The code lengths are built from the histogram, limited to kMaxBits,
+//       along with the canonical codes.
+//    3. The block header (the run-length encoded code lengths) is written,
+//       followed by the stored LZ output encoded with the new codes.
+template <int engineID, typename InPipe, typename InPipeLast>
+void SubmitDynamicHuffman(queue &q, size_t block_size, buffer<char, 1> *pobuf,
+                          buffer<struct GzipOutInfo, 1> *gzip_out_buf,
+                          buffer<struct DistLen, 1> *lz_buf, bool last_block,
+                          std::vector<event> &e_huff, int buffer_index) {
+  e_huff[buffer_index] = q.submit([&](handler &h) {
+    auto accessor_isz = block_size;
+    auto acc_gzip_out =
+        gzip_out_buf->get_access<access::mode::discard_write>(h);
+    auto accessor_output = pobuf->get_access<access::mode::discard_write>(h);
+    auto acc_lz = lz_buf->get_access<access::mode::read_write>(h);
+    auto acc_eof = last_block ? 1 : 0;
+    h.single_task<DynamicHuffman<engineID>>([=
+    ]() [[intel::kernel_args_restrict]] {
+      // the number of LZ outputs for this block (see LZReduction)
+      int num_vecs = (accessor_isz / kVec) + 1;
+
+      //-----------------------------
+      // Symbol histogram
+      //-----------------------------
+
+      // each lane counts into its own copy of the histogram, so that the kVec
+      // updates of an iteration never go to the same memory
+      unsigned int lit_hist[kVec][kLCodes];
+      unsigned int dist_hist[kVec][kDCodes];
+      for (int s = 0; s < kLCodes; s++) {
+        Unroller<0, kVec>::step([&](int i) { lit_hist[i][s] = 0; });
+      }
+      for (int s = 0; s < kDCodes; s++) {
+        Unroller<0, kVec>::step([&](int i) { dist_hist[i][s] = 0; });
+      }
+
+      for (int v = 0; v < num_vecs; v++) {
+        struct DistLen in =
+            (v < num_vecs - 1) ? InPipe::read() : InPipeLast::read();
+
+        // store the LZ output until the trees are built
+        acc_lz[v] = in;
+
+        Unroller<0, kVec>::step([&](int i) {
+          int code, extra, extra_len;
+          if (in.len[i] == 0) {
+            lit_hist[i][in.data[i]]++;
+          } else if (in.len[i] > 0) {
+            GetLengthCode(in.len[i], &code, &extra, &extra_len);
+            lit_hist[i][kLiterals + 1 + code]++;
+            GetDistCode(in.dist[i], &code, &extra, &extra_len);
+            dist_hist[i][code]++;
+          }
+        });
+      }
+
+      unsigned int lit_freq[kLCodes];
+      unsigned int dist_freq[kDCodes];
+      for (int s = 0; s < kLCodes; s++) {
+        lit_freq[s] = 0;
+        Unroller<0, kVec>::step([&](int i) { lit_freq[s] += lit_hist[i][s]; });
+      }
+      for (int s = 0; s < kDCodes; s++) {
+        dist_freq[s] = 0;
+        Unroller<0, kVec>::step(
+            [&](int i) { dist_freq[s] += dist_hist[i][s]; });
+      }
+      lit_freq[kEndBlock] = 1;
+
+      //-----------------------------
+      // Build the trees
+      //-----------------------------
+
+      unsigned char lit_len[kLCodes];
+      unsigned short lit_code[kLCodes];
+      unsigned char dist_len[kDCodes];
+      unsigned short dist_codes[kDCodes];
+      BuildCodeLengths(lit_freq, kLCodes, kMaxBits, lit_len);
+      BuildCodeLengths(dist_freq, kDCodes, kMaxBits, dist_len);
+      BuildCanonicalCodes(lit_len, kLCodes, lit_code);
+      BuildCanonicalCodes(dist_len, kDCodes, dist_codes);
+
+      // the number of literal/length and distance code lengths to send
+      int hlit = kLCodes;
+      while (hlit > kLiterals + 1 && lit_len[hlit - 1] == 0) hlit--;
+      int hdist = kDCodes;
+      while (hdist > 1 && dist_len[hdist - 1] == 0) hdist--;
+
+      // run-length encode the code lengths with the code length alphabet:
+      // 0-15 are lengths, 16 repeats the previous length 3-6 times, and 17
+      // and 18 repeat a length of 0 3-10 and 11-138 times, respectively
+      unsigned char rle_sym[kLCodes + kDCodes];
+      unsigned char rle_extra[kLCodes + kDCodes];
+      unsigned int bl_freq[kBLCodes];
+      Unroller<0, kBLCodes>::step([&](int i) { bl_freq[i] = 0; });
+
+      int total = hlit + hdist;
+      int rle_count = 0;
+      int pos = 0;
+      while (pos < total) {
+        unsigned char cur =
+            pos < hlit ? lit_len[pos] : dist_len[pos - hlit];
+        int max_run = cur == 0 ? 138 : 7;
+        int run = 1;
+        bool same = true;
+        while (same && pos + run < total && run < max_run) {
+          unsigned char next = (pos + run) < hlit ? lit_len[pos + run]
+                                                  : dist_len[pos + run - hlit];
+          same = next == cur;
+          run += same ? 1 : 0;
+        }
+
+        if (cur == 0 && run >= 11) {
+          rle_sym[rle_count] = 18;
+          rle_extra[rle_count++] = run - 11;
+        } else if (cur == 0 && run >= 3) {
+          rle_sym[rle_count] = 17;
+          rle_extra[rle_count++] = run - 3;
+        } else if (cur != 0 && run >= 4) {
+          rle_sym[rle_count] = cur;
+          rle_extra[rle_count++] = 0;
+          rle_sym[rle_count] = 16;
+          rle_extra[rle_count++] = run - 4;
+        } else {
+          run = 1;
+          rle_sym[rle_count] = cur;
+          rle_extra[rle_count++] = 0;
+        }
+        pos += run;
+      }
+
+      for (int r = 0; r < rle_count; r++) {
+        bl_freq[rle_sym[r]]++;
+      }
+
+      unsigned char bl_len[kBLCodes];
+      unsigned short bl_code[kBLCodes];
+      BuildCodeLengths(bl_freq, kBLCodes, kMaxBLBits, bl_len);
+      BuildCanonicalCodes(bl_len, kBLCodes, bl_code);
+
+      // the order in which the code length code lengths are sent
+      const unsigned char bl_order[kBLCodes] = {
+          16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+      int hclen = kBLCodes;
+      while (hclen > 4 && bl_len[bl_order[hclen - 1]] == 0) hclen--;
+
+      //-----------------------------
+      // Block header
+      //-----------------------------
+
+      // the header as a list of codes, each with its extra bits
+      constexpr int kMaxHeaderCodes = 1 + kBLCodes + kLCodes + kDCodes;
+      constexpr int kHeaderSlots =
+          ((kMaxHeaderCodes + kVec - 1) / kVec) * kVec;
+      unsigned short header_len[kHeaderSlots];
+      unsigned int header_bits[kHeaderSlots];
+      for (int k = 0; k < kHeaderSlots; k++) {
+        header_len[k] = 0;
+        header_bits[k] = 0;
+      }
+
+      // BFINAL, BTYPE, HLIT, HDIST and HCLEN
+      header_bits[0] = acc_eof | (2 << 1) | ((hlit - (kLiterals + 1)) << 3) |
+                       ((hdist - 1) << 8) | ((hclen - 4) << 13);
+      header_len[0] = 17;
+      int header_count = 1;
+
+      for (int k = 0; k < hclen; k++) {
+        header_bits[header_count] = bl_len[bl_order[k]];
+        header_len[header_count++] = 3;
+      }
+
+      for (int r = 0; r < rle_count; r++) {
+        unsigned char sym = rle_sym[r];
+        int extra_len = sym == 16 ? 2 : (sym == 17 ? 3 : (sym == 18 ? 7 : 0));
+        header_bits[header_count] = bl_code[sym] | (rle_extra[r] << bl_len[sym]);
+        header_len[header_count++] = bl_len[sym] + extra_len;
+      }
+
+      //-----------------------------
+      // Huffman encode
+      //-----------------------------
+
+      unsigned int leftover[kVec] = {0};
+      Unroller<0, kVec>::step([&](int i) { leftover[i] = 0; });
+
+      unsigned short leftover_size = 0;
+
+      unsigned int outpos_huffman = 0;
+
+      int odx = 0;
+
+      // adds kVec codes to the output, and writes it out when enough bits have
+      // been collected
+      auto pack = [&](unsigned short *code_len, unsigned int *code_bits) {
+        struct HuffmanOutput outdata;
+        outdata.write = PackBits(code_len, code_bits, outdata.data, leftover,
+                                 &leftover_size);
+
+        // prevent out of bounds write
+        if (outdata.write && (odx < accessor_isz)) {
+          Unroller<0, kVec * sizeof(unsigned int)>::step([&](int i) {
+            accessor_output[odx + i] =
+                (unsigned char)(outdata.data[(i >> 2) & (kVec - 1)] >>
+                                ((i & 3) << 3));
+          });
+        }
+
+        outpos_huffman = outdata.write ? outpos_huffman + 1 : outpos_huffman;
+        odx += outdata.write ? (sizeof(unsigned int) << kVecPow) : 0;
+      };
+
+      int header_vecs = (header_count + kVec - 1) / kVec;
+      for (int v = 0; v < header_vecs; v++) {
+        unsigned short code_len[kVec];
+        unsigned int code_bits[kVec];
+        Unroller<0, kVec>::step([&](int i) {
+          code_len[i] = header_len[v * kVec + i];
+          code_bits[i] = header_bits[v * kVec + i];
+        });
+        pack(code_len, code_bits);
+      }
+
+      for (int v = 0; v < num_vecs; v++) {
+        struct DistLen in = acc_lz[v];
+
+        // a match can take up to 48 bits with dynamic trees, so the
+        // literal/length code and the distance code of every symbol are
+        // packed separately, kVec codes at a time
+        unsigned short code_len[kVecX2];
+        unsigned int code_bits[kVecX2];
+        Unroller<0, kVec>::step([&](int i) {
+          int code, extra, extra_len;
+          code_len[2 * i] = 0;
+          code_bits[2 * i] = 0;
+          code_len[2 * i + 1] = 0;
+          code_bits[2 * i + 1] = 0;
+
+          if (in.len[i] == 0) {
+            code_len[2 * i] = lit_len[in.data[i]];
+            code_bits[2 * i] = lit_code[in.data[i]];
+          } else if (in.len[i] > 0) {
+            GetLengthCode(in.len[i], &code, &extra, &extra_len);
+            int sym = kLiterals + 1 + code;
+            code_len[2 * i] = lit_len[sym] + extra_len;
+            code_bits[2 * i] = lit_code[sym] | (extra << lit_len[sym]);
+
+            GetDistCode(in.dist[i], &code, &extra, &extra_len);
+            code_len[2 * i + 1] = dist_len[code] + extra_len;
+            code_bits[2 * i + 1] = dist_codes[code] | (extra << dist_len[code]);
+          }
+        });
+
+        pack(&code_len[0], &code_bits[0]);
+        pack(&code_len[kVec], &code_bits[kVec]);
+      }
+
+      // the end of block code
+      unsigned short eob_len[kVec];
+      unsigned int eob_bits[kVec];
+      Unroller<0, kVec>::step([&](int i) {
+        eob_len[i] = 0;
+        eob_bits[i] = 0;
+      });
+      eob_len[0] = lit_len[kEndBlock];
+      eob_bits[0] = lit_code[kEndBlock];
+      pack(eob_len, eob_bits);
+
+      // write the remaining bits
+      if (odx < accessor_isz) {
+        Unroller<0, kVec * sizeof(unsigned int)>::step([&](int i) {
+          accessor_output[odx + i] =
+              (unsigned char)(leftover[(i >> 2) & (kVec - 1)] >>
+                              ((i & 3) << 3));
+        });
+      }
+
+      // Store summary values from lz and huffman
+      acc_gzip_out[0].compression_sz =
+          (outpos_huffman * sizeof(unsigned int) * kVec) +
+          (leftover_size + 7) / 8;
+    });
+  });
+}
+
 template <int engineID>
 void SubmitGzipTasksSingleEngine(
     queue &q,
@@ -714,10 +1199,17 @@ void SubmitGzipTasksSingleEngine(
     buffer<char, 1> *pibuf, buffer<char, 1> *pobuf,
     buffer<struct GzipOutInfo, 1> *gzip_out_buf,
     buffer<unsigned, 1> *result_crc, bool last_block, std::vector<event> &e_crc, std::vector<event> &e_lz,
-    std::vector<event> &e_huff, int buffer_index) {
+    std::vector<event> &e_huff, int buffer_index, bool dynamic_huffman,
+    buffer<struct DistLen, 1> *lz_buf) {
   using acc_dist_channel = ext::intel::pipe<class some_pipe, struct DistLen>;
   using acc_dist_channel_last = ext::intel::pipe<class some_pipe2, struct DistLen>;
 
+  // the LZ output goes to the DynamicHuffman kernel through these pipes when
+  // dynamic Huffman trees are used
+  using dyn_dist_channel = ext::intel::pipe<class some_pipe3, struct DistLen>;
+  using dyn_dist_channel_last =
+      ext::intel::pipe<class some_pipe4, struct DistLen>;
+
   e_crc[buffer_index] = q.submit([&](handler &h) {
     auto accessor_isz = block_size;
     auto acc_pibuf = pibuf->get_access<access::mode::read>(h);
@@ -1977,6 +2469,7 @@ void SubmitGzipTasksSingleEngine(
   e_lz[buffer_index] = q.submit([&](handler &h) {
     auto accessor_isz = block_size;
     auto acc_pibuf = pibuf->get_access<access::mode::read>(h);
+    auto acc_dynamic = dynamic_huffman;
 
     h.single_task<LZReduction<engineID>>([=]() [[intel::kernel_args_restrict]] {
       //-------------------------------------
@@ -2255,7 +2748,11 @@ void SubmitGzipTasksSingleEngine(
           }
         });
 
-        acc_dist_channel::write(dist_offs_data);
+        if (acc_dynamic) {
+          dyn_dist_channel::write(dist_offs_data);
+        } else {
+          acc_dist_channel::write(dist_offs_data);
+        }
 
         // increment input position
         inpos_minus_vec_div_16++;
@@ -2278,10 +2775,21 @@ void SubmitGzipTasksSingleEngine(
         dist_offs_data.len[i] = pred ? 0 : -1;
       });
 
-      acc_dist_channel_last::write(dist_offs_data);
+      if (acc_dynamic) {
+        dyn_dist_channel_last::write(dist_offs_data);
+      } else {
+        acc_dist_channel_last::write(dist_offs_data);
+      }
     });
   });
 
+  if (dynamic_huffman) {
+    SubmitDynamicHuffman<engineID, dyn_dist_channel, dyn_dist_channel_last>(
+        q, block_size, pobuf, gzip_out_buf, lz_buf, last_block, e_huff,
+        buffer_index);
+    return;
+  }
+
   e_huff[buffer_index] = q.submit([&](handler &h) {
     auto accessor_isz = block_size;
     auto acc_gzip_out =
@@ -2353,19 +2861,23 @@ void SubmitGzipTasks(queue &q,
                      buffer<struct GzipOutInfo, 1> *gzip_out_buf,
                      buffer<unsigned, 1> *result_crc, bool last_block,
                      std::vector<event> &e_crc, std::vector<event> &e_lz, std::vector<event> &e_huff,
-                     size_t engineID, int buffer_index) {
+                     size_t engineID, int buffer_index, bool dynamic_huffman,
+                     buffer<struct DistLen, 1> *lz_buf) {
   // Statically declare the engines so that the hardware is created for them.
   // But at run time, the host can dynamically select which engine(s) to use via
-  // engineID.
+  // engineID. Likewise, both the static and the dynamic Huffman kernels are
+  // created for every engine, and dynamic_huffman selects one at run time.
   if (engineID == 0) {
     SubmitGzipTasksSingleEngine<0>(q, block_size, pibuf, pobuf, gzip_out_buf,
-                                   result_crc, last_block, e_crc, e_lz, e_huff, buffer_index);
+                                   result_crc, last_block, e_crc, e_lz, e_huff, buffer_index,
+                                   dynamic_huffman, lz_buf);
   }
 
   #if NUM_ENGINES > 1
     if (engineID == 1) {
       SubmitGzipTasksSingleEngine<1>(q, block_size, pibuf, pobuf, gzip_out_buf,
-                                     result_crc, last_block, e_crc, e_lz, e_huff, buffer_index);
+                                     result_crc, last_block, e_crc, e_lz, e_huff, buffer_index,
+                                     dynamic_huffman, lz_buf);
     }
   #endif
 
@@ -12,6 +12,7 @@ extern "C" void SubmitGzipTasks(
     buffer<char, 1> *pibuf, buffer<char, 1> *pobuf,
     buffer<struct GzipOutInfo, 1> *gzip_out_buf,
     buffer<unsigned, 1> *current_crc, bool last_block, std::vector<event> &e_crc,
-    std::vector<event> &e_lz, std::vector<event> &e_huff, size_t engineID, int buffer_index);
+    std::vector<event> &e_lz, std::vector<event> &e_huff, size_t engineID, int buffer_index,
+    bool dynamic_huffman, buffer<struct DistLen, 1> *lz_buf);
 
 #endif  //__GZIPKERNEL_H__
@@ -125,6 +125,9 @@ constexpr int kDCodes = 30;
 // number of codes used to transfer the bit lengths
 constexpr int kBLCodes = 19;
 
+// The codes used to transfer the bit lengths must not exceed kMaxBLBits
+constexpr int kMaxBLBits = 7;
+
 constexpr int kMaxDistance = ((32 * 1024));
 
 constexpr int kMinBufferSize = 16384;
@@ -1,6 +1,7 @@
 #ifndef __MATMUL_HPP__
 #define __MATMUL_HPP__
 
+#include <algorithm>
 #include <iostream>
 
 #include <sycl/ext/intel/ac_types/ac_int.hpp>
@@ -25,6 +26,14 @@ class APipe;
 class BPipe;
 class CPipe;
 class DonePipe;
+class GemmFeederA;
+class GemmFeederB;
+class Gemm;
+class GemmDrain;
+class GemmAPipe;
+class GemmBPipe;
+class GemmCPipe;
+class GemmDonePipe;
 
 /**
  * Implementation of the matrix multiplication using multiple streaming kernels.
@@ -141,4 +150,174 @@ void MatmulImpl(sycl::queue &q,            // Device queue
   sycl::free(c, q);
 }
 
+/**
+ * Implementation of the general matrix multiplication
+ * C = alpha * op(A) * op(B) + beta * C
+ * where op(X) is X or its transpose, using multiple streaming kernels.
+ * Parameterized by datatype and tile size; the matrix sizes are runtime
+ * values, up to "max_common" for the common dimension. Tiles that extend
+ * beyond the matrices are padded with zeros by the feeder kernels and cropped
+ * by the drain kernel, so any matrix size is supported. Exercises the kernels
+ * by running multiple repetitions of the computation.
+ *
+ * All matrices are stored in column-major order (i.e., the MatmulImpl layout
+ * corresponds to transpose_a = false and transpose_b = true).
+ *
+ * Function arguments:
+ *  q: device queue
+ *  transpose_a: whether op(A) is the transpose of A
+ *  transpose_b: whether op(B) is the transpose of B
+ *  rows_a: rows of op(A) and C
+ *  common: columns of op(A) / rows of op(B)
+ *  cols_b: columns of op(B) and C
+ *  alpha: scaling factor of op(A) * op(B)
+ *  a_matrix: input matrix A
+ *  b_matrix: input matrix B
+ *  beta: scaling factor of the input C matrix
+ *  c_matrix: input and output matrix C
+ *  repetitions: number of repetitions of the computation to execute
+ *
+ * Returns the duration of the computation in seconds, or a negative value if
+ * the computation could not be run.
+ *
+ */
+template <typename TT,   // Datatype of the elements of the matrix
+          int max_common, // Maximum columns of op(A) / rows of op(B)
+          int tile_a,    // Tile size for matrix A
+          int tile_b>    // Tile size for matrix B
+double GemmImpl(sycl::queue &q,            // Device queue
+                bool transpose_a,          // Transpose A
+                bool transpose_b,          // Transpose B
+                int rows_a,                // Rows of op(A)
+                int common,                // Columns of op(A) / rows of op(B)
+                int cols_b,                // Columns of op(B)
+                TT alpha,                  // Scaling factor of op(A) * op(B)
+                std::vector<TT> &a_matrix, // Input matrix A
+                std::vector<TT> &b_matrix, // Input matrix B
+                TT beta,                   // Scaling factor of C
+                std::vector<TT> &c_matrix, // Input/output matrix C
+                int repetitions            // Number of repetitions
+) {
+  if ((rows_a < 1) || (common < 1) || (cols_b < 1) || (repetitions < 1)) {
+    std::cerr << "The matrix sizes and the number of repetitions must be "
+                 "positive"
+              << std::endl;
+    return -1;
+  }
+  if (common > max_common) {
+    std::cerr << "The common dimension " << common
+              << " exceeds the maximum supported value " << max_common
+              << std::endl;
+    return -1;
+  }
+
+  // The compute kernel needs at least tile_b columns of op(A) per tile to
+  // write a result tile before computing the next one; smaller common
+  // dimensions are padded with zeros
+  int common_padded = std::max(common, tile_b);
+
+  // Matrix sizes
+  int matsize_a = rows_a * common;
+  int matsize_b = cols_b * common;
+  int matsize_c = rows_a * cols_b;
+
+  // Buffer locations for mmhost interfaces
+  constexpr int kBL1 = 1;
+  constexpr int kBL2 = 2;
+  constexpr int kBL3 = 3;
+  constexpr int kBL4 = 4;
+
+  // Allocate FPGA DDR memory
+#if defined(IS_BSP)
+  TT *a = sycl::malloc_device<TT>(matsize_a, q);
+  TT *b = sycl::malloc_device<TT>(matsize_b, q);
+  TT *c_in = sycl::malloc_device<TT>(matsize_c, q);
+  TT *c_out = sycl::malloc_device<TT>(matsize_c, q);
+#else
+  // malloc_device are not supported when targetting an FPGA part/family
+  TT *a = sycl::malloc_shared<TT>(matsize_a, q,
+                                  sycl::property_list{buffer_location(kBL1)});
+  TT *b = sycl::malloc_shared<TT>(matsize_b, q,
+                                  sycl::property_list{buffer_location(kBL2)});
+  TT *c_in = sycl::malloc_shared<TT>(
+      matsize_c, q, sycl::property_list{buffer_location(kBL3)});
+  TT *c_out = sycl::malloc_shared<TT>(
+      matsize_c, q, sycl::property_list{buffer_location(kBL4)});
+#endif
+
+  if ((a == nullptr) || (b == nullptr) || (c_in == nullptr) ||
+      (c_out == nullptr)) {
+    std::cerr << "Error when allocating FPGA DDR" << std::endl;
+    std::cerr << "The FPGA DDR may be full" << std::endl;
+    std::cerr << "Try reducing the matrix sizes" << std::endl;
+    // Release whichever allocations succeeded (freeing nullptr is a no-op)
+    sycl::free(a, q);
+    sycl::free(b, q);
+    sycl::free(c_in, q);
+    sycl::free(c_out, q);
+    return -1;
+  }
+
+  // Copy matrices over; C_in and C_out are distinct so that every repetition
+  // computes the same result
+  q.memcpy(a, a_matrix.data(), matsize_a * sizeof(TT)).wait();
+  q.memcpy(b, b_matrix.data(), matsize_b * sizeof(TT)).wait();
+  q.memcpy(c_in, c_matrix.data(), matsize_c * sizeof(TT)).wait();
+
+  using PipeDataA = fpga_tools::NTuple<TT, tile_a>;
+  using PipeDataB = fpga_tools::NTuple<TT, tile_b>;
+  using PipeDataC = fpga_tools::NTuple<TT, tile_a>;
+
+  // Pipes to communicate the matrices between kernels
+  using PipeA = sycl::ext::intel::pipe<GemmAPipe, PipeDataA, 64>;
+  using PipeB = sycl::ext::intel::pipe<GemmBPipe, PipeDataB, 64>;
+  using PipeC = sycl::ext::intel::pipe<GemmCPipe, PipeDataC, 64>;
+  using PipeDone = sycl::ext::intel::pipe<GemmDonePipe, bool, 64>;
+
+  // Producer kernel for matrix A
+  auto feeder_a_event = q.single_task<GemmFeederA>(
+      GemmReadFromDDRToPipeA<TT, kBL1, tile_a, tile_b, PipeA, PipeDone>{
+          a, rows_a, common, common_padded, cols_b, transpose_a,
+          repetitions});
+
+  // Producer kernel for matrix B
+  auto feeder_b_event = q.single_task<GemmFeederB>(
+      GemmReadFromDDRToPipeB<TT, kBL2, tile_a, tile_b, PipeB>{
+          b, rows_a, common, common_padded, cols_b, transpose_b,
+          repetitions});
+
+  // Matrix multiply kernel
+  auto matmul_event = q.single_task<Gemm>(
+      fpga_linalg::StreamingMatmul<TT, max_common, tile_a, tile_b, PipeA,
+                                   PipeB, PipeC, PipeDone>{common_padded});
+
+  // Consumer kernel for matrix C
+  auto drain_event = q.single_task<GemmDrain>(
+      GemmReadPipeToDDR<TT, kBL3, kBL4, tile_a, tile_b, PipeC>{
+          c_in, c_out, rows_a, cols_b, alpha, beta, repetitions});
+
+  feeder_a_event.wait();
+  feeder_b_event.wait();
+  matmul_event.wait();
+  drain_event.wait();
+
+  // Compute the total time the execution lasted
+  auto start_time = feeder_a_event.template get_profiling_info<
+      sycl::info::event_profiling::command_start>();
+  auto end_time = drain_event.template get_profiling_info<
+      sycl::info::event_profiling::command_end>();
+  double diff = (end_time - start_time) / 1.0e9;
+
+  // Copy result matrix back
+  q.memcpy(c_matrix.data(), c_out, matsize_c * sizeof(TT)).wait();
+
+  // Free USM
+  sycl::free(a, q);
+  sycl::free(b, q);
+  sycl::free(c_in, q);
+  sycl::free(c_out, q);
+
+  return diff;
+}
+
 #endif /* __MATMUL_HPP__ */
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 
@@ -115,6 +117,124 @@ void MatmulRef(std::vector<float> &a_matrix, std::vector<float> &b_matrix,
   }
 }
 
+#if defined(GEMM)
+// Computes C = alpha * op(A) * op(B) + beta * C in double precision, with all
+// matrices stored in column-major order.
+void GemmRef(bool transpose_a, bool transpose_b, int rows_a, int common,
+             int cols_b, float alpha, std::vector<float> &a_matrix,
+             std::vector<float> &b_matrix, float beta,
+             std::vector<float> &c_matrix) {
+  for (int col = 0; col < cols_b; col++) {
+    for (int row = 0; row < rows_a; row++) {
+      double sum = 0;
+      for (int k = 0; k < common; k++) {
+        float a = transpose_a ? a_matrix[row * common + k]
+                              : a_matrix[k * rows_a + row];
+        float b = transpose_b ? b_matrix[k * cols_b + col]
+                              : b_matrix[col * common + k];
+        sum += static_cast<double>(a) * b;
+      }
+      int idx = col * rows_a + row;
+      double c = (beta != 0) ? beta * static_cast<double>(c_matrix[idx]) : 0;
+      c_matrix[idx] = static_cast<float>(alpha * sum + c);
+    }
+  }
+}
+
+// Runs the GEMM kernels on a sweep of matrix shapes, including sizes that are
+// not multiples of the tile sizes and transposed operands, and reports the
+// throughput of each shape in GFLOPs.
+template <int max_common, int tile_a, int tile_b>
+int RunGemmSweep(sycl::queue &q, int repetitions) {
+  struct GemmShape {
+    int rows_a;
+    int common;
+    int cols_b;
+    bool transpose_a;
+    bool transpose_b;
+    float alpha;
+    float beta;
+  };
+
+  std::vector<GemmShape> shapes = {
+      {64, 64, 64, false, true, 1.0f, 0.0f},
+      {64, 64, 64, false, false, 1.0f, 0.0f},
+      {100, 37, 75, false, false, 2.0f, 0.5f},
+      {7, 5, 3, true, false, -1.0f, 1.0f},
+      {129, 200, 65, true, true, 0.5f, -2.0f},
+      {256, 128, 256, false, false, 1.0f, 1.0f},
+      {33, 513, 17, false, true, 1.0f, 0.0f},
+      {512, 512, 512, false, false, 1.0f, 0.0f},
+  };
+
+  // Relative error threshold value
+  constexpr double kEpsilon = 1e-4;
+
+  std::cout << "Running the GEMM sweep " << repetitions << " times per shape"
+            << " (systolic array size: " << tile_a << " x " << tile_b
+            << " PEs)" << std::endl;
+  std::cout << std::setw(6) << "M" << std::setw(6) << "K" << std::setw(6)
+            << "N" << std::setw(4) << "TA" << std::setw(4) << "TB"
+            << std::setw(7) << "alpha" << std::setw(7) << "beta"
+            << std::setw(12) << "GFLOPs" << std::setw(10) << "Status"
+            << std::endl;
+
+  bool passed = true;
+  srand(1138);
+  for (auto &shape : shapes) {
+    int matsize_a = shape.rows_a * shape.common;
+    int matsize_b = shape.common * shape.cols_b;
+    int matsize_c = shape.rows_a * shape.cols_b;
+
+    std::vector<float> a_matrix(matsize_a);
+    std::vector<float> b_matrix(matsize_b);
+    std::vector<float> c_matrix(matsize_c);
+    FillRand(a_matrix, -1, 1, matsize_a);
+    FillRand(b_matrix, -1, 1, matsize_b);
+    FillRand(c_matrix, -1, 1, matsize_c);
+
+    std::vector<float> c_reference(c_matrix);
+    GemmRef(shape.transpose_a, shape.transpose_b, shape.rows_a, shape.common,
+            shape.cols_b, shape.alpha, a_matrix, b_matrix, shape.beta,
+            c_reference);
+
+    double duration = GemmImpl<float, max_common, tile_a, tile_b>(
+        q, shape.transpose_a, shape.transpose_b, shape.rows_a, shape.common,
+        shape.cols_b, shape.alpha, a_matrix, b_matrix, shape.beta, c_matrix,
+        repetitions);
+
+    bool shape_passed = duration >= 0;
+    for (int idx = 0; shape_passed && (idx < matsize_c); idx++) {
+      double error = std::abs(c_matrix[idx] - c_reference[idx]);
+      double scale = std::max(1.0, std::abs((double)c_reference[idx]));
+      if (!(error / scale <= kEpsilon)) {
+        shape_passed = false;
+#if DEBUG
+        std::cout << "Error: C[" << idx << "] = " << c_matrix[idx]
+                  << " but REF[" << idx << "] = " << c_reference[idx]
+                  << std::endl;
+#endif
+      }
+    }
+    passed &= shape_passed;
+
+    double flops = 2.0 * shape.rows_a * shape.common * shape.cols_b;
+    double gflops = duration > 0 ? flops * repetitions / duration * 1e-9 : 0;
+    std::cout << std::setw(6) << shape.rows_a << std::setw(6) << shape.common
+              << std::setw(6) << shape.cols_b << std::setw(4)
+              << (shape.transpose_a ? "T" : "N") << std::setw(4)
+              << (shape.transpose_b ? "T" : "N") << std::setw(7)
+              << shape.alpha << std::setw(7) << shape.beta << std::setw(12)
+              << std::fixed << std::setprecision(3) << gflops
+              << std::defaultfloat << std::setw(10)
+              << (shape_passed ? "ok" : "error") << std::endl;
+  }
+
+  std::cout << std::endl << (passed ? "PASSED" : "FAILED") << std::endl;
+  return !passed;
+}
+#endif
+
 int main(int argc, char *argv[]) {
   // Matrix paramters specified by build system
   constexpr int kRowsA = ROWS_A;
@@ -160,6 +280,17 @@ int main(int argc, char *argv[]) {
             << q.get_device().get_info<sycl::info::device::name>().c_str()
             << std::endl;
 
+#if defined(GEMM)
+  // Largest common dimension supported by the GEMM kernels
+  constexpr int kGemmMaxCommon = 4096;
+#if FPGA_HARDWARE
+  int gemm_repetitions = argc > 1 ? atoi(argv[1]) : 64;
+#else
+  int gemm_repetitions = argc > 1 ? atoi(argv[1]) : 1;
+#endif
+  return RunGemmSweep<kGemmMaxCommon, kTileA, kTileB>(q, gemm_repetitions);
+#endif
+
   // Create arrays to hold the input and output matrices
   std::vector<float> a_matrix(kMatsizeA * kNumMatrices);
   std::vector<float> b_matrix(kMatsizeB * kNumMatrices);
@@ -466,4 +466,347 @@ public:
   }     // end of operator
 };
 
+/**
+ * GEMM Feeder A Kernel.
+ *
+ * Streams the tiles of op(A) directly from FPGA DDR to the pipe, "tile_a"
+ * elements at a time, where op(A) is a "rows_a" x "common" matrix. A is stored
+ * in column-major order; op(A) is A if "transpose_a" is false, and the
+ * transpose of A otherwise (in which case the "tile_a" elements of a pipe write
+ * are read with a stride of "common").
+ *
+ * The matrix sizes are runtime values: the rows of the last tile of op(A) that
+ * are beyond "rows_a" and the columns beyond "common" (up to "common_padded")
+ * are padded with zeros, so that the compute kernel always receives full
+ * tiles.
+ *
+ * Repeats this operation "repetitions" times to measure performance.
+ *
+ * Coordinates with the other feeder kernel to support matrix tiling by
+ * repeating each tile accordingly.
+ *
+ */
+template <typename TT,     // Datatype of the elements of the matrix
+          int aspace,      // Buffer location for mmhost
+          int tile_a,      // Tile size for matrix A
+          int tile_b,      // Tile size for matrix B
+          typename PipeA,  // Input pipe for matrix
+          typename PipeDone, // Pipe to notify compute kernel when to stop
+                             // reading inputs
+          int datawidth = tile_a * sizeof(TT) * 8>
+class GemmReadFromDDRToPipeA {
+public:
+#if !defined(IS_BSP)
+  // Customizing mmhost only supported when targetting an FPGA part/family
+  sycl::ext::oneapi::experimental::annotated_arg<TT *, 
+      decltype(sycl::ext::oneapi::experimental::properties{
+          sycl::ext::intel::experimental::awidth<28>,
+          sycl::ext::intel::experimental::buffer_location<aspace>,
+          sycl::ext::intel::experimental::dwidth<datawidth>,
+          sycl::ext::intel::experimental::latency<0>,
+          sycl::ext::intel::experimental::maxburst<1>,
+          sycl::ext::intel::experimental::read_write_mode_read,
+          sycl::ext::intel::experimental::wait_request_requested})>
+#else
+  TT *
+#endif
+      a_ptr;          // Input matrix pointer
+  int rows_a;         // Rows of op(A)
+  int common;         // Columns of op(A) / rows of op(B)
+  int common_padded;  // Columns of op(A) sent to the pipe per tile
+  int cols_b;         // Columns of op(B)
+  bool transpose_a;   // Whether op(A) is the transpose of A
+  int repetitions;    // Number of times to write the same matrix to the pipe
+
+  void operator()() const {
+#if defined(IS_BSP)
+    // When targeting a BSP, we instruct the compiler that this pointer lives on
+    // the device.
+    // Knowing this, the compiler won't generate hardware to potentially get
+    // data from the host.
+    sycl::ext::intel::device_ptr<TT> a_ptr_located(a_ptr);
+#else
+    // Device pointers are not supported when targeting an FPGA family/part
+    TT *a_ptr_located(a_ptr);
+#endif
+
+    // Number of tiles
+    int blocks_a = (rows_a + tile_a - 1) / tile_a;
+    int blocks_b = (cols_b + tile_b - 1) / tile_b;
+    // Number of iterations to write a matrix out to pipe
+    int iters_to_pipe = blocks_a * blocks_b * common_padded;
+    // Distance in memory between two consecutive rows/columns of op(A)
+    int row_stride = transpose_a ? common : 1;
+    int col_stride = transpose_a ? 1 : rows_a;
+
+    // Write every tile of the matrix to the pipe; repeating this operation
+    // "repetitions" times to measure performance.
+    for (int rep = 0; rep < repetitions; rep++) {
+      int col = 0;      // Column of op(A) written to the pipe
+      int block_b = 0;  // Tile of op(B) this tile of op(A) is multiplied with
+      int row_base = 0; // First row of the current tile of op(A)
+
+      [[intel::initiation_interval(1)]] // NO-FORMAT: Attribute
+      for (int i = 0; i < iters_to_pipe; i++) {
+        // Write one column of a matrix tile to the pipe, padded with zeros
+        fpga_tools::NTuple<TT, tile_a> pipe_write;
+        fpga_tools::UnrolledLoop<tile_a>([&](auto t) {
+          int row = row_base + t;
+          TT value = 0;
+          if ((row < rows_a) && (col < common)) {
+            value = a_ptr_located[row * row_stride + col * col_stride];
+          }
+          pipe_write.template get<t>() = value;
+        });
+        bool last_pipe_write =
+            (rep == repetitions - 1) & (i == iters_to_pipe - 1);
+        PipeA::write(pipe_write);
+        PipeDone::write(last_pipe_write);
+
+        // Move to the next column, tile of op(B), and tile of op(A)
+        if (col == common_padded - 1) {
+          col = 0;
+          if (block_b == blocks_b - 1) {
+            block_b = 0;
+            row_base += tile_a;
+          } else {
+            block_b++;
+          }
+        } else {
+          col++;
+        }
+      } // end of i
+    }   // end of rep
+  }     // end of operator
+};
+
+/**
+ * GEMM Feeder B Kernel.
+ *
+ * Streams the tiles of op(B) directly from FPGA DDR to the pipe, "tile_b"
+ * elements at a time, where op(B) is a "common" x "cols_b" matrix. B is stored
+ * in column-major order; op(B) is B if "transpose_b" is false, and the
+ * transpose of B otherwise (i.e., B given in row-major order, as used by
+ * MatrixReadFromDDRToPipeB).
+ *
+ * The matrix sizes are runtime values: the columns of the last tile of op(B)
+ * that are beyond "cols_b" and the rows beyond "common" (up to
+ * "common_padded") are padded with zeros.
+ *
+ * Repeats this operation "repetitions" times to measure performance.
+ *
+ * Coordinates with the other feeder kernel to support matrix tiling by
+ * repeating each tile accordingly.
+ *
+ */
+template <typename TT,     // Datatype of the elements of the matrix
+          int aspace,      // Buffer location for mmhost
+          int tile_a,      // Tile size for matrix A
+          int tile_b,      // Tile size for matrix B
+          typename PipeB,  // Input pipe for matrix
+          int datawidth = tile_b * sizeof(TT) * 8>
+class GemmReadFromDDRToPipeB {
+public:
+#if !defined(IS_BSP)
+  // Customizing mmhost only supported when targetting an FPGA part/family
+  sycl::ext::oneapi::experimental::annotated_arg<TT *, 
+      decltype(sycl::ext::oneapi::experimental::properties{
+          sycl::ext::intel::experimental::awidth<28>,
+          sycl::ext::intel::experimental::buffer_location<aspace>,
+          sycl::ext::intel::experimental::dwidth<datawidth>,
+          sycl::ext::intel::experimental::latency<0>,
+          sycl::ext::intel::experimental::maxburst<1>,
+          sycl::ext::intel::experimental::read_write_mode_read,
+          sycl::ext::intel::experimental::wait_request_requested})>
+#else
+  TT *
+#endif
+      b_ptr;          // Input matrix pointer
+  int rows_a;         // Rows of op(A)
+  int common;         // Columns of op(A) / rows of op(B)
+  int common_padded;  // Rows of op(B) sent to the pipe per tile
+  int cols_b;         // Columns of op(B)
+  bool transpose_b;   // Whether op(B) is the transpose of B
+  int repetitions;    // Number of times to write the same matrix to the pipe
+
+  void operator()() const {
+#if defined(IS_BSP)
+    // When targeting a BSP, we instruct the compiler that this pointer lives on
+    // the device.
+    // Knowing this, the compiler won't generate hardware to potentially get
+    // data from the host.
+    sycl::ext::intel::device_ptr<TT> b_ptr_located(b_ptr);
+#else
+    // Device pointers are not supported when targeting an FPGA family/part
+    TT *b_ptr_located(b_ptr);
+#endif
+
+    // Number of tiles
+    int blocks_a = (rows_a + tile_a - 1) / tile_a;
+    int blocks_b = (cols_b + tile_b - 1) / tile_b;
+    // Number of iterations to write a matrix out to pipe
+    int iters_to_pipe = blocks_a * blocks_b * common_padded;
+    // Distance in memory between two consecutive rows/columns of op(B)
+    int row_stride = transpose_b ? cols_b : 1;
+    int col_stride = transpose_b ? 1 : common;
+
+    // Write every tile of the matrix to the pipe; repeating this operation
+    // "repetitions" times to measure performance.
+    for (int rep = 0; rep < repetitions; rep++) {
+      int row = 0;      // Row of op(B) written to the pipe
+      int block_b = 0;  // Current tile of op(B)
+      int col_base = 0; // First column of the current tile of op(B)
+
+      [[intel::initiation_interval(1)]] // NO-FORMAT: Attribute
+      for (int i = 0; i < iters_to_pipe; i++) {
+        // Write one row of a matrix tile to the pipe, padded with zeros
+        fpga_tools::NTuple<TT, tile_b> pipe_write;
+        fpga_tools::UnrolledLoop<tile_b>([&](auto t) {
+          int col = col_base + t;
+          TT value = 0;
+          if ((row < common) && (col < cols_b)) {
+            value = b_ptr_located[row * row_stride + col * col_stride];
+          }
+          pipe_write.template get<t>() = value;
+        });
+        PipeB::write(pipe_write);
+
+        // Move to the next row and tile of op(B); all the tiles of op(B) are
+        // sent again for each tile of op(A)
+        if (row == common_padded - 1) {
+          row = 0;
+          if (block_b == blocks_b - 1) {
+            block_b = 0;
+            col_base = 0;
+          } else {
+            block_b++;
+            col_base += tile_b;
+          }
+        } else {
+          row++;
+        }
+      } // end of i
+    }   // end of rep
+  }     // end of operator
+};
+
+/**
+ * GEMM Drain Kernel.
+ *
+ * Reads the tiles of the "rows_a" x "cols_b" product op(A) * op(B) from the
+ * pipe, "tile_a" elements at a time, and writes
+ * C_out = alpha * op(A) * op(B) + beta * C_in
+ * directly to FPGA DDR. The padding rows and columns of the last tiles are
+ * dropped. C_in and C_out are stored in column-major order; C_in is not read
+ * when beta is 0.
+ *
+ * Repeats this operation "repetitions" times.
+ *
+ */
+template <typename TT,     // Datatype of the elements of the matrix
+          int aspace_in,   // Buffer location for mmhost of C_in
+          int aspace_out,  // Buffer location for mmhost of C_out
+          int tile_a,      // Tile size for matrix A
+          int tile_b,      // Tile size for matrix B
+          typename PipeC,  // Output pipe for matrix
+          int datawidth = tile_a * sizeof(TT) * 8>
+class GemmReadPipeToDDR {
+public:
+#if !defined(IS_BSP)
+  // Customizing mmhost only supported when targetting an FPGA part/family
+  sycl::ext::oneapi::experimental::annotated_arg<TT *, 
+      decltype(sycl::ext::oneapi::experimental::properties{
+          sycl::ext::intel::experimental::awidth<28>,
+          sycl::ext::intel::experimental::buffer_location<aspace_in>,
+          sycl::ext::intel::experimental::dwidth<datawidth>,
+          sycl::ext::intel::experimental::latency<0>,
+          sycl::ext::intel::experimental::maxburst<1>,
+          sycl::ext::intel::experimental::read_write_mode_read,
+          sycl::ext::intel::experimental::wait_request_requested})>
+#else
+  TT *
+#endif
+      c_in_ptr;    // Input matrix pointer
+#if !defined(IS_BSP)
+  sycl::ext::oneapi::experimental::annotated_arg<TT *, 
+      decltype(sycl::ext::oneapi::experimental::properties{
+          sycl::ext::intel::experimental::awidth<28>,
+          sycl::ext::intel::experimental::buffer_location<aspace_out>,
+          sycl::ext::intel::experimental::dwidth<datawidth>,
+          sycl::ext::intel::experimental::latency<0>,
+          sycl::ext::intel::experimental::maxburst<1>,
+          sycl::ext::intel::experimental::read_write_mode_write,
+          sycl::ext::intel::experimental::wait_request_requested})>
+#else
+  TT *
+#endif
+      c_out_ptr;   // Output matrix pointer
+  int rows_a;      // Rows of op(A) and C
+  int cols_b;      // Columns of op(B) and C
+  TT alpha;        // Scaling factor of op(A) * op(B)
+  TT beta;         // Scaling factor of C_in
+  int repetitions; // Number of time to read the same matrix from the pipe
+
+  void operator()() const {
+#if defined(IS_BSP)
+    // When targeting a BSP, we instruct the compiler that these pointers live
+    // on the device.
+    // Knowing this, the compiler won't generate hardware to potentially get
+    // data from the host.
+    sycl::ext::intel::device_ptr<TT> c_in_ptr_located(c_in_ptr);
+    sycl::ext::intel::device_ptr<TT> c_out_ptr_located(c_out_ptr);
+#else
+    // Device pointers are not supported when targeting an FPGA family/part
+    TT *c_in_ptr_located(c_in_ptr);
+    TT *c_out_ptr_located(c_out_ptr);
+#endif
+
+    // Number of tiles
+    int blocks_a = (rows_a + tile_a - 1) / tile_a;
+    int blocks_b = (cols_b + tile_b - 1) / tile_b;
+    // Number of iterations to read a matrix from pipe
+    int iters_from_pipe = blocks_a * blocks_b * tile_b;
+    bool read_c_in = beta != TT{0};
+
+    // Read every tile of the matrix from the pipe and write it to DDR; this
+    // operation was repeated "repetitions" times to measure performance.
+    for (int rep = 0; rep < repetitions; rep++) {
+      int col_in_tile = 0; // Column of the current tile read from the pipe
+      int col_base = 0;    // First column of the current tile
+      int row_base = 0;    // First row of the current tile
+
+      [[intel::initiation_interval(1)]] // NO-FORMAT: Attribute
+      for (int i = 0; i < iters_from_pipe; i++) {
+        // Read one column of a tile of the matrix from the pipe
+        fpga_tools::NTuple<TT, tile_a> pipe_read = PipeC::read();
+        int col = col_base + col_in_tile;
+        fpga_tools::UnrolledLoop<tile_a>([&](auto t) {
+          int row = row_base + t;
+          if ((row < rows_a) && (col < cols_b)) {
+            int ptr_idx = col * rows_a + row;
+            TT value = alpha * pipe_read.template get<t>();
+            if (read_c_in) {
+              value += beta * c_in_ptr_located[ptr_idx];
+            }
+            c_out_ptr_located[ptr_idx] = value;
+          }
+        });
+
+        // Move to the next column, tile of op(B), and tile of op(A)
+        if (col_in_tile == tile_b - 1) {
+          col_in_tile = 0;
+          if (col_base + tile_b >= cols_b) {
+            col_base = 0;
+            row_base += tile_a;
+          } else {
+            col_base += tile_b;
+          }
+        } else {
+          col_in_tile++;
+        }
+      } // end of i
+    }   // end of rep
+  }     // end of operator
+};
+
 #endif /* __MEMORY_TRANSFERS_HPP__ */
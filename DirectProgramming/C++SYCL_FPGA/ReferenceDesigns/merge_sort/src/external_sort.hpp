@@ -0,0 +1,99 @@
+#ifndef __EXTERNAL_SORT_HPP__
+#define __EXTERNAL_SORT_HPP__
+
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+//
+// Host-side support for the external (out-of-core) sort.
+// When the input is too large to be sorted in device memory at once, it is
+// split into 'runs' that each fit on the device. Each run is sorted by the
+// FPGA and copied back to host memory, and the sorted runs are then merged
+// into the final output by MergeRuns below.
+//
+
+//
+// Merges the 'k' sorted runs stored back-to-back in 'runs' into 'out', where
+// run 'r' holds the elements [run_offsets[r], run_offsets[r+1]).
+// The runs are streamed in batches of 'batch_count' elements and the output is
+// streamed out in batches of the same size, so the merge only keeps 'k+1'
+// batches in its working set, no matter how large the runs are. This is the
+// same access pattern as merging runs that are stored in files.
+// Ties are broken by run index, so the merge is stable.
+//
+template <typename ValueT, typename Compare>
+void MergeRuns(const ValueT* runs, const std::vector<size_t>& run_offsets,
+               ValueT* out, size_t batch_count, Compare comp) {
+  if (run_offsets.size() < 2) {
+    std::cerr << "ERROR: 'run_offsets' must hold at least one run\n";
+    std::terminate();
+  }
+  if (batch_count == 0) {
+    std::cerr << "ERROR: 'batch_count' must be greater than 0\n";
+    std::terminate();
+  }
+
+  const size_t k = run_offsets.size() - 1;
+
+  // the current batch of each run, the position of the next element to merge
+  // in the batch, and the position in the run of the next batch to read
+  std::vector<std::vector<ValueT>> batch(k);
+  std::vector<size_t> batch_pos(k, 0);
+  std::vector<size_t> next_read(run_offsets.begin(), run_offsets.end() - 1);
+
+  // reads the next batch of run 'r'; returns false when the run is done
+  auto read_batch = [&](size_t r) {
+    const size_t n = std::min(batch_count, run_offsets[r + 1] - next_read[r]);
+    batch[r].assign(runs + next_read[r], runs + next_read[r] + n);
+    batch_pos[r] = 0;
+    next_read[r] += n;
+    return n > 0;
+  };
+
+  // a min-heap of the head element of each run, tagged with the run index
+  using HeadT = std::pair<ValueT, size_t>;
+  auto heap_comp = [&](const HeadT& a, const HeadT& b) {
+    if (comp(b.first, a.first)) return true;
+    if (comp(a.first, b.first)) return false;
+    return a.second > b.second;
+  };
+  std::priority_queue<HeadT, std::vector<HeadT>, decltype(heap_comp)> heads(
+      heap_comp);
+
+  for (size_t r = 0; r < k; r++) {
+    if (read_batch(r)) {
+      heads.push({batch[r][0], r});
+    }
+  }
+
+  // the output batch, which is flushed to 'out' when it is full
+  std::vector<ValueT> out_batch;
+  out_batch.reserve(batch_count);
+  size_t written = 0;
+
+  while (!heads.empty()) {
+    const size_t r = heads.top().second;
+    out_batch.push_back(heads.top().first);
+    heads.pop();
+
+    if (out_batch.size() == batch_count) {
+      std::copy(out_batch.begin(), out_batch.end(), out + written);
+      written += out_batch.size();
+      out_batch.clear();
+    }
+
+    // push the next element of the run, reading its next batch if needed
+    batch_pos[r]++;
+    if (batch_pos[r] < batch[r].size() || read_batch(r)) {
+      heads.push({batch[r][batch_pos[r]], r});
+    }
+  }
+
+  // flush the last (partial) output batch
+  std::copy(out_batch.begin(), out_batch.end(), out + written);
+}
+
+#endif /* __EXTERNAL_SORT_HPP__ */
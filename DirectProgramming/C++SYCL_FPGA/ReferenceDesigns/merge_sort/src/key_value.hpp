@@ -0,0 +1,97 @@
+#ifndef __KEY_VALUE_HPP__
+#define __KEY_VALUE_HPP__
+
+#include <iostream>
+#include <limits>
+
+//
+// A record made of a sort key and a payload. The payload can be the index of
+// the record in the input, in which case the sorted output is the sorting
+// permutation, or an entire struct that is carried along with the key, so
+// that the sorted records do not have to be gathered in a second pass.
+//
+template <typename KeyT, typename PayloadT>
+struct KeyValue {
+  KeyT key;
+  PayloadT value;
+
+  bool operator==(const KeyValue& rhs) const {
+    return key == rhs.key && value == rhs.value;
+  }
+  bool operator!=(const KeyValue& rhs) const { return !(*this == rhs); }
+};
+
+template <typename KeyT, typename PayloadT>
+std::ostream& operator<<(std::ostream& os, const KeyValue<KeyT, PayloadT>& r) {
+  return os << "{" << r.key << ", " << r.value << "}";
+}
+
+//
+// Compares two records by their keys only, using 'Compare'.
+// The sorting and merge networks are not stable, so records with equal keys
+// come out of the sorter in an unspecified order.
+//
+template <typename Compare>
+struct KeyCompare {
+  template <class T>
+  bool operator()(T const& a, T const& b) const {
+    return Compare()(a.key, b.key);
+  }
+};
+
+//
+// Compares two records by their keys using 'Compare' and breaks ties by their
+// payloads (with operator<). When the payload is the index of the record in
+// the input, this is a strict total order that matches the input order for
+// equal keys, so every merge in the sorter is stable. Struct payloads can be
+// made stable in the same way by ordering them by an index field.
+//
+template <typename Compare>
+struct StableKeyCompare {
+  template <class T>
+  bool operator()(T const& a, T const& b) const {
+    const Compare comp;
+    if (comp(a.key, b.key)) return true;
+    if (comp(b.key, a.key)) return false;
+    return a.value < b.value;
+  }
+};
+
+//
+// std::numeric_limits for the records, so that generic code can pad the input
+// of the sorter with min/max records. The padding records compare after (or
+// before) every other record, including when ties are broken by the payload.
+//
+// Payloads with a std::numeric_limits specialization (e.g., the arithmetic
+// types) are set to their min/max. Other payloads, like structs, have no
+// min/max, so they are default-constructed and only the key is a sentinel: in
+// that case, the keys of the records to sort must be strictly between the
+// min and max keys, or some records could be ordered after the padding.
+//
+namespace std {
+template <typename KeyT, typename PayloadT>
+class numeric_limits<KeyValue<KeyT, PayloadT>> {
+  static constexpr bool kPayloadLimits =
+      numeric_limits<PayloadT>::is_specialized;
+
+ public:
+  static constexpr bool is_specialized = true;
+
+  static constexpr KeyValue<KeyT, PayloadT> min() {
+    if constexpr (kPayloadLimits) {
+      return {numeric_limits<KeyT>::min(), numeric_limits<PayloadT>::min()};
+    } else {
+      return {numeric_limits<KeyT>::min(), PayloadT{}};
+    }
+  }
+  static constexpr KeyValue<KeyT, PayloadT> max() {
+    if constexpr (kPayloadLimits) {
+      return {numeric_limits<KeyT>::max(), numeric_limits<PayloadT>::max()};
+    } else {
+      return {numeric_limits<KeyT>::max(), PayloadT{}};
+    }
+  }
+};
+}  // namespace std
+
+#endif /* __KEY_VALUE_HPP__ */
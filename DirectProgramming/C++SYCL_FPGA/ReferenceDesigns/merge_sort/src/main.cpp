@@ -12,6 +12,8 @@
 
 #include "exception_handler.hpp"
 
+#include "external_sort.hpp"
+#include "key_value.hpp"
 #include "merge_sort.hpp"
 
 // Included from DirectProgramming/C++SYCL_FPGA/include/
@@ -64,19 +66,68 @@ constexpr size_t kSortWidth = SORT_WIDTH;
 static_assert(kSortWidth >= 1);
 static_assert(fpga_tools::IsPow2(kSortWidth));
 
+// The payload of the (key, record) sort: a struct that is carried along with
+// its key. Records with equal keys are ordered by their index in the input.
+struct SortRecord {
+  unsigned int index;
+  float weight;
+
+  bool operator<(const SortRecord& rhs) const { return index < rhs.index; }
+  bool operator==(const SortRecord& rhs) const {
+    return index == rhs.index && weight == rhs.weight;
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const SortRecord& r) {
+  return os << "{" << r.index << ", " << r.weight << "}";
+}
+
+// Determines whether we sort plain integers, (key, index) records or
+// (key, struct) records.
+// With (key, index) records, the payload of each record is its position in the
+// input, so the sorted records are the (stable) sorting permutation of the
+// keys. (key, struct) records carry a SortRecord, which has no
+// std::numeric_limits, so the padding records only have a sentinel key (see
+// key_value.hpp).
+// This can be set on the command line by defining the preprocessor macro
+// 'KEY_VALUE_SORT' using the flag: '-DKEY_VALUE_SORT', or 'KEY_RECORD_SORT'
+// using the flag: '-DKEY_RECORD_SORT'
+#if defined(KEY_VALUE_SORT)
+constexpr bool kKeyValueSort = true;
+using SortValueT = KeyValue<int, unsigned int>;
+using SortCompare = StableKeyCompare<LessThan>;
+#elif defined(KEY_RECORD_SORT)
+constexpr bool kKeyValueSort = true;
+using SortValueT = KeyValue<int, SortRecord>;
+using SortCompare = StableKeyCompare<LessThan>;
+#else
+constexpr bool kKeyValueSort = false;
+using SortValueT = int;
+using SortCompare = LessThan;
+#endif
+
+// The number of elements per batch when the external sort merges the sorted
+// runs in host memory (see external_sort.hpp).
+constexpr size_t kMergeBatchCount = 1 << 16;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Forward declare functions used in this file by main()
 template <typename ValueT, typename IndexT, typename KernelPtrType>
 double FPGASort(queue &q, ValueT *in_vec, ValueT *out_vec, IndexT count);
 
+template <typename ValueT, typename IndexT, typename KernelPtrType>
+double ExternalFPGASort(queue &q, const ValueT *in_host, ValueT *out_host,
+                        IndexT count, IndexT run_count, ValueT *in,
+                        ValueT *out, double &merge_time);
+
 template <typename T>
 bool Validate(T *val, T *ref, unsigned int count);
 ////////////////////////////////////////////////////////////////////////////////
 
 
 int main(int argc, char *argv[]) {
-  // the type to sort, needs a compare function!
-  using ValueT = int;
+  // the type to sort, needs a compare function (SortCompare)!
+  using ValueT = SortValueT;
 
   // the type used to index in the sorter
   // below we do a runtime check to make sure this type has enough bits to
@@ -99,6 +150,12 @@ int main(int argc, char *argv[]) {
 #endif
   int seed = 777;
 
+  // the maximum number of elements sorted on the device at once. Larger
+  // inputs are sorted with an external sort: the input is sorted in runs of
+  // 'device_count' elements on the device, which are then merged on the host.
+  // 0 means the whole input is sorted on the device.
+  IndexT device_count = 0;
+
   // get the size of the input as the first command line argument
   if (argc > 1) {
     count = atoi(argv[1]);
@@ -114,6 +171,12 @@ int main(int argc, char *argv[]) {
     seed = atoi(argv[3]);
   }
 
+  // get the maximum number of elements to sort on the device at once as the
+  // fourth command line argument
+  if (argc > 4) {
+    device_count = atoi(argv[4]);
+  }
+
   // enforce at least two runs
   if (runs < 2) {
     std::cerr << "ERROR: 'runs' must be 2 or more\n";
@@ -121,17 +184,20 @@ int main(int argc, char *argv[]) {
   }
 
   // check args
-  if (count <= kMergeUnits) {
-    std::cerr << "ERROR: 'count' must be greater than number of merge units\n";
+  if (count == 0) {
+    std::cerr << "ERROR: 'count' must be greater than 0\n";
     std::terminate();
   } else if (count > std::numeric_limits<IndexT>::max()) {
     std::cerr << "ERROR: the index type (IndexT) does not have enough bits to "
               << "count to 'count'\n";
     std::terminate();
-  } else if ((count % kSortWidth) != 0) {
-    std::cerr << "ERROR: 'count' must be a multiple of the sorter width\n";
-    std::terminate();
   }
+
+  // use the external sort if the input does not fit on the device at once
+  const bool external_sort = (device_count != 0) && (count > device_count);
+
+  // the number of elements sorted on the device at once
+  const IndexT run_count = external_sort ? device_count : count;
   /////////////////////////////////////////////////////////////
 
   // the device selector
@@ -173,23 +239,40 @@ int main(int argc, char *argv[]) {
   std::vector<ValueT> in_vec(count), out_vec(count), ref(count);
 
   // generate some random input data
+  // For the key-value sort, the random numbers are the keys and the payload
+  // of each record is its index in the input (and a random weight for the
+  // (key, struct) sort).
   srand(seed);
-  std::generate(in_vec.begin(), in_vec.end(), [] { return rand() % 100; });
+  for (IndexT i = 0; i < count; i++) {
+#if defined(KEY_VALUE_SORT)
+    in_vec[i] = {rand() % 100, i};
+#elif defined(KEY_RECORD_SORT)
+    int key = rand() % 100;
+    in_vec[i] = {key, {static_cast<unsigned int>(i), (rand() % 1000) / 8.0f}};
+#else
+    in_vec[i] = rand() % 100;
+#endif
+  }
 
-  // copy the input to the output reference and compute the expected result
+  // copy the input to the output reference and compute the expected result.
+  // A stable sort by key gives the same result as the key-value sort.
   std::copy(in_vec.begin(), in_vec.end(), ref.begin());
+#if defined(KEY_VALUE_SORT) || defined(KEY_RECORD_SORT)
+  std::stable_sort(ref.begin(), ref.end(), KeyCompare<LessThan>());
+#else
   std::sort(ref.begin(), ref.end());
+#endif
 
   // allocate the input and output data either in USM host or device allocations
   ValueT *in, *out;
   if constexpr (kUseUSMHostAllocation) {
     // using USM host allocations
-    if ((in = malloc_host<ValueT>(count, q)) == nullptr) {
+    if ((in = malloc_host<ValueT>(run_count, q)) == nullptr) {
       std::cerr << "ERROR: could not allocate space for 'in' using "
                 << "malloc_host\n";
       std::terminate();
     }
-    if ((out = malloc_host<ValueT>(count, q)) == nullptr) {
+    if ((out = malloc_host<ValueT>(run_count, q)) == nullptr) {
       std::cerr << "ERROR: could not allocate space for 'out' using "
                 << "malloc_host\n";
       std::terminate();
@@ -200,35 +283,53 @@ int main(int argc, char *argv[]) {
     // we could have simply generated the input data into the host allocation
     // and avoided this copy. However, it makes the code cleaner to assume the
     // input is always in 'in_vec' and this portion of the code is not part of
-    // the performance timing.
-    std::copy(in_vec.begin(), in_vec.end(), in);
-    std::fill(out, out + count, ValueT(0));
+    // the performance timing. The external sort copies each run itself.
+    if (!external_sort) {
+      std::copy(in_vec.begin(), in_vec.end(), in);
+    }
+    std::fill(out, out + run_count, ValueT{});
   } else {
     // using device allocations
-    if ((in = malloc_device<ValueT>(count, q)) == nullptr) {
+    if ((in = malloc_device<ValueT>(run_count, q)) == nullptr) {
       std::cerr << "ERROR: could not allocate space for 'in' using "
                 << "malloc_device\n";
       std::terminate();
     }
-    if ((out = malloc_device<ValueT>(count, q)) == nullptr) {
+    if ((out = malloc_device<ValueT>(run_count, q)) == nullptr) {
       std::cerr << "ERROR: could not allocate space for 'out' using "
                 << "malloc_device\n";
       std::terminate();
     }
 
-    // copy the input to the device memory and wait for the copy to finish
-    q.memcpy(in, in_vec.data(), count * sizeof(ValueT)).wait();
+    // copy the input to the device memory and wait for the copy to finish.
+    // The external sort copies each run itself.
+    if (!external_sort) {
+      q.memcpy(in, in_vec.data(), count * sizeof(ValueT)).wait();
+    }
   }
 
-  // track timing information, in ms
-  std::vector<double> time(runs);
+  // track timing information, in ms. For the external sort, also track the
+  // time spent merging the sorted runs on the host.
+  std::vector<double> time(runs), merge_time(runs, 0.0);
 
   try {
     std::cout << "Running sort " << runs << " times for an "
               << "input size of " << count << " using " << kMergeUnits
               << " " << kSortWidth << "-way merge units\n";
+    if constexpr (kKeyValueSort) {
+#if defined(KEY_RECORD_SORT)
+      std::cout << "Sorting (key, struct) records with a stable merge\n";
+#else
+      std::cout << "Sorting (key, index) records with a stable merge\n";
+#endif
+    }
     std::cout << "Streaming data from "
               << (kUseUSMHostAllocation ? "host" : "device") << " memory\n";
+    if (external_sort) {
+      std::cout << "Using an external sort with "
+                << (count + run_count - 1) / run_count << " runs of up to "
+                << run_count << " elements\n";
+    }
 
     // the pointer type for the kernel depends on whether data is coming from
     // USM host or device allocations
@@ -239,15 +340,22 @@ int main(int argc, char *argv[]) {
 
     // run the sort multiple times to increase the accuracy of the timing
     for (int i = 0; i < runs; i++) {
-      // run the sort
-      time[i] = FPGASort<ValueT, IndexT, KernelPtrType>(q, in, out, count);
-
-      // Copy the output to 'out_vec'. In the case where we are using USM host
-      // allocations this is unnecessary since we could simply deference
-      // 'out'. However, it makes the following code cleaner since the output
-      // is always in 'out_vec' and this copy is not part of the performance
-      // timing.
-      q.memcpy(out_vec.data(), out, count * sizeof(ValueT)).wait();
+      if (external_sort) {
+        // run the external sort, which sorts 'in_vec' into 'out_vec' directly
+        time[i] = ExternalFPGASort<ValueT, IndexT, KernelPtrType>(
+            q, in_vec.data(), out_vec.data(), count, run_count, in, out,
+            merge_time[i]);
+      } else {
+        // run the sort
+        time[i] = FPGASort<ValueT, IndexT, KernelPtrType>(q, in, out, count);
+
+        // Copy the output to 'out_vec'. In the case where we are using USM
+        // host allocations this is unnecessary since we could simply deference
+        // 'out'. However, it makes the following code cleaner since the output
+        // is always in 'out_vec' and this copy is not part of the performance
+        // timing.
+        q.memcpy(out_vec.data(), out, count * sizeof(ValueT)).wait();
+      }
 
       // validate the output
       passed &= Validate(out_vec.data(), ref.data(), count);
@@ -274,6 +382,17 @@ int main(int argc, char *argv[]) {
     std::cout << "Throughput: " << (input_count_mega / (avg_time_ms * 1e-3))
               << " Melements/s\n";
 
+    if (external_sort) {
+      // the execution time of the external sort includes the copies of the
+      // runs to and from the device, since they cannot be avoided
+      double avg_merge_time_ms =
+        std::accumulate(merge_time.begin() + 1, merge_time.end(), 0.0) /
+        (runs - 1);
+      std::cout << "  Device sort time (with copies): "
+                << (avg_time_ms - avg_merge_time_ms) << " ms\n";
+      std::cout << "  Host merge time: " << avg_merge_time_ms << " ms\n";
+    }
+
     std::cout << "PASSED\n";
     return 0;
   } else {
@@ -295,14 +414,17 @@ template <typename ValueT, typename IndexT, typename KernelPtrType>
 double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
   // the input and output pipe for the sorter
   using SortInPipe =
-      sycl::ext::intel::pipe<SortInPipeID, sycl::vec<ValueT, kSortWidth>>;
+      sycl::ext::intel::pipe<SortInPipeID, SortVec<ValueT, kSortWidth>>;
   using SortOutPipe =
-      sycl::ext::intel::pipe<SortOutPipeID, sycl::vec<ValueT, kSortWidth>>;
+      sycl::ext::intel::pipe<SortOutPipeID, SortVec<ValueT, kSortWidth>>;
 
-  // the sorter must sort a power of 2, so round up the requested count
-  // to the nearest power of 2; we will pad the input to make sure the
-  // output is still correct
-  const IndexT sorter_count = fpga_tools::RoundUpPow2(count);
+  // the sorter sorts 'kSortWidth' elements at a time, and needs at least
+  // 'kSortWidth' elements for each merge unit, so round up the requested
+  // count; we will pad the input to make sure the output is still correct.
+  // This pads by less than 'kSortWidth' elements unless 'count' is tiny.
+  const IndexT sorter_count =
+      std::max(fpga_tools::RoundUpToMultiple(count, IndexT(kSortWidth)),
+               IndexT(kSortWidth * kMergeUnits));
 
   // allocate some memory for the merge sort to use as temporary storage
   ValueT *buf_0, *buf_1;
@@ -331,7 +453,8 @@ double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
   // to be this element, so pad with MAX. If you are sorting from largest to
   // smallest, make this the MIN element. If you are sorting custom types
   // which are not supported by std::numeric_limits, then you will have to set
-  // this padding element differently.
+  // this padding element differently (see the specialization for the KeyValue
+  // records in key_value.hpp).
   const auto padding_element = std::numeric_limits<ValueT>::max();
 
   // We are sorting kSortWidth elements per cycle, so we will have 
@@ -345,13 +468,12 @@ double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
       KernelPtrType in(in_ptr);
 
       for (IndexT i = 0; i < total_pipe_accesses; i++) {
-        // read data from device memory
-        bool in_range = i * kSortWidth < count;
-
-        // build the input pipe data
-        sycl::vec<ValueT, kSortWidth> data;
+        // build the input pipe data from device memory, padding the
+        // elements past the end of the input
+        SortVec<ValueT, kSortWidth> data;
         #pragma unroll
         for (unsigned char j = 0; j < kSortWidth; j++) {
+          bool in_range = i * kSortWidth + j < count;
           data[j] = in_range ? in[i * kSortWidth + j] : padding_element;
         }
 
@@ -370,14 +492,12 @@ double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
         // read data from the sorter
         auto data = SortOutPipe::read();
 
-        // sorter_count is a multiple of kSortWidth
-        bool in_range = i * kSortWidth < count;
-
-        // only write out to device memory if the index is in range
-        if (in_range) {
-          // write output to device memory
-          #pragma unroll
-          for (unsigned char j = 0; j < kSortWidth; j++) {
+        // write output to device memory, dropping the padding elements,
+        // which are sorted to the end
+        #pragma unroll
+        for (unsigned char j = 0; j < kSortWidth; j++) {
+          bool in_range = i * kSortWidth + j < count;
+          if (in_range) {
             out[i * kSortWidth + j] = data[j];
           }
         }
@@ -387,7 +507,8 @@ double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
   // launch the merge sort kernels
   auto merge_sort_events =
       SubmitMergeSort<ValueT, IndexT, SortInPipe, SortOutPipe, kSortWidth,
-                      kMergeUnits>(q, sorter_count, buf_0, buf_1);
+                      kMergeUnits>(q, sorter_count, buf_0, buf_1,
+                                   SortCompare());
 
   // wait for the input and output kernels to finish
   auto start = high_resolution_clock::now();
@@ -409,6 +530,50 @@ double FPGASort(queue &q, ValueT *in_ptr, ValueT *out_ptr, IndexT count) {
   return diff.count();
 }
 
+//
+// Sorts 'count' elements from 'in_host' into 'out_host', both in host memory,
+// when they do not fit in device memory at once (external sort).
+// The input is split into runs of up to 'run_count' elements. Each run is
+// copied to the device allocation 'in', sorted by the FPGA into 'out' and
+// copied back to a host buffer. The sorted runs are then merged on the host
+// in streamed batches (see MergeRuns in external_sort.hpp).
+// Returns the total duration in milliseconds, including the copies to and
+// from the device, and the duration of the host merge in 'merge_time'.
+//
+template <typename ValueT, typename IndexT, typename KernelPtrType>
+double ExternalFPGASort(queue &q, const ValueT *in_host, ValueT *out_host,
+                        IndexT count, IndexT run_count, ValueT *in,
+                        ValueT *out, double &merge_time) {
+  // the sorted runs, back-to-back in host memory
+  std::vector<ValueT> sorted_runs(count);
+  std::vector<size_t> run_offsets;
+
+  auto start = high_resolution_clock::now();
+
+  // sort the runs on the device, one at a time
+  for (size_t offset = 0; offset < count; offset += run_count) {
+    const IndexT n = std::min(IndexT(count - offset), run_count);
+    run_offsets.push_back(offset);
+
+    q.memcpy(in, in_host + offset, n * sizeof(ValueT)).wait();
+    FPGASort<ValueT, IndexT, KernelPtrType>(q, in, out, n);
+    q.memcpy(sorted_runs.data() + offset, out, n * sizeof(ValueT)).wait();
+  }
+  run_offsets.push_back(count);
+
+  // merge the sorted runs on the host
+  auto merge_start = high_resolution_clock::now();
+  MergeRuns(sorted_runs.data(), run_offsets, out_host, kMergeBatchCount,
+            SortCompare());
+  auto end = high_resolution_clock::now();
+
+  duration<double, std::milli> merge_diff = end - merge_start;
+  merge_time = merge_diff.count();
+
+  duration<double, std::milli> diff = end - start;
+  return diff.count();
+}
+
 //
 // simple function to check if two regions of memory contain the same values
 //
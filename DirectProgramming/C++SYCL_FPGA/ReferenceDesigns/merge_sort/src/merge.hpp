@@ -4,6 +4,7 @@
 #include <sycl/sycl.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
+#include "sort_vec.hpp"
 #include "sorting_networks.hpp"
 
 // Included from DirectProgramming/C++SYCL_FPGA/include/
@@ -12,57 +13,87 @@
 using namespace sycl;
 
 //
-// Streams in two sorted list of size 'in_count`, 'k_width' elements at a time,
-// from both InPipeA and InPipeB and merges them into a single sorted list of
-// size 'in_count*2' to OutPipe. This merges two sorted lists of size in_count
-// at a rate of 'k_width' elements per cycle.
+// Streams in 'a_count' elements from InPipeA and 'b_count' elements from
+// InPipeB, 'k_width' elements at a time, as consecutive sorted sublists of
+// size 'in_count', and merges each pair of sublists into a single sorted list
+// to OutPipe. This merges two sorted lists of size in_count at a rate of
+// 'k_width' elements per cycle.
+//
+// The last sublist of either input may be shorter than 'in_count', or missing,
+// in which case the last output list is shorter than 'in_count*2'. This lets
+// the merge sort handle counts that are not a power of 2 without padding.
+// 'a_count', 'b_count' and 'in_count' must be multiples of 'k_width'.
 //
 template <typename Id, typename ValueT, typename IndexT, typename InPipeA,
           typename InPipeB, typename OutPipe, unsigned char k_width,
           class CompareFunc>
-event Merge(queue& q, IndexT total_count, IndexT in_count,
+event Merge(queue& q, IndexT a_count, IndexT b_count, IndexT in_count,
             CompareFunc compare) {
   // sanity check on k_width
   static_assert(k_width >= 1);
   static_assert(fpga_tools::IsPow2(k_width));
 
-  // merging two lists of size 'in_count' into a single output list of
-  // double the size
-  const IndexT out_count = in_count * 2;
+  const IndexT total_count = a_count + b_count;
 
   return q.single_task<Id>([=] {
     // the two input and feedback buffers
-    sycl::vec<ValueT, k_width> a, b, network_feedback;
+    SortVec<ValueT, k_width> a, b, network_feedback;
+
+    bool drain_a, drain_b;
+    bool a_valid, b_valid;
 
-    bool drain_a = false;
-    bool drain_b = false;
-    bool a_valid = false;
-    bool b_valid = false;
+    // the number of elements of each input that have not been assigned to a
+    // sublist yet, and the size of the current sublists and of their merge
+    IndexT a_remaining = a_count;
+    IndexT b_remaining = b_count;
+    IndexT a_len, b_len, out_count;
 
     // track the number of elements we have read from each input pipe
-    // for each sublist (counts up to 'in_count')
-    IndexT read_from_a = 0;
-    IndexT read_from_b = 0;
+    // for each sublist (counts up to 'a_len' and 'b_len')
+    IndexT read_from_a, read_from_b;
 
     // create a small 2 element shift register to track whether we have
     // read the last inputs from the input pipes
-    bool read_from_a_is_last = false; // (0 == in_count)
-    bool read_from_b_is_last = false; // (0 == in_count)
-    bool next_read_from_a_is_last = (k_width == in_count);
-    bool next_read_from_b_is_last = (k_width == in_count);
+    bool read_from_a_is_last, read_from_b_is_last;
+    bool next_read_from_a_is_last, next_read_from_b_is_last;
 
     // track the number of elements we have written to the output pipe
     // for each sublist (counts up to 'out_count')
-    IndexT written_out_inner = 0;
-
-    // track the number of elements we have written to the output pipe
-    // in total (counts up to 'total_count')
-    IndexT written_out = 0;
+    IndexT written_out_inner;
 
     // this flag indicates that the chosen buffer (from Pipe A or B) is the
     // first buffer from either sublist. This indicates that no output will
     // be produced and instead we will just populate the feedback buffer
-    bool first_in_buffer = true;
+    bool first_in_buffer;
+
+    // resets all internal counters and flags to start merging the next pair
+    // of sublists
+    auto start_sublists = [&] {
+      a_len = (a_remaining < in_count) ? a_remaining : in_count;
+      b_len = (b_remaining < in_count) ? b_remaining : in_count;
+      a_remaining -= a_len;
+      b_remaining -= b_len;
+      out_count = a_len + b_len;
+
+      // if one of the sublists is empty, just drain the other one
+      drain_a = (b_len == 0);
+      drain_b = (a_len == 0);
+      a_valid = false;
+      b_valid = false;
+      read_from_a = 0;
+      read_from_b = 0;
+      read_from_a_is_last = false; // (0 == a_len)
+      read_from_b_is_last = false; // (0 == b_len)
+      next_read_from_a_is_last = (k_width == a_len);
+      next_read_from_b_is_last = (k_width == b_len);
+      written_out_inner = 0;
+      first_in_buffer = true;
+    };
+    start_sublists();
+
+    // track the number of elements we have written to the output pipe
+    // in total (counts up to 'total_count')
+    IndexT written_out = 0;
 
     // the main processing loop
     [[intel::initiation_interval(1)]]
@@ -72,7 +103,7 @@ event Merge(queue& q, IndexT total_count, IndexT in_count,
         a = InPipeA::read();
         a_valid = true;
         read_from_a_is_last = next_read_from_a_is_last;
-        next_read_from_a_is_last = (read_from_a == in_count-2*k_width);
+        next_read_from_a_is_last = (read_from_a + 2*k_width == a_len);
         read_from_a += k_width;
       }
 
@@ -81,7 +112,7 @@ event Merge(queue& q, IndexT total_count, IndexT in_count,
         b = InPipeB::read();
         b_valid = true;
         read_from_b_is_last = next_read_from_b_is_last;
-        next_read_from_b_is_last = (read_from_b == in_count-2*k_width);
+        next_read_from_b_is_last = (read_from_b + 2*k_width == b_len);
         read_from_b += k_width;
       }
 
@@ -90,7 +121,7 @@ event Merge(queue& q, IndexT total_count, IndexT in_count,
       auto chosen_data_in = choose_a ? a : b;
 
       // create input for merge sort network sorter network
-      sycl::vec<ValueT, k_width * 2> merge_sort_network_data;
+      SortVec<ValueT, k_width * 2> merge_sort_network_data;
       #pragma unroll
       for (unsigned char i = 0; i < k_width; i++) {
         // populate the k_width*2 sized input for the merge sort network
@@ -115,7 +146,7 @@ event Merge(queue& q, IndexT total_count, IndexT in_count,
         b_valid = choose_a;
         first_in_buffer = false;
       } else {
-        sycl::vec<ValueT, k_width> out_data;
+        SortVec<ValueT, k_width> out_data;
         if (written_out_inner == out_count - k_width) {
           // on the last iteration for a set of sublists, the feedback
           // is the only data left that is valid, so it goes to the output
@@ -133,21 +164,10 @@ event Merge(queue& q, IndexT total_count, IndexT in_count,
         OutPipe::write(out_data);
         written_out += k_width;
 
-        // check if switching to a new set of 'in_count' sorted sublists
+        // check if switching to a new set of sorted sublists
         if (written_out_inner == out_count - k_width) {
           // switching, so reset all internal counters and flags
-          drain_a = false;
-          drain_b = false;
-          a_valid = false;
-          b_valid = false;
-          read_from_a = 0;
-          read_from_b = 0;
-          read_from_a_is_last = false; // (0 == in_count)
-          read_from_b_is_last = false; // (0 == in_count)
-          next_read_from_a_is_last = (k_width == in_count);
-          next_read_from_b_is_last = (k_width == in_count);
-          written_out_inner = 0;
-          first_in_buffer = true;
+          start_sublists();
         } else {
           // not switching, so update counters and flags
           written_out_inner += k_width;
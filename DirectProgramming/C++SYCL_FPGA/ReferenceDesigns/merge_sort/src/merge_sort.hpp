@@ -1,6 +1,7 @@
 #ifndef __MERGESORT_HPP__
 #define __MERGESORT_HPP__
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <limits>
@@ -13,6 +14,7 @@
 #include "consume.hpp"
 #include "merge.hpp"
 #include "produce.hpp"
+#include "sort_vec.hpp"
 #include "sorting_networks.hpp"
 
 // Included from DirectProgramming/C++SYCL_FPGA/include/
@@ -67,6 +69,13 @@ class InternalMergeTreePipeID;
 
 //
 // Submits all of the merge sort kernels necessary to sort 'count' elements.
+// 'count' does not need to be a power of 2, but it must be a multiple of
+// 'k_width' and there must be at least 'k_width' elements for each merge unit.
+// 'buf_0' and 'buf_1' must hold at least 'count' elements each.
+// 'ValueT' can be a scalar or a record, like the KeyValue records in
+// key_value.hpp, which are ordered by 'comp'. For a stable sort, 'comp' must
+// break ties between equal keys by the position of the records in the input
+// (see StableKeyCompare).
 // Returns all of the events for the caller to wait on.
 // NOTE: there is no need to worry about returing a std::vector by value here;
 // C++ return-value-optimization (RVO) will take care of it!
@@ -95,7 +104,7 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
   constexpr size_t kDefPipeDepth = 0;
 
   // the type that is passed around the pipes
-  using PipeType = sycl::vec<ValueT, k_width>;
+  using PipeType = SortVec<ValueT, k_width>;
 
   // the pipes connecting the different kernels of each merge unit
   // one set of pipes for each 'units' merge units
@@ -133,21 +142,17 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
   if (count == 0) {
     std::cerr << "ERROR: 'count' must be greater than 0\n";
     std::terminate();
-  } else if (!fpga_tools::IsPow2(count)) {
-    std::cerr << "ERROR: 'count' must be a power of 2\n";
+  } else if ((count % k_width) != 0) {
+    std::cerr << "ERROR: 'count' must be a multiple of k_width\n";
     std::terminate();
-  } else if (count < 4 * units) {
-    std::cerr << "ERROR: 'count' must be at least 4x greater than "
+  } else if (count < units * k_width) {
+    std::cerr << "ERROR: 'count' must be at least k_width times greater than "
               << "the number of merge units (" << units << ")\n";
     std::terminate();
   } else if (count > std::numeric_limits<IndexT>::max()) {
     std::cerr << "ERROR: the index type does not have enough bits to count to "
               << "'count'\n";
     std::terminate();
-  } else if ((count / units) <= k_width) {
-    std::cerr << "ERROR: 'count/units' (elements per merge unit) "
-              << "must be greater than k_width\n";
-    std::terminate();
   }
 
   // validate the input buffers
@@ -169,18 +174,31 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
   unsigned buf_idx = 0;
   auto next_buf_idx = [](unsigned buf_idx) { return buf_idx ^ 0x1; };
 
-  // the number of elements each merge unit will sort
-  const IndexT count_per_unit = count / units;
-
-  // each producer will produce half of the data for each merge unit
-  const IndexT half_count_per_unit = count_per_unit / 2;
+  // the number of elements each merge unit will sort, and the offset of its
+  // partition in the temporary buffers. The 'k_width' element sets are spread
+  // as evenly as possible across the merge units, so the partitions differ by
+  // at most 'k_width' elements.
+  const size_t count_sets = count / k_width;
+  std::array<IndexT, units> count_per_unit, unit_buf_offset;
+  for (size_t u = 0; u < units; u++) {
+    const size_t sets = count_sets / units + ((u < count_sets % units) ? 1 : 0);
+    count_per_unit[u] = sets * k_width;
+    unit_buf_offset[u] = (u == 0) ? 0 : unit_buf_offset[u - 1] +
+                                            count_per_unit[u - 1];
+  }
 
-  // the number of sorting iterations each merge unit will perform
-  // NOTE: we subtract log2(k_width) because the bitonic sorting network
-  // performs the first log2(k_width) iterations of the sort while streaming
-  // the input data from the input pipe into device memory.
+  // the number of sorting iterations each merge unit will perform, which is
+  // the number of times the sorted sublists must double in size to cover the
+  // largest partition. All merge units perform the same number of
+  // iterations; a partition that is already sorted is simply copied.
+  // NOTE: the sublists start with 'k_width' elements because the bitonic
+  // sorting network performs the first log2(k_width) iterations of the sort
+  // while streaming the input data from the input pipe into device memory.
+  // There is always at least one iteration, since the last one feeds the
+  // merge tree (or the output pipe).
+  const IndexT max_sets_per_unit = count_per_unit[0] / k_width;
   const IndexT iterations =
-    fpga_tools::Log2(count_per_unit) - fpga_tools::Log2(k_width);
+      std::max(IndexT(fpga_tools::CeilLog2(max_sets_per_unit)), IndexT(1));
 
   // store the various merge unit and merge tree kernel events
   std::array<std::vector<event>, units> produce_a_events, produce_b_events,
@@ -241,32 +259,39 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
         wait_events.push_back(consume_events[u][i - 1]);
       }
 
-      // the temporary device buffers reside in a single device allocation,
-      // so compute the offset into the buffer for each merge unit.
-      const size_t unit_buf_offset = count_per_unit * u;
-
       // get device pointers for this merge unit's Produce and Consume kernels
       ValueT* in_buf = buf[buf_idx];
       ValueT* out_buf = buf[next_buf_idx(buf_idx)];
 
+      // Split the sorted sublists of this merge unit's partition in two
+      // halves: ProduceA streams the first half and ProduceB the second.
+      // Only the last sublist can be shorter than 'in_count', so ProduceA
+      // gets 'sublists/2' full sublists and ProduceB the rest. This way, the
+      // short (or unpaired) sublist is always merged last and every merged
+      // sublist, except the last one, has exactly 'in_count*2' elements.
+      const IndexT sublists = (count_per_unit[u] + in_count - 1) / in_count;
+      const IndexT a_count = (sublists / 2) * in_count;
+      const IndexT b_count = count_per_unit[u] - a_count;
+
       ////////////////////////////////////////////////////////////////////////
       // Enqueue the merge unit kernels
       // Produce A
       produce_a_events[u][i] =
-        SubmitProduceA(q, in_buf, half_count_per_unit, in_count,
-                       unit_buf_offset, wait_events);
+        SubmitProduceA(q, in_buf, a_count, in_count, unit_buf_offset[u],
+                       wait_events);
 
       // Produce B
       produce_b_events[u][i] =
-          SubmitProduceB(q, in_buf, half_count_per_unit, in_count,
-                         unit_buf_offset + half_count_per_unit, wait_events);
+          SubmitProduceB(q, in_buf, b_count, in_count,
+                         unit_buf_offset[u] + a_count, wait_events);
 
       // Merge
-      merge_events[u][i] = SubmitMerge(q, count_per_unit, in_count, comp);
+      merge_events[u][i] = SubmitMerge(q, a_count, b_count, in_count, comp);
 
       // Consume
-      consume_events[u][i] = SubmitConsume(q, out_buf, count_per_unit,
-                                           unit_buf_offset, consumer_to_pipe);
+      consume_events[u][i] = SubmitConsume(q, out_buf, count_per_unit[u],
+                                           unit_buf_offset[u],
+                                           consumer_to_pipe);
       ////////////////////////////////////////////////////////////////////////
     });
     ////////////////////////////////////////////////////////////////////////
@@ -282,6 +307,16 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
   ////////////////////////////////////////////////////////////////////////////
   // Launching all of the merge tree kernels
 
+  // the number of elements in the partitions of merge units
+  // [first, first + n), which a merge tree kernel merges into one list
+  auto partition_count = [&](size_t first, size_t n) {
+    IndexT sum = 0;
+    for (size_t u = first; u < first + n; u++) {
+      sum += count_per_unit[u];
+    }
+    return sum;
+  };
+
   // the merge tree pipe array
   // NOTE: we actually only need 2^(kReductionLevels)-2 total pipes,
   // but we have created a 2D pipe array with kReductionLevels*units
@@ -344,13 +379,17 @@ std::vector<event> SubmitMergeSort(queue& q, size_t count, ValueT* buf_0,
           typename std::conditional_t<(level == (kReductionLevels - 1)),
                                       OutPipe, MTOutPipeToMT>;
 
-      // Launch the merge kernel
-      const auto e = SubmitMTMerge(q, in_count * 2, in_count, comp);
+      // Launch the merge kernel. Each input is a single sorted list, which
+      // is the merge of the partitions of (1 << level) merge units.
+      constexpr size_t kInputUnits = size_t(1) << level;
+      const IndexT a_count =
+          partition_count(merge_unit * 2 * kInputUnits, kInputUnits);
+      const IndexT b_count =
+          partition_count((merge_unit * 2 + 1) * kInputUnits, kInputUnits);
+      const auto e = SubmitMTMerge(q, a_count, b_count,
+                                   std::max(a_count, b_count), comp);
       mt_merge_events[level].push_back(e);
     });
-
-    // increase the input size
-    in_count *= 2;
   });
   ////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,20 @@
+#ifndef __SORTVEC_HPP__
+#define __SORTVEC_HPP__
+
+#include <cstddef>
+
+//
+// A set of 'k_size' elements that is passed between the kernels of the sorter
+// through the pipes, like a sycl::vec. Unlike sycl::vec, which only holds
+// scalar types, 'ValueT' can be any trivially copyable type, such as the
+// KeyValue records in key_value.hpp.
+//
+template <typename ValueT, size_t k_size>
+struct SortVec {
+  ValueT data[k_size];
+
+  ValueT& operator[](size_t i) { return data[i]; }
+  const ValueT& operator[](size_t i) const { return data[i]; }
+};
+
+#endif /* __SORTVEC_HPP__ */
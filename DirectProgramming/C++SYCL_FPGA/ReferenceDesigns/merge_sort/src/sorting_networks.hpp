@@ -6,6 +6,8 @@
 #include <sycl/sycl.hpp>
 #include <sycl/ext/intel/fpga_extensions.hpp>
 
+#include "sort_vec.hpp"
+
 // Included from DirectProgramming/C++SYCL_FPGA/include/
 #include "constexpr_math.hpp"
 
@@ -21,7 +23,7 @@ using namespace sycl;
 //    b = {data[1], data[3], data[5], ...}
 //
 template <typename ValueT, unsigned char k_width, class CompareFunc>
-void MergeSortNetwork(sycl::vec<ValueT, k_width * 2>& data,
+void MergeSortNetwork(SortVec<ValueT, k_width * 2>& data,
                       CompareFunc compare) {
   if constexpr (k_width == 4) {
     // Special case for k_width==4 that has 1 less compare on the critical path
@@ -68,7 +70,7 @@ void MergeSortNetwork(sycl::vec<ValueT, k_width * 2>& data,
 // For more info see: https://en.wikipedia.org/wiki/Bitonic_sorter
 //
 template <typename ValueT, unsigned char k_width, class CompareFunc>
-void BitonicSortNetwork(sycl::vec<ValueT, k_width>& data, CompareFunc compare) {
+void BitonicSortNetwork(SortVec<ValueT, k_width>& data, CompareFunc compare) {
   #pragma unroll
   for (unsigned char k = 2; k <= k_width; k *= 2) {
     #pragma unroll
@@ -117,7 +119,7 @@ event SortNetworkKernel(queue& q, ValueT* out_ptr, IndexT total_count,
 
     for (IndexT i = 0; i < iterations; i++) {
       // read the input data from the pipe
-      sycl::vec<ValueT, k_width> data = InPipe::read();
+      SortVec<ValueT, k_width> data = InPipe::read();
 
       // bitonic sort network sorts the k_width elements of 'data' in-place
       // NOTE: there are no dependencies across loop iterations on 'data'
@@ -0,0 +1,304 @@
+#ifndef __LOOPBACK_TRANSPORT_HPP__
+#define __LOOPBACK_TRANSPORT_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+
+#include "Packets.hpp"
+
+using namespace std::chrono;
+
+// Declare these out of the LoopbackTransport to reduce name mangling
+template <typename Id>
+class LoopbackRxKernelId;
+template <typename Id>
+class LoopbackTxKernelId;
+template <typename Id>
+class LoopbackRxPipeId;
+template <typename Id>
+class LoopbackTxPipeId;
+
+//
+// A software replacement for the UDP offload engine and the network, so that
+// the MVDR kernels can be fed with packets, and their output can be received
+// as packets, on a system without a NIC.
+//
+// The packets use the same framing as the UDP transport (see Packets.hpp).
+// They go through two rings of 'k_ring_slots' packet slots in USM host
+// memory, which is shared by the host and the device:
+//
+//  |------------------|     |----------------------------------------------|
+//  | <CPU>            |     | <FPGA>                                       |
+//  |  Send()    ------|-----|-> rx ring --> Rx kernel ==RxPipe==> MVDR ... |
+//  |  Receive() <-----|-----|-- tx ring <-- Tx kernel <=TxPipe=== ... MVDR |
+//  |------------------|     |----------------------------------------------|
+//
+// Each ring has a 'written' and a 'read' packet counter. The producer of a ring
+// waits for a free slot before writing a packet, so when the MVDR kernels stop
+// reading their input pipe, the rx ring fills up and Send() is stalled, like a
+// NIC applying backpressure.
+//
+// Template parameters:
+//    Id:           The unique ID for the LoopbackTransport
+//    RxType:       The datatype of the pipe to the MVDR kernels
+//    TxType:       The datatype of the pipe from the MVDR kernels
+//    k_ring_slots: The number of packet slots in each ring
+//
+template <typename Id, typename RxType, typename TxType, size_t k_ring_slots>
+class LoopbackTransport {
+ private:
+  static_assert(k_ring_slots > 0);
+  static_assert((kUDPDataSize % sizeof(RxType)) == 0);
+  static_assert((kUDPDataSize % sizeof(TxType)) == 0);
+
+  static constexpr size_t kRxWordsPerPacket = kUDPDataSize / sizeof(RxType);
+  static constexpr size_t kTxWordsPerPacket = kUDPDataSize / sizeof(TxType);
+
+  // The packet counters, each one on its own cache line to avoid false sharing
+  // between the host and the device
+  static constexpr size_t kCounterStride = 64 / sizeof(unsigned long long);
+  static constexpr size_t kRxWritten = 0 * kCounterStride;
+  static constexpr size_t kRxRead = 1 * kCounterStride;
+  static constexpr size_t kTxWritten = 2 * kCounterStride;
+  static constexpr size_t kTxRead = 3 * kCounterStride;
+  static constexpr size_t kNumCounters = 4 * kCounterStride;
+
+  using CounterRef =
+      sycl::atomic_ref<unsigned long long, sycl::memory_order::acq_rel,
+                       sycl::memory_scope::system,
+                       sycl::access::address_space::global_space>;
+
+  // private members
+  static inline RxType *rx_ring_{nullptr};
+  static inline TxType *tx_ring_{nullptr};
+  static inline unsigned long long *counters_{nullptr};
+  static inline bool initialized_{false};
+
+  // private constructor so users cannot make an object
+  LoopbackTransport(){};
+
+  static void initialized_check() {
+    if (!initialized_) {
+      std::cerr << "ERROR: Init() has not been called\n";
+      std::terminate();
+    }
+  }
+
+ public:
+  // disable copy constructor and operator=
+  LoopbackTransport(const LoopbackTransport &) = delete;
+  LoopbackTransport &operator=(LoopbackTransport const &) = delete;
+
+  // the pipes to connect to in device code, which can hold a full packet
+  using RxPipe =
+      sycl::ext::intel::pipe<LoopbackRxPipeId<Id>, RxType, kRxWordsPerPacket>;
+  using TxPipe =
+      sycl::ext::intel::pipe<LoopbackTxPipeId<Id>, TxType, kTxWordsPerPacket>;
+
+  static void Init(sycl::queue &q) {
+    // make sure init hasn't already been called
+    if (initialized_) {
+      std::cerr << "ERROR: Init() was already called\n";
+      std::terminate();
+    }
+
+    // the rings must be accessible by the host while the kernels run
+    if (!q.get_device().has(sycl::aspect::usm_host_allocations)) {
+      std::cerr << "ERROR: The selected device does not support USM host"
+                << " allocations\n";
+      std::terminate();
+    }
+    // the kernels and the host synchronize through system-scope atomics on
+    // the ring counters, which are in host USM
+    if (!q.get_device().has(sycl::aspect::usm_atomic_host_allocations)) {
+      std::cerr << "ERROR: The selected device does not support atomic "
+                << "operations on USM host allocations\n";
+      std::terminate();
+    }
+
+    rx_ring_ = sycl::malloc_host<RxType>(k_ring_slots * kRxWordsPerPacket, q);
+    tx_ring_ = sycl::malloc_host<TxType>(k_ring_slots * kTxWordsPerPacket, q);
+    counters_ = sycl::malloc_host<unsigned long long>(kNumCounters, q);
+    if (rx_ring_ == nullptr || tx_ring_ == nullptr || counters_ == nullptr) {
+      std::cerr << "ERROR: failed to allocate space for the rings\n";
+      std::terminate();
+    }
+    std::fill_n(counters_, kNumCounters, 0);
+
+    initialized_ = true;
+  }
+
+  static void Destroy(sycl::queue &q) {
+    initialized_check();
+
+    sycl::free(rx_ring_, q);
+    sycl::free(tx_ring_, q);
+    sycl::free(counters_, q);
+
+    initialized_ = false;
+  }
+
+  // Launch the kernels that move 'rx_packets' packets from the rx ring to
+  // RxPipe, and 'tx_packets' packets from TxPipe to the tx ring.
+  // Returns the events of the rx and tx kernels.
+  static std::pair<sycl::event, sycl::event> Start(sycl::queue &q,
+                                                   size_t rx_packets,
+                                                   size_t tx_packets) {
+    initialized_check();
+
+    // restart from empty rings
+    std::fill_n(counters_, kNumCounters, 0);
+
+    auto rx_ring = rx_ring_;
+    auto tx_ring = tx_ring_;
+    auto counters = counters_;
+
+    auto rx_event = q.single_task<LoopbackRxKernelId<Id>>([=] {
+      sycl::ext::intel::host_ptr<RxType> ring(rx_ring);
+      CounterRef written(counters[kRxWritten]);
+      CounterRef read(counters[kRxRead]);
+
+      for (size_t packet = 0; packet < rx_packets; packet++) {
+        // wait for the host to write the packet
+        while (written.load() <= packet) {
+        }
+
+        size_t slot_offset = (packet % k_ring_slots) * kRxWordsPerPacket;
+        for (size_t i = 0; i < kRxWordsPerPacket; i++) {
+          RxPipe::write(*(ring + slot_offset + i));
+        }
+
+        // free the slot
+        read.store(packet + 1);
+      }
+    });
+
+    auto tx_event = q.single_task<LoopbackTxKernelId<Id>>([=] {
+      sycl::ext::intel::host_ptr<TxType> ring(tx_ring);
+      CounterRef written(counters[kTxWritten]);
+      CounterRef read(counters[kTxRead]);
+
+      for (size_t packet = 0; packet < tx_packets; packet++) {
+        // wait for the host to free a slot
+        while (packet >= read.load() + k_ring_slots) {
+        }
+
+        size_t slot_offset = (packet % k_ring_slots) * kTxWordsPerPacket;
+        for (size_t i = 0; i < kTxWordsPerPacket; i++) {
+          *(ring + slot_offset + i) = TxPipe::read();
+        }
+
+        // hand the packet to the host
+        written.store(packet + 1);
+      }
+    });
+
+    return std::make_pair(rx_event, tx_event);
+  }
+
+  // Send 'packets' packets to the device by replaying the 'recorded_packets'
+  // packets of 'input_data', at most 'packet_rate' packets per second (no
+  // limit if 0). The time at which each packet is handed to the device is
+  // stored in 't_in' (if not null).
+  static void Send(const unsigned char *input_data, size_t recorded_packets,
+                   size_t packets, high_resolution_clock::time_point *t_in,
+                   double packet_rate = 0) {
+    initialized_check();
+    CounterRef written(counters_[kRxWritten]);
+    CounterRef read(counters_[kRxRead]);
+
+    printf("SENDER: start\n");
+
+    // the number of packets that found the ring full
+    size_t stalled_packets = 0;
+
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < packets; i++) {
+      // hold the packet until it is due
+      if (packet_rate > 0) {
+        auto due = start + duration_cast<high_resolution_clock::duration>(
+                               duration<double>(i / packet_rate));
+        while (high_resolution_clock::now() < due) {
+        }
+      }
+
+      const unsigned char *packet =
+          input_data + (i % recorded_packets) * kUDPTotalSize;
+      if (packet[0] != 0xAB || packet[1] != 0xCD) {
+        std::cerr << "ERROR: invalid header for packet " << i << "\n";
+        std::terminate();
+      }
+
+      // wait for a free slot
+      if (i >= read.load() + k_ring_slots) {
+        stalled_packets++;
+        while (i >= read.load() + k_ring_slots) {
+          std::this_thread::yield();
+        }
+      }
+
+      memcpy(rx_ring_ + (i % k_ring_slots) * kRxWordsPerPacket,
+             packet + kUDPHeaderSize, kUDPDataSize);
+      written.store(i + 1);
+
+      if (t_in) t_in[i] = high_resolution_clock::now();
+    }
+    auto end = high_resolution_clock::now();
+    duration<double, std::milli> diff(end - start);
+
+    double tp_mb_s = (kUDPTotalSize * packets * 1e-6) / (diff.count() * 1e-3);
+    std::cout << "SENDER: throughput: " << tp_mb_s << " MB/s\n";
+    std::cout << "SENDER: " << stalled_packets << " of " << packets
+              << " packets were held back by a full ring\n";
+    printf("SENDER: closed\n\n");
+  }
+
+  // Receive 'packets' packets from the device. The packets are stored in the
+  // 'recorded_packets' packets of 'output_data', which are overwritten once
+  // all of them have been used. The time at which each packet is received is
+  // stored in 't_out' (if not null).
+  static void Receive(unsigned char *output_data, size_t recorded_packets,
+                      size_t packets,
+                      high_resolution_clock::time_point *t_out) {
+    initialized_check();
+    CounterRef written(counters_[kTxWritten]);
+    CounterRef read(counters_[kTxRead]);
+
+    printf("RECEIVER: start\n");
+
+    auto start = high_resolution_clock::now();
+    for (size_t i = 0; i < packets; i++) {
+      // wait for the device to write the packet
+      while (written.load() <= i) {
+        std::this_thread::yield();
+      }
+
+      if (t_out) t_out[i] = high_resolution_clock::now();
+
+      unsigned char *packet =
+          output_data + (i % recorded_packets) * kUDPTotalSize;
+      packet[0] = 0xAB;
+      packet[1] = 0xCD;
+      memcpy(packet + kUDPHeaderSize,
+             tx_ring_ + (i % k_ring_slots) * kTxWordsPerPacket, kUDPDataSize);
+
+      // free the slot
+      read.store(i + 1);
+    }
+    auto end = high_resolution_clock::now();
+    duration<double, std::milli> diff(end - start);
+
+    double tp_mb_s = (kUDPTotalSize * packets * 1e-6) / (diff.count() * 1e-3);
+    std::cout << "RECEIVER: throughput: " << tp_mb_s << " MB/s\n";
+    printf("RECEIVER: closed\n\n");
+  }
+};
+
+#endif /* __LOOPBACK_TRANSPORT_HPP__ */
@@ -0,0 +1,83 @@
+#ifndef __PACKETS_HPP__
+#define __PACKETS_HPP__
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+// Packet framing shared by the UDP transport (UDP.hpp) and the software
+// loopback transport (LoopbackTransport.hpp). Each packet is made of a 2-byte
+// header (0xAB, 0xCD) followed by kUDPDataSize bytes of data.
+
+// constants
+constexpr size_t kUDPDataSize = 4096;                            // bytes
+constexpr size_t kUDPHeaderSize = 2;                             // bytes
+constexpr size_t kUDPTotalSize = kUDPDataSize + kUDPHeaderSize;  // bytes
+
+unsigned char *AllocatePackets(size_t packets) {
+  // allocate aligned memory
+  auto ret = static_cast<unsigned char *>(
+      aligned_alloc(1024, kUDPTotalSize * packets));
+
+  // pin the memory
+  mlock(ret, kUDPTotalSize * packets);
+
+  return ret;
+}
+
+void FreePackets(unsigned char *ptr, size_t packets) {
+  // unpin the memory
+  munlock(ptr, kUDPTotalSize * packets);
+
+  // free the memory
+  free(ptr);
+}
+
+// convert an array of elements into packets including adding header
+template <typename T>
+void ToPackets(unsigned char *udp_bytes, T *data, size_t count) {
+  assert(kUDPDataSize % sizeof(T) == 0);
+  assert((count * sizeof(T)) % kUDPDataSize == 0);
+  size_t count_per_packet = kUDPDataSize / sizeof(T);
+  assert((count % count_per_packet) == 0);
+  size_t iterations = count / count_per_packet;
+
+  size_t packet_stride = kUDPDataSize + 2;
+  for (int i = 0; i < iterations; i++) {
+    udp_bytes[i * packet_stride] = 0xAB;
+    udp_bytes[i * packet_stride + 1] = 0xCD;
+
+    memcpy(&udp_bytes[i * packet_stride + 2], &data[i * count_per_packet],
+           kUDPDataSize);
+  }
+}
+
+// convert the bytes of packets into an array of elements
+template <typename T>
+void FromPackets(unsigned char *udp_bytes, T *data, size_t count) {
+  assert((kUDPDataSize % sizeof(T)) == 0);
+  assert((count * sizeof(T)) % kUDPDataSize == 0);
+  size_t count_per_packet = kUDPDataSize / sizeof(T);
+  assert((count % count_per_packet) == 0);
+  size_t iterations = count / count_per_packet;
+
+  size_t packet_stride = kUDPDataSize + 2;
+  for (int i = 0; i < iterations; i++) {
+    memcpy(&data[i * count_per_packet], &udp_bytes[i * packet_stride + 2],
+           kUDPDataSize);
+  }
+}
+
+// utility to pin a C++ thread to a specific CPU
+int PinThreadToCPU(std::thread &t, int cpu_id) {
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu_id, &cpuset);
+  return pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpuset);
+}
+
+#endif /* __PACKETS_HPP__ */
@@ -21,6 +21,8 @@
 #include <opae/properties.h>
 #include <opae/utils.h>
 
+#include "Packets.hpp"
+
 using namespace std::chrono;
 
 #define OPENCL_AFU_ID "3a00972e-7aac-41de-bbd1-3901124e8cda"
@@ -43,11 +45,6 @@ using namespace std::chrono;
 #define DEST_UDP_PORT 34543
 #define CHECKSUM_IP 43369
 
-// constants
-constexpr size_t kUDPDataSize = 4096;                            // bytes
-constexpr size_t kUDPHeaderSize = 2;                             // bytes
-constexpr size_t kUDPTotalSize = kUDPDataSize + kUDPHeaderSize;  // bytes
-
 // setting IP/gateway/netmask to the FPGA
 void SetupFPGA(unsigned long fpga_mac_adr, char *fpga_ip_adr,
               unsigned int fpga_udp_port, char *fpga_netmask,
@@ -311,60 +308,6 @@ void UDPReceiver(char *host_ip, unsigned int port, unsigned char *output_data,
   printf("RECEIVER: closed\n\n");
 }
 
-unsigned char *AllocatePackets(size_t packets) {
-  // allocate aligned memory
-  auto ret = static_cast<unsigned char *>(
-      aligned_alloc(1024, kUDPTotalSize * packets));
-
-  // pin the memory
-  mlock(ret, kUDPTotalSize * packets);
-
-  return ret;
-}
-
-void FreePackets(unsigned char *ptr, size_t packets) {
-  // unpin the memory
-  munlock(ptr, kUDPTotalSize * packets);
-
-  // free the memory
-  free(ptr);
-}
-
-// convert an array of elements into packets including adding header
-template <typename T>
-void ToPackets(unsigned char *udp_bytes, T *data, size_t count) {
-  assert(kUDPDataSize % sizeof(T) == 0);
-  assert((count * sizeof(T)) % kUDPDataSize == 0);
-  size_t count_per_packet = kUDPDataSize / sizeof(T);
-  assert((count % count_per_packet) == 0);
-  size_t iterations = count / count_per_packet;
-
-  size_t packet_stride = kUDPDataSize + 2;
-  for (int i = 0; i < iterations; i++) {
-    udp_bytes[i * packet_stride] = 0xAB;
-    udp_bytes[i * packet_stride + 1] = 0xCD;
-
-    memcpy(&udp_bytes[i * packet_stride + 2], &data[i * count_per_packet],
-           kUDPDataSize);
-  }
-}
-
-// convert the bytes of packets into an array of elements
-template <typename T>
-void FromPackets(unsigned char *udp_bytes, T *data, size_t count) {
-  assert((kUDPDataSize % sizeof(T)) == 0);
-  assert((count * sizeof(T)) % kUDPDataSize == 0);
-  size_t count_per_packet = kUDPDataSize / sizeof(T);
-  assert((count % count_per_packet) == 0);
-  size_t iterations = count / count_per_packet;
-
-  size_t packet_stride = kUDPDataSize + 2;
-  for (int i = 0; i < iterations; i++) {
-    memcpy(&data[i * count_per_packet], &udp_bytes[i * packet_stride + 2],
-           kUDPDataSize);
-  }
-}
-
 // utility to parse a MAC address string
 unsigned long ParseMACAddress(std::string mac_str) {
   std::replace(mac_str.begin(), mac_str.end(), ':', ' ');
@@ -395,12 +338,4 @@ unsigned long ParseMACAddress(std::string mac_str) {
   return ret;
 }
 
-// utility to pin a C++ thread to a specific CPU
-int PinThreadToCPU(std::thread &t, int cpu_id) {
-  cpu_set_t cpuset;
-  CPU_ZERO(&cpuset);
-  CPU_SET(cpu_id, &cpuset);
-  return pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpuset);
-}
-
 #endif /* __UDP_HPP__ */
@@ -30,11 +30,25 @@ static_assert(false, "Real IO pipes cannot be emulated for this design");
 static_assert(false, "Real IO pipes cannot be used in windows");
 #endif
 
+#if defined(REAL_IO_PIPES) && defined(LOOPBACK_IO_PIPES)
+static_assert(false, "Real IO pipes and loopback IO pipes cannot be combined");
+#endif
+
+#if defined(LOOPBACK_IO_PIPES) && (defined(_WIN32) || defined(_WIN64))
+static_assert(false, "Loopback IO pipes cannot be used in windows");
+#endif
+
 #if defined(REAL_IO_PIPES)
 #include <sys/mman.h>
 #include "UDP.hpp"
 #endif
 
+#if defined(LOOPBACK_IO_PIPES)
+#include <algorithm>
+#include <numeric>
+#include "LoopbackTransport.hpp"
+#endif
+
 using namespace sycl;
 using namespace std::chrono_literals;
 using namespace std::chrono;
@@ -65,7 +79,9 @@ bool AlmostEqual(ComplexType x, ComplexType y, float epsilon = 0.0004f) {
 ////////////////////////////////////////////////////////////////////////////////
 
 // Forward declare the kernel names to reduce name mangling
-#if not defined(REAL_IO_PIPES)
+#if defined(LOOPBACK_IO_PIPES)
+class LoopbackTransportID;
+#elif not defined(REAL_IO_PIPES)
 class DataProducerID;
 class DataOutConsumerID;
 #endif
@@ -110,6 +126,27 @@ using DataInPipe =
 
 using DataOutPipe =
     ext::intel::kernel_writeable_io_pipe<WriteIOPipeID, XrxPipeType, 512>;
+#elif defined(LOOPBACK_IO_PIPES)
+// LOOPBACK IO PIPES
+// number of packet slots in each ring of the loopback transport
+constexpr size_t kLoopbackRingSlots = 64;
+
+using Loopback = LoopbackTransport<LoopbackTransportID, XrxPipeType,
+                                   ComplexType, kLoopbackRingSlots>;
+using DataInPipe = Loopback::RxPipe;
+using DataOutPipe = Loopback::TxPipe;
+
+// The input data and the output data of this number of matrices both fill a
+// whole number of packets, so their packets can be replayed in a loop
+constexpr size_t kInputDataBytes = kInputDataSize * sizeof(XrxPipeType);
+constexpr size_t kDataOutBytes = kDataOutSize * sizeof(ComplexType);
+constexpr size_t kReplayMatrices =
+    std::lcm(kUDPDataSize / std::gcd(kInputDataBytes, kUDPDataSize),
+             kUDPDataSize / std::gcd(kDataOutBytes, kUDPDataSize));
+constexpr size_t kReplayInPackets =
+    kReplayMatrices * kInputDataBytes / kUDPDataSize;
+constexpr size_t kReplayOutPackets =
+    kReplayMatrices * kDataOutBytes / kUDPDataSize;
 #else
 // FAKE IO PIPES
 using DataProducer =
@@ -148,10 +185,21 @@ struct UDPArgs {
 
 // arguments
 bool ParseArgs(int argc, char *argv[], int &num_matrix_copies,
-               std::string &in_dir, std::string &out_dir, UDPArgs *udp_args);
+               std::string &in_dir, std::string &out_dir, UDPArgs *udp_args,
+               double &packet_rate);
 void PrintUsage();
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+#if defined(LOOPBACK_IO_PIPES)
+// latency statistics
+void PrintMatrixLatencies(
+    const std::vector<high_resolution_clock::time_point> &time_in,
+    const std::vector<high_resolution_clock::time_point> &time_out,
+    size_t num_matrix_copies);
+#endif
+////////////////////////////////////////////////////////////////////////////////
+
 // the main function
 int main(int argc, char *argv[]) {
   UDPArgs udp_args;
@@ -162,13 +210,28 @@ int main(int argc, char *argv[]) {
 #endif
   std::string in_dir = "../data";
   std::string out_dir = ".";
+  double packet_rate = 0;
 
   // parse the command line arguments
-  if (!ParseArgs(argc, argv, num_matrix_copies, in_dir, out_dir, &udp_args)) {
+  if (!ParseArgs(argc, argv, num_matrix_copies, in_dir, out_dir, &udp_args,
+                 packet_rate)) {
     PrintUsage();
     std::terminate();
   }
 
+#if defined(LOOPBACK_IO_PIPES)
+  // the loopback transport replays the packets of kReplayMatrices matrices,
+  // so only whole replays are sent
+  if (num_matrix_copies % kReplayMatrices != 0) {
+    const int requested_matrix_copies = num_matrix_copies;
+    num_matrix_copies +=
+        kReplayMatrices - (num_matrix_copies % kReplayMatrices);
+    printf("NOTE: the loopback transport sends the matrices in groups of %zu,"
+           " so the %d requested matrices were rounded up to %d\n",
+           kReplayMatrices, requested_matrix_copies, num_matrix_copies);
+  }
+#endif
+
   printf("\n");
 #if defined(REAL_IO_PIPES)
   printf("FPGA MAC Address: %012lx\n", udp_args.fpga_mac_addr);
@@ -180,14 +243,28 @@ int main(int argc, char *argv[]) {
   printf("Host UDP Port:    %d\n", udp_args.host_udp_port);
 #endif
   printf("Matrices:         %d\n", num_matrix_copies);
+#if defined(LOOPBACK_IO_PIPES)
+  if (packet_rate > 0) {
+    printf("Packet rate:      %.0f packets/s\n", packet_rate);
+  } else {
+    printf("Packet rate:      unlimited\n");
+  }
+#endif
   printf("Input Directory:  '%s'\n", in_dir.c_str());
   printf("Output Directory: '%s'\n", out_dir.c_str());
   printf("\n");
 
   bool passed = true;
 
-  const size_t in_count = kInputDataSize * num_matrix_copies;
-  const size_t out_count = kDataOutSize * num_matrix_copies;
+#if defined(LOOPBACK_IO_PIPES)
+  // only the data of the matrices that are replayed is stored
+  const size_t recorded_matrix_copies = kReplayMatrices;
+#else
+  const size_t recorded_matrix_copies = num_matrix_copies;
+#endif
+
+  const size_t in_count = kInputDataSize * recorded_matrix_copies;
+  const size_t out_count = kDataOutSize * recorded_matrix_copies;
 
   // find number of full matrices.
   // For the real IO pipes, we cannot send and receive a partial
@@ -213,6 +290,27 @@ int main(int argc, char *argv[]) {
   // allocate aligned memory for raw input and output data
   unsigned char *in_packets = AllocatePackets(full_in_packet_count);
   unsigned char *out_packets = AllocatePackets(full_out_packet_count);
+#elif defined(LOOPBACK_IO_PIPES)
+  // the packets of kReplayMatrices matrices are sent over and over, and the
+  // received packets of the last kReplayMatrices matrices are kept
+  const size_t num_full_matrix_copies = num_matrix_copies;
+  const size_t full_in_packet_count =
+      num_matrix_copies / kReplayMatrices * kReplayInPackets;
+  const size_t full_out_packet_count =
+      num_matrix_copies / kReplayMatrices * kReplayOutPackets;
+
+  std::cout << "replayed_matrices     = " << kReplayMatrices << "\n";
+  std::cout << "full_in_packet_count  = " << full_in_packet_count << "\n";
+  std::cout << "full_out_packet_count = " << full_out_packet_count << "\n";
+
+  // allocate aligned memory for the replayed input and the kept output packets
+  unsigned char *in_packets = AllocatePackets(kReplayInPackets);
+  unsigned char *out_packets = AllocatePackets(kReplayOutPackets);
+
+  // the time at which each packet is sent and received
+  std::vector<high_resolution_clock::time_point> time_in(full_in_packet_count);
+  std::vector<high_resolution_clock::time_point> time_out(
+      full_out_packet_count);
 #else
   // for the fake IO pipes we don't need to worry about data fitting into
   // UDP packets, so the number of full matrices is the amount requested
@@ -247,15 +345,17 @@ int main(int argc, char *argv[]) {
               << std::endl;
 
     // initialize the producers and consumers
-#if not defined(REAL_IO_PIPES)
+#if defined(LOOPBACK_IO_PIPES)
+    Loopback::Init(q);
+#elif not defined(REAL_IO_PIPES)
     DataProducer::Init(q, kInputDataSize * num_matrix_copies);
     DataOutConsumer::Init(q, kDataOutSize * num_matrix_copies);
 #endif
     SinThetaProducer::Init(q, kNumSteer);
 
     // read the input data
-    passed &=
-        ReadInputData(in_dir, (ComplexType *)in_data.data(), num_matrix_copies);
+    passed &= ReadInputData(in_dir, (ComplexType *)in_data.data(),
+                            recorded_matrix_copies);
     if (!passed) {
       std::terminate();
     }
@@ -263,6 +363,9 @@ int main(int argc, char *argv[]) {
 #if defined(REAL_IO_PIPES)
     // convert the input data into UDP packets for the real IO pipes
     ToPackets(in_packets, in_data.data(), full_in_count);
+#elif defined(LOOPBACK_IO_PIPES)
+    // convert the input data into packets for the loopback transport
+    ToPackets(in_packets, in_data.data(), in_count);
 #else
     // copy the input data to the producer fake IO pipe buffer
     std::copy_n(in_data.data(), in_count, DataProducer::Data());
@@ -374,6 +477,25 @@ int main(int argc, char *argv[]) {
     if (PinThreadToCPU(sender_thread, 3) != 0) {
       std::cerr << "ERROR: could not pin sender thread to core 3\n";
     }
+#elif defined(LOOPBACK_IO_PIPES)
+    // LOOPBACK IO PIPES: start the kernels that move the packets between the
+    // rings of the loopback transport and the MVDR kernels, and CPU threads to
+    // produce/consume the packets to/from the rings
+    event loopback_rx_event, loopback_tx_event;
+    std::tie(loopback_rx_event, loopback_tx_event) =
+        Loopback::Start(q, full_in_packet_count, full_out_packet_count);
+
+    std::cout << "Starting receiver thread" << std::endl;
+    std::thread receiver_thread([&] {
+      Loopback::Receive(out_packets, kReplayOutPackets, full_out_packet_count,
+                        time_out.data());
+    });
+
+    std::cout << "Starting sender thread" << std::endl;
+    std::thread sender_thread([&] {
+      Loopback::Send(in_packets, kReplayInPackets, full_in_packet_count,
+                     time_in.data(), packet_rate);
+    });
 #else
     // start the fake IO pipe kernels
     event consume_dma_event, consume_kernel_event;
@@ -393,7 +515,7 @@ int main(int argc, char *argv[]) {
     auto start_time = high_resolution_clock::now();
 
     // wait for producer and consumer to finish
-#if defined(REAL_IO_PIPES)
+#if defined(REAL_IO_PIPES) || defined(LOOPBACK_IO_PIPES)
     sender_thread.join();
     receiver_thread.join();
 #else
@@ -403,7 +525,10 @@ int main(int argc, char *argv[]) {
 
     auto end_time = high_resolution_clock::now();
 
-#if not defined(REAL_IO_PIPES)
+#if defined(LOOPBACK_IO_PIPES)
+    loopback_rx_event.wait();
+    loopback_tx_event.wait();
+#elif not defined(REAL_IO_PIPES)
     // Stop the timer before performing the DMA from the consumer. Again,
     // if USM host allocations are used then this is a noop.
     consume_dma_event.wait();
@@ -416,6 +541,10 @@ int main(int argc, char *argv[]) {
 
     std::cout << "Throughput: " << throughput << " matrices/second\n";
 
+#if defined(LOOPBACK_IO_PIPES)
+    PrintMatrixLatencies(time_in, time_out, num_full_matrix_copies);
+#endif
+
     // copy the output back from the consumer
 #if defined(REAL_IO_PIPES)
     const size_t count_to_extract =
@@ -425,6 +554,11 @@ int main(int argc, char *argv[]) {
 
     const size_t num_out_matrix_copies_to_check =
         count_to_extract / kDataOutSize;
+#elif defined(LOOPBACK_IO_PIPES)
+    // the packets of the last kReplayMatrices matrices were kept
+    FromPackets(out_packets, (ComplexType *)out_data.data(), out_count);
+
+    const size_t num_out_matrix_copies_to_check = kReplayMatrices;
 #else
     std::copy_n(DataOutConsumer::Data(), out_count,
                 (ComplexType *)out_data.data());
@@ -447,6 +581,10 @@ int main(int argc, char *argv[]) {
 #if defined(REAL_IO_PIPES)
     FreePackets(in_packets, full_in_packet_count);
     FreePackets(out_packets, full_out_packet_count);
+#elif defined(LOOPBACK_IO_PIPES)
+    FreePackets(in_packets, kReplayInPackets);
+    FreePackets(out_packets, kReplayOutPackets);
+    Loopback::Destroy(q);
 #else
     DataProducer::Destroy(q);
     DataOutConsumer::Destroy(q);
@@ -664,7 +802,8 @@ bool WriteOutputData(std::string out_dir, ComplexType *data_out) {
 }
 
 bool ParseArgs(int argc, char *argv[], int &num_matrix_copies,
-               std::string &in_dir, std::string &out_dir, UDPArgs *udp_args) {
+               std::string &in_dir, std::string &out_dir, UDPArgs *udp_args,
+               double &packet_rate) {
 #if defined(REAL_IO_PIPES)
   if (argc < 8) {
     return false;
@@ -708,6 +847,14 @@ bool ParseArgs(int argc, char *argv[], int &num_matrix_copies,
   if (argc > 3) {
     out_dir = argv[3];
   }
+#if defined(LOOPBACK_IO_PIPES)
+  if (argc > 4) {
+    packet_rate = atof(argv[4]);
+    if (packet_rate < 0) {
+      return false;
+    }
+  }
+#endif
   return true;
 #endif
 }
@@ -720,9 +867,49 @@ void PrintUsage() {
   std::cout << "EXAMPLE: ./mvdr_beamforming.fpga 64:4C:36:00:2F:20 "
             << "192.168.0.11 34543 255.255.255.0 94:40:C9:71:8D:10 "
             << " 192.168.0.10 34543 1024 ../data .\n";
+#elif defined(LOOPBACK_IO_PIPES)
+  std::cout << "USAGE: ./mvdr_beamforming.fpga "
+            << "[num_matrices] [in directory] [out directory] "
+            << "[packets per second]\n";
+  std::cout << "EXAMPLE: ./mvdr_beamforming.fpga 1024 ../data . 10000\n";
 #else
   std::cout << "USAGE: ./mvdr_beamforming.fpga "
             << "[num_matrices] [in directory] [out directory]\n";
   std::cout << "EXAMPLE: ./mvdr_beamforming.fpga 1024 ../data .\n";
 #endif
 }
+
+#if defined(LOOPBACK_IO_PIPES)
+// Print the distribution of the latency of the matrices. The latency of a
+// matrix is measured from the time the packet holding the end of its input
+// data is sent, to the time the packet holding the end of its output data is
+// received. This packet may also hold the output data of the next matrix, in
+// which case the latency includes processing part of the next matrix.
+void PrintMatrixLatencies(
+    const std::vector<high_resolution_clock::time_point> &time_in,
+    const std::vector<high_resolution_clock::time_point> &time_out,
+    size_t num_matrix_copies) {
+  std::vector<double> latency_ms(num_matrix_copies);
+  for (size_t m = 0; m < num_matrix_copies; m++) {
+    // index of the packets holding the last byte of the matrix
+    size_t in_packet = ((m + 1) * kInputDataBytes - 1) / kUDPDataSize;
+    size_t out_packet = ((m + 1) * kDataOutBytes - 1) / kUDPDataSize;
+    duration<double, std::milli> diff(time_out[out_packet] -
+                                      time_in[in_packet]);
+    latency_ms[m] = diff.count();
+  }
+  std::sort(latency_ms.begin(), latency_ms.end());
+
+  auto percentile = [&](double p) {
+    size_t idx = static_cast<size_t>(p / 100.0 * (latency_ms.size() - 1));
+    return latency_ms[idx];
+  };
+
+  std::cout << "Matrix latency (ms): "
+            << "min=" << latency_ms.front() << " "
+            << "p50=" << percentile(50) << " "
+            << "p90=" << percentile(90) << " "
+            << "p99=" << percentile(99) << " "
+            << "max=" << latency_ms.back() << "\n";
+}
+#endif
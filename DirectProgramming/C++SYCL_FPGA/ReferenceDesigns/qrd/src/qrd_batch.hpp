@@ -0,0 +1,345 @@
+#ifndef __QRD_BATCH_HPP__
+#define __QRD_BATCH_HPP__
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "memory_transfers.hpp"
+#include "streaming_qrd.hpp"
+#include "tuple.hpp"
+
+// Forward declare the kernel and pipe names
+// (This prevents unwanted name mangling in the optimization report.)
+// The names depend on the compiled matrix size so that several size variants
+// can be instantiated in the same program.
+template <unsigned rows, unsigned columns> class QRDBatchDDRToLocalMem;
+template <unsigned rows, unsigned columns> class QRDBatch;
+template <unsigned rows, unsigned columns> class QRDBatchLocalMemToDDRQ;
+template <unsigned rows, unsigned columns> class QRDBatchLocalMemToDDRR;
+template <unsigned rows, unsigned columns> class QRDBatchAPipe;
+template <unsigned rows, unsigned columns> class QRDBatchQPipe;
+template <unsigned rows, unsigned columns> class QRDBatchRPipe;
+
+// Number of slots in the device ring buffer. With two slots, the host prepares
+// the next batch while the device processes the current one.
+constexpr int kQRDBatchRingSlots = 2;
+
+/*
+  A matrix of a batched QR decomposition.
+  Its size can be smaller than the size the QRD kernel was compiled for.
+  Like in QRDecompositionImpl, A and Q are stored column by column
+  (transposed) and R only contains the upper triangular elements, in a row by
+  row fashion.
+*/
+template <typename TT>
+struct QRDBatchMatrix {
+  int rows;           // Number of rows of A and Q
+  int columns;        // Number of columns of A and Q, must be <= rows
+  std::vector<TT> a;  // Input matrix A, rows * columns elements
+  std::vector<TT> q;  // Output matrix Q, rows * columns elements
+  std::vector<TT> r;  // Output matrix R, columns * (columns + 1) / 2 elements
+};
+
+/*
+  Returns whether a rows x columns matrix can be decomposed by a QRD kernel
+  compiled for pad_rows x pad_columns matrices (see QRDBatchPad).
+*/
+inline bool QRDBatchFits(int rows, int columns, int pad_rows,
+                         int pad_columns) {
+  return columns >= 1 && rows >= columns && rows <= pad_rows &&
+         columns <= pad_columns;
+}
+
+/*
+  Writes the padded version of the A matrix of 'matrix' to 'padded': A is in
+  the top-left block and all the other elements are 0.
+  The Gram-Schmidt process computes the columns of Q and the rows of R from
+  left to right, so the first columns of the padded Q and R only depend on the
+  columns of A, and their top-left blocks are the Q and R of A. The padding
+  rows of these columns stay 0. The padding columns stay exactly 0 too, which
+  StreamingQRD detects (it does not divide by their zero norm).
+*/
+template <typename TT>
+void QRDBatchPad(const QRDBatchMatrix<TT> &matrix, TT *padded, int pad_rows,
+                 int pad_columns) {
+  std::fill(padded, padded + pad_rows * pad_columns, TT{0});
+  for (int col = 0; col < matrix.columns; col++) {
+    for (int row = 0; row < matrix.rows; row++) {
+      padded[col * pad_rows + row] = matrix.a[col * matrix.rows + row];
+    }
+  }
+}
+
+/*
+  Extracts the Q and R matrices of 'matrix' from the padded Q and R matrices
+  computed by the QRD kernel.
+*/
+template <typename TT>
+void QRDBatchUnpad(const TT *padded_q, const TT *padded_r, int pad_rows,
+                   int pad_columns, QRDBatchMatrix<TT> &matrix) {
+  matrix.q.resize(matrix.rows * matrix.columns);
+  for (int col = 0; col < matrix.columns; col++) {
+    for (int row = 0; row < matrix.rows; row++) {
+      matrix.q[col * matrix.rows + row] = padded_q[col * pad_rows + row];
+    }
+  }
+
+  // Row i of the padded R starts after the (pad_columns - k) elements of each
+  // previous row k
+  matrix.r.resize(matrix.columns * (matrix.columns + 1) / 2);
+  int r_idx = 0;
+  for (int i = 0; i < matrix.columns; i++) {
+    int padded_row_start = i * pad_columns - i * (i - 1) / 2;
+    for (int j = i; j < matrix.columns; j++) {
+      matrix.r[r_idx++] = padded_r[padded_row_start + j - i];
+    }
+  }
+}
+
+/*
+  Returns the number of floating-point operations of the QR decomposition of
+  a rows x columns matrix, using the usual 2*rows*columns^2 estimate of the
+  Gram-Schmidt process. A complex multiply-add counts as 4 real ones.
+*/
+inline double QRDFlops(int rows, int columns, bool is_complex) {
+  return 2.0 * rows * columns * columns * (is_complex ? 4 : 1);
+}
+
+/*
+  Batched implementation of the QR decomposition for many independent
+  matrices of (possibly) different sizes.
+  All the matrices are decomposed by the same StreamingQRD kernel, compiled for
+  rows x columns matrices, by padding them to that size (see QRDBatchPad).
+  The StreamingQRD kernel is launched once, and the matrices are streamed to it
+  in batches of batch_size matrices through a ring buffer of
+  kQRDBatchRingSlots device allocations: while the device processes a batch,
+  the host pads the next one and copies it to the next slot, and collects the
+  results of the previous one.
+  Reports the throughput of the stream, including the host padding and the
+  memory transfers, in matrices/s and in effective GFLOPs (the operations of
+  the unpadded matrices only).
+  Several instances, compiled for different sizes, can be used in the same
+  program; each one has its own kernels.
+*/
+template <unsigned columns,     // Number of columns of the compiled QRD
+          unsigned rows,        // Number of rows of the compiled QRD
+          unsigned raw_latency, // RAW latency for triangular loop optimization
+          bool is_complex,      // Selects between ac_complex<T> and T datatype
+          typename T,           // The datatype for the computation
+          typename TT = std::conditional_t<is_complex, ac_complex<T>, T>
+                        // TT will be ac_complex<T> or T depending on is_complex
+         >
+void QRDecompositionBatchedImpl(
+  std::vector<QRDBatchMatrix<TT>> &matrices, // Matrices to decompose
+  sycl::queue &q,                            // Device queue
+  int batch_size                             // Number of matrices per batch
+) {
+  constexpr int kAMatrixSize = columns * rows;
+  constexpr int kQMatrixSize = columns * rows;
+  constexpr int kRMatrixSize = columns * (columns + 1) / 2;
+  constexpr int kNumElementsPerDDRBurst = is_complex ? 4 : 8;
+
+  using PipeType = fpga_tools::NTuple<TT, kNumElementsPerDDRBurst>;
+
+  // Pipes to communicate the A, Q and R matrices between kernels
+  using AMatrixPipe =
+      sycl::ext::intel::pipe<QRDBatchAPipe<rows, columns>, PipeType, 3>;
+  using QMatrixPipe =
+      sycl::ext::intel::pipe<QRDBatchQPipe<rows, columns>, PipeType, 3>;
+  using RMatrixPipe =
+      sycl::ext::intel::pipe<QRDBatchRPipe<rows, columns>, TT,
+                             kNumElementsPerDDRBurst * 4>;
+
+  // Check that all the matrices fit in the compiled size
+  for (const auto &matrix : matrices) {
+    if (!QRDBatchFits(matrix.rows, matrix.columns, rows, columns)) {
+      std::cerr << "ERROR: a " << matrix.rows << "x" << matrix.columns
+                << " matrix cannot be padded to the compiled size " << rows
+                << "x" << columns << std::endl;
+      std::terminate();
+    }
+  }
+  if (batch_size < 1) {
+    std::cerr << "ERROR: the batch size must be at least 1" << std::endl;
+    std::terminate();
+  }
+
+  const int matrix_count = matrices.size();
+  if (matrix_count == 0) {
+    return;
+  }
+  const int batch_count = (matrix_count + batch_size - 1) / batch_size;
+
+  // Allocate the FPGA DDR memory of each ring buffer slot, and the host
+  // buffers used to pad the inputs and read back the outputs of each slot
+  std::array<TT *, kQRDBatchRingSlots> a_device, q_device, r_device;
+  std::array<std::vector<TT>, kQRDBatchRingSlots> a_host, q_host, r_host;
+  for (int slot = 0; slot < kQRDBatchRingSlots; slot++) {
+#if defined (IS_BSP)
+    a_device[slot] = sycl::malloc_device<TT>(kAMatrixSize * batch_size, q);
+    q_device[slot] = sycl::malloc_device<TT>(kQMatrixSize * batch_size, q);
+    r_device[slot] = sycl::malloc_device<TT>(kRMatrixSize * batch_size, q);
+#else
+    // malloc_device are not supported when targetting an FPGA part/family
+    a_device[slot] = sycl::malloc_shared<TT>(kAMatrixSize * batch_size, q);
+    q_device[slot] = sycl::malloc_shared<TT>(kQMatrixSize * batch_size, q);
+    r_device[slot] = sycl::malloc_shared<TT>(kRMatrixSize * batch_size, q);
+#endif
+    a_host[slot].resize(kAMatrixSize * batch_size);
+    q_host[slot].resize(kQMatrixSize * batch_size);
+    r_host[slot].resize(kRMatrixSize * batch_size);
+  }
+
+  // Read the A matrices from the AMatrixPipe pipe and compute their QR
+  // decomposition. Write the Q and R output matrices to the QMatrixPipe
+  // and RMatrixPipe pipes.
+  // This kernel processes matrices forever, so it is only launched once.
+  q.single_task<QRDBatch<rows, columns>>(
+      fpga_linalg::StreamingQRD<T, is_complex, rows, columns, raw_latency,
+                   kNumElementsPerDDRBurst,
+                   AMatrixPipe, QMatrixPipe, RMatrixPipe>());
+
+  // The events of the last kernels that read from and write to the pipes.
+  // Each batch must be streamed in order, so each memory kernel waits for the
+  // one of the previous batch.
+  sycl::event read_event, q_event, r_event;
+  std::array<sycl::event, kQRDBatchRingSlots> slot_q_event, slot_r_event;
+
+  // Copies the results of a batch back to the host and extracts the Q and R
+  // matrices of each matrix of the batch
+  auto retire_batch = [&](int batch) {
+    const int slot = batch % kQRDBatchRingSlots;
+    const int first = batch * batch_size;
+    const int count = std::min(batch_size, matrix_count - first);
+
+    slot_q_event[slot].wait();
+    slot_r_event[slot].wait();
+    q.memcpy(q_host[slot].data(), q_device[slot],
+             kQMatrixSize * count * sizeof(TT)).wait();
+    q.memcpy(r_host[slot].data(), r_device[slot],
+             kRMatrixSize * count * sizeof(TT)).wait();
+
+    for (int m = 0; m < count; m++) {
+      QRDBatchUnpad(q_host[slot].data() + m * kQMatrixSize,
+                    r_host[slot].data() + m * kRMatrixSize, rows, columns,
+                    matrices[first + m]);
+    }
+  };
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  for (int batch = 0; batch < batch_count; batch++) {
+    const int slot = batch % kQRDBatchRingSlots;
+    const int first = batch * batch_size;
+    const int count = std::min(batch_size, matrix_count - first);
+
+    // The slot is free once the batch that last used it is done
+    if (batch >= kQRDBatchRingSlots) {
+      retire_batch(batch - kQRDBatchRingSlots);
+    }
+
+    // Pad the matrices of this batch to the compiled size and copy them to
+    // the FPGA DDR
+    for (int m = 0; m < count; m++) {
+      QRDBatchPad(matrices[first + m], a_host[slot].data() + m * kAMatrixSize,
+                  rows, columns);
+    }
+    auto copy_event = q.memcpy(a_device[slot], a_host[slot].data(),
+                               kAMatrixSize * count * sizeof(TT));
+
+    TT *a_ptr = a_device[slot];
+    TT *q_ptr = q_device[slot];
+    TT *r_ptr = r_device[slot];
+    const bool first_batch = (batch == 0);
+
+    read_event = q.submit([&](sycl::handler &h) {
+      h.depends_on(copy_event);
+      if (!first_batch) {
+        h.depends_on(read_event);
+      }
+      h.single_task<QRDBatchDDRToLocalMem<rows, columns>>(
+          [=]() [[intel::kernel_args_restrict]] {
+        MatrixReadFromDDRToPipe<TT, rows, columns, kNumElementsPerDDRBurst,
+                                AMatrixPipe>(a_ptr, count, 1);
+      });
+    });
+
+    q_event = q.submit([&](sycl::handler &h) {
+      if (!first_batch) {
+        h.depends_on(q_event);
+      }
+      h.single_task<QRDBatchLocalMemToDDRQ<rows, columns>>(
+          [=]() [[intel::kernel_args_restrict]] {
+        // Read the Q matrices from the QMatrixPipe pipe and copy them to the
+        // FPGA DDR
+        MatrixReadPipeToDDR<TT, rows, columns, kNumElementsPerDDRBurst,
+                            QMatrixPipe>(q_ptr, count, 1);
+      });
+    });
+
+    r_event = q.submit([&](sycl::handler &h) {
+      if (!first_batch) {
+        h.depends_on(r_event);
+      }
+      h.single_task<QRDBatchLocalMemToDDRR<rows, columns>>(
+          [=]() [[intel::kernel_args_restrict]] {
+        // Read the R matrices from the RMatrixPipe pipe and copy them to the
+        // FPGA DDR
+#if defined (IS_BSP)
+        sycl::ext::intel::device_ptr<TT> vector_ptr_located(r_ptr);
+#else
+        TT* vector_ptr_located(r_ptr);
+#endif
+        for (int matrix_index = 0; matrix_index < count; matrix_index++) {
+          for (int r_idx = 0; r_idx < kRMatrixSize; r_idx++) {
+            vector_ptr_located[matrix_index * kRMatrixSize + r_idx] =
+                RMatrixPipe::read();
+          }
+        }
+      });
+    });
+
+    slot_q_event[slot] = q_event;
+    slot_r_event[slot] = r_event;
+  }
+
+  // Collect the results of the batches still in flight
+  for (int batch = std::max(0, batch_count - kQRDBatchRingSlots);
+       batch < batch_count; batch++) {
+    retire_batch(batch);
+  }
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> diff = end_time - start_time;
+  q.throw_asynchronous();
+
+  double flops = 0;
+  for (const auto &matrix : matrices) {
+    flops += QRDFlops(matrix.rows, matrix.columns, is_complex);
+  }
+
+  std::cout << "Compiled size " << rows << "x" << columns << ": "
+            << matrix_count << " matrices" << std::endl;
+  std::cout << "   Total duration:   " << diff.count() << " s" << std::endl;
+  std::cout << "   Throughput: " << matrix_count / diff.count() * 1e-3
+            << "k matrices/s, " << flops / diff.count() * 1e-9
+            << " effective GFLOPs" << std::endl;
+
+  // Clean allocated FPGA memory
+  for (int slot = 0; slot < kQRDBatchRingSlots; slot++) {
+    free(a_device[slot], q);
+    free(q_device[slot], q);
+    free(r_device[slot], q);
+  }
+}
+
+#endif /* __QRD_BATCH_HPP__ */
@@ -4,11 +4,16 @@
 #include <sycl/ext/intel/fpga_extensions.hpp>
 #include <sycl/ext/intel/ac_types/ac_complex.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <list>
+#include <utility>
+#include <vector>
 
 #include "exception_handler.hpp"
 
 #include "qrd.hpp"
+#include "qrd_batch.hpp"
 
 #ifdef FPGA_SIMULATOR
 #define ROWS_COMPONENT_V 8
@@ -60,6 +65,80 @@ void QRDecomposition(std::vector<ac_complex<float> > &a_matrix,
 }
 #endif
 
+#if defined(BATCHED)
+/*
+  The batched QRD is compiled for two sizes: ROWS_COMPONENT_V x
+  COLS_COMPONENT_V, and half of that size in each dimension when StreamingQRD
+  supports it (at least 4 columns). Each size has its own kernels.
+*/
+constexpr int kBatchedSmallRows = ROWS_COMPONENT_V / 2;
+constexpr int kBatchedSmallColumns = COLS_COMPONENT_V / 2;
+constexpr bool kBatchedSmallSize = kBatchedSmallColumns >= 4;
+
+/*
+  Decomposes each matrix with the smallest compiled size it fits in, so that
+  small matrices are not padded to the full size. The matrices of each
+  compiled size are streamed, and timed, separately.
+*/
+template <bool is_complex, typename TT>
+void QRDecompositionBatchedDispatch(std::vector<QRDBatchMatrix<TT>> &matrices,
+                                    sycl::queue &q, int batch_size) {
+  std::vector<bool> is_small(matrices.size());
+  std::vector<QRDBatchMatrix<TT>> small_matrices, large_matrices;
+  for (size_t m = 0; m < matrices.size(); m++) {
+    is_small[m] = kBatchedSmallSize &&
+                  QRDBatchFits(matrices[m].rows, matrices[m].columns,
+                               kBatchedSmallRows, kBatchedSmallColumns);
+    if (is_small[m]) {
+      small_matrices.push_back(std::move(matrices[m]));
+    } else {
+      large_matrices.push_back(std::move(matrices[m]));
+    }
+  }
+
+  if constexpr (kBatchedSmallSize) {
+    QRDecompositionBatchedImpl<kBatchedSmallColumns, kBatchedSmallRows,
+                               FIXED_ITERATIONS, is_complex, float>(
+        small_matrices, q, batch_size);
+  }
+  QRDecompositionBatchedImpl<COLS_COMPONENT_V, ROWS_COMPONENT_V,
+                             FIXED_ITERATIONS, is_complex, float>(
+      large_matrices, q, batch_size);
+
+  // Put the matrices back in their original order
+  auto small_it = small_matrices.begin();
+  auto large_it = large_matrices.begin();
+  for (size_t m = 0; m < matrices.size(); m++) {
+    matrices[m] = std::move(is_small[m] ? *small_it++ : *large_it++);
+  }
+}
+
+/*
+  Batched QR decomposition of matrices of mixed sizes, up to
+  ROWS_COMPONENT_V x COLS_COMPONENT_V.
+
+  Function arguments:
+  - matrices:    The matrices to decompose. The function will overwrite their
+                 Q and R matrices.
+  - q:           The device queue.
+  - batch_size:  The number of matrices streamed to the device at once.
+*/
+#if COMPLEX == 0
+void QRDecompositionBatched(std::vector<QRDBatchMatrix<float>> &matrices,
+                            sycl::queue &q, int batch_size) {
+  constexpr bool is_complex = false;
+  QRDecompositionBatchedDispatch<is_complex>(matrices, q, batch_size);
+}
+#else
+void QRDecompositionBatched(
+    std::vector<QRDBatchMatrix<ac_complex<float>>> &matrices, sycl::queue &q,
+    int batch_size) {
+  constexpr bool is_complex = true;
+  QRDecompositionBatchedDispatch<is_complex>(matrices, q, batch_size);
+}
+#endif
+#endif
+
 /*
   returns if both the real and complex parts of the given ac_complex
   value are finite
@@ -73,6 +152,130 @@ bool IsFinite(ac_complex<float> val) {
 */
 bool IsFinite(float val) { return std::isfinite(val); }
 
+/*
+  returns the complex conjugate of the given value
+*/
+ac_complex<float> Conj(ac_complex<float> val) { return val.conj(); }
+float Conj(float val) { return val; }
+
+/*
+  returns the largest absolute value of the real and imaginary parts of the
+  given value
+*/
+float MaxAbs(ac_complex<float> val) {
+  return std::max(std::abs(val.r()), std::abs(val.i()));
+}
+float MaxAbs(float val) { return std::abs(val); }
+
+#if defined(BATCHED)
+/*
+  Generates matrix_count random matrices of random sizes that fit in the
+  compiled matrix size, decomposes them with the batched QRD and checks that
+  Q * R = A and that Q has orthonormal columns.
+*/
+int RunBatchedQRD(sycl::queue &q, int matrix_count, int batch_size) {
+  constexpr int kRandomSeed = 1138;
+  constexpr int kRandomMin = 1;
+  constexpr int kRandomMax = 10;
+  constexpr int kRows = ROWS_COMPONENT_V;
+  constexpr int kColumns = COLS_COMPONENT_V;
+  constexpr bool kComplex = COMPLEX != 0;
+  using T = std::conditional_t<kComplex, ac_complex<float>, float>;
+
+  // The first matrices have the extreme sizes: a single column, the full
+  // compiled size, and as tall as possible for half of the columns
+  const std::vector<std::pair<int, int>> kFixedSizes = {
+      {kRows, 1}, {kRows, kColumns}, {kRows, std::max(1, kColumns / 2)}};
+
+  // Generate the random input matrices. A matrix can have any number of
+  // columns up to kColumns, and any number of rows from its number of columns
+  // up to kRows (see QRDBatchFits).
+  srand(kRandomSeed);
+  std::vector<QRDBatchMatrix<T>> matrices(matrix_count);
+  for (int m = 0; m < matrix_count; m++) {
+    auto &matrix = matrices[m];
+    if (m < static_cast<int>(kFixedSizes.size())) {
+      matrix.rows = kFixedSizes[m].first;
+      matrix.columns = kFixedSizes[m].second;
+    } else {
+      matrix.columns = 1 + rand() % kColumns;
+      matrix.rows = matrix.columns + rand() % (kRows - matrix.columns + 1);
+    }
+    matrix.a.resize(matrix.rows * matrix.columns);
+    for (auto &elem : matrix.a) {
+      float random_real = rand() % (kRandomMax - kRandomMin) + kRandomMin;
+#if COMPLEX == 0
+      elem = random_real;
+#else
+      float random_imag = rand() % (kRandomMax - kRandomMin) + kRandomMin;
+      elem = {random_real, random_imag};
+#endif
+    }
+  }
+
+  std::cout << "Running batched QR decomposition of " << matrix_count
+            << " matrices of up to " << kRows << "x" << kColumns
+            << " in batches of " << batch_size << std::endl;
+
+  QRDecompositionBatched(matrices, q, batch_size);
+
+  // Floating-point error threshold values at which we decide that the design
+  // computed an incorrect value (see main)
+  constexpr float kErrorThreshold = 1e-4;
+  float q_ortho_error_threshold = pow(2.0, -9);
+
+  std::cout << "Verifying results...";
+  for (const auto &matrix : matrices) {
+    const int rows = matrix.rows;
+    const int columns = matrix.columns;
+
+    // Expand R to a full columns x columns matrix
+    std::vector<T> r_full(columns * columns, T{0});
+    int r_idx = 0;
+    for (int i = 0; i < columns; i++) {
+      for (int j = i; j < columns; j++) {
+        r_full[i * columns + j] = matrix.r[r_idx++];
+      }
+    }
+
+    bool error = false;
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < columns; j++) {
+        // Q * R = A at index i,j
+        T q_r_ij{0};
+        for (int k = 0; k < columns; k++) {
+          q_r_ij += matrix.q[k * rows + i] * r_full[k * columns + j];
+        }
+        error |= !IsFinite(q_r_ij) ||
+                 MaxAbs(q_r_ij - matrix.a[j * rows + i]) >= kErrorThreshold;
+      }
+    }
+    for (int i = 0; i < columns; i++) {
+      for (int j = 0; j < columns; j++) {
+        // transpose(Q) * Q = Id at index i,j
+        T qt_q_ij{0};
+        for (int k = 0; k < rows; k++) {
+          qt_q_ij += matrix.q[i * rows + k] * Conj(matrix.q[j * rows + k]);
+        }
+        T id_ij{(i == j) ? 1.0f : 0.0f};
+        error |= !IsFinite(qt_q_ij) ||
+                 MaxAbs(qt_q_ij - id_ij) >= q_ortho_error_threshold;
+      }
+    }
+
+    if (error) {
+      std::cout << std::endl << "Error in the decomposition of a " << rows
+                << "x" << columns << " matrix" << std::endl;
+      std::cout << std::endl << "FAILED" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::endl << "PASSED" << std::endl;
+  return 0;
+}
+#endif
+
 int main(int argc, char *argv[]) {
   constexpr size_t kRandomSeed = 1138;
   constexpr size_t kRandomMin = 1;
@@ -134,6 +337,25 @@ int main(int argc, char *argv[]) {
               << device.get_info<sycl::info::device::name>().c_str()
               << std::endl;
 
+#if defined(BATCHED)
+    // In batched mode, the first argument is the number of matrices to
+    // decompose and the second one the number of matrices per batch
+#if defined(FPGA_EMULATOR)
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 32;
+#elif defined(FPGA_SIMULATOR)
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 4;
+#else
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 16384;
+#endif
+    int batch_size = argc > 2 ? atoi(argv[2]) : 16;
+    if (batched_matrix_count < 1 || batch_size < 1) {
+      std::cout << "The number of matrices and the batch size must be at "
+                << "least 1." << std::endl;
+      return 1;
+    }
+    return RunBatchedQRD(q, batched_matrix_count, batch_size);
+#endif
+
     // Select a type for this compile depending on the value of COMPLEX
     using T = std::conditional_t<kComplex, ac_complex<float>, float>;
 
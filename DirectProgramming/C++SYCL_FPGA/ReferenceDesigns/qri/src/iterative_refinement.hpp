@@ -0,0 +1,88 @@
+#pragma once
+
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mixed_precision_utils.hpp"
+
+/*
+  Host-side mixed-precision iterative refinement of the inverse of a square
+  matrix A.
+
+  The inverse X of A is first computed in a low precision format (on the
+  FPGA), and is then refined in double precision with Newton-Schulz
+  iterations:
+
+  repeat:
+    R = I - AX        (double precision)
+    X = X + XR        (double precision)
+  until ||I - AX|| is small enough
+
+  The iteration converges as long as ||I - AX|| < 1 for the initial X, and the
+  error is squared at each step, so very few steps are needed to go from a
+  half precision inverse to a double precision one.
+
+  All matrices are stored using TD, which is double or ac_complex<double>.
+  A is stored column by column and X row by row, as in the QRI design.
+*/
+
+/*
+  Computes R = I - AX and returns ||I - AX|| using the infinity norm
+*/
+template <typename TD>
+double InverseResidual(const std::vector<TD> &a_matrix,
+                       const std::vector<TD> &x_matrix,
+                       std::vector<TD> &r_matrix, int size) {
+  double norm_r = 0;
+  for (int row = 0; row < size; row++) {
+    double row_norm = 0;
+    for (int col = 0; col < size; col++) {
+      TD ax{0};
+      for (int k = 0; k < size; k++) {
+        ax += a_matrix[k * size + row] * x_matrix[k * size + col];
+      }
+      TD id{(row == col) ? 1.0 : 0.0};
+      r_matrix[row * size + col] = id - ax;
+      row_norm += fpga_tools::RefinementAbs(r_matrix[row * size + col]);
+    }
+    norm_r = std::max(norm_r, row_norm);
+  }
+  return norm_r;
+}
+
+/*
+  Refines the low precision inverse X of A until ||I - AX|| is lower than
+  'tolerance' or 'max_iterations' refinement steps were performed.
+  Returns the number of refinement steps performed, and sets 'residual' to
+  ||I - AX|| for the returned X.
+*/
+template <typename TD>
+int RefineInverse(const std::vector<TD> &a_matrix, std::vector<TD> &x_matrix,
+                  int size, int max_iterations, double tolerance,
+                  double &residual) {
+  std::vector<TD> r_matrix(size * size), xr_matrix(size * size);
+
+  residual = InverseResidual(a_matrix, x_matrix, r_matrix, size);
+
+  int iteration = 0;
+  while (iteration < max_iterations && residual > tolerance) {
+    for (int row = 0; row < size; row++) {
+      for (int col = 0; col < size; col++) {
+        TD xr{0};
+        for (int k = 0; k < size; k++) {
+          xr += x_matrix[row * size + k] * r_matrix[k * size + col];
+        }
+        xr_matrix[row * size + col] = xr;
+      }
+    }
+    for (int i = 0; i < size * size; i++) {
+      x_matrix[i] += xr_matrix[i];
+    }
+    residual = InverseResidual(a_matrix, x_matrix, r_matrix, size);
+    iteration++;
+  }
+  return iteration;
+}
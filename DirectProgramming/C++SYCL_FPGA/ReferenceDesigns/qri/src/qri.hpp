@@ -17,14 +17,16 @@
 
 // Forward declare the kernel and pipe names
 // (This prevents unwanted name mangling in the optimization report.)
-class QRIDDRToLocalMem;
-class QRD;
-class QRIKernel;
-class QRILocalMemToDDRQ;
-class APipe;
-class QPipe;
-class RPipe;
-class IPipe;
+// The names are templated on the computation type so that the inversion can
+// be instantiated in several precisions in the same program.
+template <typename T> class QRIDDRToLocalMem;
+template <typename T> class QRD;
+template <typename T> class QRIKernel;
+template <typename T> class QRILocalMemToDDRQ;
+template <typename T> class APipe;
+template <typename T> class QPipe;
+template <typename T> class RPipe;
+template <typename T> class IPipe;
 
 template <unsigned columns,         // Number of columns in the input matrix
           unsigned rows,            // Number of rows in the input matrix
@@ -57,14 +59,20 @@ void QRIImpl(
 
   constexpr int kAMatrixSize = rows * columns;
   constexpr int kInverseMatrixSize = rows * columns;
-  constexpr int kNumElementsPerDDRBurst = is_complex ? 4 : 8;
+  // A DDR burst is 32 bytes wide (8 floats), so the bursts of the half
+  // precision matrices hold twice as many elements. Matrices that have fewer
+  // rows than that keep the single precision burst size.
+  constexpr int kDDRBurstBytes = 32;
+  constexpr int kElementsPerBurst = kDDRBurstBytes / sizeof(TT);
+  constexpr int kNumElementsPerDDRBurst =
+      (rows >= kElementsPerBurst) ? kElementsPerBurst : (is_complex ? 4 : 8);
 
   using PipeType = fpga_tools::NTuple<TT, kNumElementsPerDDRBurst>;
 
-  using AMatrixPipe = sycl::ext::intel::pipe<APipe, PipeType, 3>;
-  using QMatrixPipe = sycl::ext::intel::pipe<QPipe, PipeType, 3>;
-  using RMatrixPipe = sycl::ext::intel::pipe<RPipe, TT, 3>;
-  using InverseMatrixPipe = sycl::ext::intel::pipe<IPipe, PipeType, 3>;
+  using AMatrixPipe = sycl::ext::intel::pipe<APipe<T>, PipeType, 3>;
+  using QMatrixPipe = sycl::ext::intel::pipe<QPipe<T>, PipeType, 3>;
+  using RMatrixPipe = sycl::ext::intel::pipe<RPipe<T>, TT, 3>;
+  using InverseMatrixPipe = sycl::ext::intel::pipe<IPipe<T>, PipeType, 3>;
 
 
   // Create buffers and allocate space for them.
@@ -82,7 +90,7 @@ void QRIImpl(
                              kAMatrixSize * matrix_count * sizeof(TT)).wait();
 
   auto ddr_write_event = q.submit([&](sycl::handler &h) {
-    h.single_task<QRIDDRToLocalMem>([=]() [[intel::kernel_args_restrict]] {
+    h.single_task<QRIDDRToLocalMem<T>>([=]() [[intel::kernel_args_restrict]] {
       MatrixReadFromDDRToPipe<TT, rows, columns, kNumElementsPerDDRBurst,
                             AMatrixPipe>(a_device, matrix_count, repetitions);
     });
@@ -91,12 +99,12 @@ void QRIImpl(
   // Read the A matrix from the AMatrixPipe pipe and compute the QR
   // decomposition. Write the Q and R output matrices to the QMatrixPipe
   // and RMatrixPipe pipes.
-  q.single_task<QRD>(
+  q.single_task<QRD<T>>(
       fpga_linalg::StreamingQRD<T, is_complex, rows, columns, raw_latency_qrd,
                    kNumElementsPerDDRBurst,
                    AMatrixPipe, QMatrixPipe, RMatrixPipe>());
 
-  q.single_task<QRIKernel>(
+  q.single_task<QRIKernel<T>>(
       // Read the Q and R matrices from pipes and compute the inverse of A.
       // Write the result to the InverseMatrixPipe pipe.
       fpga_linalg::StreamingQRI<T, is_complex, rows, columns, raw_latency_qri,
@@ -104,7 +112,7 @@ void QRIImpl(
                    QMatrixPipe, RMatrixPipe, InverseMatrixPipe>());
 
 
-  auto i_event = q.single_task<QRILocalMemToDDRQ>([=
+  auto i_event = q.single_task<QRILocalMemToDDRQ<T>>([=
                                       ]() [[intel::kernel_args_restrict]] {
       // Read the inverse matrix from the InverseMatrixPipe pipe and copy it
       // to the FPGA DDR
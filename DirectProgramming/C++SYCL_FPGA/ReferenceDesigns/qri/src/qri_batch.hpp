@@ -0,0 +1,297 @@
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <sycl/ext/intel/fpga_extensions.hpp>
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+#include <sycl/ext/intel/ac_types/ac_int.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "memory_transfers.hpp"
+#include "streaming_qrd.hpp"
+#include "streaming_qri.hpp"
+#include "tuple.hpp"
+
+// Forward declare the kernel and pipe names
+// (This prevents unwanted name mangling in the optimization report.)
+// The names depend on the compiled matrix size so that several size variants
+// can be instantiated in the same program.
+template <unsigned size> class QRIBatchDDRToLocalMem;
+template <unsigned size> class QRIBatchQRD;
+template <unsigned size> class QRIBatchKernel;
+template <unsigned size> class QRIBatchLocalMemToDDRQ;
+template <unsigned size> class QRIBatchAPipe;
+template <unsigned size> class QRIBatchQPipe;
+template <unsigned size> class QRIBatchRPipe;
+template <unsigned size> class QRIBatchIPipe;
+
+// Number of slots in the device ring buffer. With two slots, the host prepares
+// the next batch while the device processes the current one.
+constexpr int kQRIBatchRingSlots = 2;
+
+/*
+  A square matrix of a batched QR based inversion.
+  Its size can be smaller than the size the QRI kernels were compiled for.
+  The input and inverse matrices use the same layouts as the ones of QRIImpl.
+*/
+template <typename TT>
+struct QRIBatchMatrix {
+  int size;                 // Number of rows and columns of A
+  std::vector<TT> a;        // Input matrix A, size * size elements
+  std::vector<TT> inverse;  // Output inverse of A, size * size elements
+};
+
+/*
+  Writes the padded version of the A matrix of 'matrix' to 'padded', which is
+  a pad_size x pad_size matrix: A is in the top-left block and the identity
+  matrix in the bottom-right block. The top-left block of the inverse of the
+  padded matrix is then the inverse of A.
+*/
+template <typename TT>
+void QRIBatchPad(const QRIBatchMatrix<TT> &matrix, TT *padded, int pad_size) {
+  std::fill(padded, padded + pad_size * pad_size, TT{0});
+  for (int col = 0; col < matrix.size; col++) {
+    for (int row = 0; row < matrix.size; row++) {
+      padded[col * pad_size + row] = matrix.a[col * matrix.size + row];
+    }
+  }
+  for (int k = matrix.size; k < pad_size; k++) {
+    padded[k * pad_size + k] = TT{1};
+  }
+}
+
+/*
+  Extracts the inverse of 'matrix' from the top-left block of the padded
+  inverse computed by the QRI kernels.
+*/
+template <typename TT>
+void QRIBatchUnpad(const TT *padded_inverse, int pad_size,
+                   QRIBatchMatrix<TT> &matrix) {
+  matrix.inverse.resize(matrix.size * matrix.size);
+  for (int i = 0; i < matrix.size; i++) {
+    for (int j = 0; j < matrix.size; j++) {
+      matrix.inverse[i * matrix.size + j] = padded_inverse[i * pad_size + j];
+    }
+  }
+}
+
+/*
+  Returns the number of floating-point operations of the QR based inversion
+  of a size x size matrix: 2*size^3 for the QR decomposition, size^3/3 to
+  invert R and size^3 to multiply the inverse of R by the transpose of Q.
+  A complex multiply-add counts as 4 real ones.
+*/
+inline double QRIFlops(int size, bool is_complex) {
+  double n = size;
+  return (2.0 + 1.0 / 3.0 + 1.0) * n * n * n * (is_complex ? 4 : 1);
+}
+
+/*
+  Batched implementation of the QR based inversion for many independent
+  square matrices of (possibly) different sizes.
+  All the matrices are inverted by the same StreamingQRD and StreamingQRI
+  kernels, compiled for size x size matrices, by padding them to that size
+  (see QRIBatchPad).
+  The streaming kernels are launched once, and the matrices are streamed to
+  them in batches of batch_size matrices through a ring buffer of
+  kQRIBatchRingSlots device allocations: while the device processes a batch,
+  the host pads the next one and copies it to the next slot, and collects the
+  results of the previous one.
+  Reports the throughput of the stream, including the host padding and the
+  memory transfers, in matrices/s and in effective GFLOPs (the operations of
+  the unpadded matrices only).
+*/
+template <unsigned size,            // Number of rows and columns of the
+                                    // compiled QRI
+          unsigned raw_latency_qrd, // RAW latency for triangular loop
+                                    // optimization in the QRD kernel
+          unsigned raw_latency_qri, // RAW latency for triangular loop
+                                    // optimization in the QRI kernel
+          bool is_complex,          // Selects between ac_complex<T> and T
+                                    // datatype
+          typename T,               // The datatype for the computation
+          typename TT = std::conditional_t<is_complex, ac_complex<T>, T>
+                                    // TT will be ac_complex<T> or T depending
+                                    // on is_complex
+          >
+void QRIBatchedImpl(
+    std::vector<QRIBatchMatrix<TT>> &matrices, // Matrices to invert
+    sycl::queue &q,                            // Device queue
+    int batch_size                             // Number of matrices per batch
+) {
+  // Functional limitations
+  static_assert(size >= 4, "only matrices of size 4x4 or over are supported");
+
+  constexpr int kMatrixSize = size * size;
+  constexpr int kNumElementsPerDDRBurst = is_complex ? 4 : 8;
+
+  using PipeType = fpga_tools::NTuple<TT, kNumElementsPerDDRBurst>;
+
+  using AMatrixPipe =
+      sycl::ext::intel::pipe<QRIBatchAPipe<size>, PipeType, 3>;
+  using QMatrixPipe =
+      sycl::ext::intel::pipe<QRIBatchQPipe<size>, PipeType, 3>;
+  using RMatrixPipe = sycl::ext::intel::pipe<QRIBatchRPipe<size>, TT, 3>;
+  using InverseMatrixPipe =
+      sycl::ext::intel::pipe<QRIBatchIPipe<size>, PipeType, 3>;
+
+  // Check that all the matrices fit in the compiled size
+  for (const auto &matrix : matrices) {
+    if (matrix.size < 1 || matrix.size > static_cast<int>(size)) {
+      std::cerr << "ERROR: a " << matrix.size << "x" << matrix.size
+                << " matrix cannot be padded to the compiled size " << size
+                << "x" << size << std::endl;
+      std::terminate();
+    }
+  }
+  if (batch_size < 1) {
+    std::cerr << "ERROR: the batch size must be at least 1" << std::endl;
+    std::terminate();
+  }
+
+  const int matrix_count = matrices.size();
+  if (matrix_count == 0) {
+    return;
+  }
+  const int batch_count = (matrix_count + batch_size - 1) / batch_size;
+
+  // Allocate the FPGA DDR memory of each ring buffer slot, and the host
+  // buffers used to pad the inputs and read back the outputs of each slot
+  std::array<TT *, kQRIBatchRingSlots> a_device, i_device;
+  std::array<std::vector<TT>, kQRIBatchRingSlots> a_host, i_host;
+  for (int slot = 0; slot < kQRIBatchRingSlots; slot++) {
+#if defined (IS_BSP)
+    a_device[slot] = sycl::malloc_device<TT>(kMatrixSize * batch_size, q);
+    i_device[slot] = sycl::malloc_device<TT>(kMatrixSize * batch_size, q);
+#else
+    // malloc_device are not supported when targetting an FPGA part/family
+    a_device[slot] = sycl::malloc_shared<TT>(kMatrixSize * batch_size, q);
+    i_device[slot] = sycl::malloc_shared<TT>(kMatrixSize * batch_size, q);
+#endif
+    a_host[slot].resize(kMatrixSize * batch_size);
+    i_host[slot].resize(kMatrixSize * batch_size);
+  }
+
+  // Read the A matrices from the AMatrixPipe pipe and compute their QR
+  // decomposition, then compute their inverse from the Q and R matrices.
+  // These kernels process matrices forever, so they are only launched once.
+  q.single_task<QRIBatchQRD<size>>(
+      fpga_linalg::StreamingQRD<T, is_complex, size, size, raw_latency_qrd,
+                   kNumElementsPerDDRBurst,
+                   AMatrixPipe, QMatrixPipe, RMatrixPipe>());
+
+  q.single_task<QRIBatchKernel<size>>(
+      fpga_linalg::StreamingQRI<T, is_complex, size, size, raw_latency_qri,
+                   kNumElementsPerDDRBurst,
+                   QMatrixPipe, RMatrixPipe, InverseMatrixPipe>());
+
+  // The events of the last kernels that read from and write to the pipes.
+  // Each batch must be streamed in order, so each memory kernel waits for the
+  // one of the previous batch.
+  sycl::event read_event, i_event;
+  std::array<sycl::event, kQRIBatchRingSlots> slot_i_event;
+
+  // Copies the results of a batch back to the host and extracts the inverse
+  // of each matrix of the batch
+  auto retire_batch = [&](int batch) {
+    const int slot = batch % kQRIBatchRingSlots;
+    const int first = batch * batch_size;
+    const int count = std::min(batch_size, matrix_count - first);
+
+    slot_i_event[slot].wait();
+    q.memcpy(i_host[slot].data(), i_device[slot],
+             kMatrixSize * count * sizeof(TT)).wait();
+
+    for (int m = 0; m < count; m++) {
+      QRIBatchUnpad(i_host[slot].data() + m * kMatrixSize, size,
+                    matrices[first + m]);
+    }
+  };
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+
+  for (int batch = 0; batch < batch_count; batch++) {
+    const int slot = batch % kQRIBatchRingSlots;
+    const int first = batch * batch_size;
+    const int count = std::min(batch_size, matrix_count - first);
+
+    // The slot is free once the batch that last used it is done
+    if (batch >= kQRIBatchRingSlots) {
+      retire_batch(batch - kQRIBatchRingSlots);
+    }
+
+    // Pad the matrices of this batch to the compiled size and copy them to
+    // the FPGA DDR
+    for (int m = 0; m < count; m++) {
+      QRIBatchPad(matrices[first + m], a_host[slot].data() + m * kMatrixSize,
+                  size);
+    }
+    auto copy_event = q.memcpy(a_device[slot], a_host[slot].data(),
+                               kMatrixSize * count * sizeof(TT));
+
+    TT *a_ptr = a_device[slot];
+    TT *i_ptr = i_device[slot];
+    const bool first_batch = (batch == 0);
+
+    read_event = q.submit([&](sycl::handler &h) {
+      h.depends_on(copy_event);
+      if (!first_batch) {
+        h.depends_on(read_event);
+      }
+      h.single_task<QRIBatchDDRToLocalMem<size>>(
+          [=]() [[intel::kernel_args_restrict]] {
+        MatrixReadFromDDRToPipe<TT, size, size, kNumElementsPerDDRBurst,
+                                AMatrixPipe>(a_ptr, count, 1);
+      });
+    });
+
+    i_event = q.submit([&](sycl::handler &h) {
+      if (!first_batch) {
+        h.depends_on(i_event);
+      }
+      h.single_task<QRIBatchLocalMemToDDRQ<size>>(
+          [=]() [[intel::kernel_args_restrict]] {
+        // Read the inverse matrices from the InverseMatrixPipe pipe and copy
+        // them to the FPGA DDR
+        MatrixReadPipeToDDR<TT, size, size, kNumElementsPerDDRBurst,
+                            InverseMatrixPipe>(i_ptr, count, 1);
+      });
+    });
+
+    slot_i_event[slot] = i_event;
+  }
+
+  // Collect the results of the batches still in flight
+  for (int batch = std::max(0, batch_count - kQRIBatchRingSlots);
+       batch < batch_count; batch++) {
+    retire_batch(batch);
+  }
+
+  auto end_time = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> diff = end_time - start_time;
+
+  // Make sure we throw any asynchronous errors if they have occurred during
+  // the computation
+  q.throw_asynchronous();
+
+  double flops = 0;
+  for (const auto &matrix : matrices) {
+    flops += QRIFlops(matrix.size, is_complex);
+  }
+
+  std::cout << "   Total duration:   " << diff.count() << " s" << std::endl;
+  std::cout << "Throughput: " << matrix_count / diff.count() * 1e-3
+            << "k matrices/s, " << flops / diff.count() * 1e-9
+            << " effective GFLOPs" << std::endl;
+
+  // Clean allocated FPGA memory
+  for (int slot = 0; slot < kQRIBatchRingSlots; slot++) {
+    free(a_device[slot], q);
+    free(i_device[slot], q);
+  }
+}
@@ -9,6 +9,8 @@
 #include "exception_handler.hpp"
 
 #include "qri.hpp"
+#include "qri_batch.hpp"
+#include "iterative_refinement.hpp"
 
 #ifdef FPGA_SIMULATOR
 #define ROWS_COMPONENT_V 8
@@ -60,6 +62,49 @@ void QRI(std::vector<ac_complex<float> > &a_matrix,
 }
 #endif
 
+#if defined(REFINEMENT)
+/*
+  Half precision QR based inversion, for the mixed-precision iterative
+  refinement.
+  The arguments are the same as the ones of QRI.
+*/
+template <typename T, bool is_complex>
+void QRIHalf(std::vector<T> &a_matrix, std::vector<T> &inv_matrix,
+             sycl::queue &q, size_t matrices, size_t repetitions) {
+  QRIImpl<COLS_COMPONENT_V, ROWS_COMPONENT_V, FIXED_ITERATIONS_QRD,
+          FIXED_ITERATIONS_QRI, is_complex, sycl::half>(
+      a_matrix, inv_matrix, q, matrices, repetitions);
+}
+#endif
+
+#if defined(BATCHED)
+/*
+  Batched QR based inversion of square matrices of mixed sizes, up to
+  ROWS_COMPONENT_V x ROWS_COMPONENT_V.
+
+  Function arguments:
+  - matrices:   The matrices to invert. The function will overwrite their
+                inverse matrices.
+  - q:          The device queue.
+  - batch_size: The number of matrices streamed to the device at once.
+*/
+#if COMPLEX == 0
+void QRIBatched(std::vector<QRIBatchMatrix<float>> &matrices, sycl::queue &q,
+                int batch_size) {
+  constexpr bool is_complex = false;
+  QRIBatchedImpl<ROWS_COMPONENT_V, FIXED_ITERATIONS_QRD, FIXED_ITERATIONS_QRI,
+                 is_complex, float>(matrices, q, batch_size);
+}
+#else
+void QRIBatched(std::vector<QRIBatchMatrix<ac_complex<float>>> &matrices,
+                sycl::queue &q, int batch_size) {
+  constexpr bool is_complex = true;
+  QRIBatchedImpl<ROWS_COMPONENT_V, FIXED_ITERATIONS_QRD, FIXED_ITERATIONS_QRI,
+                 is_complex, float>(matrices, q, batch_size);
+}
+#endif
+#endif
+
 /*
   Returns a random floating-point value between min and max
 */
@@ -137,8 +182,8 @@ bool IsFinite(float val) { return std::isfinite(val); }
     % Do the diagonal scaling
     B=diag(diag(A))\A;
 */
-template <int size, typename T>
-void GenerateMatrixWithCondititionNumber(float epsilon,
+template <typename T>
+void GenerateMatrixWithCondititionNumber(int size, float epsilon,
                                          std::vector<T> &output) {
   // Random min and max values for the random floating-point value generation
   constexpr float kRandomMin = 0;
@@ -181,6 +226,203 @@ void GenerateMatrixWithCondititionNumber(float epsilon,
   }
 }
 
+/*
+  returns the largest absolute value of the real and imaginary parts of the
+  given value
+*/
+double MaxAbs(ac_complex<double> val) {
+  return std::max(std::abs(val.r()), std::abs(val.i()));
+}
+double MaxAbs(double val) { return std::abs(val); }
+
+#if defined(BATCHED)
+/*
+  Generates matrix_count random square matrices of random sizes that fit in
+  the compiled matrix size, inverts them with the batched QRI and checks that
+  A * inverse(A) = Id.
+*/
+int RunBatchedQRI(sycl::queue &q, int matrix_count, int batch_size) {
+  constexpr size_t kRandomSeed = 1138;
+  constexpr int kSize = ROWS_COMPONENT_V;
+  constexpr bool kComplex = COMPLEX != 0;
+  using TF = std::conditional_t<kComplex, ac_complex<float>, float>;
+  using TD = std::conditional_t<kComplex, ac_complex<double>, double>;
+
+  // Generate the random input matrices.
+  // Setting an epsilon of 0.5 ensures that the inverse matrices will have
+  // a condition number using the infinite norm lower than 1.5/0.5 = 3
+  srand(kRandomSeed);
+  std::vector<QRIBatchMatrix<TF>> matrices(matrix_count);
+  for (auto &matrix : matrices) {
+    // (the generator needs off-diagonal elements, so the smallest size is 2)
+    matrix.size = 2 + rand() % (kSize - 1);
+    std::vector<TF> random_matrix(matrix.size * matrix.size);
+    GenerateMatrixWithCondititionNumber(matrix.size, 0.5, random_matrix);
+
+    // Store the generated matrix column by column, like in main
+    matrix.a.resize(matrix.size * matrix.size);
+    for (int row = 0; row < matrix.size; row++) {
+      for (int col = 0; col < matrix.size; col++) {
+        matrix.a[col * matrix.size + row] =
+            random_matrix[row * matrix.size + col];
+      }
+    }
+  }
+
+  std::cout << "Running batched QR inversion of " << matrix_count
+            << " matrices of up to " << kSize << "x" << kSize
+            << " in batches of " << batch_size << std::endl;
+
+  QRIBatched(matrices, q, batch_size);
+
+  // Floating-point error threshold value at which we decide that the design
+  // computed an incorrect value (see main)
+  constexpr float kErrorThreshold = 1e-4;
+
+  std::cout << "Verifying results... ";
+  for (const auto &matrix : matrices) {
+    const int n = matrix.size;
+    bool error = false;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < n; j++) {
+        // A * inverse(A) = Id at index i,j
+        TD a_inv_ij{0.0};
+        for (int k = 0; k < n; k++) {
+          TD a_ik = matrix.a[k * n + i];
+          TD inv_kj = matrix.inverse[k * n + j];
+          a_inv_ij += a_ik * inv_kj;
+        }
+        TD id_ij{(i == j) ? 1.0 : 0.0};
+        double diff = MaxAbs(a_inv_ij - id_ij);
+        error |= !std::isfinite(diff) || diff > kErrorThreshold;
+      }
+    }
+
+    if (error) {
+      std::cout << std::endl << "Error in the inversion of a " << n << "x"
+                << n << " matrix" << std::endl;
+      std::cout << std::endl << "FAILED" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << std::endl << "PASSED" << std::endl;
+  return 0;
+}
+#endif
+
+#if defined(REFINEMENT)
+/*
+  Benchmarks the mixed-precision iterative refinement against the single
+  precision path:
+  - the matrices are inverted in single precision, without refinement
+  - the matrices are inverted in half precision and the inverses are refined
+    in double precision on the host
+  The residuals ||I - A * inverse(A)|| of both inverses are reported, and the
+  refined inverses must reach double precision residuals.
+  Returns 0 on success.
+*/
+int RunRefinedQRI(sycl::queue &q, size_t matrix_count, int repetitions) {
+  static_assert(ROWS_COMPONENT_V == COLS_COMPONENT_V,
+                "The iterative refinement requires square matrices");
+
+  constexpr size_t kRandomSeed = 1138;
+  constexpr int kSize = ROWS_COMPONENT_V;
+  constexpr size_t kMatrixSize = kSize * kSize;
+  constexpr bool kComplex = COMPLEX != 0;
+  using TF = std::conditional_t<kComplex, ac_complex<float>, float>;
+  using TH = std::conditional_t<kComplex, ac_complex<sycl::half>, sycl::half>;
+  using TD = std::conditional_t<kComplex, ac_complex<double>, double>;
+
+  // Maximum number of refinement steps, and residual at which the inverses
+  // are considered to be accurate to double precision
+  constexpr int kMaxRefinementSteps = 10;
+  constexpr double kDoubleResidualThreshold = 1e-14;
+
+  // Generate the random input matrices.
+  // Setting an epsilon of 0.5 ensures that the inverse matrices will have
+  // a condition number using the infinite norm lower than 1.5/0.5 = 3
+  srand(kRandomSeed);
+  std::vector<TF> a(kMatrixSize * matrix_count);
+  for (size_t matrix = 0; matrix < matrix_count; matrix++) {
+    std::vector<TF> random_matrix(kMatrixSize);
+    GenerateMatrixWithCondititionNumber(kSize, 0.5, random_matrix);
+
+    // Store the generated matrix column by column, like in main
+    for (int row = 0; row < kSize; row++) {
+      for (int col = 0; col < kSize; col++) {
+        a[matrix * kMatrixSize + col * kSize + row] =
+            random_matrix[row * kSize + col];
+      }
+    }
+  }
+  std::vector<TD> a_double = fpga_tools::ConvertMatrix<TD>(a);
+
+  // Single precision inversion, without refinement
+  std::cout << "Single precision QR inversion of " << matrix_count
+            << " matrices " << repetitions << " times" << std::endl;
+  std::vector<TF> inv_single(kMatrixSize * matrix_count);
+  QRI(a, inv_single, q, matrix_count, repetitions);
+  std::vector<TD> inv_single_double = fpga_tools::ConvertMatrix<TD>(inv_single);
+
+  double single_residual = 0;
+  for (size_t matrix = 0; matrix < matrix_count; matrix++) {
+    std::vector<TD> a_mat(a_double.begin() + matrix * kMatrixSize,
+                          a_double.begin() + (matrix + 1) * kMatrixSize);
+    std::vector<TD> x_mat(
+        inv_single_double.begin() + matrix * kMatrixSize,
+        inv_single_double.begin() + (matrix + 1) * kMatrixSize);
+    std::vector<TD> r_mat(kMatrixSize);
+    single_residual = std::max(single_residual,
+                               InverseResidual(a_mat, x_mat, r_mat, kSize));
+  }
+  std::cout << "   Residual:         " << single_residual << std::endl;
+
+  // Half precision inversion, followed by double precision refinement
+  std::cout << "Half precision QR inversion with double precision refinement"
+            << std::endl;
+  std::vector<TH> a_half = fpga_tools::ConvertMatrix<TH>(a);
+  std::vector<TH> inv_half(kMatrixSize * matrix_count);
+  QRIHalf<TH, kComplex>(a_half, inv_half, q, matrix_count, repetitions);
+  std::vector<TD> inv_half_double = fpga_tools::ConvertMatrix<TD>(inv_half);
+
+  double refined_residual = 0;
+  int max_steps = 0;
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (size_t matrix = 0; matrix < matrix_count; matrix++) {
+    std::vector<TD> a_mat(a_double.begin() + matrix * kMatrixSize,
+                          a_double.begin() + (matrix + 1) * kMatrixSize);
+    std::vector<TD> x_mat(
+        inv_half_double.begin() + matrix * kMatrixSize,
+        inv_half_double.begin() + (matrix + 1) * kMatrixSize);
+    double residual;
+    int steps = RefineInverse(a_mat, x_mat, kSize, kMaxRefinementSteps,
+                              kDoubleResidualThreshold, residual);
+    max_steps = std::max(max_steps, steps);
+    refined_residual = std::max(refined_residual, residual);
+  }
+  auto end_time = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> refinement_time = end_time - start_time;
+
+  std::cout << "   Refinement steps: " << max_steps << " (max)" << std::endl;
+  std::cout << "   Refinement time:  "
+            << refinement_time.count() / matrix_count * 1e6
+            << " us per matrix (host)" << std::endl;
+  std::cout << "   Residual:         " << refined_residual << std::endl;
+
+  if (!(refined_residual < kDoubleResidualThreshold)) {
+    std::cerr << std::endl
+              << "The refined inverses did not reach a residual of "
+              << kDoubleResidualThreshold << std::endl;
+    std::cerr << std::endl << "FAILED" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::endl << "PASSED" << std::endl;
+  return 0;
+}
+#endif
+
 int main(int argc, char *argv[]) {
   constexpr size_t kRandomSeed = 1138;
   constexpr size_t kRows = ROWS_COMPONENT_V;
@@ -234,6 +476,29 @@ int main(int argc, char *argv[]) {
               << device.get_info<sycl::info::device::name>().c_str()
               << std::endl;
 
+#if defined(BATCHED)
+    // In batched mode, the first argument is the number of matrices to
+    // invert and the second one the number of matrices per batch
+#if defined(FPGA_EMULATOR)
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 32;
+#elif defined(FPGA_SIMULATOR)
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 4;
+#else
+    int batched_matrix_count = argc > 1 ? atoi(argv[1]) : 65536;
+#endif
+    int batch_size = argc > 2 ? atoi(argv[2]) : 64;
+    if (batched_matrix_count < 1 || batch_size < 1) {
+      std::cout << "The number of matrices and the batch size must be at "
+                << "least 1." << std::endl;
+      return 1;
+    }
+    return RunBatchedQRI(q, batched_matrix_count, batch_size);
+#endif
+
+#if defined(REFINEMENT)
+    return RunRefinedQRI(q, kMatricesToInvert, repetitions);
+#endif
+
     // Select a type for this compile depending on the value of COMPLEX
     using TF = std::conditional_t<kComplex, ac_complex<float>, float>;
     // Select a type for computing the inverse in the testbench using a more
@@ -267,7 +532,7 @@ int main(int argc, char *argv[]) {
       // Setting an epsilon of 0.5 ensures that the inverse matrix will have
       // a condition number using the infinite norm lower than 1.5/0.5 = 3
       float epsilon = 0.5;
-      GenerateMatrixWithCondititionNumber<kRows>(epsilon, random_matrix);
+      GenerateMatrixWithCondititionNumber(kRows, epsilon, random_matrix);
 
       // Copy the generated matrix in the A vector
       for (size_t row = 0; row < kRows; row++) {
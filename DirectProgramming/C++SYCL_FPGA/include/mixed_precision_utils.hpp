@@ -0,0 +1,47 @@
+#ifndef __MIXED_PRECISION_UTILS_HPP__
+#define __MIXED_PRECISION_UTILS_HPP__
+
+//
+// This file contains host-side helpers to move real and complex matrices
+// between the half, single and double precision formats, as needed by the
+// mixed-precision iterative refinement of the linear algebra designs.
+//
+
+#include <sycl/ext/intel/ac_types/ac_complex.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace fpga_tools {
+
+// converts a real or complex value to the format 'TO' (e.g. float, sycl::half,
+// double or ac_complex of one of these)
+template <typename TO, typename FROM>
+TO ConvertElement(FROM val) {
+  return TO(val);
+}
+template <typename TO, typename FROM>
+TO ConvertElement(ac_complex<FROM> val) {
+  return TO(val.r(), val.i());
+}
+
+// converts all the elements of a matrix to the format 'TO'
+template <typename TO, typename FROM>
+std::vector<TO> ConvertMatrix(const std::vector<FROM> &matrix) {
+  std::vector<TO> converted(matrix.size());
+  for (size_t i = 0; i < matrix.size(); i++) {
+    converted[i] = ConvertElement<TO>(matrix[i]);
+  }
+  return converted;
+}
+
+// returns the absolute value (modulus) of a real or complex double, so that
+// the norms of the refinement are written once for both
+inline double RefinementAbs(double val) { return std::abs(val); }
+inline double RefinementAbs(ac_complex<double> val) {
+  return std::sqrt(val.r() * val.r() + val.i() * val.i());
+}
+
+}  // namespace fpga_tools
+
+#endif /* __MIXED_PRECISION_UTILS_HPP__ */
@@ -0,0 +1,267 @@
+#ifndef __STREAMING_CHOLESKY_SOLVE_HPP__
+#define __STREAMING_CHOLESKY_SOLVE_HPP__
+
+#include "constexpr_math.hpp"
+#include "tuple.hpp"
+#include "unrolled_loop.hpp"
+
+namespace fpga_linalg {
+
+/*
+  Cholesky-based linear solve - Computes X such that AX=B where:
+  - A is a hermitian, positive definite matrix, given through its Cholesky
+    factor L (A=LL*) as produced by StreamingCholesky
+  - B is a matrix of rhs_columns right-hand side vectors
+  - X is the matrix of the rhs_columns solution vectors
+
+  The solution is computed with a forward substitution followed by a backward
+  substitution, without ever forming the inverse of A:
+    LY = B   (forward substitution)
+    L*X = Y  (backward substitution)
+
+  Pseudo code:
+
+  for (rhs = 0; rhs < rhs_columns; rhs++) {
+    // Forward substitution, in place
+    for (column = 0; column < rows; column++) {
+      B[column][rhs] = B[column][rhs] / L[column][column];
+      for (row = column + 1; row < rows; row++)
+        B[row][rhs] -= L[row][column] * B[column][rhs];
+    }
+    // Backward substitution with L*, in place
+    for (column = rows - 1; column >= 0; column--) {
+      B[column][rhs] = B[column][rhs] / L[column][column];
+      for (row = 0; row < column; row++)
+        B[row][rhs] -= conj(L[column][row]) * B[column][rhs];
+    }
+  }
+
+  The row loops are fully unrolled, and the right-hand sides are interleaved
+  in the column loops so that the updates of one right-hand side hide the
+  latency of the updates of the others.
+  Solving for many right-hand sides per matrix therefore comes at almost no
+  extra cost, and is both faster and smaller than computing the inverse of A
+  followed by a matrix-matrix product.
+
+  The input and output matrices are consumed/produced from/to pipes.
+*/
+template <typename T,         // The datatype for the computation
+          bool is_complex,    // True if T is ac_complex<X>
+          int rows,           // Number of rows==columns in the A matrices
+          int rhs_columns,    // Number of right-hand side vectors (columns
+                              // of B and X) to solve for, for each A matrix
+          int pipe_size,      // Number of elements read/write per pipe
+                              // operation to read B and to write X
+          typename LIn,       // L matrix input pipe, receive one element per
+                              // read.
+                              // Only lower-left elements of L are received in
+                              // row order, starting with row 0, as sent by
+                              // StreamingCholesky.
+          typename BIn,       // B matrix input pipe, receive pipe_size
+                              // elements from the pipe with each read.
+                              // B is received in column order.
+          typename XOut       // X matrix output pipe, send pipe_size
+                              // elements to the pipe with each write.
+                              // X is sent in column order.
+          >
+struct StreamingCholeskySolve {
+  void operator()() const {
+    // Functional assertions
+    static_assert(rows >= 4,
+                  "Only matrices of size 4x4 and over are supported");
+    static_assert(rhs_columns >= 1,
+                  "There must be at least one right-hand side to solve for");
+    static_assert(pipe_size >= 1,
+                  "The pipe must be able to contain at least one element");
+
+    // Set the computation type to T or ac_complex<T> depending on the value
+    // of is_complex
+    using TT = std::conditional_t<is_complex, ac_complex<T>, T>;
+
+    // Number of lower-left elements in the L input matrix
+    constexpr int kLMatrixSize = rows * (rows + 1) / 2;
+
+    // Number of pipe reads/writes of pipe_size required for a full column of
+    // B or X
+    constexpr int kExtraIteration = ((rows % pipe_size) != 0) ? 1 : 0;
+    constexpr int kLoopIterPerColumn = (rows / pipe_size) + kExtraIteration;
+    // Number of pipe reads/writes of pipe_size for the whole B or X matrix
+    constexpr int kLoopIter = kLoopIterPerColumn * rhs_columns;
+    // Size in bits of the loop iterator over kLoopIter iterations
+    constexpr int kLoopIterBitSize =
+        fpga_tools::BitsForMaxValue<kLoopIter + 1>();
+
+    // Number of iterations of each of the substitution loops
+    constexpr int kSolveIterations = rows * rhs_columns;
+
+    // Compute the solutions as long as matrices are given as inputs
+    while (1) {
+      // L is stored twice: once in row order to read a full row of L (i.e. a
+      // full column of L*) per cycle in the backward substitution, and once
+      // in column order to read a full column of L per cycle in the forward
+      // substitution.
+      [[intel::private_copies(2)]]  // NO-FORMAT: Attribute
+      TT l_row_major[rows][rows];
+      [[intel::private_copies(2)]]  // NO-FORMAT: Attribute
+      TT l_col_major[rows][rows];
+      [[intel::private_copies(2)]]  // NO-FORMAT: Attribute
+      TT l_diag_recip[rows];
+
+      // Right-hand sides, updated in place into the solutions.
+      // Each right-hand side is read and written as a whole in every
+      // iteration of the substitution loops.
+      [[intel::private_copies(2)]]  // NO-FORMAT: Attribute
+      TT x_matrix[rhs_columns][rows];
+
+      // Receive the L matrix from the pipe
+      int l_row = 0;
+      int l_column = 0;
+      for (int l_idx = 0; l_idx < kLMatrixSize; l_idx++) {
+        TT element = LIn::read();
+
+        l_row_major[l_row][l_column] = element;
+        l_col_major[l_column][l_row] = element;
+
+        // Precompute the reciprocal of the diagonal so that the substitution
+        // loops only contain multiplications
+        if (l_row == l_column) {
+          if constexpr (is_complex) {
+            l_diag_recip[l_row] = {1 / element.r(), 0};
+          } else {
+            l_diag_recip[l_row] = 1 / element;
+          }
+        }
+
+        if (l_column == l_row) {
+          l_row++;
+          l_column = 0;
+        } else {
+          l_column++;
+        }
+      }
+
+      // Receive the B matrix from the pipe
+      [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+      for (ac_int<kLoopIterBitSize, false> li = 0; li < kLoopIter; li++) {
+        fpga_tools::NTuple<TT, pipe_size> pipe_read = BIn::read();
+
+        int write_idx = li % kLoopIterPerColumn;
+
+        fpga_tools::UnrolledLoop<kLoopIterPerColumn>([&](auto k) {
+          fpga_tools::UnrolledLoop<pipe_size>([&](auto t) {
+            if constexpr (k * pipe_size + t < rows) {
+              if (write_idx == k) {
+                x_matrix[li / kLoopIterPerColumn][k * pipe_size + t] =
+                    pipe_read.template get<t>();
+              }
+            }
+
+            // Delay data signals to create a vine-based data distribution
+            // to lower signal fanout.
+            pipe_read.template get<t>() =
+                sycl::ext::intel::fpga_reg(pipe_read.template get<t>());
+          });
+
+          write_idx = sycl::ext::intel::fpga_reg(write_idx);
+        });
+      }
+
+      // Forward substitution: solve LY = B
+      // A given right-hand side is only updated every rhs_columns iterations
+      int column = 0;
+      int rhs = 0;
+      [[intel::ivdep(rhs_columns)]]  // NO-FORMAT: Attribute
+      for (int iteration = 0; iteration < kSolveIterations; iteration++) {
+        TT current[rows];
+        fpga_tools::UnrolledLoop<rows>(
+            [&](auto r) { current[r] = x_matrix[rhs][r]; });
+
+        TT solved = current[column] * l_diag_recip[column];
+
+        fpga_tools::UnrolledLoop<rows>([&](auto r) {
+          TT l_value = l_col_major[column][r];
+          if (r == column) {
+            current[r] = solved;
+          } else if (r > column) {
+            current[r] -= l_value * solved;
+          }
+          x_matrix[rhs][r] = current[r];
+        });
+
+        // Update loop indexes
+        if (rhs == rhs_columns - 1) {
+          rhs = 0;
+          column++;
+        } else {
+          rhs++;
+        }
+      }
+
+      // Backward substitution: solve L*X = Y
+      column = rows - 1;
+      rhs = 0;
+      [[intel::ivdep(rhs_columns)]]  // NO-FORMAT: Attribute
+      for (int iteration = 0; iteration < kSolveIterations; iteration++) {
+        TT current[rows];
+        fpga_tools::UnrolledLoop<rows>(
+            [&](auto r) { current[r] = x_matrix[rhs][r]; });
+
+        TT solved = current[column] * l_diag_recip[column];
+
+        fpga_tools::UnrolledLoop<rows>([&](auto r) {
+          TT l_value = l_row_major[column][r];
+          TT l_star_value;
+          if constexpr (is_complex) {
+            l_star_value = l_value.conj();
+          } else {
+            l_star_value = l_value;
+          }
+          if (r == column) {
+            current[r] = solved;
+          } else if (r < column) {
+            current[r] -= l_star_value * solved;
+          }
+          x_matrix[rhs][r] = current[r];
+        });
+
+        // Update loop indexes
+        if (rhs == rhs_columns - 1) {
+          rhs = 0;
+          column--;
+        } else {
+          rhs++;
+        }
+      }
+
+      // Send the X matrix to the pipe
+      [[intel::initiation_interval(1)]]  // NO-FORMAT: Attribute
+      for (ac_int<kLoopIterBitSize, false> li = 0; li < kLoopIter; li++) {
+        int column_iter = li % kLoopIterPerColumn;
+        bool get[kLoopIterPerColumn];
+        fpga_tools::UnrolledLoop<kLoopIterPerColumn>([&](auto k) {
+          get[k] = column_iter == k;
+          column_iter = sycl::ext::intel::fpga_reg(column_iter);
+        });
+
+        fpga_tools::NTuple<TT, pipe_size> pipe_write;
+        fpga_tools::UnrolledLoop<kLoopIterPerColumn>([&](auto t) {
+          fpga_tools::UnrolledLoop<pipe_size>([&](auto k) {
+            if constexpr (t * pipe_size + k < rows) {
+              pipe_write.template get<k>() =
+                  get[t] ? x_matrix[li / kLoopIterPerColumn]
+                                   [t * pipe_size + k]
+                         : sycl::ext::intel::fpga_reg(
+                               pipe_write.template get<k>());
+            }
+          });
+        });
+        XOut::write(pipe_write);
+      }
+
+    }  // end of while(1)
+  }    // end of operator
+};     // end of struct
+
+}  // namespace fpga_linalg
+
+#endif /* __STREAMING_CHOLESKY_SOLVE_HPP__ */
@@ -13,9 +13,16 @@ namespace fpga_linalg {
  * Repeatedly reads matrix tiles of A and B from input pipes and computes A * B
  * using a systolic array of PEs. Writes result matrix tile of C to output pipe.
  *
+ * The number of columns of A / rows of B can be set at runtime with
+ * "common_size", up to the "common" template parameter. It must be at least
+ * "tile_b", so that a result tile is fully written to the pipe before the
+ * next one is computed (the feeders can pad the tiles with zeros to ensure
+ * this). The kernel exits once the signal to stop reading inputs has been
+ * received and the last result tile has been written to the pipe.
+ *
  */
 template <typename TT,       // Datatype of the elements of the matrix
-          int common,        // Columns of matrix A / rows of matrix B
+          int common,        // (Maximum) columns of matrix A / rows of matrix B
           int tile_a,        // Tile size for matrix A
           int tile_b,        // Tile size for matrix B
           typename PipeA,    // Input pipe for matrix A
@@ -24,7 +31,12 @@ template <typename TT,       // Datatype of the elements of the matrix
           typename PipeDone> // Pipe to receive signal to stop reading inputs
 class StreamingMatmul {
 public:
+  int common_size = common; // Columns of matrix A / rows of matrix B
+
   void operator()() const {
+    static_assert(common >= tile_b,
+                  "The common dimension must be at least as large as tile_b");
+
     // An array of registers to accumulate the dot products which form the
     // output matrix C; one register per PE; initialized to 0 in order to infer
     // the FP accumulator
@@ -43,8 +55,11 @@ public:
     TT results[tile_a][tile_b];
 
     constexpr int kCommonBitSize = fpga_tools::BitsForMaxValue<common + 1>();
+    constexpr int kTileBBitSize = fpga_tools::BitsForMaxValue<tile_b + 1>();
     ac_int<kCommonBitSize, false> counter = 0;
-    bool write_flag = false;
+    ac_int<kCommonBitSize, false> last_counter = common_size - 1;
+    // Number of columns of the results array left to write to the pipe
+    ac_int<kTileBBitSize, false> writes_left = 0;
     bool last_pipe_read = false;
 
     // Compute matrix multiplications as long as matrices are given as inputs
@@ -70,7 +85,10 @@ public:
       fpga_tools::UnrolledLoop<tile_b>([&](auto col) {
         pipe_read_b.template get<col>() = 0;
       });
-      if (!last_pipe_read) {
+      // Once all the inputs have been read, the counter stops so that no more
+      // result tiles are flushed
+      bool pipe_read = !last_pipe_read;
+      if (pipe_read) {
         pipe_read_a = PipeA::read();
         pipe_read_b = PipeB::read();
         last_pipe_read = PipeDone::read();
@@ -88,30 +106,26 @@ public:
                       pipe_read_b.template get<col>() + accum[row][col];
           accum[row][col] = result;
           // Flush matrix to results array if finished computing
-          if (counter == (common - 1)) {
+          if (pipe_read & (counter == last_counter)) {
             results[row][col] = result;
-            write_flag = true;
           }
         });
       });
 
-      if (counter == common - 1) {
-        counter = 0;
-      } else {
-        counter++;
-      }
-
-      // Stop writing while we wait for the next matrix to finish computing
-      // (only necessary if common > tile_b, i.e., when it takes strictly longer
-      // to compute than to write to pipe)
-      if constexpr (common > tile_b) {
-        if ((counter == tile_b) & write_flag) {
-          write_flag = false;
+      if (pipe_read) {
+        if (counter == last_counter) {
+          counter = 0;
+          writes_left = tile_b;
+        } else {
+          counter++;
         }
       }
 
-      // Write the result matrix C from the registers to the output pipe
-      if (write_flag) {
+      // Write the result matrix C from the registers to the output pipe, one
+      // column per iteration; stop writing while we wait for the next matrix
+      // to finish computing (when common_size > tile_b, i.e., when it takes
+      // strictly longer to compute than to write to pipe)
+      if (writes_left != 0) {
         fpga_tools::NTuple<TT, tile_a> pipe_write;
         fpga_tools::UnrolledLoop<tile_a>([&](auto row) {
           pipe_write.template get<row>() = results[row][0];
@@ -120,6 +134,10 @@ public:
           });
         });
         PipeC::write(pipe_write);
+        writes_left--;
+      } else if (last_pipe_read) {
+        // All the results have been written
+        break;
       }
     } // end of while (1)
   }   // end of operator